@@ -0,0 +1,69 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <pthread.h>
+
+/**
+ * @class boundedQueue
+ *
+ * First-in first-out queue of pointers with a fixed capacity that can be used
+ * by several producer and consumer threads. Producers block while the queue is
+ * full, consumers block while it is empty.
+ *
+ * @member items        Ring buffer of capacity elements
+ * @member capacity     Maximum amount of items in the queue
+ * @member head         Index of the oldest item
+ * @member count        Amount of items in the queue
+ * @member closed       Nonzero after close_queue has been called
+ * @member lock         Mutex protecting all other members
+ * @member notEmpty     Signaled when an item is pushed or the queue is closed
+ * @member notFull      Signaled when an item is popped or the queue is closed
+ */
+struct boundedQueue {
+    void** items;
+    unsigned capacity;
+    unsigned head;
+    unsigned count;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+};
+
+/**
+ * Initializes an empty queue.
+ *
+ * @param q         The queue
+ * @param capacity  Maximum amount of items in the queue. Must be at least 1.
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int init_queue(struct boundedQueue* q, unsigned capacity);
+
+/**
+ * Frees the memory of a queue. No thread may use the queue anymore.
+ * Items still in the queue are not freed.
+ */
+void destroy_queue(struct boundedQueue* q);
+
+/**
+ * Appends an item to the queue, waiting while the queue is full.
+ *
+ * @return          1 if the item was appended, 0 if the queue is closed
+ */
+int push_queue(struct boundedQueue* q, void* item);
+
+/**
+ * Removes the oldest item from the queue, waiting while the queue is empty
+ * and not closed.
+ *
+ * @return          The item, or null if the queue is closed and empty
+ */
+void* pop_queue(struct boundedQueue* q);
+
+/**
+ * Closes the queue. Items that are already in the queue can still be popped;
+ * further pushes fail. Wakes up all waiting threads.
+ */
+void close_queue(struct boundedQueue* q);
+
+#endif
@@ -27,30 +27,6 @@ struct cscMatrix {
     uint64_t* colPtr;
 };
 
-/**
- * @class cscMatrixTranspose
- *
- * CSC Matrix for transposing
- *
- * @member rows         Amount of rows
- * @member columns      Amount of columns
- * @member valueCount   Amount of entries in values and rowIndices
- * @member values       Nonzero values in the matrix
- * @member rowIndices   Row index of each value
- * @member colIndices   Column index of each  value
- * @member colPtr       Array that splits values based on which column they are in.
- *                      It has m+1 elements in a n*m matrix by definition.
- */
-struct cscMatrixTranspose {
-    uint64_t rows;
-    uint64_t columns;
-    uint64_t valueCount;
-    float* values;
-    uint64_t* rowIndices;
-    uint64_t* colIndices;
-    uint64_t* colPtr;
-};
-
 /**
  * @class cscRow
  *
@@ -205,14 +181,6 @@ void generate_csc_matr(struct cscMatrix* dest, uint64_t rows, uint64_t columns,
                        float* values);
 
 
-/**
- * Generates a cscMatrixTranspose with the given parameters. Refer to the documentation
- * of struct cscMatrixTranspose for information about the struct members.
- */
-void generateCSCMatrixTranspose(struct cscMatrixTranspose* dest, uint64_t rows, uint64_t columns,
-                       uint64_t valueCount, uint64_t* rowIndices, uint64_t* colIndices, uint64_t* colPtr,
-                       float* values);
-
 /**
  * Calculates the column indices for a given array of column pointers.
  * @param colPtr    The given column pointers
@@ -310,16 +278,92 @@ void print_random_floats(int n, int prob);
  */
 void generate_csc_matr_rand(struct cscMatrix* dest, int minD_inv, int maxD_inv);
 
-void generateCSCMatrixTRand(struct cscMatrixTranspose* dest, int minD_inv,
-        int maxD_inv);    
-
 /**
  * Prints the members of a struct cscMatrix
  *
  * @param m     Matrix to print
  */
 void printCSCMatrixMetadata(struct cscMatrix* m);
-void printCSCMatrixMetadataT(struct cscMatrixTranspose* m);
+
+// Amount of buckets of the histograms of values per column. Bucket i counts
+// the columns with 2^(i-1) to 2^i - 1 values, bucket 0 the empty ones and
+// the last bucket all larger ones.
+#define CSC_HISTOGRAM_BUCKETS 16
+
+/**
+ * @class cscStatistics
+ *
+ * Structure of a CSC matrix, see compute_csc_statistics
+ *
+ * @member rows             Amount of rows
+ * @member columns          Amount of columns
+ * @member valueCount       Amount of nonzero values
+ * @member density          Fraction of nonzero values
+ * @member emptyColumns     Columns without values
+ * @member minColumn        Fewest values in a column
+ * @member maxColumn        Most values in a column
+ * @member meanColumn       Average amount of values per column
+ * @member stddevColumn     Standard deviation of the values per column
+ * @member histogram        Histogram of the values per column, see
+ *                          CSC_HISTOGRAM_BUCKETS
+ * @member lowerBandwidth   Largest i - j of a value in row i and column j
+ * @member upperBandwidth   Largest j - i of a value in row i and column j
+ * @member profile          Sum of j - i over the first value of every column
+ *                          j that lies above the diagonal, the amount of
+ *                          entries of the upper envelope
+ */
+struct cscStatistics {
+    uint64_t rows;
+    uint64_t columns;
+    uint64_t valueCount;
+    double density;
+    uint64_t emptyColumns;
+    uint64_t minColumn;
+    uint64_t maxColumn;
+    double meanColumn;
+    double stddevColumn;
+    uint64_t histogram[CSC_HISTOGRAM_BUCKETS];
+    uint64_t lowerBandwidth;
+    uint64_t upperBandwidth;
+    uint64_t profile;
+};
+
+/**
+ * Returns the bucket of a column with n values in a histogram of values per
+ * column.
+ *
+ * @param n     Amount of values of the column
+ * @return      Index of the bucket, see CSC_HISTOGRAM_BUCKETS
+ */
+unsigned csc_histogram_bucket(uint64_t n);
+
+/**
+ * Computes the structure of a matrix in a single pass over its row indices,
+ * without allocating memory.
+ *
+ * @param m     The matrix
+ * @param s     Struct to store the statistics in
+ */
+void compute_csc_statistics(const struct cscMatrix* m,
+        struct cscStatistics* s);
+
+/**
+ * Prints a histogram of values per column on one line.
+ *
+ * @param name      Name of the matrix
+ * @param hist      The histogram, see CSC_HISTOGRAM_BUCKETS
+ */
+void printCSCColumnHistogram(const char* name, const uint64_t* hist);
+
+/**
+ * Prints the statistics of a matrix. Unlike printCSCMatrixMetadata, the
+ * output does not grow with the size of the matrix.
+ *
+ * @param name  Name of the matrix
+ * @param s     Its statistics
+ */
+void printCSCMatrixStatistics(const char* name,
+        const struct cscStatistics* s);
 
 /**
  * Tests the purity of a vector. A vector is considered pure if it contains no
@@ -355,24 +399,4 @@ int testVectorPurity(float* vector, uint64_t len);
  */
 int is_valid_csc(struct cscMatrix* m);
 
-/**
- * Checks if the metadata in a struct cscMatrixTranspose corresponds to a valid 
- * CSC matrix
- *
- * See the documentation of is_valid_csc for further information about the behavior
- * of this function.
- *
- * @param m     The matrix to test
- * @return      1 if the matrix is valid, 
- *              otherwise,
- *              -1: invalid dimensions
- *              -2: row indices out of range
- *              -3: column indices out of range
- *              -4: zero in value ptr
- *              -5: column indices not sorted
- *              -6: colPtr not sorted
- *              -7: last index of colPtr is not valueCount
- */
-int is_valid_csc_transpose(struct cscMatrixTranspose* m);
-
 #endif
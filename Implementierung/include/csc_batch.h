@@ -0,0 +1,132 @@
+#ifndef CSC_BATCH_H
+#define CSC_BATCH_H
+
+#include <stdint.h>
+
+// Capacity of the queues between the stages of a batch
+#define BATCH_QUEUE_DEPTH 2
+
+// Stages of the pipeline of a batch
+enum batchStage {BATCH_PARSE, BATCH_MULTIPLY, BATCH_WRITE, BATCH_STAGES};
+
+/**
+ * @class batchJob
+ *
+ * A product of a manifest
+ *
+ * @member a        Filename of A
+ * @member b        Filename of B
+ * @member output   Filename of the result, written in the Matrix Market
+ *                  format if it ends in .mtx and in the text format
+ *                  otherwise
+ * @member line     Line of the job in the manifest
+ */
+struct batchJob {
+    char* a;
+    char* b;
+    char* output;
+    unsigned line;
+};
+
+struct cscCache;
+
+/**
+ * @class batchConfig
+ *
+ * Settings shared by all jobs of a batch
+ *
+ * @member version      Kernel, 0 to 2 or VERSION_AUTO to select it for
+ *                      every job
+ * @member threads      Threads of the shared pool used by every stage
+ * @member precision    Significant digits of the text results, see
+ *                      write_csc_text_mt
+ * @member cache        Cache of the inputs, or null
+ * @member modelFile    Cost model of VERSION_AUTO, see load_cost_model, or
+ *                      null for the built-in one
+ */
+struct batchConfig {
+    int version;
+    unsigned threads;
+    unsigned precision;
+    const struct cscCache* cache;
+    const char* modelFile;
+};
+
+/**
+ * @class batchStats
+ *
+ * Totals of a batch
+ *
+ * @member jobs         Amount of jobs, including the failed ones
+ * @member failed       Amount of jobs that failed
+ * @member seconds      Duration of the whole batch
+ * @member busy         Time every stage spent working on jobs, the rest it
+ *                      waited for the neighboring stages
+ * @member inputBytes   Size of the input files
+ * @member outputBytes  Size of the written results
+ * @member inputValues  Nonzero values of the inputs
+ * @member resultValues Nonzero values of the results
+ * @member flops        Floating point operations of the products, see
+ *                      mul_metrics
+ */
+struct batchStats {
+    unsigned jobs;
+    unsigned failed;
+    double seconds;
+    double busy[BATCH_STAGES];
+    uint64_t inputBytes;
+    uint64_t outputBytes;
+    uint64_t inputValues;
+    uint64_t resultValues;
+    uint64_t flops;
+};
+
+/**
+ * Reads a manifest with one job per line: the filenames of A, B and the
+ * result, separated by whitespace. Empty lines and lines starting with #
+ * are skipped. Filenames are relative to the working directory and can not
+ * contain whitespace.
+ *
+ * @param filename  Filename of the manifest
+ * @param jobs      Output parameter for the jobs, stored on the heap. Free
+ *                  with free_batch_jobs.
+ * @param count     Output parameter for the amount of jobs
+ * @return          1 if successful, 0 otherwise. errno is set on failure
+ *                  and an invalid line is reported on stderr.
+ */
+int read_batch_manifest(const char* filename, struct batchJob** jobs,
+        unsigned* count);
+
+/**
+ * Frees the jobs of read_batch_manifest.
+ */
+void free_batch_jobs(struct batchJob* jobs, unsigned count);
+
+/**
+ * Runs jobs through a pipeline of three threads connected by queues of
+ * BATCH_QUEUE_DEPTH jobs: one loads the inputs of the next jobs, one
+ * multiplies, and the calling thread writes the results. The loading and
+ * writing of some jobs thereby overlaps with the multiplication of another,
+ * and at most 2 * BATCH_QUEUE_DEPTH + 3 jobs are held in memory.
+ *
+ * A failed job is reported on stderr and counted in the totals, and the
+ * remaining jobs are run.
+ *
+ * @param jobs      The jobs
+ * @param count     Amount of jobs
+ * @param config    Settings of the jobs
+ * @param stats     Struct to store the totals in
+ * @return          1 if the jobs were run, 0 if the pipeline or the cost model
+ *                  can not be set up. errno is set on failure.
+ */
+int run_batch(const struct batchJob* jobs, unsigned count,
+        const struct batchConfig* config, struct batchStats* stats);
+
+/**
+ * Prints the throughput of a batch and the utilization of its stages.
+ *
+ * @param s     The totals of the batch
+ */
+void print_batch_stats(const struct batchStats* s);
+
+#endif
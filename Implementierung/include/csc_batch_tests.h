@@ -0,0 +1,21 @@
+#ifndef CSC_BATCH_TESTS_H
+#define CSC_BATCH_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Writes two random matrices and a manifest with comments, valid jobs with
+ * text and Matrix Market results and jobs with a missing input and with
+ * mismatched dimensions. Runs the batch with version 0 and with version
+ * auto and compares the results with matr_mult_csc and the totals with the
+ * expected ones. Also checks that a manifest with an invalid line is
+ * rejected.
+ *
+ * @param size      Amount of rows of A
+ * @param density   Density of the matrices
+ * @param threads   Amount of threads of the jobs
+ * @return          1 if the test passed, 0 otherwise
+ */
+int test_csc_batch(uint64_t size, double density, unsigned threads);
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef CSC_BENCH_H
+#define CSC_BENCH_H
+
+#include <stdint.h>
+#include "cs_matrix.h"
+#include "csc_binary.h"
+
+// Size of the buffer written to evict the CPU caches between iterations
+#define CSC_BENCH_FLUSH_BYTES (64 << 20)
+
+/**
+ * @class benchSummary
+ *
+ * Statistics of the samples of one phase of a benchmark in seconds
+ *
+ * @member count    Amount of samples
+ * @member min      Shortest sample
+ * @member median   Median, the mean of the two middle samples for even counts
+ * @member p90      90th percentile (nearest rank)
+ * @member p99      99th percentile (nearest rank)
+ * @member max      Longest sample
+ * @member mean     Arithmetic mean
+ * @member stddev   Sample standard deviation, 0 for a single sample
+ */
+struct benchSummary {
+    unsigned count;
+    double min;
+    double median;
+    double p90;
+    double p99;
+    double max;
+    double mean;
+    double stddev;
+};
+
+/**
+ * @class benchConfig
+ *
+ * Parameters of a benchmark run
+ *
+ * @member warmup       Amount of untimed kernel runs before the samples
+ * @member iterations   Amount of timed kernel runs, at least 1
+ * @member flush        Nonzero to evict the CPU caches before every kernel
+ *                      run, which gives cold-cache timings
+ */
+struct benchConfig {
+    unsigned warmup;
+    unsigned iterations;
+    int flush;
+};
+
+/**
+ * @class mulMetrics
+ *
+ * Work and memory traffic of a multiplication, which do not depend on the
+ * kernel, so kernels can be compared across matrices of different density
+ *
+ * @member products     Multiply-adds, one for every pair of a value A(i, k)
+ *                      and a value B(k, j)
+ * @member flops        Floating point operations, 2 * products
+ * @member valueCount   Amount of nonzero values of the result
+ * @member compression  products / valueCount, the average amount of products
+ *                      summed into a value of the result. 0 for an empty
+ *                      result.
+ * @member bytes        Bytes every kernel has to touch at least: A and B are
+ *                      read and the result is written once, see
+ *                      csc_matrix_bytes
+ */
+struct mulMetrics {
+    uint64_t products;
+    uint64_t flops;
+    uint64_t valueCount;
+    double compression;
+    uint64_t bytes;
+};
+
+/**
+ * @class benchReport
+ *
+ * Result of bench_multiplication
+ *
+ * @member parseTime    Time spent loading both inputs once (cold)
+ * @member load         Timings of the inputs, see load_csc_files
+ * @member kernel       Statistics of the kernel samples
+ * @member writeTime    Time spent writing the result once
+ * @member rows         Amount of rows of the result
+ * @member columns      Amount of columns of the result
+ * @member valueCount   Amount of nonzero values of the result
+ * @member metrics      Metrics of the multiplication, all 0 if an input has
+ *                      no nonzero values
+ */
+struct benchReport {
+    double parseTime;
+    struct loadStats load;
+    struct benchSummary kernel;
+    double writeTime;
+    uint64_t rows;
+    uint64_t columns;
+    uint64_t valueCount;
+    struct mulMetrics metrics;
+};
+
+/**
+ * Computes the statistics of a set of samples.
+ *
+ * @param samples   The samples. They are not modified.
+ * @param count     Amount of samples, at least 1
+ * @param s         Struct to store the statistics in
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int summarize_samples(const double* samples, unsigned count,
+        struct benchSummary* s);
+
+/**
+ * Evicts the CPU caches by writing and reading a buffer of
+ * CSC_BENCH_FLUSH_BYTES bytes. The buffer is allocated on the first call and
+ * kept for later calls, so no page faults are timed by accident.
+ */
+void flush_cpu_caches();
+
+/**
+ * Runs a kernel config->warmup times without timing it and then
+ * config->iterations times, storing the duration of every timed run. logData
+ * is cleared while the kernel runs so progress messages are not timed.
+ *
+ * @param mul       The kernel, usually of quietKernels (see matrix_mul.h)
+ * @param a         The first factor in the layout mul expects
+ * @param b         The second factor
+ * @param config    The benchmark parameters
+ * @param samples   Array of config->iterations durations in seconds
+ * @param result    Matrix to store the product of the last run in. The
+ *                  products of the other runs are freed.
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int bench_kernel(void (*mul)(const void*, const void*, void*),
+        const struct cscMatrix* a, const struct cscMatrix* b,
+        const struct benchConfig* config, double* samples,
+        struct cscMatrix* result);
+
+/**
+ * Benchmarks a multiplication with the inputs parsed only once. Both input
+ * files are loaded (and A transposed if transposeA is set), the kernel is
+ * benchmarked with bench_kernel, and the last product is written to the
+ * output file, in the Matrix Market format if its name ends in .mtx.
+ *
+ * @param mul           The kernel
+ * @param transposeA    Nonzero if mul expects transpose(A)
+ * @param filename_a    Name of the file of A
+ * @param filename_b    Name of the file of B
+ * @param output        Name of the output file
+ * @param precision     Precision of the output values. See format_float.
+ * @param threads       Amount of threads used for loading and writing
+ * @param cache         The input cache, or null. See csc_cache.h.
+ * @param config        The benchmark parameters
+ * @param report        Struct to store the timings in
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int bench_multiplication(void (*mul)(const void*, const void*, void*),
+        int transposeA, const char* filename_a, const char* filename_b,
+        const char* output, int precision, unsigned threads,
+        const struct cscCache* cache, const struct benchConfig* config,
+        struct benchReport* report);
+
+/**
+ * Counts the floating point operations of A*B: one multiplication and one
+ * addition for every pair of a value A(i, k) and a value B(k, j).
+ *
+ * @param a     A, untransposed
+ * @param b     B
+ * @return      The amount of operations
+ */
+uint64_t count_mul_flops(const struct cscMatrix* a, const struct cscMatrix* b);
+
+/**
+ * Computes the size of a matrix in memory: its values, row indices and
+ * column pointers.
+ *
+ * @param m     The matrix
+ * @return      The size in bytes
+ */
+uint64_t csc_matrix_bytes(const struct cscMatrix* m);
+
+/**
+ * Computes the metrics of the multiplication A*B.
+ *
+ * @param a             A, or its transpose if transposedA is set
+ * @param b             B
+ * @param transposedA   Nonzero if a is the transpose of A, as for versions 0
+ *                      and 1
+ * @param result        The product A*B
+ * @param m             Struct to store the metrics in
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int mul_metrics(const struct cscMatrix* a, const struct cscMatrix* b,
+        int transposedA, const struct cscMatrix* result,
+        struct mulMetrics* m);
+
+/**
+ * Prints the rates of a multiplication and its compression ratio.
+ *
+ * @param m         The metrics of the multiplication
+ * @param seconds   Duration of the multiplication
+ */
+void print_mul_metrics(const struct mulMetrics* m, double seconds);
+
+/**
+ * Prints a line with the statistics of a phase, scaled to milliseconds.
+ *
+ * @param phase     Name of the phase
+ * @param s         The statistics
+ */
+void print_bench_summary(const char* phase, const struct benchSummary* s);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef CSC_BENCH_TESTS_H
+#define CSC_BENCH_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Checks the statistics of summarize_samples for fixed sample sets in
+ * shuffled order, including a single sample and an even amount of samples.
+ *
+ * @return          1 if all statistics are correct, 0 otherwise
+ */
+int test_summarize_samples();
+
+/**
+ * Benchmarks all kernels on random matrices with warmup runs and cache
+ * flushes and compares the product of the last run with a plain call of the
+ * kernel.
+ *
+ * @param minSize   The minimum amount of rows and columns of the matrices
+ * @param maxSize   The maximum amount of rows and columns of the matrices
+ * @return          1 if the products are identical and every sample is
+ *                  positive, 0 otherwise
+ */
+int test_bench_kernel(uint64_t minSize, uint64_t maxSize);
+
+/**
+ * Computes the metrics of the product of two random square matrices with A
+ * given directly and as its transpose, and compares them with products
+ * counted pair by pair and with the sizes of the matrices.
+ *
+ * @param size      The amount of rows and columns of the matrices
+ * @return          1 if the metrics are correct, 0 otherwise
+ */
+int test_mul_metrics(uint64_t size);
+
+#endif
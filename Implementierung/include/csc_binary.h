@@ -0,0 +1,251 @@
+#ifndef CSC_BINARY_H
+#define CSC_BINARY_H
+
+#include <stdint.h>
+#include "cs_matrix.h"
+#include "csc_mmap.h"
+
+#define CSC_BINARY_MAGIC "CSCBIN\r\n"
+#define CSC_BINARY_VERSION 1
+#define CSC_BINARY_ALIGNMENT 64
+#define CSC_BINARY_BYTE_ORDER 0x01020304u
+
+// Value types
+#define CSC_BINARY_FLOAT32 1
+
+// Header flags
+#define CSC_BINARY_TRANSPOSED 1u
+
+/**
+ * @class cscBinaryHeader
+ *
+ * Header of a binary CSC file. The header is followed by the arrays colPtr,
+ * rowIndices and values, in this order. Every array starts at an offset that
+ * is a multiple of CSC_BINARY_ALIGNMENT, the gaps are filled with zeros. All
+ * numbers are stored in the byte order of the machine that wrote the file.
+ *
+ * @member magic            CSC_BINARY_MAGIC, without the terminating null
+ * @member version          CSC_BINARY_VERSION
+ * @member byteOrder        CSC_BINARY_BYTE_ORDER in the byte order of the file
+ * @member rows             Amount of rows
+ * @member columns          Amount of columns
+ * @member valueCount       Amount of nonzero values
+ * @member indexWidth       Size of a row index and a column pointer in bytes.
+ *                          Only 8 is supported.
+ * @member valueType        Type of the values. Only CSC_BINARY_FLOAT32 is
+ *                          supported.
+ * @member flags            CSC_BINARY_TRANSPOSED if the file contains the
+ *                          transpose of the matrix (i.e. the matrix in
+ *                          row-major layout)
+ * @member reserved         Always 0
+ * @member colPtrOffset     Offset of colPtr from the start of the file
+ * @member rowIndicesOffset Offset of rowIndices from the start of the file
+ * @member valuesOffset     Offset of values from the start of the file
+ * @member fileSize         Size of the whole file in bytes
+ * @member colPtrChecksum       Checksum of colPtr
+ * @member rowIndicesChecksum   Checksum of rowIndices
+ * @member valuesChecksum       Checksum of values
+ * @member headerChecksum   Checksum of all preceding members of the header
+ */
+struct cscBinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t rows;
+    uint64_t columns;
+    uint64_t valueCount;
+    uint32_t indexWidth;
+    uint32_t valueType;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t colPtrOffset;
+    uint64_t rowIndicesOffset;
+    uint64_t valuesOffset;
+    uint64_t fileSize;
+    uint64_t colPtrChecksum;
+    uint64_t rowIndicesChecksum;
+    uint64_t valuesChecksum;
+    uint64_t headerChecksum;
+};
+
+/**
+ * @class cscFile
+ *
+ * Matrix loaded from a text or binary file. The arrays of a matrix loaded from
+ * a binary file point into the mapping of the file; otherwise they are stored
+ * on the heap and mapping is empty.
+ *
+ * @member matrix       The matrix
+ * @member mapping      Mapping of the binary file the arrays point into
+ * @member transposed   1 if matrix contains the transpose of the file's matrix
+ */
+struct cscFile {
+    struct cscMatrix matrix;
+    struct mappedFile mapping;
+    int transposed;
+};
+
+/**
+ * Computes the checksum used in binary CSC files. The checksum is a
+ * multiplicative hash over 64 bit words; it detects truncated and corrupted
+ * files, but is not cryptographically secure.
+ *
+ * @param data      Data to hash
+ * @param size      Size of data in bytes
+ * @return          The checksum
+ */
+uint64_t csc_checksum(const void* data, uint64_t size);
+
+/**
+ * Writes a matrix to a binary CSC file.
+ *
+ * @param m             Matrix to write
+ * @param transposed    Nonzero if m is the transpose of the matrix the file
+ *                      should represent
+ * @param filename      Name of the file to write
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int write_csc_binary(const struct cscMatrix* m, int transposed,
+        const char* filename);
+
+/**
+ * Checks whether a file starts with CSC_BINARY_MAGIC.
+ *
+ * @param filename      Name of the file to check
+ * @return              1 if the file is a binary CSC file, 0 otherwise
+ *                      (including files that can not be read)
+ */
+int is_csc_binary(const char* filename);
+
+/**
+ * Maps a binary CSC file into memory and points f->matrix at the mapped arrays
+ * without copying them. The header checksum, the array bounds, colPtr and the
+ * row indices are always validated, so the matrix can be handed to the
+ * kernels; the array checksums only if verify is nonzero, since this also
+ * reads the values.
+ *
+ * The mapping is read-only. f must be released with release_csc_file.
+ * If an error occurs, errno is set and f is empty.
+ *
+ * @param filename      Name of the file to map
+ * @param f             Struct to store the matrix and the mapping in
+ * @param verify        Nonzero if the array checksums should be verified
+ * @return              1 if the matrix contains no nonzero values, 0 otherwise
+ */
+int map_csc_binary(const char* filename, struct cscFile* f, int verify);
+
+/**
+ * Reads consecutive columns of a binary CSC file onto the heap with pread,
+ * without reading the rest of the file. The column pointers of the panel
+ * start at 0. The column pointers and row indices of the panel are validated.
+ *
+ * @param fd            File descriptor of the binary file
+ * @param h             Validated header of the file, e.g. of a mapping
+ *                      created with map_csc_binary
+ * @param first         Index of the first column to read
+ * @param count         Amount of columns to read
+ * @param m             Output parameter for the panel, which has the rows of
+ *                      the file's matrix and count columns. Its members must
+ *                      be freed with free_csc_members.
+ * @return              1 if successful, 0 otherwise. errno is set on failure
+ *                      and m is empty.
+ */
+int read_csc_binary_columns(int fd, const struct cscBinaryHeader* h,
+        uint64_t first, uint64_t count, struct cscMatrix* m);
+
+/**
+ * Loads a matrix from a text, binary or Matrix Market file. Binary files are
+ * mapped with map_csc_binary; if the stored orientation differs from the
+ * requested one, the matrix is transposed onto the heap and the file is
+ * unmapped. Text files are parsed with parse_csc_file_mmap, Matrix Market files
+ * with parse_mtx_file.
+ *
+ * If an error occurs, errno is set and f is empty.
+ *
+ * @param filename      Name of the file to load
+ * @param f             Struct to store the matrix in
+ * @param transpose     Nonzero if f->matrix should contain the transpose
+ * @param threads       Amount of threads used for parsing text files
+ * @return              1 if the matrix contains no nonzero values, 0 otherwise
+ */
+int load_csc_file(const char* filename, struct cscFile* f, int transpose,
+        unsigned threads);
+
+/**
+ * @class loadStats
+ *
+ * Durations of the loading phase of load_csc_files
+ *
+ * @member aTime        Seconds spent loading A, including its transposition
+ * @member bTime        Seconds spent loading B
+ * @member concurrent   1 if A and B were loaded on separate threads
+ * @member aCached      1 if A was loaded from the cache
+ * @member bCached      1 if B was loaded from the cache
+ */
+struct loadStats {
+    double aTime;
+    double bTime;
+    int concurrent;
+    int aCached;
+    int bCached;
+};
+
+struct cscCache;
+
+/**
+ * Loads the input matrices of a multiplication, which can be any combination
+ * of text, binary and Matrix Market files.
+ *
+ * A is loaded on a second thread while the calling thread loads B, so the
+ * transposition of A overlaps with the parsing of B. The threads for parsing
+ * text files are split between both files. If one of the files is a pipe,
+ * both are parsed in lockstep by parse_csc_files_mmap instead.
+ *
+ * @param filename_a    Filename of matrix A
+ * @param filename_b    Filename of matrix B
+ * @param a             Struct in which A (or transpose(A)) is stored
+ * @param b             Struct in which B is stored
+ * @param transposeA    Nonzero if transpose(A) should be stored in a
+ * @param threads       Amount of threads used for parsing text files
+ * @param cache         Cache of parsed input files (see csc_cache.h), used
+ *                      unless the files are read in lockstep. May be null.
+ * @param stats         Output parameter for the durations. May be null.
+ * @return              Returns if one of the matrices is only made up of zeros.
+ *                      errno is set if an error occurred.
+ */
+int load_csc_files(const char* filename_a, const char* filename_b,
+        struct cscFile* a, struct cscFile* b, int transposeA, unsigned threads,
+        const struct cscCache* cache, struct loadStats* stats);
+
+/**
+ * Releases a matrix loaded with load_csc_file or map_csc_binary. Mapped files
+ * are unmapped, heap arrays are freed.
+ *
+ * @param f             The matrix to release
+ */
+void release_csc_file(struct cscFile* f);
+
+/**
+ * Converts a matrix file from the text format to the binary format.
+ *
+ * @param input         Name of the text file
+ * @param output        Name of the binary file to write
+ * @param transposed    Nonzero if the transpose of the matrix should be stored,
+ *                      which allows loading it as transpose(A) without a copy
+ * @param threads       Amount of threads used for parsing
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int convert_text_to_binary(const char* input, const char* output,
+        int transposed, unsigned threads);
+
+/**
+ * Converts a binary matrix file to the text format. The array checksums are
+ * verified.
+ *
+ * @param input         Name of the binary file
+ * @param output        Name of the text file to write
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int convert_binary_to_text(const char* input, const char* output);
+
+#endif
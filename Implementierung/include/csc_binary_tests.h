@@ -0,0 +1,44 @@
+#ifndef CSC_BINARY_TESTS_H
+#define CSC_BINARY_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Writes a random matrix to binary files in both orientations and loads each
+ * file as the matrix and as its transpose.
+ *
+ * @param minSize   The minimum amount of rows and columns of the matrix
+ * @param maxSize   The maximum amount of rows and columns of the matrix
+ * @return          1 if all loaded matrices are correct, the arrays are aligned
+ *                  and files in the requested orientation are not copied,
+ *                  0 otherwise
+ */
+int test_binary_roundtrip(uint64_t minSize, uint64_t maxSize);
+
+/**
+ * Corrupts the header, the values and a row index of a binary file.
+ *
+ * @return          1 if the corruptions are detected, 0 otherwise
+ */
+int test_binary_corrupt();
+
+/**
+ * Converts a text file to the binary format and back.
+ *
+ * @return          1 if the matrix is unchanged, 0 otherwise
+ */
+int test_binary_convert();
+
+/**
+ * Loads random matrices A and B from every combination of text, binary and
+ * Matrix Market files with load_csc_files, with A transposed, using the given
+ * amount of threads.
+ *
+ * @param threads   Amount of threads used for parsing
+ * @return          1 if the matrices are loaded correctly on separate threads
+ *                  and a dimension mismatch, a missing input and a directory
+ *                  are reported with EINVAL, ENOENT and EISDIR, 0 otherwise
+ */
+int test_load_csc_files(unsigned threads);
+
+#endif
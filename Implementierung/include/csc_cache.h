@@ -0,0 +1,64 @@
+#ifndef CSC_CACHE_H
+#define CSC_CACHE_H
+
+#include <stdint.h>
+#include "csc_binary.h"
+
+/**
+ * @class cscCache
+ *
+ * Directory of binary CSC files that hold the parsed (or transposed) form of
+ * text and Matrix Market input files. A cache file is named after a 64 bit key
+ * of its input file and orientation; files of the wrong orientation are never
+ * used.
+ *
+ * @member dir          The cache directory. It is created if it is missing.
+ * @member hashContents Nonzero if the key is a hash of the file's contents.
+ *                      Otherwise the key is a hash of the file's absolute
+ *                      path, device, inode, size and modification time,
+ *                      which only needs a stat call.
+ */
+struct cscCache {
+    const char* dir;
+    int hashContents;
+};
+
+/**
+ * Computes the cache key of an input file.
+ *
+ * @param cache         The cache
+ * @param filename      Name of the input file
+ * @param transpose     Nonzero for the key of the file's transpose
+ * @param key           Output parameter for the key
+ * @return              1 if successful, 0 if the file can not be read
+ */
+int csc_cache_key(const struct cscCache* cache, const char* filename,
+        int transpose, uint64_t* key);
+
+/**
+ * Loads a matrix like load_csc_file, using the cache for text and Matrix
+ * Market files. If the cache holds the matrix in the requested orientation,
+ * its binary file is mapped and neither parsing nor transposition is needed.
+ * Otherwise the input is loaded with load_csc_file and stored in the cache;
+ * failing to store it only prints a warning. Binary inputs and files that can
+ * not be mapped are loaded without the cache.
+ *
+ * The cache file is written under a temporary name and renamed, so concurrent
+ * runs never map a partially written file. It is mapped with the checksums
+ * verified; a damaged cache file is replaced by re-parsing the input.
+ *
+ * @param filename      Name of the file to load
+ * @param f             Struct to store the matrix in
+ * @param transpose     Nonzero if f->matrix should contain the transpose
+ * @param threads       Amount of threads used for parsing text files
+ * @param cache         The cache
+ * @param hit           Output parameter, set to 1 if the matrix was loaded
+ *                      from the cache and 0 otherwise. May be null.
+ * @return              1 if the matrix contains no nonzero values, 0 otherwise.
+ *                      errno is set on failure.
+ */
+int load_csc_file_cached(const char* filename, struct cscFile* f,
+        int transpose, unsigned threads, const struct cscCache* cache,
+        int* hit);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef CSC_CACHE_TESTS_H
+#define CSC_CACHE_TESTS_H
+
+/**
+ * Loads a random text file through a cache twice, untransposed and
+ * transposed, and checks that the second load is a cache hit with the same
+ * matrix, and that a damaged cache file is a miss that replaces it. Then
+ * rewrites the file with another matrix and checks that the stale cache file
+ * is not used.
+ *
+ * @param hashContents  Nonzero to key the cache by the file contents
+ * @return              1 if the cache behaves correctly, 0 otherwise
+ */
+int test_csc_cache(int hashContents);
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef CSC_CONTEXT_H
+#define CSC_CONTEXT_H
+
+#include <stddef.h>
+
+struct cscPool;
+
+/*
+ * The context covers the kernels (mul_csc_ctx) and libcscmul, which work on
+ * matrices in memory. The file formats (csc_io.h, csc_mmap.h, csc_binary.h,
+ * csc_mtx.h, csc_writer.h and the modes built on them) keep reporting errors
+ * through errno and printing to stderr, which is safe on several threads at
+ * once: errno is thread-local, and logData is only written while main parses
+ * the options, so the parsers and writers merely read it. The daemon and the
+ * batch pipeline load and write files this way and multiply through a
+ * context.
+ */
+
+/**
+ * Result of the functions that take a context. Unlike errno, which the rest
+ * of the program uses, a status is returned to the caller directly.
+ */
+enum cscStatus {
+    CSC_OK,
+    CSC_INVALID_ARGUMENT,
+    CSC_OUT_OF_MEMORY,
+    CSC_OVERFLOW,
+    CSC_IO_ERROR,
+    CSC_STATUSES
+};
+
+/**
+ * Messages of a context are passed to its log function if their level is at
+ * most the log level of the context.
+ */
+enum cscLogLevel {
+    CSC_LOG_NONE,
+    CSC_LOG_ERROR,
+    CSC_LOG_PROGRESS
+};
+
+/**
+ * @class cscAllocator
+ *
+ * Memory functions of a context. They behave like malloc, realloc and free,
+ * with the user pointer of the allocator as additional argument.
+ *
+ * @member malloc   Allocates size bytes, or returns null
+ * @member realloc  Resizes a block to size bytes, or returns null and keeps
+ *                  the block
+ * @member free     Frees a block, null is ignored
+ * @member user     Passed to every function, e.g. an arena
+ */
+struct cscAllocator {
+    void* (*malloc)(size_t size, void* user);
+    void* (*realloc)(void* p, size_t size, void* user);
+    void (*free)(void* p, void* user);
+    void* user;
+};
+
+/**
+ * @class cscContext
+ *
+ * Everything a call needs besides its arguments, so that calls with
+ * different contexts can run on different threads at the same time. A
+ * context is only read by the functions it is passed to.
+ *
+ * @member logLevel     Most detailed level that is logged, see cscLogLevel
+ * @member log          Receives every logged message, including its line
+ *                      breaks. Must be thread-safe if the context is shared.
+ * @member logUser      Passed to log
+ * @member allocator    Allocates the memory returned to the caller and the
+ *                      memory used during a call. Must be thread-safe if
+ *                      pool has more than one thread.
+ * @member pool         Threads a call may use besides the calling one (see
+ *                      csc_pool.h), or null to run on the calling thread
+ *                      only
+ */
+struct cscContext {
+    int logLevel;
+    void (*log)(int level, const char* message, void* user);
+    void* logUser;
+    struct cscAllocator allocator;
+    struct cscPool* pool;
+};
+
+/**
+ * Initializes a context that logs nothing, allocates with malloc and runs on
+ * the calling thread.
+ *
+ * @param ctx   The context
+ */
+void csc_context_init(struct cscContext* ctx);
+
+/**
+ * Initializes the context of the matrixMul program: progress is logged to
+ * stdout if logData is set, errors are always logged to stderr, memory is
+ * allocated with malloc and the shared pool is used, if it has been started.
+ *
+ * @param ctx   The context
+ */
+void csc_context_from_globals(struct cscContext* ctx);
+
+/**
+ * Returns a description of a status.
+ *
+ * @param status    The status, see cscStatus
+ * @return          A string literal
+ */
+const char* csc_status_string(int status);
+
+/**
+ * Converts a status to the errno value with the same meaning.
+ *
+ * @param status    The status
+ * @return          0 for CSC_OK, an errno value otherwise
+ */
+int csc_status_errno(int status);
+
+/**
+ * Converts an errno value to the status with the same meaning.
+ *
+ * @param err   The errno value
+ * @return      The status, CSC_IO_ERROR for values without an equivalent
+ */
+int csc_errno_status(int err);
+
+/**
+ * Formats a message and passes it to the log function of the context if its
+ * level is logged. Messages are truncated to 1023 characters.
+ *
+ * @param ctx       The context
+ * @param level     Level of the message, see cscLogLevel
+ * @param format    printf format of the message
+ */
+void csc_log(const struct cscContext* ctx, int level, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Allocates memory with the allocator of a context.
+ *
+ * @param ctx   The context
+ * @param size  Amount of bytes
+ * @return      The memory, or null
+ */
+void* csc_malloc(const struct cscContext* ctx, size_t size);
+
+/**
+ * Allocates zeroed memory for an array with the allocator of a context.
+ *
+ * @param ctx   The context
+ * @param n     Amount of elements
+ * @param size  Size of an element
+ * @return      The memory, or null if it can not be allocated or n * size
+ *              overflows
+ */
+void* csc_calloc(const struct cscContext* ctx, size_t n, size_t size);
+
+/**
+ * Resizes memory with the allocator of a context.
+ *
+ * @param ctx   The context
+ * @param p     The memory, or null
+ * @param size  New amount of bytes
+ * @return      The resized memory, or null, in which case p is unchanged
+ */
+void* csc_realloc(const struct cscContext* ctx, void* p, size_t size);
+
+/**
+ * Frees memory with the allocator of a context.
+ *
+ * @param ctx   The context
+ * @param p     The memory, or null
+ */
+void csc_free(const struct cscContext* ctx, void* p);
+
+#endif
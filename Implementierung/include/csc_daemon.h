@@ -0,0 +1,80 @@
+#ifndef CSC_DAEMON_H
+#define CSC_DAEMON_H
+
+#include <stddef.h>
+
+// Maximum length of the name of a resident matrix, including the null
+#define CSC_DAEMON_NAME_LENGTH 64
+
+// Maximum length of a request line, including the line break
+#define CSC_DAEMON_LINE_LENGTH 4096
+
+/*
+ * The daemon (--serve) keeps named matrices in memory and serves requests
+ * over a Unix domain socket, so that repeated products with the same inputs
+ * cost only the kernel. A connection sends any amount of requests, one per
+ * line with the arguments separated by spaces, and receives one line per
+ * request that starts with "ok" or with "error" followed by a message:
+ *
+ *     load <name> <file>           Loads a text, binary or Matrix Market
+ *                                  file. Answers "ok <rows> <columns>
+ *                                  <values>".
+ *     mul <name> <a> <b> [<v>]     Multiplies two resident matrices with
+ *                                  version v (0 to 2 or auto, the default)
+ *                                  and keeps the product under name.
+ *                                  Answers "ok <rows> <columns> <values>
+ *                                  <version> <seconds of the kernel>".
+ *     fetch <name> <file>          Writes a matrix to a binary CSC file.
+ *                                  A file in /dev/shm is shared memory the
+ *                                  client maps with map_csc_binary.
+ *     drop <name>                  Frees a matrix.
+ *     list                         Answers "ok <count>" followed by name,
+ *                                  rows, columns and values of every matrix.
+ *     shutdown                     Stops the daemon once every connection
+ *                                  is closed.
+ *
+ * Loading or computing a matrix under an existing name replaces it. The
+ * transpose of a matrix that versions 0 and 1 need is computed on first use
+ * and kept with the matrix. Requests of different connections run on their
+ * own threads, and loading, transposing and multiplying use the shared
+ * pool (see csc_pool.h).
+ */
+
+/**
+ * Serves requests on a Unix domain socket until a shutdown request is
+ * received or the process receives SIGINT or SIGTERM. The socket file of a
+ * daemon that did not shut down is replaced, but if another file or a running
+ * daemon occupies the path, errno is set to EADDRINUSE. The socket file is
+ * removed on return.
+ *
+ * @param socketPath    Path of the socket
+ * @param threads       Amount of threads to load and multiply with
+ * @param modelFile     Cost model of version auto, see load_cost_model, or
+ *                      null for the built-in one
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int run_daemon(const char* socketPath, unsigned threads,
+        const char* modelFile);
+
+/**
+ * Connects to a daemon.
+ *
+ * @param socketPath    Path of the socket of the daemon
+ * @return              Descriptor of the connection, or -1 with errno set
+ */
+int daemon_connect(const char* socketPath);
+
+/**
+ * Sends a request to a daemon and waits for its answer.
+ *
+ * @param fd        Descriptor of the connection
+ * @param request   The request, without line break
+ * @param response  Buffer for the answer without line break. Longer answers
+ *                  are truncated.
+ * @param size      Size of the buffer, at least 1
+ * @return          1 if the answer starts with "ok", 0 otherwise. If the
+ *                  connection fails, errno is set and response is empty.
+ */
+int daemon_request(int fd, const char* request, char* response, size_t size);
+
+#endif
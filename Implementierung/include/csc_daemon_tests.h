@@ -0,0 +1,21 @@
+#ifndef CSC_DAEMON_TESTS_H
+#define CSC_DAEMON_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Runs the daemon on a thread, loads two random matrices through a
+ * connection, multiplies them with every version, fetches the products and
+ * compares them with matr_mult_csc. Also checks the answers to invalid
+ * requests, that dropped matrices are gone, that a second connection sees
+ * the matrices of the first and that shutdown stops the daemon and removes
+ * its socket. A stale socket file is replaced, while a regular file or the
+ * socket of a running daemon make a second daemon fail.
+ *
+ * @param size      Amount of rows of A
+ * @param density   Density of the matrices
+ * @return          1 if the test passed, 0 otherwise
+ */
+int test_csc_daemon(uint64_t size, double density);
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef CSC_GEN_H
+#define CSC_GEN_H
+
+#include <stdint.h>
+#include "cs_matrix.h"
+
+/**
+ * Structures of generated matrices
+ *
+ * FAMILY_UNIFORM           Every value is nonzero independently with the
+ *                          given density, so the amount of values of a
+ *                          column is binomially distributed
+ * FAMILY_BANDED            A band of consecutive rows around the diagonal is
+ *                          filled, its width is density * rows
+ * FAMILY_BLOCK_DIAGONAL    Uniform blocks on the diagonal, a quarter full
+ * FAMILY_POWER_LAW         The amount of values per column follows a Pareto
+ *                          distribution with shape 2, so a few columns hold
+ *                          a large share of the values
+ * FAMILY_RMAT              Recursive matrix with RMAT_DEFAULT_PARAMS, see
+ *                          generate_rmat, which gives power-law rows and
+ *                          columns
+ */
+enum matrixFamily {
+    FAMILY_UNIFORM,
+    FAMILY_BANDED,
+    FAMILY_BLOCK_DIAGONAL,
+    FAMILY_POWER_LAW,
+    FAMILY_RMAT,
+    FAMILY_COUNT
+};
+
+// Names of the families, indexed by enum matrixFamily
+extern const char* const familyNames[FAMILY_COUNT];
+
+// Amount of edges of an R-MAT matrix drawn from the same stream of random
+// numbers. The edges do not depend on the amount of threads.
+#define RMAT_BLOCK_EDGES (1 << 16)
+
+// Quadrant probabilities of the Graph500 benchmark
+#define RMAT_DEFAULT_PARAMS {0.57, 0.19, 0.19, 0.05}
+
+/**
+ * @class rmatParams
+ *
+ * Probabilities of the quadrants of an R-MAT matrix. At every level of the
+ * recursion an edge falls into the top left (a), top right (b), bottom left
+ * (c) or bottom right (d) quadrant. a > d gives power-law degrees, and the
+ * larger a is compared to b and c, the more skewed they are.
+ *
+ * @member a    Probability of the top left quadrant
+ * @member b    Probability of the top right quadrant
+ * @member c    Probability of the bottom left quadrant
+ * @member d    Probability of the bottom right quadrant
+ */
+struct rmatParams {
+    double a;
+    double b;
+    double c;
+    double d;
+};
+
+/**
+ * Looks up a family by its name.
+ *
+ * @param name  Name of the family, see familyNames
+ * @return      The family, or -1 if there is no family with that name
+ */
+int parse_family(const char* name);
+
+/**
+ * Generates a random matrix of a family. The work is proportional to the
+ * amount of generated values, not to rows * columns. Every column draws from
+ * its own stream of random numbers, so the columns are generated in parallel
+ * and the result only depends on the seed, not on the amount of threads,
+ * which makes it reproducible across runs and machines. The values
+ * are integers from 1 to 8, so products of generated matrices are exact in
+ * single precision as long as no sum exceeds 2^24, regardless of the order
+ * in which a kernel adds the products.
+ *
+ * @param m         Matrix to store the result in
+ * @param family    The family, see enum matrixFamily
+ * @param rows      Amount of rows
+ * @param columns   Amount of columns
+ * @param density   Expected fraction of nonzero values, from 0 to 1
+ * @param seed      Seed of the random numbers
+ * @param threads   Amount of threads to use, at least 1
+ * @return          1 if successful, 0 otherwise. errno is set on failure and
+ *                  the pointer members of m are null.
+ */
+int generate_family(struct cscMatrix* m, int family, uint64_t rows,
+        uint64_t columns, double density, uint64_t seed, unsigned threads);
+
+/**
+ * Generates a recursive matrix (R-MAT, a stochastic Kronecker graph). Every
+ * edge is placed by choosing one of four quadrants with the probabilities p
+ * for every bit of its row and column in a 2^scale by 2^scale matrix, where
+ * 2^scale is the smallest power of two covering rows and columns. Edges
+ * outside of the matrix are drawn again up to 64 times before they are
+ * dropped, and repeated edges are stored once, so the matrix can have fewer
+ * than edges values. The Graph500 graph of scale s and edge factor f is
+ * generate_rmat(m, 1 << s, 1 << s, f << s, &p, seed, threads).
+ *
+ * The edges are drawn in parallel in blocks of RMAT_BLOCK_EDGES, each from
+ * its own stream, then sorted by column with a counting sort, and the rows of
+ * the columns are sorted and deduplicated in parallel. The result only
+ * depends on the seed, not on the amount of threads. The values are integers
+ * from 1 to 8 like those of generate_family.
+ *
+ * @param m         Matrix to store the result in
+ * @param rows      Amount of rows
+ * @param columns   Amount of columns
+ * @param edges     Amount of edges to draw
+ * @param p         The quadrant probabilities. Their sum must be 1.
+ * @param seed      Seed of the random numbers
+ * @param threads   Amount of threads to use, at least 1
+ * @return          1 if successful, 0 otherwise. errno is set on failure and
+ *                  the pointer members of m are null.
+ */
+int generate_rmat(struct cscMatrix* m, uint64_t rows, uint64_t columns,
+        uint64_t edges, const struct rmatParams* p, uint64_t seed,
+        unsigned threads);
+
+/**
+ * Generates the random input matrices A (rows by inner) and B (inner by
+ * columns) with generate_family and writes them to files. B is generated
+ * with the seed seed + 1. Files ending in .bin are written in the binary
+ * format, files ending in .mtx in the Matrix Market format and all others in
+ * the text format.
+ *
+ * @param family    The family, see enum matrixFamily
+ * @param rows      Amount of rows of A
+ * @param inner     Amount of columns of A and rows of B
+ * @param columns   Amount of columns of B
+ * @param density   Expected fraction of nonzero values. For FAMILY_RMAT, the
+ *                  amount of drawn edges is density * rows * columns.
+ * @param rmat      Quadrant probabilities for FAMILY_RMAT, or null for
+ *                  RMAT_DEFAULT_PARAMS
+ * @param seed      Seed of the random numbers
+ * @param threads   Amount of threads used for generating and writing
+ * @param filenameA Name of the file of A
+ * @param filenameB Name of the file of B
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int generate_input_files(int family, uint64_t rows, uint64_t inner,
+        uint64_t columns, double density, const struct rmatParams* rmat,
+        uint64_t seed, unsigned threads, const char* filenameA,
+        const char* filenameB);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef CSC_GEN_TESTS_H
+#define CSC_GEN_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Generates a matrix of every family twice with the same seed, with one and
+ * with three threads, and checks that both are identical, valid, have strictly ascending rows in every column and
+ * values from 1 to 8, and that uniform matrices come close to the density
+ * and to the binomial variance of the amount of values per column.
+ *
+ * @param rows      Amount of rows
+ * @param columns   Amount of columns
+ * @param density   Density of the matrices
+ * @return          1 if all matrices are correct, 0 otherwise
+ */
+int test_generate_family(uint64_t rows, uint64_t columns, double density);
+
+/**
+ * Generates an R-MAT matrix with one and with four threads and checks that
+ * both are identical and valid, that repeated edges were removed and that
+ * the degrees of the columns are skewed. Also generates a non-square matrix
+ * and checks that invalid probabilities are rejected.
+ *
+ * @param scale         The matrix is 2^scale by 2^scale
+ * @param edgeFactor    Amount of drawn edges per row
+ * @return              1 if all matrices are correct, 0 otherwise
+ */
+int test_generate_rmat(unsigned scale, unsigned edgeFactor);
+
+#endif
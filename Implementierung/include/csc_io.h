@@ -6,10 +6,41 @@
 #include <stdio.h>
 #include "cs_matrix.h"
 
+// Values of the options without a short form
+#define OPT_TO_BINARY 256
+#define OPT_TO_TEXT 257
+#define OPT_TRANSPOSED 258
+#define OPT_CACHE 259
+#define OPT_CACHE_HASH 260
+#define OPT_BENCH 261
+#define OPT_WARMUP 262
+#define OPT_FLUSH_CACHE 263
+#define OPT_SEED 264
+#define OPT_DIMS 265
+#define OPT_DENSITY 266
+#define OPT_FAMILY 267
+#define OPT_RMAT 268
+#define OPT_SCALE 269
+#define OPT_EDGE_FACTOR 270
+#define OPT_GEN_BINARY 271
+#define OPT_TRACE 272
+#define OPT_CALIBRATE 273
+#define OPT_MODEL 274
+#define OPT_PIN 275
+#define OPT_SERVE 276
+#define OPT_SEND 277
+#define OPT_BATCH 278
+
 extern const char* usage_msg;
 
 extern const char* help_msg;
 
+extern const char* bench_help_msg;
+
+extern const char* generate_help_msg;
+
+extern const char* daemon_help_msg;
+
 extern const char* shortopts;
 
 extern const struct option longopts[];
@@ -22,7 +53,8 @@ extern const struct option longopts[];
 void print_usage(const char* progname);
 
 /**
- * Prints content of usage_msg and help_msg.
+ * Prints content of usage_msg, help_msg, bench_help_msg, generate_help_msg
+ * and daemon_help_msg.
  *
  * @param progname          Name of the program. 
  */
@@ -36,11 +68,12 @@ void print_help(const char* progname);
 void free_csc_matrix(struct cscMatrix* matrix);
 
 /**
- * Frees the memory allocated for the matrix and its pointer members.
+ * Frees the pointer members of the matrix and sets them to null. The matrix
+ * itself is not freed.
  *
- * @param matrix          CSCTransposeMatrix to be freed
+ * @param matrix          CSCMatrix whose members are to be freed
  */
-void free_transpose_matrix(struct cscMatrixTranspose* matrix);
+void free_csc_members(struct cscMatrix* matrix);
 
 /**
  * Converts a char into int
@@ -59,30 +92,29 @@ int convert_int(char* c, int* i);
 int convert_unsigned(char* c, unsigned int* ui);
 
 /**
- * Calculates the column indices from a csc Matrix.
- *
- * @param matrix         Matrix from which the indexes are to be calculated.
- */
-void get_col_indices(struct cscMatrixTranspose* matrix, uint64_t* coolIndex);
-
-
-/**
- * Parses file into cscMatrix struct
+ * Parses the files into two cscMatrix structs without transposing A. Both
+ * files are read line by line in lockstep, which also works for pipes. A is
+ * transposed by parse_csc_files_mmap and load_csc_files.
  *
  * @param filename_a         Filename of a Matrix. 
  * @param filename_b         Filename of a Matrix. 
  * @param matrixA            Matrix in which the values of the documents to be saved.
  * @param matrixB            Matrix in which the values of the documents to be saved.
+ * @param threads            Amount of threads. With more than one thread, the
+ *                           files are parsed with the parallel chunked parser
+ *                           of parse_csc_files_mmap.
  * @return                   Returns if one of the matrices is only made up of zeros.
+ *                           On failure errno is set and only the members
+ *                           of the matrices are freed, so they can live on
+ *                           the stack.
  */
-int parse_csc_file(const char* filename_a, const char* filename_b, 
-        struct cscMatrixTranspose* matrixA, struct cscMatrix* matrixB);
-
-int parse_csc_file_V2(const char* filename_a, const char* filename_b, 
-        struct cscMatrix* matrixA, struct cscMatrix* matrixB);
+int parse_csc_file_V2(const char* filename_a, const char* filename_b,
+        struct cscMatrix* matrixA, struct cscMatrix* matrixB,
+        unsigned threads);
 
 /**
- * Parses result into the output file.
+ * Parses result into the output file. The values are written with their
+ * shortest round-trip representation, see write_csc_text.
  *
  * @param result_matrix       Result of the multiplication. Passed as const cscMatrix*.  
  * @param output_file         Filename of the output file. Passed as const char*.  
@@ -9,4 +9,6 @@ int test_result_to_file_fixed();
 
 int test_result_to_file_random(uint64_t maxSize, uint64_t minSize);
 
+int test_parse_csc_file_mmap_transposed();
+
 #endif
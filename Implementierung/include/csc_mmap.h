@@ -0,0 +1,153 @@
+#ifndef CSC_MMAP_H
+#define CSC_MMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cs_matrix.h"
+
+/**
+ * @class mappedFile
+ *
+ * Read-only memory mapping of a whole file
+ *
+ * @member data     First byte of the file
+ * @member size     Size of the file in bytes
+ */
+struct mappedFile {
+    const char* data;
+    size_t size;
+};
+
+/**
+ * Maps a regular file read-only into memory.
+ *
+ * @param filename  Name of the file to map
+ * @param file      Struct to store the mapping in
+ * @return          1 if successful, 0 otherwise. errno is set to EISDIR for
+ *                  a directory, to ENODEV if the file is not a regular file
+ *                  otherwise (e.g. a pipe), and to EINVAL if it is empty.
+ */
+int map_file(const char* filename, struct mappedFile* file);
+
+/**
+ * Checks whether a file can be memory mapped, i.e. whether it is a regular
+ * file. Files that do not exist and directories count as mappable, so that
+ * map_file reports them with ENOENT (or the error of stat) and EISDIR instead
+ * of the stream parser failing on them.
+ *
+ * @param filename  Name of the file to check
+ * @return          1 if the file can be mapped, 0 otherwise
+ */
+int is_mappable(const char* filename);
+
+/**
+ * Unmaps a file mapped with map_file.
+ *
+ * @param file      The mapping to release
+ */
+void unmap_file(struct mappedFile* file);
+
+/**
+ * Compares the contents of two regular files by mapping them.
+ *
+ * @param a     Name of the first file
+ * @param b     Name of the second file
+ * @return      1 if both files can be mapped and are equal, 0 otherwise
+ */
+int cmp_files(const char* a, const char* b);
+
+/**
+ * Scans an unsigned decimal integer.
+ *
+ * @param p         First character of the number
+ * @param end       End of the buffer (exclusive)
+ * @param out       Output parameter for the number
+ * @return          Pointer to the first character after the number, or null
+ *                  if there is no number at p or it overflows uint64_t
+ */
+const char* scan_uint64(const char* p, const char* end, uint64_t* out);
+
+/**
+ * Scans a decimal floating point number in the formats written by printf's
+ * %g, %f and %e conversions. The conversion ignores the locale.
+ *
+ * Numbers with up to 7 significant digits and small exponents are converted
+ * with a single correctly rounded float division. Longer numbers go through a
+ * double and are correct to within one ulp; inf, nan and numbers outside of the
+ * exactly representable range fall back to strtof.
+ *
+ * @param p         First character of the number
+ * @param end       End of the buffer (exclusive)
+ * @param out       Output parameter for the number
+ * @return          Pointer to the first character after the number, or null
+ *                  if there is no number at p
+ */
+const char* scan_float(const char* p, const char* end, float* out);
+
+/**
+ * Parses a matrix file into a struct cscMatrix from a memory mapping of the
+ * file. Every line is scanned exactly once and the numbers are written
+ * straight into the matrix arrays.
+ *
+ * If an error occurs, errno is set and the pointer members of m are null.
+ *
+ * @param filename  Name of the file to parse
+ * @param m         Matrix to store the result in
+ * @return          1 if the matrix contains no nonzero values, 0 otherwise
+ */
+int parse_csc_mmap(const char* filename, struct cscMatrix* m);
+
+/**
+ * Parses a matrix file directly into its transpose (i.e. the matrix in
+ * row-major layout, stored as a struct cscMatrix) from a memory mapping of the
+ * file. The row indices are scanned twice: once to count the entries of every
+ * row and once to scatter the entries.
+ *
+ * If an error occurs, errno is set and the pointer members of m_t are null.
+ *
+ * @param filename  Name of the file to parse
+ * @param m_t       Matrix to store the transposed matrix in
+ * @return          1 if the matrix contains no nonzero values, 0 otherwise
+ */
+int parse_csc_mmap_transposed(const char* filename, struct cscMatrix* m_t);
+
+/**
+ * Parses a single matrix file with the mmap parser, using the chunked parallel
+ * parser if threads is greater than one.
+ *
+ * If an error occurs, errno is set and the pointer members of m are null.
+ *
+ * @param filename  Name of the file to parse
+ * @param m         Matrix to store the result in
+ * @param transpose Nonzero if the transpose of the matrix should be stored
+ * @param threads   Amount of threads used for parsing each line
+ * @return          1 if the matrix contains no nonzero values, 0 otherwise
+ */
+int parse_csc_file_mmap(const char* filename, struct cscMatrix* m,
+        int transpose, unsigned threads);
+
+/**
+ * Parses the input matrices of a multiplication with the mmap parser.
+ * Files that can not be mapped (pipes, character devices) are parsed with
+ * parse_csc_file_V2 instead, and A is then transposed with transpose_csc.
+ *
+ * With more than one thread, every line is split at comma boundaries into one
+ * chunk per thread. The threads count the tokens of their chunks, the chunk
+ * offsets are computed with a prefix sum, and every thread then parses its
+ * chunk into its part of the matrix array. transpose(A) is then computed with
+ * transpose_csc.
+ *
+ * @param filename_a    Filename of matrix A
+ * @param filename_b    Filename of matrix B
+ * @param matrixA       Matrix in which A (or transpose(A)) is stored
+ * @param matrixB       Matrix in which B is stored
+ * @param transposeA    Nonzero if transpose(A) should be stored in matrixA
+ * @param threads       Amount of threads used for parsing each line
+ * @return              Returns if one of the matrices is only made up of zeros.
+ *                      errno is set if an error occurred.
+ */
+int parse_csc_files_mmap(const char* filename_a, const char* filename_b,
+        struct cscMatrix* matrixA, struct cscMatrix* matrixB, int transposeA,
+        unsigned threads);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef CSC_MMAP_TESTS_H
+#define CSC_MMAP_TESTS_H
+
+#include <stdint.h>
+
+int test_scan_float_fixed();
+
+int test_scan_float_rand(unsigned n);
+
+int test_parse_mmap_fixed();
+
+/**
+ * Writes a random matrix to a file and parses it with both parse_csc_file_V2
+ * and the mmap parser. Prints the throughput of both parsers in MB/s.
+ *
+ * @param minSize   The minimum amount of rows and columns of the matrix
+ * @param maxSize   The maximum amount of rows and columns of the matrix
+ * @return          1 if both parsers return equal matrices, 0 otherwise
+ */
+int test_parse_mmap_throughput(uint64_t minSize, uint64_t maxSize);
+
+/**
+ * Parses a random matrix with parse_csc_file_V2 and parse_csc_files_mmap
+ * using several threads.
+ *
+ * @return          1 if all parsers return the written matrix, 0 otherwise
+ */
+int test_parse_mmap_threads(uint64_t minSize, uint64_t maxSize, unsigned threads);
+
+/**
+ * Parses a malformed and a valid matrix A from a FIFO with
+ * parse_csc_files_mmap, which reads inputs that can not be mapped in lockstep.
+ *
+ * @return          1 if the malformed matrix fails with EINVAL and leaves no
+ *                  members behind and the valid one is parsed, 0 otherwise
+ */
+int test_parse_mmap_pipe();
+
+#endif
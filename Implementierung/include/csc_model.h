@@ -0,0 +1,280 @@
+#ifndef CSC_MODEL_H
+#define CSC_MODEL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "cs_matrix.h"
+#include "csc_cache.h"
+
+// Value of the version that selects the kernel with the cost model (-V auto)
+#define VERSION_AUTO -1
+
+// Amount of kernels the cost model chooses from, versions 0 to
+// MODEL_KERNELS - 1
+#define MODEL_KERNELS 3
+
+// Amount of terms of the cost of a kernel, see mulFeatures
+#define MODEL_TERMS 5
+
+// Amount of buckets of the histograms of values per column
+#define MODEL_BUCKETS CSC_HISTOGRAM_BUCKETS
+
+// File the cost model is read from and written to by default
+#define CSC_MODEL_FILE "cost_model.txt"
+
+// The kernels, indexed by version
+extern void (*const modelKernels[MODEL_KERNELS])(const void*, const void*,
+        void*);
+
+/**
+ * @class mulFeatures
+ *
+ * Features of a multiplication A*B that can be computed in time linear in
+ * the amount of values, without multiplying
+ *
+ * @member rows             Amount of rows of A
+ * @member inner            Amount of columns of A and rows of B
+ * @member columns          Amount of columns of B
+ * @member valuesA          Nonzero values of A
+ * @member valuesB          Nonzero values of B
+ * @member densityA         Fraction of nonzero values of A
+ * @member densityB         Fraction of nonzero values of B
+ * @member histA            Histogram of the values per column of A, see
+ *                          MODEL_BUCKETS
+ * @member histB            Histogram of the values per column of B
+ * @member maxColumnA       Largest amount of values in a column of A
+ * @member maxColumnB       Largest amount of values in a column of B
+ * @member nonEmptyB        Columns of B with at least one value
+ * @member products         Multiply-adds, see mulMetrics
+ * @member estimatedValues  Expected nonzero values of the result if the
+ *                          rows of every column of A were random
+ * @member estimatedDensity estimatedValues / (rows * columns)
+ * @member maxValues        Upper bound of the nonzero values of the result:
+ *                          a column has at most as many as it has products,
+ *                          and at most rows
+ * @member terms            Terms of the cost model:
+ *                          0: 1, the fixed cost of a call
+ *                          1: nonEmptyB * rows, pairs of a row of A and a
+ *                             column of B visited by the kernels
+ *                          2: nonEmptyB * valuesA + valuesB * rows, steps of
+ *                             the sparse dot products of all pairs
+ *                          3: estimatedValues, values stored in the result
+ *                          4: nonEmptyB * rows * (inner + valuesA / 2),
+ *                             steps of extracting every row of A for every
+ *                             column of B (version 2)
+ */
+struct mulFeatures {
+    uint64_t rows;
+    uint64_t inner;
+    uint64_t columns;
+    uint64_t valuesA;
+    uint64_t valuesB;
+    double densityA;
+    double densityB;
+    uint64_t histA[MODEL_BUCKETS];
+    uint64_t histB[MODEL_BUCKETS];
+    uint64_t maxColumnA;
+    uint64_t maxColumnB;
+    uint64_t nonEmptyB;
+    uint64_t products;
+    double estimatedValues;
+    double estimatedDensity;
+    uint64_t maxValues;
+    double terms[MODEL_TERMS];
+};
+
+/**
+ * @class costModel
+ *
+ * Linear model of the duration of every kernel: the predicted seconds of
+ * version v are the sum of coef[v][i] * terms[i] of the features
+ *
+ * @member coef         Seconds per unit of every term, for every kernel
+ * @member calibrated   1 if the model was fitted on this machine, 0 for the
+ *                      built-in defaults
+ */
+struct costModel {
+    double coef[MODEL_KERNELS][MODEL_TERMS];
+    int calibrated;
+};
+
+/**
+ * @class kernelChoice
+ *
+ * Decision of choose_kernel and select_kernel
+ *
+ * @member version      The kernel with the lowest predicted duration
+ * @member predicted    Predicted seconds of every kernel
+ * @member features     Features of the inputs
+ */
+struct kernelChoice {
+    int version;
+    double predicted[MODEL_KERNELS];
+    struct mulFeatures features;
+};
+
+/**
+ * @class mulPlan
+ *
+ * Memory and time requirements of a multiplication, see plan_multiplication
+ *
+ * @member inputBytes       Bytes of A and B, see csc_matrix_bytes
+ * @member transposeBytes   Additional bytes of the transpose of A, which
+ *                          versions 0 and 1 multiply with
+ * @member resultBytes      Expected bytes of the result after the kernel has
+ *                          shrunk it to its values
+ * @member peakBytes        Expected bytes the kernel allocates for the result
+ *                          at most: it starts with max(rows, columns) values
+ *                          and doubles until they fit
+ * @member maxResultBytes   resultBytes with maxValues instead of the expected
+ *                          amount of values
+ * @member predicted        Predicted seconds of every kernel
+ * @member version          The kernel with the lowest predicted duration
+ */
+struct mulPlan {
+    uint64_t inputBytes;
+    uint64_t transposeBytes;
+    uint64_t resultBytes;
+    uint64_t peakBytes;
+    uint64_t maxResultBytes;
+    double predicted[MODEL_KERNELS];
+    int version;
+};
+
+/**
+ * Sets the built-in coefficients, which were fitted on a typical x86-64
+ * machine.
+ *
+ * @param m     The model
+ */
+void default_cost_model(struct costModel* m);
+
+/**
+ * Reads a model written by save_cost_model. If the file does not exist, the
+ * built-in model is used.
+ *
+ * @param filename  Name of the file
+ * @param m         The model
+ * @return          1 if successful, 0 if the file can not be read or is not a
+ *                  model. errno is set on failure.
+ */
+int load_cost_model(const char* filename, struct costModel* m);
+
+/**
+ * Reads a model like load_cost_model, but without printing anything. A file
+ * that is not a model is only reported through errno (EINVAL).
+ *
+ * @param filename  Name of the file
+ * @param m         The model
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int read_cost_model(const char* filename, struct costModel* m);
+
+/**
+ * Writes a model to a text file.
+ *
+ * @param filename  Name of the file
+ * @param m         The model
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int save_cost_model(const char* filename, const struct costModel* m);
+
+/**
+ * Computes the features of A*B.
+ *
+ * @param a             A, or its transpose if transposedA is set
+ * @param b             B
+ * @param transposedA   Nonzero if a is the transpose of A
+ * @param f             Struct to store the features in
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int compute_features(const struct cscMatrix* a, const struct cscMatrix* b,
+        int transposedA, struct mulFeatures* f);
+
+/**
+ * Predicts the duration of a kernel.
+ *
+ * @param m         The model
+ * @param version   The kernel
+ * @param f         Features of the inputs
+ * @return          Predicted seconds
+ */
+double predict_cost(const struct costModel* m, int version,
+        const struct mulFeatures* f);
+
+/**
+ * Computes the features of loaded inputs and chooses the kernel with the
+ * lowest predicted duration.
+ *
+ * @param a             Matrix A, or its transpose
+ * @param b             Matrix B
+ * @param transposedA   Nonzero if a holds the transpose of A
+ * @param m             The model
+ * @param choice        Struct to store the decision in
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int choose_kernel(const struct cscMatrix* a, const struct cscMatrix* b,
+        int transposedA, const struct costModel* m,
+        struct kernelChoice* choice);
+
+/**
+ * Loads the input files with A transposed and chooses the kernel with
+ * choose_kernel. The files are read a second time when they are multiplied,
+ * so they must not be pipes.
+ *
+ * @param filename_a    Name of the file of A
+ * @param filename_b    Name of the file of B
+ * @param threads       Amount of threads used for loading
+ * @param cache         The input cache, or null. See csc_cache.h.
+ * @param m             The model
+ * @param choice        Struct to store the decision in
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int select_kernel(const char* filename_a, const char* filename_b,
+        unsigned threads, const struct cscCache* cache,
+        const struct costModel* m, struct kernelChoice* choice);
+
+/**
+ * Estimates the memory and time requirements of A*B from its features.
+ *
+ * @param f     Features of the inputs
+ * @param m     The model
+ * @param plan  Struct to store the requirements in
+ */
+void plan_multiplication(const struct mulFeatures* f,
+        const struct costModel* m, struct mulPlan* plan);
+
+/**
+ * Prints the flops, the expected size of the result and the requirements of
+ * every kernel.
+ *
+ * @param f     Features of the inputs
+ * @param plan  Their requirements
+ */
+void print_mul_plan(const struct mulFeatures* f, const struct mulPlan* plan);
+
+/**
+ * Prints the decision, the predicted duration of every kernel and, if
+ * verbose is set, the features.
+ *
+ * @param choice    The decision
+ * @param m         The model it was made with
+ * @param verbose   Nonzero to print the features as well
+ */
+void print_kernel_choice(const struct kernelChoice* choice,
+        const struct costModel* m, int verbose);
+
+/**
+ * Fits the model on this machine. Every kernel is timed on generated
+ * uniform and power-law matrices of several sizes and densities, skipping
+ * runs the built-in model predicts to take longer than half a second, and the
+ * coefficients are fitted with non-negative least squares on the relative
+ * error.
+ *
+ * @param m         The model
+ * @param log       Stream to print every measurement to, or null
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int calibrate_cost_model(struct costModel* m, FILE* log);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef CSC_MODEL_TESTS_H
+#define CSC_MODEL_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Computes the features of the product of two random matrices with A given
+ * directly and as its transpose and compares them with each other, with the
+ * metrics of the product and with its actual amount of values, which the
+ * estimate must come close to. Also checks that a saved model is read back
+ * unchanged, that the built-in model never selects version 2 for these
+ * matrices and that the planned memory is consistent with the matrices.
+ *
+ * @param size      Amount of rows and columns of the matrices
+ * @param density   Density of the matrices
+ * @return          1 if the features and the model are correct, 0 otherwise
+ */
+int test_cost_model(uint64_t size, double density);
+
+/**
+ * Computes the statistics of a small matrix and of a matrix without columns
+ * and compares them with their known values.
+ *
+ * @return  1 if the statistics are correct, 0 otherwise
+ */
+int test_csc_statistics();
+
+#endif
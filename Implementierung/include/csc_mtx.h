@@ -0,0 +1,75 @@
+#ifndef CSC_MTX_H
+#define CSC_MTX_H
+
+#include <stdint.h>
+#include "cs_matrix.h"
+
+// First token of a Matrix Market file
+#define MTX_BANNER "%%MatrixMarket"
+
+/**
+ * Checks whether a file starts with MTX_BANNER.
+ *
+ * @param filename  Name of the file to check
+ * @return          1 if the file is a Matrix Market file, 0 otherwise
+ *                  (including files that can not be mapped)
+ */
+int is_mtx_file(const char* filename);
+
+/**
+ * Parses a Matrix Market file in coordinate format into a struct cscMatrix.
+ * The fields real, integer and pattern (every value is 1) and the symmetries
+ * general, symmetric and skew-symmetric are supported; the missing triangle
+ * of symmetric matrices is filled in.
+ *
+ * The entries are parsed in chunks of lines, one per thread, and converted to
+ * CSC with two stable counting sorts, by row and then by column, so the row
+ * indices of every column end up sorted. Each thread counts and scatters the
+ * entries of its own chunk. Duplicate entries are summed, and explicit zeros
+ * are dropped since the matrix formats only store nonzero values.
+ *
+ * If an error occurs, errno is set and the pointer members of m are null.
+ *
+ * @param filename  Name of the file to parse
+ * @param m         Matrix to store the result in
+ * @param transpose Nonzero if the transpose of the matrix should be stored.
+ *                  The transpose is built directly by swapping the sort keys.
+ * @param threads   Amount of threads to use
+ * @return          1 if the matrix contains no nonzero values, 0 otherwise
+ */
+int parse_mtx_file(const char* filename, struct cscMatrix* m, int transpose,
+        unsigned threads);
+
+/**
+ * Writes a matrix to a Matrix Market file in the coordinate real general
+ * format, with one-based indices in column-major order.
+ *
+ * @param m         The matrix to write
+ * @param filename  Name of the output file
+ * @param precision Precision of the values. See format_float.
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int write_mtx_file(const struct cscMatrix* m, const char* filename,
+        int precision);
+
+/**
+ * Converts a Matrix Market file to the text format read by the parsers.
+ *
+ * @param input     Name of the Matrix Market file
+ * @param output    Name of the text file to write
+ * @param precision Precision of the values. See format_float.
+ * @param threads   Amount of threads used for parsing and writing
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int convert_mtx_to_text(const char* input, const char* output, int precision,
+        unsigned threads);
+
+/**
+ * Checks whether a filename ends with the extension .mtx.
+ *
+ * @param filename  The filename
+ * @return          1 if it does, 0 otherwise
+ */
+int has_mtx_extension(const char* filename);
+
+#endif
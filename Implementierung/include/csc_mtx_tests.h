@@ -0,0 +1,27 @@
+#ifndef CSC_MTX_TESTS_H
+#define CSC_MTX_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Writes a random matrix to a Matrix Market file with its lines in random
+ * order, parses it with the given amount of threads, also into its transpose,
+ * and compares the results with the matrix.
+ *
+ * @param minSize   The minimum amount of rows and columns of the matrix
+ * @param maxSize   The maximum amount of rows and columns of the matrix
+ * @param threads   Amount of threads used for parsing
+ * @return          1 if the matrices are identical, 0 otherwise
+ */
+int test_mtx_roundtrip(uint64_t minSize, uint64_t maxSize, unsigned threads);
+
+/**
+ * Parses small Matrix Market files with symmetric, skew-symmetric and pattern
+ * matrices, comments, duplicate entries and explicit zeros, and checks that
+ * malformed and unsupported files are rejected.
+ *
+ * @return          1 if all files are handled correctly, 0 otherwise
+ */
+int test_mtx_variants();
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef CSC_OOC_H
+#define CSC_OOC_H
+
+#include <stdint.h>
+
+// Smallest memory budget accepted by mul_csc_ooc in bytes
+#define CSC_OOC_MIN_BUDGET (1 << 12)
+
+/**
+ * @class oocStats
+ *
+ * Statistics of an out-of-core multiplication
+ *
+ * @member bPanels      Amount of column panels of B
+ * @member aPanels      Amount of row panels of A
+ * @member products     Amount of multiplied panel pairs
+ * @member bBytesRead   Bytes read from the file of B
+ * @member aBytesRead   Bytes of the arrays of A accessed through the mapping,
+ *                      summed over all passes over A
+ * @member valueCount   Amount of nonzero values of the result
+ * @member bytesWritten Size of the stream file in bytes
+ */
+struct oocStats {
+    uint64_t bPanels;
+    uint64_t aPanels;
+    uint64_t products;
+    uint64_t bBytesRead;
+    uint64_t aBytesRead;
+    uint64_t valueCount;
+    uint64_t bytesWritten;
+};
+
+/**
+ * Computes A*B for input matrices that do not fit into memory and appends the
+ * result to a stream file (see csc_stream.h) block by block.
+ *
+ * Both inputs must be binary CSC files. B is read in panels of consecutive
+ * columns. A is mapped; if mul expects transpose(A), A is split into panels
+ * of consecutive rows, which are columns of the stored transpose, and the
+ * pages of a panel are dropped from memory after it was multiplied. Every
+ * pair of a B panel and an A panel is multiplied with mul, and the products
+ * of the row panels are joined into the result block of the B panel.
+ *
+ * The panels are sized so that the B panel and the A panel each use about a
+ * quarter of the memory budget and the result blocks in flight the other
+ * half. The size of a result block is estimated from the average amount of
+ * nonzero values per column of A; if that underestimates a block, more memory
+ * is used. B is mapped as well to read its column pointers, and every panel
+ * has at least one row or column.
+ *
+ * @param mul           One of the multiplication functions of matrix_mul.h,
+ *                      usually of quietKernels
+ * @param transposedA   Nonzero if mul expects transpose(A). The file of A must
+ *                      then be stored transposed (see --transposed), and
+ *                      untransposed otherwise.
+ * @param filename_a    Name of the binary file of A
+ * @param filename_b    Name of the binary file of B
+ * @param budget        Amount of memory to use in bytes, at least
+ *                      CSC_OOC_MIN_BUDGET
+ * @param filename      Name of the stream file to write
+ * @param stats         Output parameter for statistics. May be null.
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int mul_csc_ooc(void (*mul)(const void*, const void*, void*), int transposedA,
+        const char* filename_a, const char* filename_b, uint64_t budget,
+        const char* filename, struct oocStats* stats);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef CSC_OOC_TESTS_H
+#define CSC_OOC_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Multiplies random matrices stored in binary files with every kernel in the
+ * out-of-core mode with the given memory budget, converts the stream file to
+ * text and compares it with the text output of the regular multiplication.
+ *
+ * @param minSize   The minimum amount of rows and columns of the matrices
+ * @param maxSize   The maximum amount of rows and columns of the matrices
+ * @param budget    Memory budget in bytes
+ * @return          1 if the outputs are identical, 0 otherwise
+ */
+int test_mul_ooc(uint64_t minSize, uint64_t maxSize, uint64_t budget);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef CSC_PERF_H
+#define CSC_PERF_H
+
+#include <stdint.h>
+
+/**
+ * Hardware events counted by a perfGroup
+ *
+ * PERF_CYCLES          CPU cycles
+ * PERF_INSTRUCTIONS    Retired instructions
+ * PERF_L1D_MISSES      Read misses of the L1 data cache
+ * PERF_LLC_MISSES      Misses of the last level cache
+ * PERF_BRANCH_MISSES   Mispredicted branches
+ * PERF_DTLB_MISSES     Read misses of the data TLB
+ */
+enum perfCounter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_COUNTERS
+};
+
+// Names of the counters, indexed by enum perfCounter
+extern const char* const perfCounterNames[PERF_COUNTERS];
+
+/**
+ * @class perfGroup
+ *
+ * Hardware counters of the calling thread and the threads it creates
+ * afterwards, opened with perf_event_open as one group so they are scheduled
+ * onto the PMU together. User space events only are counted, which works
+ * with the default perf_event_paranoid setting of 2.
+ *
+ * @member fds      File descriptor of every counter, -1 if it could not be
+ *                  opened
+ * @member opened   Amount of opened counters
+ */
+struct perfGroup {
+    int fds[PERF_COUNTERS];
+    unsigned opened;
+};
+
+/**
+ * @class perfReading
+ *
+ * Raw state of the counters of a group at one point in time
+ *
+ * @member value    Count of every counter
+ * @member enabled  Time every counter was enabled in nanoseconds
+ * @member running  Time every counter was counting. It is less than enabled
+ *                  if the kernel multiplexed the counters.
+ */
+struct perfReading {
+    uint64_t value[PERF_COUNTERS];
+    uint64_t enabled[PERF_COUNTERS];
+    uint64_t running[PERF_COUNTERS];
+};
+
+/**
+ * @class perfTotals
+ *
+ * Counts of a phase, summed over every time the phase ran
+ *
+ * @member count        Count of every counter, scaled up by enabled / running
+ *                      if the counter was multiplexed
+ * @member counted      Nonzero if the counter ran during the phase at all
+ * @member scaled       Nonzero if any count was scaled
+ */
+struct perfTotals {
+    double count[PERF_COUNTERS];
+    int counted[PERF_COUNTERS];
+    int scaled;
+};
+
+/**
+ * Opens the counters. Counters the CPU or kernel does not support are
+ * skipped, so the group may be incomplete. A group without counters can be
+ * passed to the other functions, which then do nothing.
+ *
+ * @param g     The group
+ * @return      Amount of opened counters. If it is 0, errno is set to the
+ *              reason the first counter could not be opened.
+ */
+unsigned perf_open(struct perfGroup* g);
+
+/**
+ * Reads the current state of the counters.
+ *
+ * @param g     The group
+ * @param r     Struct to store the state in. Counters that are not open or
+ *              could not be read are 0.
+ */
+void perf_read(const struct perfGroup* g, struct perfReading* r);
+
+/**
+ * Adds the counts between two readings to the totals of a phase.
+ *
+ * @param t         The totals of the phase
+ * @param before    Reading at the start of the phase
+ * @param after     Reading at the end of the phase
+ */
+void perf_accumulate(struct perfTotals* t, const struct perfReading* before,
+        const struct perfReading* after);
+
+/**
+ * Closes the counters.
+ *
+ * @param g     The group
+ */
+void perf_close(struct perfGroup* g);
+
+/**
+ * Prints a table with a line of counts per phase, including the
+ * instructions per cycle. Counters that did not run are printed as n/a.
+ *
+ * @param names     Name of every phase
+ * @param totals    Totals of every phase
+ * @param phases    Amount of phases
+ */
+void print_perf_totals(const char* const* names,
+        const struct perfTotals* totals, unsigned phases);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef CSC_PERF_TESTS_H
+#define CSC_PERF_TESTS_H
+
+/**
+ * Opens the hardware counters and counts a loop around a multiplication.
+ * The cycle and instruction counts must be nonzero if they could be opened,
+ * and counters that did not open must be reported as not counted. Passes if
+ * no counter can be opened, as long as errno tells why and the other
+ * functions accept the empty group.
+ *
+ * @param size  Amount of rows and columns of the multiplied matrices
+ * @return      1 if the counts are consistent, 0 otherwise
+ */
+int test_perf_counters(unsigned size);
+
+#endif
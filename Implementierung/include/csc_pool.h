@@ -0,0 +1,133 @@
+#ifndef CSC_POOL_H
+#define CSC_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// Iterations a waiting thread checks for work or completion before it blocks
+#define CSC_POOL_SPIN 4096
+
+struct cscPoolJob;
+
+/**
+ * @class cscPool
+ *
+ * Persistent worker threads that run the parts of jobs. A job is submitted
+ * by a thread that then works on its own parts as well and returns once all
+ * of them are finished, so a pool of one thread has no workers and runs
+ * everything on the calling thread. Any amount of threads may submit jobs at
+ * the same time, including the parts of a job itself.
+ *
+ * Idle workers spin for CSC_POOL_SPIN iterations before they block, so that
+ * jobs following each other closely, like the phases of a parser or
+ * repeated small products, do not wait for a wake-up. They only spin if the
+ * pool has no more threads than the machine has processors.
+ *
+ * @member lock         Mutex protecting the queue and the counters
+ * @member wake         Signaled when a job is queued or the pool is stopped
+ * @member done         Broadcast when the last part of a job is finished
+ * @member jobs         Queue of the jobs with parts that have not been
+ *                      started, oldest first
+ * @member workers      Thread ids of the threads - 1 workers
+ * @member threads      Amount of threads, including the submitting one
+ * @member sleeping     Amount of workers blocked on wake
+ * @member spin         Iterations to spin before blocking, 0 or
+ *                      CSC_POOL_SPIN
+ * @member pin          Nonzero if every worker is pinned to one processor
+ * @member stop         Set by csc_pool_destroy
+ */
+struct cscPool {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    struct cscPoolJob* jobs;
+    pthread_t* workers;
+    unsigned threads;
+    unsigned sleeping;
+    unsigned spin;
+    int pin;
+    int stop;
+};
+
+/**
+ * Starts a pool. With pinning, worker i runs on the (i+1)-th processor the
+ * process may use, wrapping around, and the submitting threads are left
+ * alone. Pinning is only supported on Linux and ignored elsewhere.
+ *
+ * @param pool      The pool
+ * @param threads   Amount of threads including the submitting one, at
+ *                  least 1
+ * @param pin       Nonzero to pin the workers
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int csc_pool_init(struct cscPool* pool, unsigned threads, int pin);
+
+/**
+ * Stops the workers of a pool and frees its memory. No job may be running.
+ *
+ * @param pool  The pool
+ */
+void csc_pool_destroy(struct cscPool* pool);
+
+/**
+ * Returns the amount of threads of a pool.
+ *
+ * @param pool  The pool, or null
+ * @return      The amount of threads, 1 for null
+ */
+unsigned csc_pool_threads(struct cscPool* pool);
+
+/**
+ * Runs fn on n parts of size bytes each and returns when all are finished.
+ * The parts are handed out to the threads of the pool one at a time, the
+ * calling thread included.
+ *
+ * @param pool  The pool, or null to run all parts on the calling thread
+ * @param parts Array of the parts
+ * @param size  Size of a part
+ * @param n     Amount of parts
+ * @param fn    Function called with a pointer to every part. Its return
+ *              value is ignored.
+ */
+void csc_pool_run(struct cscPool* pool, void* parts, size_t size, unsigned n,
+        void* (*fn)(void*));
+
+/**
+ * Calls body on consecutive ranges of [0, n) in parallel and returns when
+ * all are finished.
+ *
+ * @param pool  The pool, or null to run on the calling thread
+ * @param n     Size of the iteration space
+ * @param grain Size of the ranges, the last one may be smaller. 0 splits
+ *              the space into four ranges per thread.
+ * @param body  Called with the range [begin, end) and arg
+ * @param arg   Passed to body
+ */
+void csc_pool_for(struct cscPool* pool, uint64_t n, uint64_t grain,
+        void (*body)(uint64_t begin, uint64_t end, void* arg), void* arg);
+
+/**
+ * Sets up the pool shared by the parallel parts of the program: parsing,
+ * transposing, multiplying and writing. Must be called before the shared
+ * pool is used by another thread.
+ *
+ * @param threads   Amount of threads, see csc_pool_init
+ * @param pin       Nonzero to pin the workers, also the ones added later by
+ *                  csc_shared_pool
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int csc_shared_pool_init(unsigned threads, int pin);
+
+/**
+ * Returns the pool shared by the program, which is started on first use and
+ * grown to at least the given amount of threads. It is stopped when the
+ * program exits.
+ *
+ * @param threads   Amount of threads needed, 0 to leave the pool as it is
+ * @return          The pool, or null if it has not been started or can not
+ *                  be started, in which case callers run on their own thread
+ */
+struct cscPool* csc_shared_pool(unsigned threads);
+
+#endif
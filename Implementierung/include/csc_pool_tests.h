@@ -0,0 +1,30 @@
+#ifndef CSC_POOL_TESTS_H
+#define CSC_POOL_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Checks that csc_pool_for and csc_pool_run of a pool with the given amount
+ * of threads visit every index and part exactly once, also when the parts
+ * submit jobs to the same pool and when several threads submit jobs at the
+ * same time, and that pinned pools can be started.
+ *
+ * @param threads   Amount of threads of the pool
+ * @return          1 if the test passed, 0 otherwise
+ */
+int test_csc_pool(unsigned threads);
+
+/**
+ * Transposes and multiplies random matrices with every version, with and
+ * without the threads of a pool in the context, and checks that the results
+ * are equal, also for a view of the columns of B whose first column pointer
+ * is not 0. Checks that split_csc_columns balances the values of such views.
+ *
+ * @param threads   Amount of threads of the pool
+ * @param size      Amount of rows of A
+ * @param density   Density of the matrices
+ * @return          1 if all results are equal, 0 otherwise
+ */
+int test_csc_pool_kernels(unsigned threads, uint64_t size, double density);
+
+#endif
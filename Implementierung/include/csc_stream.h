@@ -0,0 +1,190 @@
+#ifndef CSC_STREAM_H
+#define CSC_STREAM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "cs_matrix.h"
+#include "bounded_queue.h"
+
+#define CSC_STREAM_MAGIC "CSCSTRM\n"
+#define CSC_STREAM_VERSION 1
+
+// Default amount of columns per block of mul_csc_stream
+#define CSC_STREAM_BLOCK_COLUMNS 1024
+
+// Default amount of blocks that may wait for the writer thread
+#define CSC_STREAM_QUEUE_CAPACITY 4
+
+/**
+ * @class cscStreamHeader
+ *
+ * Header of a CSC stream file. A stream file stores a matrix as a sequence
+ * of column blocks, so it can be written front to back while the matrix is
+ * computed. The header is followed by the blocks in ascending column order,
+ * each starting with a struct cscStreamBlock, and a terminating block.
+ * All numbers are stored in the byte order of the writing machine.
+ *
+ * @member magic        CSC_STREAM_MAGIC, without the terminating null
+ * @member version      CSC_STREAM_VERSION
+ * @member byteOrder    CSC_BINARY_BYTE_ORDER in the byte order of the file
+ * @member rows         Amount of rows of the matrix
+ * @member columns      Amount of columns of the matrix
+ */
+struct cscStreamHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t rows;
+    uint64_t columns;
+};
+
+/**
+ * @class cscStreamBlock
+ *
+ * Header of a block of consecutive columns in a stream file. It is followed
+ * by the block's colPtr (columnCount + 1 entries, starting at 0), rowIndices
+ * and values, and zeros up to the next multiple of 8 bytes.
+ *
+ * The terminating block has a columnCount of 0, its firstColumn is the amount
+ * of columns of the matrix and its valueCount the amount of nonzero values of
+ * the whole matrix.
+ *
+ * @member firstColumn  Index of the first column of the block
+ * @member columnCount  Amount of columns in the block
+ * @member valueCount   Amount of nonzero values in the block
+ */
+struct cscStreamBlock {
+    uint64_t firstColumn;
+    uint64_t columnCount;
+    uint64_t valueCount;
+};
+
+/**
+ * @class cscStreamWriter
+ *
+ * Writes column blocks to a stream file on a separate thread. Blocks are
+ * handed to the thread through a bounded queue, so that at most the queue's
+ * capacity of finished blocks is held in memory.
+ *
+ * @member file         The stream file
+ * @member thread       The writer thread
+ * @member queue        Blocks waiting to be written
+ * @member rows         Amount of rows of the matrix
+ * @member columns      Amount of columns of the matrix
+ * @member nextColumn   First column of the next block to be written
+ * @member valueCount   Amount of values written so far
+ * @member bytes        Amount of bytes written so far
+ * @member error        errno of the first failed operation, 0 otherwise
+ */
+struct cscStreamWriter {
+    FILE* file;
+    pthread_t thread;
+    struct boundedQueue queue;
+    uint64_t rows;
+    uint64_t columns;
+    uint64_t nextColumn;
+    uint64_t valueCount;
+    uint64_t bytes;
+    int error;
+};
+
+/**
+ * @class streamStats
+ *
+ * Statistics of a streaming multiplication
+ *
+ * @member blocks       Amount of column blocks
+ * @member valueCount   Amount of nonzero values of the result
+ * @member bytes        Size of the stream file in bytes
+ * @member waitTime     Seconds the multiplication waited for the writer
+ */
+struct streamStats {
+    uint64_t blocks;
+    uint64_t valueCount;
+    uint64_t bytes;
+    double waitTime;
+};
+
+/**
+ * Creates a stream file, writes its header and starts the writer thread.
+ *
+ * @param w             The writer to initialize
+ * @param filename      Name of the stream file
+ * @param rows          Amount of rows of the matrix
+ * @param columns       Amount of columns of the matrix
+ * @param capacity      Maximum amount of blocks waiting to be written
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int open_stream_writer(struct cscStreamWriter* w, const char* filename,
+        uint64_t rows, uint64_t columns, unsigned capacity);
+
+/**
+ * Hands a column block to the writer thread, waiting while the queue is full.
+ * The writer takes ownership of the block's pointer members and frees them
+ * after writing. Blocks must be pushed in ascending column order without
+ * gaps.
+ *
+ * @param w             The writer
+ * @param block         The block. Its rows must equal the matrix' rows.
+ * @param firstColumn   Index of the block's first column in the matrix
+ * @return              1 if successful, 0 otherwise. errno is set on
+ *                      failure and the block's members are freed.
+ */
+int stream_writer_push(struct cscStreamWriter* w, struct cscMatrix* block,
+        uint64_t firstColumn);
+
+/**
+ * Waits for the writer thread to write all blocks, writes the terminating
+ * block and closes the file.
+ *
+ * @param w             The writer
+ * @return              1 if the complete matrix was written, 0 otherwise.
+ *                      errno is set on failure.
+ */
+int close_stream_writer(struct cscStreamWriter* w);
+
+/**
+ * Computes A*B block by block and streams the result to a stream file. Every
+ * block of blockColumns columns of B is multiplied with mul, which receives
+ * a view of B that shares its arrays, and is handed to a writer thread while
+ * the next block is computed. Only a few blocks of the result are held in
+ * memory at any time.
+ *
+ * @param mul           One of the multiplication functions of matrix_mul.h,
+ *                      usually of quietKernels
+ * @param a             Matrix A in the layout expected by mul
+ * @param b             Matrix B
+ * @param resultRows    Amount of rows of A*B
+ * @param blockColumns  Amount of columns per block
+ * @param filename      Name of the stream file
+ * @param stats         Output parameter for statistics. May be null.
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int mul_csc_stream(void (*mul)(const void*, const void*, void*),
+        const struct cscMatrix* a, const struct cscMatrix* b,
+        uint64_t resultRows, uint64_t blockColumns, const char* filename,
+        struct streamStats* stats);
+
+/**
+ * Checks whether a file starts with CSC_STREAM_MAGIC.
+ *
+ * @param filename      Name of the file to check
+ * @return              1 if the file is a stream file, 0 otherwise
+ */
+int is_csc_stream(const char* filename);
+
+/**
+ * Converts a stream file to the text format. The stream file is mapped and
+ * read three times, once for every line of the text format, so the matrix is
+ * never held in memory.
+ *
+ * @param input         Name of the stream file
+ * @param output        Name of the text file to write
+ * @param precision     Precision of the values. See format_float.
+ * @return              1 if successful, 0 otherwise. errno is set on failure.
+ */
+int convert_stream_to_text(const char* input, const char* output,
+        int precision);
+
+#endif
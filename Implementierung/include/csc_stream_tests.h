@@ -0,0 +1,26 @@
+#ifndef CSC_STREAM_TESTS_H
+#define CSC_STREAM_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Passes numbers from a producer thread to the calling thread through a
+ * bounded queue with a capacity of 2 and closes the queue.
+ *
+ * @return          1 if all numbers arrive in order, 0 otherwise
+ */
+int test_bounded_queue();
+
+/**
+ * Multiplies random matrices with every kernel in streaming mode with the
+ * given block size, converts the stream file to text and compares it with the
+ * text output of the regular multiplication.
+ *
+ * @param minSize       The minimum amount of rows and columns of the matrices
+ * @param maxSize       The maximum amount of rows and columns of the matrices
+ * @param blockColumns  Amount of columns per block
+ * @return              1 if the outputs are identical, 0 otherwise
+ */
+int test_mul_stream(uint64_t minSize, uint64_t maxSize, uint64_t blockColumns);
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef CSC_TRACE_H
+#define CSC_TRACE_H
+
+#include <stdint.h>
+
+// Amount of spans kept per thread. Older spans are overwritten.
+#define TRACE_BUFFER_EVENTS 4096
+
+// Nonzero while spans are recorded, see trace_start
+extern int traceEnabled;
+
+/*
+ * Spans are recorded with
+ *
+ *     TRACE_BEGIN(t);
+ *     ...
+ *     TRACE_END(t, "name");
+ *
+ * where t is a new local variable holding the start time and name is a
+ * string literal. A disabled trace costs one branch per macro. Compiling
+ * with -DCSC_NO_TRACE (make notrace) removes the macros entirely.
+ */
+#ifdef CSC_NO_TRACE
+#define TRACE_BEGIN(t)
+#define TRACE_END(t, name)
+#else
+#define TRACE_BEGIN(t) uint64_t t = traceEnabled ? trace_now() : 0
+#define TRACE_END(t, name) \
+    do { if (traceEnabled) trace_span(name, t); } while (0)
+#endif
+
+/**
+ * @class traceSpan
+ *
+ * A recorded span of a thread
+ *
+ * @member name     Name of the span. Must stay valid until the trace is
+ *                  written, so it is a string literal.
+ * @member start    Start in nanoseconds, see trace_now
+ * @member duration Duration in nanoseconds
+ */
+struct traceSpan {
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+};
+
+/**
+ * @class traceBuffer
+ *
+ * Ring buffer of the spans of a thread. Buffers of finished threads are
+ * handed to the next thread that records a span, so the amount of buffers
+ * is the largest amount of threads that ran at the same time, and every
+ * buffer is one line of the timeline.
+ *
+ * @member spans    The last TRACE_BUFFER_EVENTS spans
+ * @member count    Amount of spans recorded into the buffer so far
+ * @member lane     Number of the buffer, used as thread id in the trace
+ * @member owned    Nonzero while a running thread records into the buffer
+ * @member next     Next buffer in the list of all buffers
+ */
+struct traceBuffer {
+    struct traceSpan spans[TRACE_BUFFER_EVENTS];
+    uint64_t count;
+    unsigned lane;
+    int owned;
+    struct traceBuffer* next;
+};
+
+/**
+ * Starts recording spans. Spans start at 0 at the time of the call.
+ *
+ * @return  1 if successful, 0 otherwise. errno is set on failure.
+ */
+int trace_start();
+
+/**
+ * Returns the current time for spans.
+ *
+ * @return  Nanoseconds of CLOCK_MONOTONIC
+ */
+uint64_t trace_now();
+
+/**
+ * Records a span that ends now into the buffer of the calling thread. Spans
+ * that started before trace_start are dropped.
+ *
+ * @param name      Name of the span, a string literal
+ * @param start     Start of the span, see trace_now
+ */
+void trace_span(const char* name, uint64_t start);
+
+/**
+ * Writes the recorded spans as a Chrome trace event file (JSON object
+ * format, complete events), which can be opened in chrome://tracing or
+ * Perfetto. Must not be called while other threads record spans.
+ *
+ * @param filename  Name of the file
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int trace_write(const char* filename);
+
+/**
+ * Stops recording spans and frees all buffers. Must not be called while
+ * other threads record spans.
+ */
+void trace_stop();
+
+#endif
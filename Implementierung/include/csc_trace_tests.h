@@ -0,0 +1,17 @@
+#ifndef CSC_TRACE_TESTS_H
+#define CSC_TRACE_TESTS_H
+
+/**
+ * Records spans on the calling thread and on worker threads, including more
+ * spans than fit into a ring buffer, writes the trace and checks that the
+ * file contains the expected amount of complete events, thread names and
+ * dropped spans. Also checks that spans are not recorded after trace_stop
+ * and that a thread running across two traces records into the second one.
+ *
+ * @param threads   Amount of worker threads, started one after another and
+ *                  then at the same time
+ * @return          1 if the trace is correct, 0 otherwise
+ */
+int test_trace(unsigned threads);
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef CSC_WRITER_H
+#define CSC_WRITER_H
+
+#include <stdint.h>
+#include "cs_matrix.h"
+
+// Size of the output buffer of write_csc_text in bytes
+#define CSC_WRITER_BUFFER_SIZE (1 << 20)
+
+// Maximum amount of array elements formatted by a thread of write_csc_text_mt
+// at once
+#define CSC_WRITER_SEGMENT_SIZE (1 << 18)
+
+// Maximum amount of characters written by format_float and format_uint64
+#define CSC_WRITER_MAX_NUMBER 24
+
+/**
+ * Computes the shortest decimal representation of a finite float that is
+ * parsed back to the same float, using the Ryu algorithm by Ulf Adams
+ * (https://github.com/ulfjack/ryu). If several representations of the same
+ * length exist, the one closest to the float is chosen.
+ *
+ * The float is given by digits * 10^exponent.
+ *
+ * @param f         The float to convert. Must not be inf or nan.
+ * @param digits    Output parameter for the decimal significand
+ * @param exponent  Output parameter for the decimal exponent
+ * @return          The amount of decimal digits of digits
+ */
+int float_to_shortest(float f, uint32_t* digits, int32_t* exponent);
+
+/**
+ * Writes a float in the format of printf's %g conversion, without a
+ * terminating null.
+ *
+ * With a precision of 0, the float is written with its shortest round-trip
+ * representation (see float_to_shortest), formatted like %.9g would format
+ * these digits. Otherwise the output is identical to %.<precision>g.
+ *
+ * @param p         Buffer with space for at least CSC_WRITER_MAX_NUMBER
+ *                  characters
+ * @param f         The float to write
+ * @param precision Amount of significant digits, or 0 for the shortest
+ *                  round-trip representation
+ * @return          Pointer to the first character after the number
+ */
+char* format_float(char* p, float f, int precision);
+
+/**
+ * Writes an unsigned integer in decimal, without a terminating null.
+ *
+ * @param p         Buffer with space for at least 20 characters
+ * @param value     The integer to write
+ * @return          Pointer to the first character after the number
+ */
+char* format_uint64(char* p, uint64_t value);
+
+/**
+ * @class textWriter
+ *
+ * Buffered writer on a file descriptor. The buffer of CSC_WRITER_BUFFER_SIZE
+ * bytes is written with a single write call whenever it is full.
+ *
+ * @member fd       File descriptor to write to
+ * @member buffer   The buffer
+ * @member used     Amount of bytes in the buffer
+ * @member section  Name of the data being written, for progress messages
+ * @member done     Amount of elements of the section written so far
+ * @member total    Amount of elements of the section. If logData is set and
+ *                  total is not 0, the progress is printed after every flush.
+ */
+struct textWriter {
+    int fd;
+    char* buffer;
+    size_t used;
+    const char* section;
+    uint64_t done;
+    uint64_t total;
+};
+
+/**
+ * Opens a file for writing with a textWriter. The file is truncated.
+ *
+ * @param w         The writer to initialize
+ * @param filename  Name of the file
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int open_text_writer(struct textWriter* w, const char* filename);
+
+/**
+ * Appends a float formatted with format_float, preceded by separator unless
+ * separator is '\0'.
+ *
+ * @return          1 if successful, 0 if flushing the buffer failed
+ */
+int text_writer_put_float(struct textWriter* w, char separator, float f,
+        int precision);
+
+/**
+ * Appends an unsigned integer, preceded by separator unless separator is '\0'.
+ *
+ * @return          1 if successful, 0 if flushing the buffer failed
+ */
+int text_writer_put_uint64(struct textWriter* w, char separator,
+        uint64_t value);
+
+/**
+ * Appends a single character.
+ *
+ * @return          1 if successful, 0 if flushing the buffer failed
+ */
+int text_writer_put_char(struct textWriter* w, char c);
+
+/**
+ * Flushes the buffer, closes the file and frees the buffer. Prints an error
+ * message if writing failed.
+ *
+ * @param w         The writer to close
+ * @param ok        0 if a previous call on w failed
+ * @return          1 if ok is nonzero and all data was written, 0 otherwise.
+ *                  errno is set on failure.
+ */
+int close_text_writer(struct textWriter* w, int ok);
+
+/**
+ * Writes a matrix to a file in the text format read by the parsers. The
+ * output is formatted into a buffer of CSC_WRITER_BUFFER_SIZE bytes that is
+ * written with a single write call whenever it is full.
+ *
+ * If logData is set, the progress is printed after every flush.
+ *
+ * @param m         The matrix to write
+ * @param filename  Name of the output file
+ * @param precision Precision of the values. See format_float.
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int write_csc_text(const struct cscMatrix* m, const char* filename,
+        int precision);
+
+/**
+ * Writes a matrix like write_csc_text, using several threads. Every array is
+ * written in rounds: each thread formats a slice of the array into its own
+ * buffer, the byte offsets of the slices are computed with a prefix sum, the
+ * file is extended to the end of the round and every thread writes its slice
+ * with pwrite. The output is identical to the output of write_csc_text.
+ *
+ * Each thread uses a buffer of about
+ * CSC_WRITER_SEGMENT_SIZE * (CSC_WRITER_MAX_NUMBER + 1) bytes.
+ *
+ * @param m         The matrix to write
+ * @param filename  Name of the output file
+ * @param precision Precision of the values. See format_float.
+ * @param threads   Amount of threads to use. With one thread, or if the file
+ *                  is not a regular file, write_csc_text is called.
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+int write_csc_text_mt(const struct cscMatrix* m, const char* filename,
+        int precision, unsigned threads);
+
+#endif
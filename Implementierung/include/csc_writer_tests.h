@@ -0,0 +1,41 @@
+#ifndef CSC_WRITER_TESTS_H
+#define CSC_WRITER_TESTS_H
+
+#include <stdint.h>
+
+int test_format_float_fixed();
+
+/**
+ * Formats n random floats. The shortest representations must be read back
+ * exactly and be as short as the shortest %.*e representation that is read
+ * back exactly; the representations with precision 6 must be identical to
+ * %.6g.
+ *
+ * @param n         Amount of floats to test
+ * @return          1 if all floats are formatted correctly, 0 otherwise
+ */
+int test_format_float_rand(unsigned n);
+
+/**
+ * Writes a random matrix with write_csc_text and with fprintf. Prints the
+ * throughput of both writers in MB/s.
+ *
+ * @param minSize   The minimum amount of rows and columns of the matrix
+ * @param maxSize   The maximum amount of rows and columns of the matrix
+ * @return          1 if the output with precision 6 is identical to the
+ *                  fprintf output and the shortest output is parsed back to
+ *                  the same matrix, 0 otherwise
+ */
+int test_write_csc_text(uint64_t minSize, uint64_t maxSize);
+
+/**
+ * Writes a random matrix with write_csc_text and with write_csc_text_mt with
+ * 2, 4 and 8 threads and prints the runtimes.
+ *
+ * @param minSize   The minimum amount of rows and columns of the matrix
+ * @param maxSize   The maximum amount of rows and columns of the matrix
+ * @return          1 if all outputs are identical, 0 otherwise
+ */
+int test_write_csc_text_mt(uint64_t minSize, uint64_t maxSize);
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef CSCMUL_H
+#define CSCMUL_H
+
+#include <stdint.h>
+#include "cs_matrix.h"
+#include "csc_context.h"
+
+/*
+ * Public interface of libcscmul, the kernels of matrixMul as a library
+ * (make lib builds libcscmul.a and libcscmul.so).
+ *
+ * A multiplication is split into an inspector and an executor:
+ *
+ *     struct cscmulOptions options = CSCMUL_DEFAULT_OPTIONS;
+ *     struct cscmulPlan* plan;
+ *     struct cscMatrix c;
+ *     if (cscmul_analyze(ctx, &a, &b, &options, &plan) == CSC_OK) {
+ *         if (cscmul_execute(ctx, plan, &c) == CSC_OK) {
+ *             ...
+ *             cscmul_free_result(ctx, &c);
+ *         }
+ *         cscmul_destroy(plan);
+ *     }
+ *
+ * The inputs are the caller's arrays wrapped in a struct cscMatrix. They are
+ * never copied or modified, but must stay valid and unchanged until the plan
+ * is destroyed. A plan can be executed any amount of times, also by several
+ * threads at once.
+ *
+ * Every function returns a status of csc_context.h and uses no global
+ * state: it logs and allocates only through its context (see cscContext),
+ * which may be null for one that logs nothing and allocates with malloc.
+ * Independent products can therefore run on different threads, each with
+ * its own context or sharing one. If the context has a pool, the conversion
+ * of A and every product are split over its threads.
+ */
+
+// Version of cscmulOptions that selects the kernel with the cost model
+#define CSCMUL_AUTO -1
+
+/**
+ * @class cscmulOptions
+ *
+ * Options of cscmul_analyze
+ *
+ * @member version      Kernel to use, 0 to 2 as with -V, or CSCMUL_AUTO
+ * @member transposedA  Nonzero if a holds the transpose of A. Versions 0 and 1
+ *                      multiply with the transpose and version 2 with A
+ *                      itself; the other layout is converted once by
+ *                      cscmul_analyze.
+ * @member modelFile    Cost model of CSCMUL_AUTO (see csc_model.h), or null
+ *                      for the built-in one
+ */
+struct cscmulOptions {
+    int version;
+    int transposedA;
+    const char* modelFile;
+};
+
+#define CSCMUL_DEFAULT_OPTIONS {CSCMUL_AUTO, 0, 0}
+
+// Opaque handle of an analyzed multiplication
+struct cscmulPlan;
+
+/**
+ * Checks that A and B are valid CSC matrices that can be multiplied, with
+ * increasing row indices in every column, selects the kernel and prepares
+ * the layout of A it needs.
+ *
+ * Validating the inputs takes time linear in their amount of values.
+ * Converting A additionally allocates a matrix of its size, which is owned
+ * by the plan. The plan is allocated with the allocator of ctx as well.
+ *
+ * @param ctx       The context, or null
+ * @param a         A, or its transpose if options->transposedA is set
+ * @param b         B
+ * @param options   The options, or null for CSCMUL_DEFAULT_OPTIONS
+ * @param plan      Output parameter for the plan, null on failure
+ * @return          CSC_OK, CSC_INVALID_ARGUMENT if the inputs or options are
+ *                  invalid, CSC_OUT_OF_MEMORY if memory allocation fails,
+ *                  or the status of the error reading the model file
+ */
+int cscmul_analyze(const struct cscContext* ctx, const struct cscMatrix* a,
+        const struct cscMatrix* b, const struct cscmulOptions* options,
+        struct cscmulPlan** plan);
+
+/**
+ * Computes A*B.
+ *
+ * @param ctx   The context, or null. Its allocator allocates the pointer
+ *              members of c, see cscmul_free_result.
+ * @param plan  The plan
+ * @param c     Struct to store the product in
+ * @return      CSC_OK, or the status of the error. On failure, the pointer
+ *              members of c are null.
+ */
+int cscmul_execute(const struct cscContext* ctx, const struct cscmulPlan* plan,
+        struct cscMatrix* c);
+
+/**
+ * Returns the kernel a plan executes.
+ *
+ * @param plan  The plan
+ * @return      Version of the kernel, 0 to 2
+ */
+int cscmul_version(const struct cscmulPlan* plan);
+
+/**
+ * Frees the pointer members of a product computed by cscmul_execute and sets
+ * them to null.
+ *
+ * @param ctx   The context the product was computed with, or null
+ * @param c     The product
+ */
+void cscmul_free_result(const struct cscContext* ctx, struct cscMatrix* c);
+
+/**
+ * Frees a plan and the memory it owns with the allocator it was created
+ * with. The inputs are not freed.
+ *
+ * @param plan  The plan, or null
+ */
+void cscmul_destroy(struct cscmulPlan* plan);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef CSCMUL_TESTS_H
+#define CSCMUL_TESTS_H
+
+#include <stdint.h>
+
+/**
+ * Multiplies two random matrices through the library interface with every
+ * version, with A given directly and as its transpose, and compares the
+ * products with that of matr_mult_csc. Also checks that inputs with
+ * mismatched dimensions, an invalid version or unsorted row indices are
+ * rejected and that a product with an empty input is empty.
+ *
+ * @param size      Amount of rows of A
+ * @param density   Density of the matrices
+ * @return          1 if all products are correct, 0 otherwise
+ */
+int test_cscmul(uint64_t size, double density);
+
+/**
+ * Computes the same product on several threads at once, each with its own
+ * context with a counting allocator and log function, and checks the
+ * products, that every context received progress messages and that all of
+ * its memory was freed.
+ *
+ * @param threads   Amount of threads
+ * @return          1 if all products are correct, 0 otherwise
+ */
+int test_cscmul_threads(unsigned threads);
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef MATRIX_MUL_H
 #define MATRIX_MUL_H
 #include <stdint.h>
+#include "cs_matrix.h"
+#include "csc_context.h"
 
 /**
  * Computes A*B with transpose(A) and in-place scalar product.
@@ -29,6 +31,42 @@ void matr_mult_csc_V1(const void* a, const void* b, void* result);
  */
 void matr_mult_csc_V2(const void* a, const void* b, void* result);
 
+// The kernels above, indexed by version, without their progress output. For
+// callers that run a kernel many times, e.g. once per block of a stream.
+extern void (*const quietKernels[3])(const void*, const void*, void*);
+
+/**
+ * Computes A*B with the kernel of the given version. Unlike the functions
+ * above, which log according to logData and report errors through errno,
+ * it only uses the context, so calls with different contexts and results
+ * can run on different threads at the same time.
+ *
+ * @param ctx       The context. Its allocator allocates the members of the
+ *                  result and the memory the kernel needs.
+ * @param version   The kernel: 0 and 1 take the transpose of A, 2 takes A
+ * @param a         A or its transpose, see version
+ * @param b         B
+ * @param result    Struct to store the result in
+ * @return          CSC_OK, or a status of csc_context.h. On failure, the
+ *                  pointer members of the result are null.
+ */
+int mul_csc_ctx(const struct cscContext* ctx, int version,
+        const struct cscMatrix* a, const struct cscMatrix* b,
+        struct cscMatrix* result);
+
+/**
+ * Splits the columns of B into ranges with about the same amount of values,
+ * as the threads of mul_csc_ctx multiply them. B may be a view of some
+ * columns of a larger matrix, whose first column pointer is not 0.
+ *
+ * @param b     B
+ * @param n     Amount of ranges, at least 1 and at most the columns of B
+ * @param ends  Output parameter for the end of every range. Range i covers
+ *              the columns ends[i - 1] (0 for the first one) to ends[i] - 1
+ *              and holds at least one column.
+ */
+void split_csc_columns(const struct cscMatrix* b, uint64_t n, uint64_t* ends);
+
 void matr_mult_dense(const void* a, const void* b, void* result, uint64_t a_rows, uint64_t a_cols, uint64_t b_cols);
 
 #endif
@@ -2,17 +2,62 @@
 #define TRANSPOSE_H
 #include <stdint.h>
 #include "cs_matrix.h"
+#include "csc_context.h"
 
 int computeColPtr(uint64_t* indices, uint64_t* dest, uint64_t n, uint64_t valueCount);
 
-int transpose(struct cscMatrixTranspose* a, struct cscMatrix* a_t);
 /**
- * Copies the contents of a cscMatrixTranspose into a cscMatrix
+ * Transposes a cscMatrix with a counting sort over its row indices. The row
+ * indices of every column of the result are sorted.
  *
- * @param a     The cscMatrixTranspose
- * @param a_t   The cscMatrix
+ * If memory allocation fails, errno is set to ENOMEM and the pointer members
+ * of a_t are null.
+ *
+ * @param a     The matrix to transpose
+ * @param a_t   The transposed matrix. Its pointer members are stored on the heap
  * @return      1 if the operation succeeded, 0 otherwise
  */
-int csc_matr_cpy(struct cscMatrixTranspose* a, struct cscMatrix* a_t);
+int transpose_csc(const struct cscMatrix* a, struct cscMatrix* a_t);
+
+/**
+ * Transposes a cscMatrix like transpose_csc into memory allocated by the
+ * caller.
+ *
+ * @param a     The matrix to transpose
+ * @param a_t   The transposed matrix. values and rowIndices must hold
+ *              a->valueCount elements and colPtr a->rows + 2 zeroed ones.
+ */
+void transpose_csc_into(const struct cscMatrix* a, struct cscMatrix* a_t);
+
+/**
+ * Transposes a cscMatrix like transpose_csc_into with the threads of the pool
+ * of a context. The columns of a are split into one slice per thread, every
+ * slice counts its rows, the positions of the slices' values in every row
+ * are computed with a prefix sum and the slices are then scattered in
+ * parallel, which gives the same result as the serial transpose.
+ *
+ * The row counts of the slices take threads * a->rows integers allocated
+ * with the allocator of the context. The serial transpose is used if that is
+ * more than a->valueCount or the memory can not be allocated.
+ *
+ * @param ctx   The context
+ * @param a     The matrix to transpose
+ * @param a_t   The transposed matrix, see transpose_csc_into
+ */
+void transpose_csc_ctx(const struct cscContext* ctx, const struct cscMatrix* a,
+        struct cscMatrix* a_t);
+
+/**
+ * Transposes a cscMatrix like transpose_csc with up to the given amount of
+ * threads of the shared pool, see transpose_csc_ctx.
+ *
+ * @param a         The matrix to transpose
+ * @param a_t       The transposed matrix. Its pointer members are stored on
+ *                  the heap
+ * @param threads   Amount of threads to use
+ * @return          1 if the operation succeeded, 0 otherwise
+ */
+int transpose_csc_mt(const struct cscMatrix* a, struct cscMatrix* a_t,
+        unsigned threads);
 
 #endif
@@ -19,4 +19,6 @@ int test_transpose_performance_fixed();
 
 int test_transpose_rand(uint64_t minSize, uint64_t maxSize);
 
+int test_transpose_csc_fixed();
+
 #endif
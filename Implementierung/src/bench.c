@@ -0,0 +1,407 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/resource.h>
+
+#include "csc_bench.h"
+#include "csc_gen.h"
+#include "csc_io.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+#include "cs_matrix.h"
+
+// Maximum amount of entries of a list option
+#define BENCH_MAX_LIST 16
+
+static const char* bench_usage =
+    "Usage: %s [options]\n"
+    "Multiplies generated matrices with every kernel, checks the products "
+    "and writes the timings to\n"
+    "<Prefix>.csv and <Prefix>.json.\n\n"
+    "  -f <Names>   Comma separated matrix families (default: all of uniform,"
+                    " banded,\n"
+    "               block-diagonal, power-law, rmat)\n"
+    "  -n <Sizes>   Comma separated sizes; A and B are square (default: "
+                    "256,512)\n"
+    "  -d <List>    Comma separated densities (default: 0.005,0.02)\n"
+    "  -V <List>    Comma separated versions (default: 0,1,2)\n"
+    "  -i <N>       Timed runs per kernel (default: 3)\n"
+    "  -w <N>       Untimed warmup runs per kernel (default: 1)\n"
+    "  -s <N>       Seed of the matrices (default: 1)\n"
+    "  -c           Flush the CPU caches before every run\n"
+    "  -o <Prefix>  Prefix of the output files (default: bench_results)\n"
+    "  -h           Print this message\n";
+
+/**
+ * @class benchRow
+ *
+ * Measurements of one kernel on one pair of matrices
+ *
+ * @member family       Family of the matrices
+ * @member size         Amount of rows and columns of A and B
+ * @member density      Density the matrices were generated with
+ * @member version      The kernel
+ * @member nnzA         Nonzero values of A
+ * @member nnzB         Nonzero values of B
+ * @member nnzC         Nonzero values of the product
+ * @member flops        Floating point operations, see count_mul_flops
+ * @member kernel       Statistics of the kernel samples
+ * @member inputBytes   Size of A (in the layout of the kernel) and B in memory
+ * @member outputBytes  Size of the product in memory
+ * @member peakRss      Peak resident set size of the process in KB so far
+ * @member verified     1 if the product equals the reference product
+ */
+struct benchRow {
+    int family;
+    unsigned size;
+    double density;
+    int version;
+    uint64_t nnzA;
+    uint64_t nnzB;
+    uint64_t nnzC;
+    uint64_t flops;
+    struct benchSummary kernel;
+    uint64_t inputBytes;
+    uint64_t outputBytes;
+    long peakRss;
+    int verified;
+};
+
+static long peak_rss() {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) ? 0 : usage.ru_maxrss;
+}
+
+/**
+ * Computes A*B with a dense accumulator per column. It shares no code with
+ * the kernels and serves as the reference for their products.
+ *
+ * @return      1 if successful, 0 otherwise. errno is set on failure.
+ */
+static int reference_mul(const struct cscMatrix* a, const struct cscMatrix* b,
+        struct cscMatrix* c) {
+    memset(c, 0, sizeof(*c));
+    c->rows = a->rows;
+    c->columns = b->columns;
+    uint64_t capacity = a->valueCount + b->valueCount + 1;
+    float* acc = calloc(a->rows, sizeof(float));
+    uint64_t* marker = malloc(a->rows * sizeof(uint64_t));
+    c->colPtr = malloc((b->columns + 1) * sizeof(uint64_t));
+    c->rowIndices = malloc(capacity * sizeof(uint64_t));
+    c->values = malloc(capacity * sizeof(float));
+    int ok = acc && marker && c->colPtr && c->rowIndices && c->values;
+    for (uint64_t i = 0; ok && i < a->rows; i++) marker[i] = UINT64_MAX;
+
+    uint64_t k = 0;
+    for (uint64_t j = 0; ok && j < b->columns; j++) {
+        c->colPtr[j] = k;
+        for (uint64_t p = b->colPtr[j]; p < b->colPtr[j + 1]; p++) {
+            uint64_t col = b->rowIndices[p];
+            for (uint64_t q = a->colPtr[col]; q < a->colPtr[col + 1]; q++) {
+                uint64_t row = a->rowIndices[q];
+                if (marker[row] != j) {
+                    marker[row] = j;
+                    acc[row] = 0;
+                    if (k == capacity) {
+                        capacity *= 2;
+                        uint64_t* r = realloc(c->rowIndices,
+                                capacity * sizeof(uint64_t));
+                        if (r) c->rowIndices = r;
+                        float* v = realloc(c->values, capacity * sizeof(float));
+                        if (v) c->values = v;
+                        if (!r || !v) {
+                            ok = 0;
+                            break;
+                        }
+                    }
+                    c->rowIndices[k++] = row;
+                }
+                acc[row] += a->values[q] * b->values[p];
+            }
+            if (!ok) break;
+        }
+        if (!ok) break;
+        // Rows of the column in ascending order, without zero sums
+        uint64_t start = c->colPtr[j], end = k;
+        for (uint64_t i = start + 1; i < end; i++) {
+            uint64_t row = c->rowIndices[i], m = i;
+            for (; m > start && c->rowIndices[m - 1] > row; m--) {
+                c->rowIndices[m] = c->rowIndices[m - 1];
+            }
+            c->rowIndices[m] = row;
+        }
+        k = start;
+        for (uint64_t i = start; i < end; i++) {
+            uint64_t row = c->rowIndices[i];
+            if (acc[row] == 0) continue;
+            c->rowIndices[k] = row;
+            c->values[k++] = acc[row];
+        }
+    }
+    if (ok) {
+        c->colPtr[b->columns] = k;
+        c->valueCount = k;
+    }
+    free(acc);
+    free(marker);
+    if (!ok) {
+        free_csc_members(c);
+        errno = ENOMEM;
+    }
+    return ok;
+}
+
+/**
+ * Splits a comma separated list of numbers.
+ *
+ * @return  Amount of numbers, 0 if the list is invalid
+ */
+static unsigned parse_list(char* list, double* numbers) {
+    unsigned count = 0;
+    for (char* token = strtok(list, ","); token; token = strtok(0, ",")) {
+        char* end;
+        if (count == BENCH_MAX_LIST) return 0;
+        numbers[count++] = strtod(token, &end);
+        if (end == token || *end) return 0;
+    }
+    return count;
+}
+
+static void write_csv_row(FILE* csv, const struct benchRow* r) {
+    fprintf(csv, "%s,%u,%g,%d,%lu,%lu,%lu,%lu,%u,%.9g,%.9g,%.9g,%.9g,%.9g,"
+            "%.9g,%.6g,%lu,%lu,%ld,%d\n", familyNames[r->family], r->size,
+            r->density, r->version, r->nnzA, r->nnzB, r->nnzC, r->flops,
+            r->kernel.count, r->kernel.median, r->kernel.p90, r->kernel.p99,
+            r->kernel.min, r->kernel.mean, r->kernel.stddev,
+            r->flops / r->kernel.median / 1e9, r->inputBytes, r->outputBytes,
+            r->peakRss, r->verified);
+}
+
+static void write_json_row(FILE* json, const struct benchRow* r, int first) {
+    fprintf(json, "%s\n  {\"family\": \"%s\", \"size\": %u, \"density\": %g, "
+            "\"version\": %d, \"nnz_a\": %lu, \"nnz_b\": %lu, \"nnz_c\": %lu, "
+            "\"flops\": %lu, \"samples\": %u, \"median_s\": %.9g, "
+            "\"p90_s\": %.9g, \"p99_s\": %.9g, \"min_s\": %.9g, "
+            "\"mean_s\": %.9g, \"stddev_s\": %.9g, \"gflops\": %.6g, "
+            "\"input_bytes\": %lu, \"output_bytes\": %lu, "
+            "\"peak_rss_kb\": %ld, \"verified\": %s}", first ? "" : ",",
+            familyNames[r->family], r->size, r->density, r->version, r->nnzA,
+            r->nnzB, r->nnzC, r->flops, r->kernel.count, r->kernel.median,
+            r->kernel.p90, r->kernel.p99, r->kernel.min, r->kernel.mean,
+            r->kernel.stddev, r->flops / r->kernel.median / 1e9,
+            r->inputBytes, r->outputBytes, r->peakRss,
+            r->verified ? "true" : "false");
+}
+
+/**
+ * Benchmarks the selected kernels on one pair of generated matrices and
+ * writes a row per kernel.
+ *
+ * @return  Amount of kernels whose product differs from the reference, or -1
+ *          if an error occurred
+ */
+static int bench_pair(int family, unsigned size, double density,
+        uint64_t seed, const int* versions, unsigned versionCount,
+        const struct benchConfig* config, FILE* csv, FILE* json,
+        int* firstRow) {
+    void (*kernels[])(const void*, const void*, void*) = {matr_mult_csc,
+        matr_mult_csc_V1, matr_mult_csc_V2};
+    struct cscMatrix a, b, a_t = {0}, expected = {0};
+    double* samples = malloc(config->iterations * sizeof(double));
+    errno = 0;
+    int ok = samples
+        && generate_family(&a, family, size, size, density, seed, 1);
+    if (ok && !generate_family(&b, family, size, size, density, seed + 1,
+                1)) {
+        free_csc_members(&a);
+        ok = 0;
+    }
+    if (!ok) {
+        free(samples);
+        perror("Unable to generate matrices");
+        return -1;
+    }
+    // The kernels are only called with nonzero inputs, like in main.c
+    if (!a.valueCount || !b.valueCount) {
+        printf("%-14s %6u %8g  skipped, an input has no nonzero values\n",
+                familyNames[family], size, density);
+        free_csc_members(&a);
+        free_csc_members(&b);
+        free(samples);
+        return 0;
+    }
+    ok = transpose_csc(&a, &a_t) && reference_mul(&a, &b, &expected);
+
+    int mismatches = 0;
+    uint64_t flops = count_mul_flops(&a, &b);
+    for (unsigned v = 0; ok && v < versionCount; v++) {
+        struct cscMatrix result = {0};
+        const struct cscMatrix* factor = versions[v] == 2 ? &a : &a_t;
+        struct benchRow row = {family, size, density, versions[v],
+            a.valueCount, b.valueCount, 0, flops, {0}, 0, 0, 0, 0};
+        ok = bench_kernel(kernels[versions[v]], factor, &b, config, samples,
+                &result) && summarize_samples(samples, config->iterations,
+                    &row.kernel);
+        if (!ok) break;
+        row.nnzC = result.valueCount;
+        row.inputBytes = csc_matrix_bytes(factor) + csc_matrix_bytes(&b);
+        row.outputBytes = csc_matrix_bytes(&result);
+        row.peakRss = peak_rss();
+        row.verified = cmp_csc_eq(&result, &expected);
+        mismatches += !row.verified;
+        free_csc_members(&result);
+
+        printf("%-14s %6u %8g  V%d  %12.4f ms  %8.3f GFLOP/s  %10.1f MB  %s\n",
+                familyNames[family], size, density, versions[v],
+                1e3 * row.kernel.median, flops / row.kernel.median / 1e9,
+                (row.inputBytes + row.outputBytes) / 1e6,
+                row.verified ? "ok" : "MISMATCH");
+        fflush(stdout);
+        write_csv_row(csv, &row);
+        write_json_row(json, &row, *firstRow);
+        *firstRow = 0;
+    }
+    if (!ok) perror("Benchmark failed");
+
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    free_csc_members(&expected);
+    free(samples);
+    return ok ? mismatches : -1;
+}
+
+int main(int argc, char* argv[]) {
+    int families[FAMILY_COUNT], versions[3] = {0, 1, 2};
+    unsigned familyCount = FAMILY_COUNT, versionCount = 3;
+    double sizes[BENCH_MAX_LIST] = {256, 512}, densities[BENCH_MAX_LIST] =
+        {0.005, 0.02}, numbers[BENCH_MAX_LIST];
+    unsigned sizeCount = 2, densityCount = 2;
+    struct benchConfig config = {1, 3, 0};
+    unsigned seed = 1;
+    const char* prefix = "bench_results";
+    for (int f = 0; f < FAMILY_COUNT; f++) families[f] = f;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:n:d:V:i:w:s:co:h")) != -1) {
+        switch (opt) {
+            case 'f':
+                familyCount = 0;
+                for (char* name = strtok(optarg, ","); name;
+                        name = strtok(0, ",")) {
+                    int f = parse_family(name);
+                    if (f < 0 || familyCount == FAMILY_COUNT) {
+                        fprintf(stderr, "Unknown matrix family: %s\n", name);
+                        return EXIT_FAILURE;
+                    }
+                    families[familyCount++] = f;
+                }
+                break;
+            case 'n':
+            case 'd':
+            case 'V': {
+                unsigned count = parse_list(optarg, numbers);
+                for (unsigned i = 0; i < count; i++) {
+                    double x = numbers[i];
+                    if (opt == 'n' ? x < 1 || x != (unsigned) x
+                            : opt == 'd' ? x < 0 || x > 1
+                            : x != 0 && x != 1 && x != 2) count = 0;
+                }
+                if (!count || (opt == 'V' && count > 3)) {
+                    fprintf(stderr, "Invalid list: -%c\n", opt);
+                    return EXIT_FAILURE;
+                }
+                if (opt == 'n') {
+                    memcpy(sizes, numbers, count * sizeof(double));
+                    sizeCount = count;
+                } else if (opt == 'd') {
+                    memcpy(densities, numbers, count * sizeof(double));
+                    densityCount = count;
+                } else {
+                    for (unsigned i = 0; i < count; i++) {
+                        versions[i] = numbers[i];
+                    }
+                    versionCount = count;
+                }
+                break;
+            }
+            case 'i':
+                if (convert_unsigned(optarg, &config.iterations) != 0) {
+                    return EXIT_FAILURE;
+                }
+                if (!config.iterations) {
+                    fprintf(stderr, "The benchmark needs at least one "
+                            "iteration.\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'w':
+                if (convert_unsigned(optarg, &config.warmup) != 0) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's':
+                if (convert_unsigned(optarg, &seed) != 0) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'c':
+                config.flush = 1;
+                break;
+            case 'o':
+                prefix = optarg;
+                break;
+            case 'h':
+                printf(bench_usage, argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                fprintf(stderr, bench_usage, argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    char csvName[4096], jsonName[4096];
+    snprintf(csvName, sizeof(csvName), "%s.csv", prefix);
+    snprintf(jsonName, sizeof(jsonName), "%s.json", prefix);
+    FILE* csv = fopen(csvName, "w");
+    FILE* json = fopen(jsonName, "w");
+    if (!csv || !json) {
+        perror("Unable to open output file");
+        if (csv) fclose(csv);
+        if (json) fclose(json);
+        return EXIT_FAILURE;
+    }
+    fprintf(csv, "family,size,density,version,nnz_a,nnz_b,nnz_c,flops,"
+            "samples,median_s,p90_s,p99_s,min_s,mean_s,stddev_s,gflops,"
+            "input_bytes,output_bytes,peak_rss_kb,verified\n");
+    fprintf(json, "[");
+
+    int failures = 0, firstRow = 1;
+    for (unsigned f = 0; f < familyCount && failures >= 0; f++) {
+        for (unsigned n = 0; n < sizeCount && failures >= 0; n++) {
+            for (unsigned d = 0; d < densityCount; d++) {
+                int res = bench_pair(families[f], sizes[n], densities[d],
+                        seed, versions, versionCount, &config, csv, json,
+                        &firstRow);
+                if (res < 0) {
+                    failures = -1;
+                    break;
+                }
+                failures += res;
+            }
+        }
+    }
+    fprintf(json, "\n]\n");
+    int closed = !fclose(csv) & !fclose(json);
+    if (!closed) perror("Unable to write output file");
+    if (failures) {
+        fprintf(stderr, failures > 0 ? "%d products differ from the "
+                "reference.\n" : "The benchmark was aborted.\n", failures);
+    } else {
+        printf("Results written to %s and %s.\n", csvName, jsonName);
+    }
+    return !failures && closed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "bounded_queue.h"
+
+int init_queue(struct boundedQueue* q, unsigned capacity) {
+    q->items = malloc(capacity * sizeof(void*));
+    if (!q->items) {
+        errno = ENOMEM;
+        return 0;
+    }
+    q->capacity = capacity;
+    q->head = 0;
+    q->count = 0;
+    q->closed = 0;
+    pthread_mutex_init(&q->lock, 0);
+    pthread_cond_init(&q->notEmpty, 0);
+    pthread_cond_init(&q->notFull, 0);
+    return 1;
+}
+
+void destroy_queue(struct boundedQueue* q) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->notEmpty);
+    pthread_cond_destroy(&q->notFull);
+    free(q->items);
+    q->items = 0;
+}
+
+int push_queue(struct boundedQueue* q, void* item) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->capacity && !q->closed) {
+        pthread_cond_wait(&q->notFull, &q->lock);
+    }
+    if (q->closed) {
+        pthread_mutex_unlock(&q->lock);
+        return 0;
+    }
+    q->items[(q->head + q->count) % q->capacity] = item;
+    q->count++;
+    pthread_cond_signal(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+    return 1;
+}
+
+void* pop_queue(struct boundedQueue* q) {
+    pthread_mutex_lock(&q->lock);
+    while (!q->count && !q->closed) {
+        pthread_cond_wait(&q->notEmpty, &q->lock);
+    }
+    void* item = 0;
+    if (q->count) {
+        item = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        pthread_cond_signal(&q->notFull);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return item;
+}
+
+void close_queue(struct boundedQueue* q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->notEmpty);
+    pthread_cond_broadcast(&q->notFull);
+    pthread_mutex_unlock(&q->lock);
+}
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <float.h>
 #include <errno.h>
+#include <math.h>
 
 #include "cs_matrix.h"
 
@@ -205,18 +206,6 @@ void generate_csc_matr(struct cscMatrix* dest, uint64_t rows, uint64_t columns,
     dest->values = values;
 }
 
-void generateCSCMatrixTranspose(struct cscMatrixTranspose* dest, uint64_t rows, 
-        uint64_t columns, uint64_t valueCount, uint64_t* rowIndices, 
-        uint64_t* colIndices, uint64_t* colPtr, float* values) {
-    dest->rows = rows;
-    dest->columns = columns;
-    dest->valueCount = valueCount;
-    dest->rowIndices = rowIndices;
-    dest->colIndices = colIndices;
-    dest->colPtr = colPtr;
-    dest->values = values;
-}
-
 void calculateColumnIndices(uint64_t *colPtr, uint64_t numCols, uint64_t *colInd) {
     for (uint64_t j = 0; j < numCols; j++) {
         for (uint64_t i = colPtr[j]; i < colPtr[j + 1]; i++) {
@@ -292,80 +281,6 @@ void generate_csc_matr_rand(struct cscMatrix* dest, int minD_inv,
     free(rowIndices);
 }
 
-void generateCSCMatrixTRand(struct cscMatrixTranspose* dest, int minD_inv,
-        int maxD_inv) {    
-
-    dest->valueCount = 0;
-    uint64_t maxVals;
-    bool of = __builtin_umull_overflow(dest->rows, dest->columns, &maxVals);
-    if (of) {
-        errno = ERANGE;
-        return;
-    }
-    float* vals = malloc(maxVals * sizeof(float));
-    uint64_t* rowIndices = malloc(maxVals * sizeof(uint64_t));
-    uint64_t* colIndices = malloc(maxVals * sizeof(uint64_t));
-    dest->colPtr = calloc(dest->columns+1, sizeof(uint64_t));
-    if (!vals || !rowIndices || !dest->colPtr) {
-        free(vals);
-        free(rowIndices);
-        free(colIndices);
-        free(dest->colPtr);
-        errno = ENOMEM;
-        return;
-    }
-
-    int density = maxD_inv + random() % minD_inv;
-
-    for (uint64_t i = 0; i < maxVals; ++i) {
-        if (logData && !(i % 100)) {
-            printf("\rGenerating matrix. %.0f%% done", 100*((double)i)/maxVals);
-            fflush(stdout);
-        }
-        if (!(i % dest->rows) && (i / dest->rows) < dest->columns) {
-            dest->colPtr[(i/dest->rows) + 1] = dest->colPtr[i / dest->rows];
-        } 
-
-        if (!(rand() % density)) {
-            float nextVal;
-            do {
-                nextVal = ((float)(rand() % 10000))/100;
-            } while(!nextVal);
-            vals[dest->valueCount] = nextVal; 
-            colIndices[dest->valueCount] = i / dest->rows;
-            rowIndices[dest->valueCount++] = i % dest->rows;
-            dest->colPtr[(i / dest->rows) + 1]++;
-        }
-    }
-
-    dest->rowIndices = malloc(dest->valueCount * sizeof(uint64_t));
-    dest->colIndices = malloc(dest->valueCount * sizeof(uint64_t));
-    dest->values = malloc(dest->valueCount * sizeof(float));
-
-    if (!dest->rowIndices || !dest->values || !dest->colIndices) {
-        free(dest->colPtr);
-        free(dest->rowIndices);
-        free(dest->colIndices);
-        free(dest->values);
-        errno = ENOMEM;
-        return;
-    }
-
-    for (uint64_t i = 0; i < dest->valueCount; ++i) {
-        if (logData && !(i % 100)) {
-            printf("\rStoring data. %.0f%% done.", 100*((double)i)/dest->valueCount);
-            fflush(stdout);
-        }
-        dest->rowIndices[i] = rowIndices[i];
-        dest->colIndices[i] = colIndices[i];
-        dest->values[i] = vals[i];
-    }
-    free(vals);
-    free(rowIndices);
-    free(colIndices);
-}
-
-
 /**
  * Stores a row of a CSC matrix into a float*
  *
@@ -486,18 +401,77 @@ void printCSCMatrixMetadata(struct cscMatrix* m) {
     printf("colPtr: ");
     printUint64Vector(m->colPtr, m->columns+1);
 }
-void printCSCMatrixMetadataT(struct cscMatrixTranspose* m) {
-    printf("rows: %lu\n", m->rows);
-    printf("columns: %lu\n", m->columns);
-    printf("valueCount: %lu\n", m->valueCount);
-    printf("values: ");
-    printFloatVector(m->values, m->valueCount);
-    printf("rowIndices: ");
-    printUint64Vector(m->rowIndices, m->valueCount);
-    printf("colPtr: ");
-    printUint64Vector(m->colPtr, m->columns+1);
-    printf("colIndices: ");
-    printUint64Vector(m->colIndices, m->valueCount);
+
+unsigned csc_histogram_bucket(uint64_t n) {
+    unsigned b = n ? 64 - __builtin_clzll(n) : 0;
+    return b < CSC_HISTOGRAM_BUCKETS ? b : CSC_HISTOGRAM_BUCKETS - 1;
+}
+
+void compute_csc_statistics(const struct cscMatrix* m,
+        struct cscStatistics* s) {
+    memset(s, 0, sizeof(*s));
+    s->rows = m->rows;
+    s->columns = m->columns;
+    s->valueCount = m->valueCount;
+    if (m->rows && m->columns) {
+        s->density = (double) m->valueCount / m->rows / m->columns;
+    }
+    if (!m->columns) return;
+    s->minColumn = UINT64_MAX;
+    double squares = 0;
+    for (uint64_t j = 0; j < m->columns; j++) {
+        uint64_t start = m->colPtr[j], end = m->colPtr[j + 1];
+        uint64_t n = end - start;
+        s->histogram[csc_histogram_bucket(n)]++;
+        if (n < s->minColumn) s->minColumn = n;
+        if (n > s->maxColumn) s->maxColumn = n;
+        squares += (double) n * n;
+        if (!n) {
+            s->emptyColumns++;
+            continue;
+        }
+        // The row indices of a column are not necessarily sorted
+        uint64_t first = m->rowIndices[start], last = first;
+        for (uint64_t i = start + 1; i < end; i++) {
+            if (m->rowIndices[i] < first) first = m->rowIndices[i];
+            if (m->rowIndices[i] > last) last = m->rowIndices[i];
+        }
+        if (first < j) {
+            if (j - first > s->upperBandwidth) s->upperBandwidth = j - first;
+            s->profile += j - first;
+        }
+        if (last > j && last - j > s->lowerBandwidth) {
+            s->lowerBandwidth = last - j;
+        }
+    }
+    s->meanColumn = (double) m->valueCount / m->columns;
+    double variance = squares / m->columns - s->meanColumn * s->meanColumn;
+    s->stddevColumn = variance > 0 ? sqrt(variance) : 0;
+}
+
+void printCSCColumnHistogram(const char* name, const uint64_t* hist) {
+    printf("Values per column of %s:", name);
+    for (int i = 0; i < CSC_HISTOGRAM_BUCKETS; i++) {
+        if (!hist[i]) continue;
+        if (!i) printf(" 0: %lu", hist[i]);
+        else if (i == CSC_HISTOGRAM_BUCKETS - 1) {
+            printf(" >=%lu: %lu", 1UL << (i - 1), hist[i]);
+        } else printf(" <%lu: %lu", 1UL << i, hist[i]);
+    }
+    printf("\n");
+}
+
+void printCSCMatrixStatistics(const char* name,
+        const struct cscStatistics* s) {
+    printf("Matrix %s\n", name);
+    printf("Dimensions: %lu rows and %lu columns\n", s->rows, s->columns);
+    printf("Nonzero values: %lu (density %.4g)\n", s->valueCount, s->density);
+    printf("Values per column: min %lu, max %lu, mean %.4g, stddev %.4g, "
+            "%lu empty\n", s->columns ? s->minColumn : 0, s->maxColumn,
+            s->meanColumn, s->stddevColumn, s->emptyColumns);
+    printCSCColumnHistogram(name, s->histogram);
+    printf("Bandwidth: %lu below and %lu above the diagonal, profile %lu\n",
+            s->lowerBandwidth, s->upperBandwidth, s->profile);
 }
 
 int testVectorPurity(float* vector, uint64_t len) {
@@ -525,24 +499,3 @@ int is_valid_csc(struct cscMatrix* m) {
     if (m->colPtr[m->columns] != m->valueCount) return -5;
     return 1;
 }
-
-int is_valid_csc_transpose(struct cscMatrixTranspose* m) {
-    if (m->rows < 1 || m->columns < 1) return -1;
-
-    for (uint64_t i = 0; i < m->valueCount; ++i) {
-        if (m->rowIndices[i] >= m->rows) return -2;
-        if (m->colIndices[i] >= m->columns) return -3; 
-        if (m->values[i] == 0) {
-            printf("Zero at index %lu: %f\n", i, m->values[i]);
-            return -4;
-        }
-        if (i < m->valueCount - 1 && m->colIndices[i+1] < m->colIndices[i]) 
-            return -5;
-    }
-
-    for (uint64_t i = 0; i < m->columns; ++i) {
-        if (m->colPtr[i+1] < m->colPtr[i]) return -6;
-    }
-    if (m->colPtr[m->columns] != m->valueCount) return -7;
-    return 1;
-}
@@ -0,0 +1,410 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "csc_batch.h"
+#include "bounded_queue.h"
+#include "csc_bench.h"
+#include "csc_binary.h"
+#include "csc_context.h"
+#include "csc_io.h"
+#include "csc_model.h"
+#include "csc_mtx.h"
+#include "csc_pool.h"
+#include "csc_writer.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+#include "cs_matrix.h"
+
+static const char* stageNames[BATCH_STAGES] = {"parse", "multiply", "write"};
+
+/**
+ * @class batchItem
+ *
+ * A job on its way through the pipeline. Each stage owns the item between
+ * popping it from its input queue and pushing it to its output queue.
+ *
+ * @member job          The job
+ * @member a            A, or its transpose if version is not 2
+ * @member b            B
+ * @member result       The product, colPtr is null until it is computed
+ * @member loaded       Nonzero if a and b hold matrices
+ * @member version      Kernel that computes the product
+ * @member inputBytes   Size of the input files
+ * @member inputValues  Nonzero values of the inputs
+ * @member flops        Floating point operations of the product
+ * @member error        Message of the first failure, empty on success
+ */
+struct batchItem {
+    const struct batchJob* job;
+    struct cscFile a;
+    struct cscFile b;
+    struct cscMatrix result;
+    int loaded;
+    int version;
+    uint64_t inputBytes;
+    uint64_t inputValues;
+    uint64_t flops;
+    char error[256];
+};
+
+/**
+ * @class batchPipeline
+ *
+ * State shared by the stages of run_batch
+ *
+ * @member jobs     The jobs
+ * @member count    Amount of jobs
+ * @member config   Settings of the jobs
+ * @member model    Cost model of VERSION_AUTO
+ * @member parsed   Items with loaded inputs
+ * @member products Items with computed products
+ * @member busy     Time every stage spent working, each written by its stage
+ */
+struct batchPipeline {
+    const struct batchJob* jobs;
+    unsigned count;
+    const struct batchConfig* config;
+    struct costModel model;
+    struct boundedQueue parsed;
+    struct boundedQueue products;
+    double busy[BATCH_STAGES];
+};
+
+static double seconds_since(const struct timespec* start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + 1e-9 * (end.tv_nsec
+            - start->tv_nsec);
+}
+
+static uint64_t file_size(const char* filename) {
+    struct stat st;
+    return stat(filename, &st) ? 0 : (uint64_t) st.st_size;
+}
+
+// Splits the next whitespace separated word off a line
+static char* next_word(char** line) {
+    char* s = *line + strspn(*line, " \t\r\n");
+    if (!*s) return 0;
+    char* end = s + strcspn(s, " \t\r\n");
+    *line = *end ? end + 1 : end;
+    *end = 0;
+    return s;
+}
+
+void free_batch_jobs(struct batchJob* jobs, unsigned count) {
+    for (unsigned i = 0; i < count; i++) {
+        free(jobs[i].a);
+        free(jobs[i].b);
+        free(jobs[i].output);
+    }
+    free(jobs);
+}
+
+int read_batch_manifest(const char* filename, struct batchJob** jobs,
+        unsigned* count) {
+    FILE* file = fopen(filename, "r");
+    if (!file) return 0;
+    struct batchJob* list = 0;
+    unsigned n = 0, capacity = 0, line = 0;
+    char* buffer = 0;
+    size_t size = 0;
+    int ok = 1;
+    while (ok && getline(&buffer, &size, file) >= 0) {
+        line++;
+        char* rest = buffer;
+        char* words[4];
+        int found = 0;
+        while (found < 4 && (words[found] = next_word(&rest))) found++;
+        if (!found || words[0][0] == '#') continue;
+        if (found != 3) {
+            fprintf(stderr, "%s:%u: expected the files of A, B and the "
+                    "result.\n", filename, line);
+            errno = EINVAL;
+            ok = 0;
+            break;
+        }
+        if (n == capacity) {
+            capacity = capacity ? 2 * capacity : 16;
+            struct batchJob* grown = realloc(list, capacity * sizeof(*list));
+            if (!grown) {
+                errno = ENOMEM;
+                ok = 0;
+                break;
+            }
+            list = grown;
+        }
+        struct batchJob* job = &list[n];
+        job->a = strdup(words[0]);
+        job->b = strdup(words[1]);
+        job->output = strdup(words[2]);
+        job->line = line;
+        n++;
+        if (!job->a || !job->b || !job->output) {
+            errno = ENOMEM;
+            ok = 0;
+        }
+    }
+    if (ok && ferror(file)) {
+        errno = EIO;
+        ok = 0;
+    }
+    free(buffer);
+    fclose(file);
+    if (!ok) {
+        free_batch_jobs(list, n);
+        return 0;
+    }
+    *jobs = list;
+    *count = n;
+    return 1;
+}
+
+// Loads the inputs of an item, A as its transpose unless version 2 is fixed
+static void parse_item(struct batchPipeline* p, struct batchItem* item) {
+    const struct batchConfig* c = p->config;
+    const struct batchJob* job = item->job;
+    item->version = c->version;
+    errno = 0;
+    load_csc_files(job->a, job->b, &item->a, &item->b, c->version != 2,
+            c->threads, c->cache, 0);
+    if (errno) {
+        snprintf(item->error, sizeof(item->error), "loading the inputs "
+                "failed: %s", strerror(errno));
+        return;
+    }
+    item->loaded = 1;
+    item->inputBytes = file_size(job->a) + file_size(job->b);
+    item->inputValues = item->a.matrix.valueCount + item->b.matrix.valueCount;
+}
+
+/**
+ * Selects the kernel of an item with VERSION_AUTO. A was loaded as its
+ * transpose, which is transposed back if version 2 is selected.
+ *
+ * @return  1 if successful, 0 otherwise. errno is set on failure.
+ */
+static int select_item_version(struct batchPipeline* p,
+        struct batchItem* item) {
+    struct mulFeatures features;
+    struct mulPlan plan;
+    if (!compute_features(&item->a.matrix, &item->b.matrix, 1, &features)) {
+        return 0;
+    }
+    plan_multiplication(&features, &p->model, &plan);
+    item->version = plan.version;
+    if (plan.version != 2) return 1;
+
+    struct cscMatrix a;
+    if (!transpose_csc_mt(&item->a.matrix, &a, p->config->threads)) return 0;
+    release_csc_file(&item->a);
+    memset(&item->a, 0, sizeof(item->a));
+    item->a.matrix = a;
+    return 1;
+}
+
+// Computes the product of an item and releases its inputs
+static void multiply_item(struct batchPipeline* p, struct batchItem* item) {
+    const struct cscMatrix* a = &item->a.matrix;
+    const struct cscMatrix* b = &item->b.matrix;
+    // The dimensions were checked by load_csc_files
+    uint64_t rows = p->config->version != 2 ? a->columns : a->rows;
+    int status = CSC_OK;
+    errno = 0;
+    // The kernels are not run on an input without values
+    if (!a->valueCount || !b->valueCount) {
+        item->result = (struct cscMatrix) {rows, b->columns, 0, 0, 0,
+            calloc(b->columns + 1, sizeof(uint64_t))};
+        status = item->result.colPtr ? CSC_OK : CSC_OUT_OF_MEMORY;
+    } else if (item->version == VERSION_AUTO
+            && !select_item_version(p, item)) {
+        status = csc_errno_status(errno);
+    } else {
+        struct cscContext ctx;
+        csc_context_init(&ctx);
+        ctx.pool = csc_shared_pool(p->config->threads);
+        status = mul_csc_ctx(&ctx, item->version, &item->a.matrix, b,
+                &item->result);
+        struct mulMetrics metrics;
+        if (!status && mul_metrics(&item->a.matrix, b, item->version != 2,
+                    &item->result, &metrics)) {
+            item->flops = metrics.flops;
+        }
+    }
+    if (status) {
+        snprintf(item->error, sizeof(item->error), "multiplication failed: "
+                "%s", csc_status_string(status));
+    }
+    release_csc_file(&item->b);
+    release_csc_file(&item->a);
+    item->loaded = 0;
+}
+
+// Writes the result of an item, returns the size of the written file
+static uint64_t write_item(struct batchPipeline* p, struct batchItem* item) {
+    const char* output = item->job->output;
+    errno = 0;
+    int ok = has_mtx_extension(output)
+        ? write_mtx_file(&item->result, output, p->config->precision)
+        : write_csc_text_mt(&item->result, output, p->config->precision,
+                p->config->threads);
+    if (!ok) {
+        snprintf(item->error, sizeof(item->error), "writing the result "
+                "failed: %s", strerror(errno ? errno : EIO));
+        return 0;
+    }
+    return file_size(output);
+}
+
+static void free_item(struct batchItem* item) {
+    if (item->loaded) {
+        release_csc_file(&item->b);
+        release_csc_file(&item->a);
+    }
+    if (item->result.colPtr) free_csc_members(&item->result);
+    free(item);
+}
+
+static void* run_parse_stage(void* arg) {
+    struct batchPipeline* p = arg;
+    for (unsigned i = 0; i < p->count; i++) {
+        struct batchItem* item = calloc(1, sizeof(struct batchItem));
+        if (!item) {
+            // The job never reaches the writing stage and is counted as
+            // failed by run_batch
+            fprintf(stderr, "Job in line %u failed: %s\n", p->jobs[i].line,
+                    strerror(ENOMEM));
+            continue;
+        }
+        item->job = &p->jobs[i];
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        parse_item(p, item);
+        p->busy[BATCH_PARSE] += seconds_since(&start);
+        push_queue(&p->parsed, item);
+    }
+    close_queue(&p->parsed);
+    return 0;
+}
+
+static void* run_multiply_stage(void* arg) {
+    struct batchPipeline* p = arg;
+    struct batchItem* item;
+    while ((item = pop_queue(&p->parsed))) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (item->loaded) multiply_item(p, item);
+        p->busy[BATCH_MULTIPLY] += seconds_since(&start);
+        push_queue(&p->products, item);
+    }
+    close_queue(&p->products);
+    return 0;
+}
+
+// Writes the results and sums up the totals on the calling thread
+static void run_write_stage(struct batchPipeline* p, struct batchStats* s) {
+    struct batchItem* item;
+    while ((item = pop_queue(&p->products))) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (!item->error[0]) {
+            s->outputBytes += write_item(p, item);
+        }
+        p->busy[BATCH_WRITE] += seconds_since(&start);
+
+        const struct batchJob* job = item->job;
+        if (item->error[0]) {
+            fprintf(stderr, "Job in line %u (%s * %s) failed: %s\n",
+                    job->line, job->a, job->b, item->error);
+        } else {
+            s->jobs++;
+            s->inputBytes += item->inputBytes;
+            s->inputValues += item->inputValues;
+            s->resultValues += item->result.valueCount;
+            s->flops += item->flops;
+            if (logData) {
+                printf("Wrote %s (%lu by %lu, %lu values", job->output,
+                        item->result.rows, item->result.columns,
+                        item->result.valueCount);
+                // No kernel is selected for an input without values
+                if (item->version >= 0) printf(", version %d", item->version);
+                printf(").\n");
+            }
+        }
+        free_item(item);
+    }
+}
+
+int run_batch(const struct batchJob* jobs, unsigned count,
+        const struct batchConfig* config, struct batchStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    struct batchPipeline p = {0};
+    p.jobs = jobs;
+    p.count = count;
+    p.config = config;
+    if (config->modelFile) {
+        if (!load_cost_model(config->modelFile, &p.model)) return 0;
+    } else {
+        default_cost_model(&p.model);
+    }
+    if (!init_queue(&p.parsed, BATCH_QUEUE_DEPTH)) return 0;
+    if (!init_queue(&p.products, BATCH_QUEUE_DEPTH)) {
+        destroy_queue(&p.parsed);
+        return 0;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t parser, multiplier;
+    int err = pthread_create(&parser, 0, run_parse_stage, &p);
+    if (!err) {
+        err = pthread_create(&multiplier, 0, run_multiply_stage, &p);
+        if (err) {
+            // Drains the parsed jobs so the parsing stage can finish
+            close_queue(&p.parsed);
+            pthread_join(parser, 0);
+            struct batchItem* item;
+            while ((item = pop_queue(&p.parsed))) free_item(item);
+        }
+    }
+    if (!err) {
+        run_write_stage(&p, stats);
+        pthread_join(multiplier, 0);
+        pthread_join(parser, 0);
+    }
+    destroy_queue(&p.products);
+    destroy_queue(&p.parsed);
+    if (err) {
+        errno = err;
+        return 0;
+    }
+
+    stats->seconds = seconds_since(&start);
+    memcpy(stats->busy, p.busy, sizeof(p.busy));
+    stats->failed = count - stats->jobs;
+    stats->jobs = count;
+    return 1;
+}
+
+void print_batch_stats(const struct batchStats* s) {
+    double seconds = s->seconds > 0 ? s->seconds : 1e-9;
+    printf("Ran %u jobs in %g s (%.2f jobs/s), %u failed.\n", s->jobs,
+            s->seconds, s->jobs / seconds, s->failed);
+    printf("Read %.1f MB (%.1f MB/s) with %lu input values (%.3g values/s).\n",
+            s->inputBytes / 1e6, s->inputBytes / 1e6 / seconds,
+            s->inputValues, s->inputValues / seconds);
+    printf("Wrote %.1f MB (%.1f MB/s) with %lu result values (%.3g "
+            "values/s).\n", s->outputBytes / 1e6, s->outputBytes / 1e6
+            / seconds, s->resultValues, s->resultValues / seconds);
+    printf("Multiplied with %.3g GFLOP/s over the whole batch.\n",
+            s->flops / 1e9 / seconds);
+    for (int i = 0; i < BATCH_STAGES; i++) {
+        printf("%-8s stage busy %g s (%.0f%% of the time).\n", stageNames[i],
+                s->busy[i], 100 * s->busy[i] / seconds);
+    }
+}
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include "csc_bench.h"
+#include "csc_binary.h"
+#include "csc_cache.h"
+#include "csc_writer.h"
+#include "csc_mtx.h"
+#include "csc_io.h"
+#include "cs_matrix.h"
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples, computed in integers so that
+// for example the 90th percentile of 10 samples is the 9th one
+static double percentile(const double* sorted, unsigned count,
+        unsigned percent) {
+    uint64_t rank = ((uint64_t) percent * count + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+int summarize_samples(const double* samples, unsigned count,
+        struct benchSummary* s) {
+    double* sorted = malloc(count * sizeof(double));
+    if (!count || !sorted) {
+        free(sorted);
+        errno = count ? ENOMEM : EINVAL;
+        return 0;
+    }
+    memcpy(sorted, samples, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), cmp_double);
+
+    double sum = 0;
+    for (unsigned i = 0; i < count; i++) sum += sorted[i];
+    double mean = sum / count, squares = 0;
+    for (unsigned i = 0; i < count; i++) {
+        squares += (sorted[i] - mean) * (sorted[i] - mean);
+    }
+
+    s->count = count;
+    s->min = sorted[0];
+    s->median = count % 2 ? sorted[count / 2]
+        : (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+    s->p90 = percentile(sorted, count, 90);
+    s->p99 = percentile(sorted, count, 99);
+    s->max = sorted[count - 1];
+    s->mean = mean;
+    s->stddev = count > 1 ? sqrt(squares / (count - 1)) : 0;
+    free(sorted);
+    return 1;
+}
+
+void flush_cpu_caches() {
+    static volatile unsigned char* buffer;
+    if (!buffer) buffer = malloc(CSC_BENCH_FLUSH_BYTES);
+    if (!buffer) return;
+    // One byte per cache line is enough to replace every line
+    for (size_t i = 0; i < CSC_BENCH_FLUSH_BYTES; i += 64) buffer[i] = i;
+    unsigned char x = 0;
+    for (size_t i = 0; i < CSC_BENCH_FLUSH_BYTES; i += 64) x ^= buffer[i];
+    // Keeps the reads from being optimized away
+    buffer[0] = x;
+}
+
+int bench_kernel(void (*mul)(const void*, const void*, void*),
+        const struct cscMatrix* a, const struct cscMatrix* b,
+        const struct benchConfig* config, double* samples,
+        struct cscMatrix* result) {
+    unsigned runs = config->warmup + config->iterations;
+    int ok = 1;
+    for (unsigned i = 0; ok && i < runs; i++) {
+        if (config->flush) flush_cpu_caches();
+        errno = 0;
+        double start = now();
+        mul(a, b, result);
+        double end = now();
+        if (errno) {
+            // The kernel already freed the result
+            ok = 0;
+            break;
+        }
+        if (i >= config->warmup) samples[i - config->warmup] = end - start;
+        if (i + 1 < runs) free_csc_members(result);
+    }
+    return ok;
+}
+
+int bench_multiplication(void (*mul)(const void*, const void*, void*),
+        int transposeA, const char* filename_a, const char* filename_b,
+        const char* output, int precision, unsigned threads,
+        const struct cscCache* cache, const struct benchConfig* config,
+        struct benchReport* report) {
+    memset(report, 0, sizeof(*report));
+    double* samples = malloc(config->iterations * sizeof(double));
+    if (!samples) {
+        errno = ENOMEM;
+        return 0;
+    }
+
+    struct cscFile a, b;
+    errno = 0;
+    double start = now();
+    int isZero = load_csc_files(filename_a, filename_b, &a, &b, transposeA,
+            threads, cache, &report->load);
+    report->parseTime = now() - start;
+    if (errno) {
+        free(samples);
+        return 0;
+    }
+    report->rows = transposeA ? a.matrix.columns : a.matrix.rows;
+    report->columns = b.matrix.columns;
+
+    struct cscMatrix result = {report->rows, report->columns, 0, 0, 0, 0};
+    // An empty product is written without running the kernel
+    int ok = isZero || (bench_kernel(mul, &a.matrix, &b.matrix, config,
+                samples, &result)
+            && summarize_samples(samples, config->iterations,
+                &report->kernel));
+    if (ok && !isZero && !mul_metrics(&a.matrix, &b.matrix, transposeA,
+                &result, &report->metrics)) {
+        free_csc_members(&result);
+        ok = 0;
+    }
+    int err = errno;
+    release_csc_file(&a);
+    release_csc_file(&b);
+    free(samples);
+
+    if (ok) {
+        report->valueCount = result.valueCount;
+        start = now();
+        if (has_mtx_extension(output)) {
+            ok = write_mtx_file(&result, output, precision);
+        } else if (isZero) {
+            errno = 0;
+            print_empty_matrix(result.rows, result.columns, output);
+            ok = !errno;
+        } else {
+            ok = write_csc_text_mt(&result, output, precision, threads);
+        }
+        report->writeTime = now() - start;
+        err = errno;
+        if (!isZero) free_csc_members(&result);
+    }
+    errno = err;
+    return ok;
+}
+
+uint64_t count_mul_flops(const struct cscMatrix* a, const struct cscMatrix* b) {
+    uint64_t products = 0;
+    for (uint64_t i = 0; i < b->valueCount; i++) {
+        uint64_t k = b->rowIndices[i];
+        products += a->colPtr[k + 1] - a->colPtr[k];
+    }
+    return 2 * products;
+}
+
+uint64_t csc_matrix_bytes(const struct cscMatrix* m) {
+    return (m->columns + 1) * sizeof(uint64_t)
+        + m->valueCount * (sizeof(uint64_t) + sizeof(float));
+}
+
+int mul_metrics(const struct cscMatrix* a, const struct cscMatrix* b,
+        int transposedA, const struct cscMatrix* result,
+        struct mulMetrics* m) {
+    if (transposedA) {
+        // The values of column k of A are the values of row k of its
+        // transpose, so they are counted first
+        uint64_t* counts = calloc(a->rows + 1, sizeof(uint64_t));
+        if (!counts) {
+            errno = ENOMEM;
+            return 0;
+        }
+        for (uint64_t i = 0; i < a->valueCount; i++) {
+            counts[a->rowIndices[i]]++;
+        }
+        m->products = 0;
+        for (uint64_t i = 0; i < b->valueCount; i++) {
+            m->products += counts[b->rowIndices[i]];
+        }
+        free(counts);
+    } else {
+        m->products = count_mul_flops(a, b) / 2;
+    }
+    m->flops = 2 * m->products;
+    m->valueCount = result->valueCount;
+    m->compression = result->valueCount
+        ? (double) m->products / result->valueCount : 0;
+    m->bytes = csc_matrix_bytes(a) + csc_matrix_bytes(b)
+        + csc_matrix_bytes(result);
+    return 1;
+}
+
+void print_mul_metrics(const struct mulMetrics* m, double seconds) {
+    printf("%lu multiply-adds into %lu values (compression ratio %.2f), "
+            "%.1f MB touched:\n%.3f GFLOP/s, %.3f GB/s effective.\n",
+            m->products, m->valueCount, m->compression, m->bytes / 1e6,
+            seconds > 0 ? m->flops / seconds / 1e9 : 0,
+            seconds > 0 ? m->bytes / seconds / 1e9 : 0);
+}
+
+void print_bench_summary(const char* phase, const struct benchSummary* s) {
+    printf("%-8s %6u samples  median %10.4f ms  p90 %10.4f ms  "
+            "p99 %10.4f ms  min %10.4f ms  max %10.4f ms  "
+            "mean %10.4f ms  stddev %8.4f ms\n", phase, s->count,
+            1e3 * s->median, 1e3 * s->p90, 1e3 * s->p99, 1e3 * s->min,
+            1e3 * s->max, 1e3 * s->mean, 1e3 * s->stddev);
+}
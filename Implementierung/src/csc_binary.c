@@ -0,0 +1,480 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "csc_binary.h"
+#include "csc_mmap.h"
+#include "csc_mtx.h"
+#include "csc_cache.h"
+#include "csc_io.h"
+#include "cs_matrix.h"
+#include "transpose.h"
+#include "csc_trace.h"
+
+_Static_assert(sizeof(struct cscBinaryHeader) == 120,
+        "The binary header must not contain padding");
+
+static const char zeros[CSC_BINARY_ALIGNMENT];
+
+static uint64_t align_offset(uint64_t offset) {
+    return (offset + CSC_BINARY_ALIGNMENT - 1)
+        & ~(uint64_t) (CSC_BINARY_ALIGNMENT - 1);
+}
+
+uint64_t csc_checksum(const void* data, uint64_t size) {
+    const unsigned char* p = data;
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ size;
+    uint64_t word;
+    for (; size >= 8; p += 8, size -= 8) {
+        memcpy(&word, p, 8);
+        h = (h ^ word) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    if (size) {
+        word = 0;
+        memcpy(&word, p, size);
+        h = (h ^ word) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 29);
+}
+
+/**
+ * Writes an array followed by zeros up to the next multiple of
+ * CSC_BINARY_ALIGNMENT.
+ */
+static int write_padded(FILE* file, const void* data, uint64_t size) {
+    if (size && fwrite(data, 1, size, file) != size) return 0;
+    uint64_t padding = align_offset(size) - size;
+    return !padding || fwrite(zeros, 1, padding, file) == padding;
+}
+
+int write_csc_binary(const struct cscMatrix* m, int transposed,
+        const char* filename) {
+    uint64_t colPtrSize = (m->columns + 1) * sizeof(uint64_t);
+    uint64_t rowIndicesSize = m->valueCount * sizeof(uint64_t);
+    uint64_t valuesSize = m->valueCount * sizeof(float);
+
+    struct cscBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CSC_BINARY_MAGIC, sizeof(header.magic));
+    header.version = CSC_BINARY_VERSION;
+    header.byteOrder = CSC_BINARY_BYTE_ORDER;
+    header.rows = m->rows;
+    header.columns = m->columns;
+    header.valueCount = m->valueCount;
+    header.indexWidth = sizeof(uint64_t);
+    header.valueType = CSC_BINARY_FLOAT32;
+    header.flags = transposed ? CSC_BINARY_TRANSPOSED : 0;
+    header.colPtrOffset = align_offset(sizeof(header));
+    header.rowIndicesOffset = header.colPtrOffset + align_offset(colPtrSize);
+    header.valuesOffset = header.rowIndicesOffset + align_offset(rowIndicesSize);
+    header.fileSize = header.valuesOffset + align_offset(valuesSize);
+    header.colPtrChecksum = csc_checksum(m->colPtr, colPtrSize);
+    header.rowIndicesChecksum = csc_checksum(m->rowIndices, rowIndicesSize);
+    header.valuesChecksum = csc_checksum(m->values, valuesSize);
+    header.headerChecksum = csc_checksum(&header,
+            offsetof(struct cscBinaryHeader, headerChecksum));
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        perror("Unable to open file");
+        return 0;
+    }
+    int ok = write_padded(file, &header, sizeof(header))
+        && write_padded(file, m->colPtr, colPtrSize)
+        && write_padded(file, m->rowIndices, rowIndicesSize)
+        && write_padded(file, m->values, valuesSize);
+    int err = errno;
+    if (fclose(file)) ok = 0;
+    if (!ok) {
+        errno = err ? err : EIO;
+        perror("Unable to write binary file");
+        return 0;
+    }
+    return 1;
+}
+
+int is_csc_binary(const char* filename) {
+    struct mappedFile file;
+    int err = errno;
+    if (!map_file(filename, &file)) {
+        errno = err;
+        return 0;
+    }
+    int res = file.size >= sizeof(struct cscBinaryHeader)
+        && !memcmp(file.data, CSC_BINARY_MAGIC, 8);
+    unmap_file(&file);
+    return res;
+}
+
+/**
+ * Checks whether the array of size bytes at offset lies within a file of the
+ * given size and is aligned.
+ */
+static int is_valid_array(uint64_t offset, uint64_t size, uint64_t fileSize) {
+    return !(offset % CSC_BINARY_ALIGNMENT) && offset <= fileSize
+        && size <= fileSize - offset;
+}
+
+/**
+ * Validates the header of a mapped binary file. Prints an error message if
+ * the header is invalid.
+ *
+ * @return      1 if the header is valid, 0 otherwise
+ */
+static int is_valid_header(const struct cscBinaryHeader* h, uint64_t fileSize) {
+    if (fileSize < sizeof(*h) || memcmp(h->magic, CSC_BINARY_MAGIC, 8)) {
+        fprintf(stderr, "Wrong format. Not a binary CSC file.\n");
+        return 0;
+    }
+    if (h->version != CSC_BINARY_VERSION) {
+        fprintf(stderr, "Unsupported binary CSC version %u.\n", h->version);
+        return 0;
+    }
+    if (h->byteOrder != CSC_BINARY_BYTE_ORDER) {
+        fprintf(stderr, "The binary CSC file was written on a machine with a "
+                "different byte order.\n");
+        return 0;
+    }
+    if (h->headerChecksum != csc_checksum(h,
+                offsetof(struct cscBinaryHeader, headerChecksum))) {
+        fprintf(stderr, "Corrupted binary CSC file: wrong header checksum.\n");
+        return 0;
+    }
+    if (h->indexWidth != sizeof(uint64_t)
+            || h->valueType != CSC_BINARY_FLOAT32) {
+        fprintf(stderr, "Unsupported index width or value type in binary CSC "
+                "file.\n");
+        return 0;
+    }
+    if (h->fileSize != fileSize || h->columns >= fileSize / sizeof(uint64_t)
+            || h->valueCount > fileSize / sizeof(uint64_t)
+            || !is_valid_array(h->colPtrOffset,
+                (h->columns + 1) * sizeof(uint64_t), fileSize)
+            || !is_valid_array(h->rowIndicesOffset,
+                h->valueCount * sizeof(uint64_t), fileSize)
+            || !is_valid_array(h->valuesOffset, h->valueCount * sizeof(float),
+                fileSize)) {
+        fprintf(stderr, "Corrupted binary CSC file: the arrays exceed the "
+                "file.\n");
+        return 0;
+    }
+    return 1;
+}
+
+int map_csc_binary(const char* filename, struct cscFile* f, int verify) {
+    memset(f, 0, sizeof(*f));
+    if (!map_file(filename, &f->mapping)) {
+        perror("Unable to map file");
+        return 0;
+    }
+
+    const struct cscBinaryHeader* h = (const void*) f->mapping.data;
+    if (!is_valid_header(h, f->mapping.size)) goto format_error;
+
+    // The mapping is read-only; the matrix is never written through these
+    // pointers
+    struct cscMatrix* m = &f->matrix;
+    m->rows = h->rows;
+    m->columns = h->columns;
+    m->valueCount = h->valueCount;
+    m->colPtr = (uint64_t*) (f->mapping.data + h->colPtrOffset);
+    m->rowIndices = (uint64_t*) (f->mapping.data + h->rowIndicesOffset);
+    m->values = (float*) (f->mapping.data + h->valuesOffset);
+    f->transposed = (h->flags & CSC_BINARY_TRANSPOSED) != 0;
+
+    if (verify && (h->colPtrChecksum != csc_checksum(m->colPtr,
+                    (m->columns + 1) * sizeof(uint64_t))
+                || h->rowIndicesChecksum != csc_checksum(m->rowIndices,
+                    m->valueCount * sizeof(uint64_t))
+                || h->valuesChecksum != csc_checksum(m->values,
+                    m->valueCount * sizeof(float)))) {
+        fprintf(stderr, "Corrupted binary CSC file: wrong array checksum.\n");
+        goto format_error;
+    }
+
+    // The kernels index with colPtr and the row indices without checking them,
+    // so both are always validated
+    if (m->colPtr[0] != 0 || m->colPtr[m->columns] != m->valueCount) {
+        fprintf(stderr, "Wrong format. Invalid column pointers.\n");
+        goto format_error;
+    }
+    for (uint64_t i = 0; i < m->columns; i++) {
+        if (m->colPtr[i] > m->colPtr[i + 1]) {
+            fprintf(stderr, "Wrong format. Invalid column pointers.\n");
+            goto format_error;
+        }
+    }
+    for (uint64_t i = 0; i < m->valueCount; i++) {
+        if (m->rowIndices[i] >= m->rows) {
+            fprintf(stderr, "Wrong format. Invalid row indices.\n");
+            goto format_error;
+        }
+    }
+    return m->valueCount == 0;
+
+format_error:
+    errno = EINVAL;
+    unmap_file(&f->mapping);
+    memset(f, 0, sizeof(*f));
+    return 0;
+}
+
+/**
+ * Reads size bytes at offset of a file, retrying after partial reads.
+ *
+ * @return      1 if successful, 0 otherwise. errno is set to EIO if the file
+ *              ends before.
+ */
+static int read_fully(int fd, void* buffer, uint64_t size, uint64_t offset) {
+    char* p = buffer;
+    while (size) {
+        ssize_t n = pread(fd, p, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (!n) errno = EIO;
+            return 0;
+        }
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return 1;
+}
+
+int read_csc_binary_columns(int fd, const struct cscBinaryHeader* h,
+        uint64_t first, uint64_t count, struct cscMatrix* m) {
+    memset(m, 0, sizeof(*m));
+    if (first > h->columns || count > h->columns - first) {
+        errno = EINVAL;
+        return 0;
+    }
+    m->rows = h->rows;
+    m->columns = count;
+    m->colPtr = malloc((count + 1) * sizeof(uint64_t));
+    if (!m->colPtr) {
+        errno = ENOMEM;
+        return 0;
+    }
+    if (!read_fully(fd, m->colPtr, (count + 1) * sizeof(uint64_t),
+                h->colPtrOffset + first * sizeof(uint64_t))) goto error;
+
+    // Column pointers relative to the first column of the panel
+    uint64_t base = m->colPtr[0];
+    for (uint64_t i = 0; i <= count; i++) {
+        if (m->colPtr[i] < base || m->colPtr[i] > h->valueCount
+                || (i && m->colPtr[i] < m->colPtr[i - 1])) {
+            fprintf(stderr, "Wrong format. Invalid column pointers.\n");
+            errno = EINVAL;
+            goto error;
+        }
+        m->colPtr[i] -= base;
+    }
+    m->valueCount = m->colPtr[count];
+
+    m->rowIndices = malloc(m->valueCount * sizeof(uint64_t));
+    m->values = malloc(m->valueCount * sizeof(float));
+    if (m->valueCount && (!m->rowIndices || !m->values)) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (!read_fully(fd, m->rowIndices, m->valueCount * sizeof(uint64_t),
+                h->rowIndicesOffset + base * sizeof(uint64_t))
+            || !read_fully(fd, m->values, m->valueCount * sizeof(float),
+                h->valuesOffset + base * sizeof(float))) goto error;
+    for (uint64_t i = 0; i < m->valueCount; i++) {
+        if (m->rowIndices[i] >= m->rows) {
+            fprintf(stderr, "Wrong format. Invalid row indices.\n");
+            errno = EINVAL;
+            goto error;
+        }
+    }
+    return 1;
+
+error:
+    free_csc_members(m);
+    memset(m, 0, sizeof(*m));
+    return 0;
+}
+
+int load_csc_file(const char* filename, struct cscFile* f, int transpose,
+        unsigned threads) {
+    memset(f, 0, sizeof(*f));
+    errno = 0;
+    if (is_mtx_file(filename)) {
+        f->transposed = transpose != 0;
+        return parse_mtx_file(filename, &f->matrix, transpose, threads);
+    }
+    if (!is_csc_binary(filename)) {
+        f->transposed = transpose != 0;
+        return parse_csc_file_mmap(filename, &f->matrix, transpose, threads);
+    }
+
+    int isZero = map_csc_binary(filename, f, 0);
+    if (errno) return 0;
+    // The arrays are read like the heap arrays of a parsed matrix, not once
+    // from front to back as assumed by map_file
+    madvise((void*) f->mapping.data, f->mapping.size, MADV_WILLNEED);
+    if (f->transposed == (transpose != 0)) return isZero;
+
+    struct cscMatrix m = {0};
+    if (!transpose_csc_mt(&f->matrix, &m, threads)) {
+        release_csc_file(f);
+        errno = ENOMEM;
+        return 0;
+    }
+    unmap_file(&f->mapping);
+    f->matrix = m;
+    f->transposed = transpose != 0;
+    return isZero;
+}
+
+/**
+ * @class loadTask
+ *
+ * Matrix loaded by load_csc_files on its own thread
+ *
+ * @member filename     Name of the file to load
+ * @member f            Struct to store the matrix in
+ * @member transpose    Nonzero if the transpose should be stored
+ * @member threads      Amount of threads used for parsing text files
+ * @member cache        Cache of parsed files. May be null.
+ * @member isZero       Return value of load_csc_file
+ * @member error        errno after loading, 0 if successful
+ * @member cached       1 if the matrix was loaded from the cache
+ * @member time         Seconds spent loading, including the transposition
+ */
+struct loadTask {
+    const char* filename;
+    struct cscFile* f;
+    int transpose;
+    unsigned threads;
+    const struct cscCache* cache;
+    int isZero;
+    int error;
+    int cached;
+    double time;
+};
+
+static void* run_load_task(void* arg) {
+    struct loadTask* t = arg;
+    struct timespec start, end;
+    TRACE_BEGIN(span);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    t->isZero = t->cache
+        ? load_csc_file_cached(t->filename, t->f, t->transpose, t->threads,
+                t->cache, &t->cached)
+        : load_csc_file(t->filename, t->f, t->transpose, t->threads);
+    t->error = errno;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    t->time = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+    TRACE_END(span, "load file");
+    return 0;
+}
+
+int load_csc_files(const char* filename_a, const char* filename_b,
+        struct cscFile* a, struct cscFile* b, int transposeA, unsigned threads,
+        const struct cscCache* cache, struct loadStats* stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!is_mappable(filename_a) || !is_mappable(filename_b)) {
+        // Pipes are read in lockstep by a single thread
+        memset(a, 0, sizeof(*a));
+        memset(b, 0, sizeof(*b));
+        a->transposed = transposeA != 0;
+        errno = 0;
+        return parse_csc_files_mmap(filename_a, filename_b, &a->matrix,
+                &b->matrix, transposeA, threads);
+    }
+
+    // A is loaded and transposed on a second thread while the calling thread
+    // loads B. The parser threads are split between both files.
+    unsigned threadsB = threads / 2 ? threads / 2 : 1;
+    unsigned threadsA = threads > threadsB ? threads - threadsB : 1;
+    struct loadTask taskA = {filename_a, a, transposeA, threadsA, cache, 0, 0,
+        0, 0};
+    struct loadTask taskB = {filename_b, b, 0, threadsB, cache, 0, 0, 0, 0};
+    pthread_t tid;
+    int started = !pthread_create(&tid, 0, run_load_task, &taskA);
+    if (!started) run_load_task(&taskA);
+    run_load_task(&taskB);
+    if (started) pthread_join(tid, 0);
+    if (stats) {
+        stats->aTime = taskA.time;
+        stats->bTime = taskB.time;
+        stats->concurrent = started;
+        stats->aCached = taskA.cached;
+        stats->bCached = taskB.cached;
+    }
+
+    if (taskA.error || taskB.error) {
+        if (!taskA.error) release_csc_file(a);
+        if (!taskB.error) release_csc_file(b);
+        errno = taskA.error ? taskA.error : taskB.error;
+        return 0;
+    }
+
+    uint64_t aRows = transposeA ? a->matrix.columns : a->matrix.rows;
+    uint64_t aCols = transposeA ? a->matrix.rows : a->matrix.columns;
+    if (aCols != b->matrix.rows) {
+        fprintf(stderr, "Dimension mismatch: cannot multiply %lu by %lu "
+                "matrix by a %lu by %lu matrix.\n", aRows, aCols,
+                b->matrix.rows, b->matrix.columns);
+        release_csc_file(a);
+        release_csc_file(b);
+        errno = EINVAL;
+        return 0;
+    }
+    errno = 0;
+    return taskA.isZero || taskB.isZero;
+}
+
+void release_csc_file(struct cscFile* f) {
+    if (f->mapping.data) {
+        unmap_file(&f->mapping);
+    } else {
+        free_csc_members(&f->matrix);
+    }
+    memset(f, 0, sizeof(*f));
+}
+
+int convert_text_to_binary(const char* input, const char* output,
+        int transposed, unsigned threads) {
+    struct cscFile f;
+    load_csc_file(input, &f, transposed, threads);
+    if (errno) return 0;
+    int res = write_csc_binary(&f.matrix, transposed, output);
+    release_csc_file(&f);
+    return res;
+}
+
+int convert_binary_to_text(const char* input, const char* output) {
+    struct cscFile f;
+    errno = 0;
+    map_csc_binary(input, &f, 1);
+    if (errno) return 0;
+
+    struct cscMatrix* m = &f.matrix;
+    struct cscMatrix original = {0};
+    if (f.transposed) {
+        if (!transpose_csc(&f.matrix, &original)) {
+            release_csc_file(&f);
+            errno = ENOMEM;
+            return 0;
+        }
+        m = &original;
+    }
+    errno = 0;
+    result_to_file(m, output);
+    int res = errno == 0;
+    free_csc_members(&original);
+    release_csc_file(&f);
+    return res;
+}
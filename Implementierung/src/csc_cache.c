@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "csc_cache.h"
+#include "csc_binary.h"
+#include "csc_mmap.h"
+#include "csc_io.h"
+#include "cs_matrix.h"
+
+// Version of the cache keys. Changing it invalidates all cache files.
+#define CSC_CACHE_KEY_VERSION 1
+
+/**
+ * @class fileIdentity
+ *
+ * Metadata of an input file that the fast cache key is computed from
+ *
+ * @member version      CSC_CACHE_KEY_VERSION
+ * @member transpose    Orientation of the cached matrix
+ * @member device       Device of the file
+ * @member inode        Inode of the file
+ * @member size         Size of the file in bytes
+ * @member mtimeSec     Seconds of the modification time
+ * @member mtimeNsec    Nanoseconds of the modification time
+ */
+struct fileIdentity {
+    uint64_t version;
+    uint64_t transpose;
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    uint64_t mtimeSec;
+    uint64_t mtimeNsec;
+};
+
+int csc_cache_key(const struct cscCache* cache, const char* filename,
+        int transpose, uint64_t* key) {
+    struct stat st;
+    if (stat(filename, &st)) return 0;
+
+    if (cache->hashContents) {
+        struct mappedFile file;
+        if (!map_file(filename, &file)) return 0;
+        uint64_t words[3] = {CSC_CACHE_KEY_VERSION, transpose != 0,
+            csc_checksum(file.data, file.size)};
+        unmap_file(&file);
+        // Distinguishes content keys from path keys
+        *key = csc_checksum(words, sizeof(words)) ^ 1;
+        return 1;
+    }
+
+    struct fileIdentity id = {CSC_CACHE_KEY_VERSION, transpose != 0,
+        st.st_dev, st.st_ino, st.st_size, st.st_mtim.tv_sec,
+        st.st_mtim.tv_nsec};
+    char path[PATH_MAX];
+    if (!realpath(filename, path)) return 0;
+    uint64_t words[2] = {csc_checksum(&id, sizeof(id)),
+        csc_checksum(path, strlen(path))};
+    *key = csc_checksum(words, sizeof(words)) & ~(uint64_t) 1;
+    return 1;
+}
+
+/**
+ * Writes a matrix to the cache file path. The file is written under a
+ * temporary name and renamed. Prints a warning on failure.
+ */
+static void store_in_cache(const struct cscMatrix* m, int transposed,
+        const char* path) {
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long) getpid())
+            >= (int) sizeof(tmp)) return;
+    if (!write_csc_binary(m, transposed, tmp) || rename(tmp, path)) {
+        perror("Warning: unable to store matrix in cache");
+        remove(tmp);
+    }
+}
+
+int load_csc_file_cached(const char* filename, struct cscFile* f,
+        int transpose, unsigned threads, const struct cscCache* cache,
+        int* hit) {
+    if (hit) *hit = 0;
+    uint64_t key;
+    char path[PATH_MAX];
+    errno = 0;
+    if (!is_mappable(filename) || is_csc_binary(filename)
+            || !csc_cache_key(cache, filename, transpose, &key)
+            || snprintf(path, sizeof(path), "%s/%016lx.bin", cache->dir, key)
+                >= (int) sizeof(path)) {
+        return load_csc_file(filename, f, transpose, threads);
+    }
+
+    // The cache file is verified, since a damaged one would silently change
+    // the product. It is then re-parsed from the input and replaced below.
+    if (!access(path, R_OK)) {
+        errno = 0;
+        int isZero = map_csc_binary(path, f, 1);
+        if (!errno && f->transposed == (transpose != 0)) {
+            if (hit) *hit = 1;
+            return isZero;
+        }
+        if (!errno) release_csc_file(f);
+    }
+
+    int isZero = load_csc_file(filename, f, transpose, threads);
+    if (errno) return 0;
+    if (mkdir(cache->dir, 0777) && errno != EEXIST) {
+        perror("Warning: unable to create cache directory");
+    } else {
+        store_in_cache(&f->matrix, f->transposed, path);
+    }
+    errno = 0;
+    return isZero;
+}
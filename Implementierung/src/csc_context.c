@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+
+#include "csc_context.h"
+#include "cs_matrix.h"
+#include "csc_pool.h"
+
+static const char* const statusStrings[CSC_STATUSES] = {
+    "Success", "Invalid argument", "Out of memory", "Result too large",
+    "Input/output error"};
+
+static void* default_malloc(size_t size, void* user) {
+    (void) user;
+    return malloc(size);
+}
+
+static void* default_realloc(void* p, size_t size, void* user) {
+    (void) user;
+    return realloc(p, size);
+}
+
+static void default_free(void* p, void* user) {
+    (void) user;
+    free(p);
+}
+
+// Progress goes to stdout like the rest of the output of -l, errors to
+// stderr
+static void print_log(int level, const char* message, void* user) {
+    (void) user;
+    FILE* stream = level == CSC_LOG_ERROR ? stderr : stdout;
+    fputs(message, stream);
+    fflush(stream);
+}
+
+void csc_context_init(struct cscContext* ctx) {
+    ctx->logLevel = CSC_LOG_NONE;
+    ctx->log = 0;
+    ctx->logUser = 0;
+    ctx->allocator.malloc = default_malloc;
+    ctx->allocator.realloc = default_realloc;
+    ctx->allocator.free = default_free;
+    ctx->allocator.user = 0;
+    ctx->pool = 0;
+}
+
+void csc_context_from_globals(struct cscContext* ctx) {
+    csc_context_init(ctx);
+    ctx->logLevel = logData ? CSC_LOG_PROGRESS : CSC_LOG_ERROR;
+    ctx->log = print_log;
+    ctx->pool = csc_shared_pool(0);
+}
+
+const char* csc_status_string(int status) {
+    if (status < 0 || status >= CSC_STATUSES) return "Unknown status";
+    return statusStrings[status];
+}
+
+int csc_status_errno(int status) {
+    switch (status) {
+        case CSC_OK:
+            return 0;
+        case CSC_INVALID_ARGUMENT:
+            return EINVAL;
+        case CSC_OUT_OF_MEMORY:
+            return ENOMEM;
+        case CSC_OVERFLOW:
+            return ERANGE;
+        default:
+            return EIO;
+    }
+}
+
+int csc_errno_status(int err) {
+    switch (err) {
+        case 0:
+            return CSC_OK;
+        case EINVAL:
+            return CSC_INVALID_ARGUMENT;
+        case ENOMEM:
+            return CSC_OUT_OF_MEMORY;
+        case ERANGE:
+        case EOVERFLOW:
+            return CSC_OVERFLOW;
+        default:
+            return CSC_IO_ERROR;
+    }
+}
+
+void csc_log(const struct cscContext* ctx, int level, const char* format,
+        ...) {
+    if (level > ctx->logLevel || !ctx->log) return;
+    char message[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    ctx->log(level, message, ctx->logUser);
+}
+
+void* csc_malloc(const struct cscContext* ctx, size_t size) {
+    return ctx->allocator.malloc(size, ctx->allocator.user);
+}
+
+void* csc_calloc(const struct cscContext* ctx, size_t n, size_t size) {
+    size_t bytes;
+    if (__builtin_mul_overflow(n, size, &bytes)) return 0;
+    void* p = csc_malloc(ctx, bytes);
+    if (p) memset(p, 0, bytes);
+    return p;
+}
+
+void* csc_realloc(const struct cscContext* ctx, void* p, size_t size) {
+    return ctx->allocator.realloc(p, size, ctx->allocator.user);
+}
+
+void csc_free(const struct cscContext* ctx, void* p) {
+    ctx->allocator.free(p, ctx->allocator.user);
+}
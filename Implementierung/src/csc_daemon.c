@@ -0,0 +1,673 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "csc_daemon.h"
+#include "csc_binary.h"
+#include "csc_io.h"
+#include "csc_model.h"
+#include "csc_context.h"
+#include "csc_pool.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+#include "cs_matrix.h"
+
+// Maximum amount of arguments of a request, including the command
+#define DAEMON_MAX_ARGS 8
+
+/**
+ * @class residentMatrix
+ *
+ * A named matrix of the daemon. Entries are only freed once no request uses
+ * them, so a matrix can be replaced or dropped while it is multiplied.
+ *
+ * @member name         Name of the matrix
+ * @member file         The matrix, mapped or on the heap
+ * @member transposed   Its transpose on the heap, colPtr is null until a
+ *                      request needs it
+ * @member users        Amount of requests using the entry
+ * @member dropped      Nonzero once the entry is no longer in the list
+ * @member next         Next entry in the list of the daemon
+ */
+struct residentMatrix {
+    char name[CSC_DAEMON_NAME_LENGTH];
+    struct cscFile file;
+    struct cscMatrix transposed;
+    unsigned users;
+    int dropped;
+    struct residentMatrix* next;
+};
+
+/**
+ * @class daemonConnection
+ *
+ * An open connection, served by its own thread
+ *
+ * @member fd       Descriptor of the connection
+ * @member daemon   The daemon
+ * @member next     Next connection in the list of the daemon
+ */
+struct daemonConnection {
+    int fd;
+    struct cscDaemon* daemon;
+    struct daemonConnection* next;
+};
+
+/**
+ * @class cscDaemon
+ *
+ * State of run_daemon
+ *
+ * @member fd           Descriptor of the listening socket
+ * @member threads      Amount of threads to load and multiply with
+ * @member model        Cost model of version auto
+ * @member lock         Mutex protecting all following members
+ * @member closed       Signaled when a connection is closed
+ * @member matrices     List of the resident matrices
+ * @member connections  List of the open connections
+ * @member stop         Nonzero once a shutdown request was received
+ * @member requests     Amount of requests served
+ * @member products     Amount of products computed
+ * @member kernelTime   Seconds spent in the kernels
+ */
+struct cscDaemon {
+    int fd;
+    unsigned threads;
+    struct costModel model;
+    pthread_mutex_t lock;
+    pthread_cond_t closed;
+    struct residentMatrix* matrices;
+    struct daemonConnection* connections;
+    int stop;
+    unsigned long requests;
+    unsigned long products;
+    double kernelTime;
+};
+
+// Listening socket closed by the signal handler
+static volatile int listenFd = -1;
+static volatile sig_atomic_t stopSignal = 0;
+
+static void stop_on_signal(int sig) {
+    (void) sig;
+    stopSignal = 1;
+    if (listenFd >= 0) shutdown(listenFd, SHUT_RDWR);
+}
+
+static double seconds_since(const struct timespec* start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + 1e-9 * (end.tv_nsec
+            - start->tv_nsec);
+}
+
+// Frees an entry that is neither in the list nor used
+static void free_resident(struct residentMatrix* m) {
+    release_csc_file(&m->file);
+    free_csc_members(&m->transposed);
+    free(m);
+}
+
+// Returns the entry with the given name, the lock must be held
+static struct residentMatrix* find_resident(struct cscDaemon* d,
+        const char* name) {
+    for (struct residentMatrix* m = d->matrices; m; m = m->next) {
+        if (!strcmp(m->name, name)) return m;
+    }
+    return 0;
+}
+
+// Removes an entry from the list and frees it if it is unused, the lock
+// must be held
+static void drop_resident(struct cscDaemon* d, struct residentMatrix* m) {
+    struct residentMatrix** p = &d->matrices;
+    while (*p != m) p = &(*p)->next;
+    *p = m->next;
+    m->dropped = 1;
+    if (!m->users) free_resident(m);
+}
+
+// Ends the use of an entry by a request, the lock must be held
+static void release_resident(struct residentMatrix* m) {
+    if (!--m->users && m->dropped) free_resident(m);
+}
+
+/**
+ * Adds a matrix under a name, replacing the matrix with that name. On
+ * failure, f is released.
+ *
+ * @return  1 if successful, 0 if the entry can not be allocated
+ */
+static int add_resident(struct cscDaemon* d, const char* name,
+        struct cscFile* f) {
+    struct residentMatrix* m = calloc(1, sizeof(struct residentMatrix));
+    if (!m) {
+        release_csc_file(f);
+        return 0;
+    }
+    strcpy(m->name, name);
+    m->file = *f;
+    pthread_mutex_lock(&d->lock);
+    struct residentMatrix* old = find_resident(d, name);
+    if (old) drop_resident(d, old);
+    m->next = d->matrices;
+    d->matrices = m;
+    pthread_mutex_unlock(&d->lock);
+    return 1;
+}
+
+static void handle_load(struct cscDaemon* d, char** args, int argc,
+        FILE* out) {
+    if (argc != 3) {
+        fprintf(out, "error usage: load <name> <file>");
+        return;
+    }
+    struct cscFile f;
+    errno = 0;
+    load_csc_file(args[2], &f, 0, d->threads);
+    if (errno) {
+        fprintf(out, "error loading %s: %s", args[2], strerror(errno));
+        return;
+    }
+    struct cscMatrix m = f.matrix;
+    if (!add_resident(d, args[1], &f)) {
+        fprintf(out, "error %s", strerror(ENOMEM));
+        return;
+    }
+    fprintf(out, "ok %lu %lu %lu", m.rows, m.columns, m.valueCount);
+}
+
+/**
+ * Selects the version of a product with the cost model.
+ *
+ * @return  The version, or -1 if the features can not be computed
+ */
+static int select_version(struct cscDaemon* d, const struct cscMatrix* a,
+        const struct cscMatrix* b) {
+    struct mulFeatures features;
+    struct mulPlan plan;
+    if (!compute_features(a, b, 0, &features)) return -1;
+    plan_multiplication(&features, &d->model, &plan);
+    return plan.version;
+}
+
+/**
+ * Returns the transpose of a resident matrix, which is computed and kept
+ * with the matrix on first use. The request must use the entry.
+ *
+ * @return  CSC_OK, or CSC_OUT_OF_MEMORY
+ */
+static int get_transpose(struct cscDaemon* d, struct residentMatrix* m,
+        struct cscMatrix* t) {
+    pthread_mutex_lock(&d->lock);
+    *t = m->transposed;
+    pthread_mutex_unlock(&d->lock);
+    if (t->colPtr) return CSC_OK;
+
+    // Two requests may transpose at the same time, the first one is kept
+    errno = 0;
+    if (!transpose_csc_mt(&m->file.matrix, t, d->threads)) {
+        return CSC_OUT_OF_MEMORY;
+    }
+    pthread_mutex_lock(&d->lock);
+    if (m->transposed.colPtr) {
+        free_csc_members(t);
+    } else {
+        m->transposed = *t;
+    }
+    *t = m->transposed;
+    pthread_mutex_unlock(&d->lock);
+    return CSC_OK;
+}
+
+// Multiplies resident matrices, see csc_daemon.h
+static int multiply(struct cscDaemon* d, struct residentMatrix* a,
+        struct residentMatrix* b, int version, struct cscMatrix* c,
+        double* seconds) {
+    const struct cscMatrix* ma = &a->file.matrix;
+    const struct cscMatrix* mb = &b->file.matrix;
+    struct cscMatrix t;
+    int status = version == 2 ? CSC_OK : get_transpose(d, a, &t);
+    if (status) return status;
+
+    struct cscContext ctx;
+    csc_context_init(&ctx);
+    ctx.pool = csc_shared_pool(d->threads);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    // The kernels are not run on an input without values
+    if (!ma->valueCount || !mb->valueCount) {
+        *c = (struct cscMatrix) {ma->rows, mb->columns, 0, 0, 0,
+            calloc(mb->columns + 1, sizeof(uint64_t))};
+        status = c->colPtr ? CSC_OK : CSC_OUT_OF_MEMORY;
+    } else {
+        status = mul_csc_ctx(&ctx, version, version == 2 ? ma : &t, mb, c);
+    }
+    *seconds = seconds_since(&start);
+    return status;
+}
+
+static void handle_mul(struct cscDaemon* d, char** args, int argc,
+        FILE* out) {
+    int version = -1;
+    if (argc == 5 && strcmp(args[4], "auto")) {
+        char* end;
+        version = strtol(args[4], &end, 10);
+        if (*end || end == args[4] || version < 0 || version > 2) {
+            fprintf(out, "error invalid version %s", args[4]);
+            return;
+        }
+    }
+    if (argc != 4 && argc != 5) {
+        fprintf(out, "error usage: mul <name> <a> <b> [<version>]");
+        return;
+    }
+
+    pthread_mutex_lock(&d->lock);
+    struct residentMatrix* a = find_resident(d, args[2]);
+    struct residentMatrix* b = find_resident(d, args[3]);
+    if (a && b) {
+        a->users++;
+        b->users++;
+    }
+    pthread_mutex_unlock(&d->lock);
+    if (!a || !b) {
+        fprintf(out, "error no matrix %s", a ? args[3] : args[2]);
+        return;
+    }
+
+    const struct cscMatrix* ma = &a->file.matrix;
+    const struct cscMatrix* mb = &b->file.matrix;
+    struct cscMatrix c = {0};
+    double seconds = 0;
+    int status = CSC_OK;
+    int fits = ma->columns == mb->rows;
+    if (!fits) {
+        fprintf(out, "error can not multiply %lu by %lu matrix by a %lu by "
+                "%lu matrix", ma->rows, ma->columns, mb->rows, mb->columns);
+    } else {
+        errno = 0;
+        if (version < 0) version = select_version(d, ma, mb);
+        status = version < 0 ? csc_errno_status(errno)
+            : multiply(d, a, b, version, &c, &seconds);
+        if (status) fprintf(out, "error %s", csc_status_string(status));
+    }
+
+    pthread_mutex_lock(&d->lock);
+    release_resident(a);
+    release_resident(b);
+    if (fits && !status) d->products++;
+    d->kernelTime += seconds;
+    pthread_mutex_unlock(&d->lock);
+    if (!fits || status) return;
+
+    struct cscFile f = {0};
+    f.matrix = c;
+    if (!add_resident(d, args[1], &f)) {
+        fprintf(out, "error %s", strerror(ENOMEM));
+        return;
+    }
+    fprintf(out, "ok %lu %lu %lu %d %g", c.rows, c.columns, c.valueCount,
+            version, seconds);
+}
+
+static void handle_fetch(struct cscDaemon* d, char** args, int argc,
+        FILE* out) {
+    if (argc != 3) {
+        fprintf(out, "error usage: fetch <name> <file>");
+        return;
+    }
+    pthread_mutex_lock(&d->lock);
+    struct residentMatrix* m = find_resident(d, args[1]);
+    if (m) m->users++;
+    pthread_mutex_unlock(&d->lock);
+    if (!m) {
+        fprintf(out, "error no matrix %s", args[1]);
+        return;
+    }
+    errno = 0;
+    int ok = write_csc_binary(&m->file.matrix, 0, args[2]);
+    int err = errno;
+    pthread_mutex_lock(&d->lock);
+    release_resident(m);
+    pthread_mutex_unlock(&d->lock);
+    if (ok) {
+        fprintf(out, "ok");
+    } else {
+        fprintf(out, "error writing %s: %s", args[2], strerror(err));
+    }
+}
+
+static void handle_drop(struct cscDaemon* d, char** args, int argc,
+        FILE* out) {
+    if (argc != 2) {
+        fprintf(out, "error usage: drop <name>");
+        return;
+    }
+    pthread_mutex_lock(&d->lock);
+    struct residentMatrix* m = find_resident(d, args[1]);
+    if (m) drop_resident(d, m);
+    pthread_mutex_unlock(&d->lock);
+    if (m) {
+        fprintf(out, "ok");
+    } else {
+        fprintf(out, "error no matrix %s", args[1]);
+    }
+}
+
+static void handle_list(struct cscDaemon* d, FILE* out) {
+    pthread_mutex_lock(&d->lock);
+    unsigned count = 0;
+    for (struct residentMatrix* m = d->matrices; m; m = m->next) count++;
+    fprintf(out, "ok %u", count);
+    for (struct residentMatrix* m = d->matrices; m; m = m->next) {
+        fprintf(out, " %s %lu %lu %lu", m->name, m->file.matrix.rows,
+                m->file.matrix.columns, m->file.matrix.valueCount);
+    }
+    pthread_mutex_unlock(&d->lock);
+}
+
+/**
+ * Splits a request at spaces and runs it.
+ *
+ * @param line  The request, modified in place
+ * @param out   Stream the answer is written to, without line break
+ */
+static void handle_request(struct cscDaemon* d, char* line, FILE* out) {
+    char* args[DAEMON_MAX_ARGS];
+    int argc = 0;
+    char* save;
+    for (char* arg = strtok_r(line, " \t\r\n", &save); arg;
+            arg = strtok_r(0, " \t\r\n", &save)) {
+        if (argc == DAEMON_MAX_ARGS) {
+            fprintf(out, "error too many arguments");
+            return;
+        }
+        args[argc++] = arg;
+    }
+    if (!argc) {
+        fprintf(out, "error empty request");
+        return;
+    }
+    if (argc > 1 && strlen(args[1]) >= CSC_DAEMON_NAME_LENGTH) {
+        fprintf(out, "error names are limited to %d characters",
+                CSC_DAEMON_NAME_LENGTH - 1);
+        return;
+    }
+
+    if (!strcmp(args[0], "load")) {
+        handle_load(d, args, argc, out);
+    } else if (!strcmp(args[0], "mul")) {
+        handle_mul(d, args, argc, out);
+    } else if (!strcmp(args[0], "fetch")) {
+        handle_fetch(d, args, argc, out);
+    } else if (!strcmp(args[0], "drop")) {
+        handle_drop(d, args, argc, out);
+    } else if (!strcmp(args[0], "list")) {
+        handle_list(d, out);
+    } else if (!strcmp(args[0], "shutdown")) {
+        pthread_mutex_lock(&d->lock);
+        d->stop = 1;
+        pthread_mutex_unlock(&d->lock);
+        shutdown(d->fd, SHUT_RDWR);
+        fprintf(out, "ok");
+    } else {
+        fprintf(out, "error unknown request %s", args[0]);
+    }
+}
+
+// Sends all bytes, returns 1 if successful
+static int send_all(int fd, const char* data, size_t size) {
+    while (size) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return 0;
+        data += sent;
+        size -= sent;
+    }
+    return 1;
+}
+
+// Serves the requests of a connection until it is closed
+static void* serve_connection(void* arg) {
+    struct daemonConnection* c = arg;
+    struct cscDaemon* d = c->daemon;
+    char line[CSC_DAEMON_LINE_LENGTH];
+    size_t length = 0;
+    int open = 1;
+    while (open) {
+        ssize_t got = recv(c->fd, line + length, sizeof(line) - 1 - length,
+                0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        length += got;
+
+        char* end;
+        while (open && (end = memchr(line, '\n', length))) {
+            *end = '\0';
+            char* answer = 0;
+            size_t size = 0;
+            FILE* out = open_memstream(&answer, &size);
+            if (!out) {
+                open = 0;
+                break;
+            }
+            if (logData) printf("Request: %s\n", line);
+            handle_request(d, line, out);
+            fputc('\n', out);
+            fclose(out);
+            if (logData) printf("Answer: %s", answer);
+            open = send_all(c->fd, answer, size);
+            free(answer);
+            pthread_mutex_lock(&d->lock);
+            d->requests++;
+            pthread_mutex_unlock(&d->lock);
+
+            size_t used = end + 1 - line;
+            memmove(line, end + 1, length - used);
+            length -= used;
+        }
+        if (length == sizeof(line) - 1) {
+            const char* answer = "error request too long\n";
+            send_all(c->fd, answer, strlen(answer));
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&d->lock);
+    struct daemonConnection** p = &d->connections;
+    while (*p != c) p = &(*p)->next;
+    *p = c->next;
+    close(c->fd);
+    free(c);
+    pthread_cond_broadcast(&d->closed);
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+// Creates the listening socket
+/**
+ * Removes the socket file of a daemon that did not shut down cleanly. Other
+ * files and the sockets of running daemons are left alone.
+ *
+ * @return      1 if the path is free to bind, 0 otherwise. errno is set to
+ *              EADDRINUSE if the path is taken.
+ */
+static int remove_stale_socket(const struct sockaddr_un* addr) {
+    struct stat st;
+    if (lstat(addr->sun_path, &st)) return errno == ENOENT;
+    if (!S_ISSOCK(st.st_mode)) {
+        fprintf(stderr, "%s exists and is not a socket.\n", addr->sun_path);
+        errno = EADDRINUSE;
+        return 0;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+    int stale = connect(fd, (const struct sockaddr*) addr, sizeof(*addr))
+        && errno == ECONNREFUSED;
+    close(fd);
+    if (!stale) {
+        fprintf(stderr, "A daemon is already serving requests on %s.\n",
+                addr->sun_path);
+        errno = EADDRINUSE;
+        return 0;
+    }
+    return !unlink(addr->sun_path) || errno == ENOENT;
+}
+
+static int open_socket(const char* socketPath) {
+    struct sockaddr_un addr = {0};
+    if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+    if (!remove_stale_socket(&addr)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) || listen(fd, 16)) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+int run_daemon(const char* socketPath, unsigned threads,
+        const char* modelFile) {
+    struct cscDaemon d = {0};
+    d.threads = threads ? threads : 1;
+    if (modelFile) {
+        if (!load_cost_model(modelFile, &d.model)) return 0;
+    } else {
+        default_cost_model(&d.model);
+    }
+    d.fd = open_socket(socketPath);
+    if (d.fd < 0) return 0;
+    pthread_mutex_init(&d.lock, 0);
+    pthread_cond_init(&d.closed, 0);
+
+    struct sigaction stop = {0}, oldInt, oldTerm;
+    stop.sa_handler = stop_on_signal;
+    sigemptyset(&stop.sa_mask);
+    stopSignal = 0;
+    listenFd = d.fd;
+    sigaction(SIGINT, &stop, &oldInt);
+    sigaction(SIGTERM, &stop, &oldTerm);
+    if (logData) printf("Serving requests on %s.\n", socketPath);
+
+    int ok = 1;
+    for (;;) {
+        int fd = accept(d.fd, 0, 0);
+        pthread_mutex_lock(&d.lock);
+        int stopped = d.stop || stopSignal;
+        pthread_mutex_unlock(&d.lock);
+        if (stopped) {
+            if (fd >= 0) close(fd);
+            break;
+        }
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            ok = 0;
+            break;
+        }
+        struct daemonConnection* c = malloc(sizeof(struct daemonConnection));
+        pthread_t tid;
+        if (c) {
+            c->fd = fd;
+            c->daemon = &d;
+            pthread_mutex_lock(&d.lock);
+            c->next = d.connections;
+            d.connections = c;
+            pthread_mutex_unlock(&d.lock);
+        }
+        if (!c || pthread_create(&tid, 0, serve_connection, c)) {
+            if (c) {
+                pthread_mutex_lock(&d.lock);
+                d.connections = c->next;
+                pthread_mutex_unlock(&d.lock);
+            }
+            free(c);
+            close(fd);
+            continue;
+        }
+        pthread_detach(tid);
+    }
+    int err = errno;
+
+    // Open connections are closed for reading, their current request is
+    // still answered
+    pthread_mutex_lock(&d.lock);
+    for (struct daemonConnection* c = d.connections; c; c = c->next) {
+        shutdown(c->fd, SHUT_RD);
+    }
+    while (d.connections) pthread_cond_wait(&d.closed, &d.lock);
+    pthread_mutex_unlock(&d.lock);
+
+    sigaction(SIGINT, &oldInt, 0);
+    sigaction(SIGTERM, &oldTerm, 0);
+    listenFd = -1;
+    close(d.fd);
+    unlink(socketPath);
+    while (d.matrices) drop_resident(&d, d.matrices);
+    pthread_cond_destroy(&d.closed);
+    pthread_mutex_destroy(&d.lock);
+    if (logData) {
+        printf("Served %lu requests and %lu products, %g s in the "
+                "kernels.\n", d.requests, d.products, d.kernelTime);
+    }
+    errno = ok ? 0 : err;
+    return ok;
+}
+
+int daemon_connect(const char* socketPath) {
+    struct sockaddr_un addr = {0};
+    if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*) &addr, sizeof(addr))) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+int daemon_request(int fd, const char* request, char* response,
+        size_t size) {
+    *response = '\0';
+    if (!send_all(fd, request, strlen(request)) || !send_all(fd, "\n", 1)) {
+        return 0;
+    }
+    size_t length = 0;
+    for (;;) {
+        char ch;
+        ssize_t got = recv(fd, &ch, 1, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            if (!got) errno = ECONNRESET;
+            *response = '\0';
+            return 0;
+        }
+        if (ch == '\n') break;
+        if (length + 1 < size) response[length++] = ch;
+    }
+    response[length] = '\0';
+    return !strncmp(response, "ok", 2);
+}
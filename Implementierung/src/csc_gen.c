@@ -0,0 +1,532 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <math.h>
+
+#include "csc_gen.h"
+#include "csc_writer.h"
+#include "csc_binary.h"
+#include "csc_mtx.h"
+#include "csc_io.h"
+#include "cs_matrix.h"
+#include "csc_pool.h"
+
+const char* const familyNames[FAMILY_COUNT] = {"uniform", "banded",
+    "block-diagonal", "power-law", "rmat"};
+
+int parse_family(const char* name) {
+    for (int f = 0; f < FAMILY_COUNT; f++) {
+        if (!strcmp(name, familyNames[f])) return f;
+    }
+    return -1;
+}
+
+// SplitMix64, a small generator that passes BigCrush. Its state is a counter,
+// so every column can start its own stream at a hash of the seed and column.
+static uint64_t next_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// Uniform double in [0, 1)
+static double next_double(uint64_t* state) {
+    return (next_random(state) >> 11) * 0x1p-53;
+}
+
+// Rounds x up with probability frac(x), so the expected result is x
+static uint64_t round_random(double x, uint64_t* state) {
+    uint64_t floor = (uint64_t) x;
+    return floor + (next_double(state) < x - floor);
+}
+
+// Amount of successes of n trials with probability p, drawn exactly by
+// summing the geometric gaps between successes in O(n * p) steps
+static uint64_t binomial_random(uint64_t n, double p, uint64_t* state) {
+    if (p >= 1) return n;
+    if (!(p > 0)) return 0;
+    double logFailure = log1p(-p);
+    double position = 0;
+    for (uint64_t k = 0;; k++) {
+        double u = ((next_random(state) >> 11) + 1) * 0x1p-53;
+        position += floor(log(u) / logFailure) + 1;
+        if (position > n) return k;
+    }
+}
+
+static int cmp_uint64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+// Sorts an array and removes duplicates. Returns the new length.
+static uint64_t sort_unique(uint64_t* a, uint64_t n) {
+    qsort(a, n, sizeof(uint64_t), cmp_uint64);
+    uint64_t k = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        if (!k || a[i] != a[k - 1]) a[k++] = a[i];
+    }
+    return k;
+}
+
+/**
+ * @class columnPlan
+ *
+ * Parameters shared by the columns of a generated matrix
+ *
+ * @member family   The family
+ * @member rows     Amount of rows
+ * @member columns  Amount of columns
+ * @member density  Expected fraction of nonzero values
+ * @member seed     Seed of the random numbers
+ * @member blocks   Amount of diagonal blocks of FAMILY_BLOCK_DIAGONAL
+ */
+struct columnPlan {
+    int family;
+    uint64_t rows;
+    uint64_t columns;
+    double density;
+    uint64_t seed;
+    uint64_t blocks;
+};
+
+// State of the random numbers of column j. Every column has its own stream,
+// so a column can be generated again without generating the others.
+static uint64_t column_state(const struct columnPlan* p, uint64_t j) {
+    uint64_t state = p->seed ^ (j + 1) * 0xd1342543de82ef95;
+    next_random(&state);
+    return state;
+}
+
+/**
+ * Chooses the range of rows [lo, hi) of column j that its values are drawn
+ * from and the amount of values.
+ *
+ * @return  The amount of values, at most hi - lo
+ */
+static uint64_t column_count(const struct columnPlan* p, uint64_t j,
+        uint64_t* state, uint64_t* lo, uint64_t* hi) {
+    uint64_t rows = p->rows;
+    double expected = p->density * rows;
+    *lo = 0;
+    *hi = rows;
+    uint64_t k;
+    switch (p->family) {
+        case FAMILY_BANDED: {
+            uint64_t width = (uint64_t) (expected + 0.5);
+            if (!width && p->density > 0) width = 1;
+            if (width > rows) width = rows;
+            uint64_t center = (uint64_t) ((double) j * rows / p->columns);
+            *lo = center > width / 2 ? center - width / 2 : 0;
+            if (*lo + width > rows) *lo = rows - width;
+            *hi = *lo + width;
+            k = width;
+            break;
+        }
+        case FAMILY_BLOCK_DIAGONAL: {
+            uint64_t b = j * p->blocks / p->columns;
+            *lo = b * rows / p->blocks;
+            *hi = (b + 1) * rows / p->blocks;
+            double inner = p->density * p->blocks;
+            k = round_random((inner < 1 ? inner : 1) * (*hi - *lo), state);
+            break;
+        }
+        case FAMILY_POWER_LAW: {
+            // Pareto distribution with shape 2 and mean expected
+            double u = ((next_random(state) >> 11) + 1) * 0x1p-53;
+            k = round_random(expected / 2 / sqrt(u), state);
+            break;
+        }
+        default:
+            // Every entry is nonzero on its own, so the amount per column
+            // varies like it would for a per-entry draw
+            k = binomial_random(rows, p->density, state);
+    }
+    return k < *hi - *lo ? k : *hi - *lo;
+}
+
+/**
+ * Draws k distinct sorted rows from [lo, hi) into rows. Dense columns are
+ * drawn with selection sampling, sparse ones by drawing rows until k of them
+ * are distinct.
+ */
+static void sample_rows(uint64_t lo, uint64_t hi, uint64_t k, uint64_t* rows,
+        uint64_t* state) {
+    uint64_t range = hi - lo;
+    if (k * 4 >= range) {
+        uint64_t chosen = 0;
+        for (uint64_t i = 0; i < range && chosen < k; i++) {
+            if (next_double(state) * (range - i) < k - chosen) {
+                rows[chosen++] = lo + i;
+            }
+        }
+        return;
+    }
+    uint64_t count = 0;
+    while (count < k) {
+        for (uint64_t i = count; i < k; i++) {
+            rows[i] = lo + next_random(state) % range;
+        }
+        count = sort_unique(rows, k);
+    }
+}
+
+// Allocates the arrays of m for its valueCount. Returns 1 if successful.
+static int alloc_members(struct cscMatrix* m) {
+    m->values = malloc(m->valueCount * sizeof(float));
+    m->rowIndices = malloc(m->valueCount * sizeof(uint64_t));
+    if (m->valueCount && (!m->values || !m->rowIndices)) {
+        free_csc_members(m);
+        errno = ENOMEM;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @class genChunk
+ *
+ * Consecutive columns of a generated matrix filled by one thread
+ *
+ * @member plan     Parameters of the matrix
+ * @member m        The matrix
+ * @member first    First column of the chunk
+ * @member end      Column after the last column of the chunk
+ */
+struct genChunk {
+    const struct columnPlan* plan;
+    struct cscMatrix* m;
+    uint64_t first;
+    uint64_t end;
+};
+
+/**
+ * Runs fn on n parts of size bytes each with the threads of the shared pool,
+ * see csc_pool_run.
+ */
+static void run_parts(void* parts, size_t size, unsigned n,
+        void* (*fn)(void*)) {
+    csc_pool_run(csc_shared_pool(n), parts, size, n, fn);
+}
+
+// Stores the amount of values of column j in colPtr[j + 1]
+static void* count_columns(void* arg) {
+    struct genChunk* c = arg;
+    for (uint64_t j = c->first; j < c->end; j++) {
+        uint64_t state = column_state(c->plan, j), lo, hi;
+        c->m->colPtr[j + 1] = column_count(c->plan, j, &state, &lo, &hi);
+    }
+    return 0;
+}
+
+// Draws the rows and values of the columns, replaying the streams
+static void* fill_columns(void* arg) {
+    struct genChunk* c = arg;
+    struct cscMatrix* m = c->m;
+    for (uint64_t j = c->first; j < c->end; j++) {
+        uint64_t state = column_state(c->plan, j), lo, hi;
+        uint64_t k = column_count(c->plan, j, &state, &lo, &hi);
+        uint64_t start = m->colPtr[j];
+        sample_rows(lo, hi, k, m->rowIndices + start, &state);
+        for (uint64_t i = start; i < start + k; i++) {
+            m->values[i] = 1 + next_random(&state) % 8;
+        }
+    }
+    return 0;
+}
+
+static int generate_columns(struct cscMatrix* m, const struct columnPlan* p,
+        unsigned threads) {
+    if (threads > m->columns) threads = m->columns;
+    struct genChunk* chunks = malloc(threads * sizeof(*chunks));
+    if (threads && !chunks) {
+        errno = ENOMEM;
+        return 0;
+    }
+    for (unsigned t = 0; t < threads; t++) {
+        chunks[t] = (struct genChunk) {p, m, m->columns * t / threads,
+            m->columns * (t + 1) / threads};
+    }
+    run_parts(chunks, sizeof(*chunks), threads, count_columns);
+    for (uint64_t j = 0; j < m->columns; j++) m->colPtr[j + 1] += m->colPtr[j];
+    m->valueCount = m->colPtr[m->columns];
+    int ok = alloc_members(m);
+    if (ok) run_parts(chunks, sizeof(*chunks), threads, fill_columns);
+    free(chunks);
+    return ok;
+}
+
+/**
+ * @class rmatJob
+ *
+ * State shared by the threads generating an R-MAT matrix
+ *
+ * @member m        The matrix
+ * @member p        The quadrant probabilities
+ * @member seed     Seed of the random numbers
+ * @member scale    The edges are drawn in a 2^scale by 2^scale matrix
+ * @member edges    Amount of drawn edges
+ * @member rows     Row of every edge, UINT64_MAX for a dropped edge
+ * @member cols     Column of every edge
+ * @member sorted   Rows of the kept edges, sorted by column
+ * @member starts   Start of every column in sorted, with columns + 1 entries
+ */
+struct rmatJob {
+    struct cscMatrix* m;
+    const struct rmatParams* p;
+    uint64_t seed;
+    int scale;
+    uint64_t edges;
+    uint64_t* rows;
+    uint64_t* cols;
+    uint64_t* sorted;
+    uint64_t* starts;
+};
+
+/**
+ * @class rmatChunk
+ *
+ * Range of blocks of edges or of columns processed by one thread
+ *
+ * @member job      The shared state
+ * @member first    First block or column of the chunk
+ * @member end      Block or column after the last one of the chunk
+ */
+struct rmatChunk {
+    struct rmatJob* job;
+    uint64_t first;
+    uint64_t end;
+};
+
+// Draws the edges of the blocks of the chunk
+static void* draw_edges(void* arg) {
+    struct rmatChunk* c = arg;
+    struct rmatJob* job = c->job;
+    const struct rmatParams* p = job->p;
+    double ab = p->a + p->b, abc = ab + p->c;
+    for (uint64_t block = c->first; block < c->end; block++) {
+        // Every block has its own stream, so threads do not change the edges
+        uint64_t state = job->seed ^ (block + 1) * 0xd1342543de82ef95;
+        next_random(&state);
+        uint64_t end = (block + 1) * RMAT_BLOCK_EDGES;
+        if (end > job->edges) end = job->edges;
+        for (uint64_t e = block * RMAT_BLOCK_EDGES; e < end; e++) {
+            job->rows[e] = UINT64_MAX;
+            // Edges outside of a non-square matrix are drawn again, but not
+            // forever
+            for (int tries = 0; tries < 64; tries++) {
+                uint64_t row = 0, col = 0;
+                for (int bit = 0; bit < job->scale; bit++) {
+                    double r = next_double(&state);
+                    row = row << 1 | (r >= ab);
+                    col = col << 1 | ((r >= p->a && r < ab) || r >= abc);
+                }
+                if (row < job->m->rows && col < job->m->columns) {
+                    job->rows[e] = row;
+                    job->cols[e] = col;
+                    break;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// Sorts the rows of every column of the chunk and removes repeated edges.
+// Stores the amount of distinct rows of column j in colPtr[j + 1].
+static void* sort_columns(void* arg) {
+    struct rmatChunk* c = arg;
+    struct rmatJob* job = c->job;
+    for (uint64_t j = c->first; j < c->end; j++) {
+        job->m->colPtr[j + 1] = sort_unique(job->sorted + job->starts[j],
+                job->starts[j + 1] - job->starts[j]);
+    }
+    return 0;
+}
+
+// Copies the distinct rows of the columns of the chunk and draws the values
+static void* fill_rmat_columns(void* arg) {
+    struct rmatChunk* c = arg;
+    struct rmatJob* job = c->job;
+    struct cscMatrix* m = job->m;
+    for (uint64_t j = c->first; j < c->end; j++) {
+        uint64_t state = ~job->seed ^ (j + 1) * 0xd1342543de82ef95;
+        next_random(&state);
+        const uint64_t* rows = job->sorted + job->starts[j];
+        for (uint64_t i = m->colPtr[j]; i < m->colPtr[j + 1]; i++) {
+            m->rowIndices[i] = *rows++;
+            m->values[i] = 1 + next_random(&state) % 8;
+        }
+    }
+    return 0;
+}
+
+int generate_rmat(struct cscMatrix* m, uint64_t rows, uint64_t columns,
+        uint64_t edges, const struct rmatParams* p, uint64_t seed,
+        unsigned threads) {
+    memset(m, 0, sizeof(*m));
+    double sum = p->a + p->b + p->c + p->d;
+    if (!rows || !columns || !threads || !(p->a >= 0) || !(p->b >= 0)
+            || !(p->c >= 0) || !(p->d >= 0) || sum < 0.999 || sum > 1.001) {
+        errno = EINVAL;
+        return 0;
+    }
+    m->rows = rows;
+    m->columns = columns;
+    struct rmatJob job = {m, p, seed, 0, edges, 0, 0, 0, 0};
+    while (job.scale < 63 && (1ull << job.scale) < rows) job.scale++;
+    while (job.scale < 63 && (1ull << job.scale) < columns) job.scale++;
+
+    m->colPtr = calloc(columns + 1, sizeof(uint64_t));
+    job.rows = malloc(edges * sizeof(uint64_t));
+    job.cols = malloc(edges * sizeof(uint64_t));
+    job.starts = calloc(columns + 1, sizeof(uint64_t));
+    struct rmatChunk* chunks = malloc(threads * sizeof(*chunks));
+    if (!m->colPtr || !job.starts || !chunks
+            || (edges && (!job.rows || !job.cols))) {
+        free(job.rows);
+        free(job.cols);
+        free(job.starts);
+        free(chunks);
+        free_csc_members(m);
+        errno = ENOMEM;
+        return 0;
+    }
+
+    uint64_t blocks = (edges + RMAT_BLOCK_EDGES - 1) / RMAT_BLOCK_EDGES;
+    unsigned n = threads < blocks ? threads : blocks ? blocks : 1;
+    for (unsigned t = 0; t < n; t++) {
+        chunks[t] = (struct rmatChunk) {&job, blocks * t / n,
+            blocks * (t + 1) / n};
+    }
+    run_parts(chunks, sizeof(*chunks), n, draw_edges);
+
+    // Counting sort of the rows by column, dropped edges are left out
+    for (uint64_t e = 0; e < edges; e++) {
+        if (job.rows[e] != UINT64_MAX) job.starts[job.cols[e] + 1]++;
+    }
+    for (uint64_t j = 0; j < columns; j++) job.starts[j + 1] += job.starts[j];
+    job.sorted = malloc(job.starts[columns] * sizeof(uint64_t));
+    if (job.starts[columns] && !job.sorted) {
+        free(job.rows);
+        free(job.cols);
+        free(job.starts);
+        free(chunks);
+        free_csc_members(m);
+        errno = ENOMEM;
+        return 0;
+    }
+    // colPtr holds the next free position of every column for now
+    uint64_t* next = m->colPtr;
+    memcpy(next, job.starts, columns * sizeof(uint64_t));
+    for (uint64_t e = 0; e < edges; e++) {
+        if (job.rows[e] != UINT64_MAX) {
+            job.sorted[next[job.cols[e]]++] = job.rows[e];
+        }
+    }
+    free(job.rows);
+    free(job.cols);
+
+    n = threads < columns ? threads : columns;
+    for (unsigned t = 0; t < n; t++) {
+        chunks[t] = (struct rmatChunk) {&job, columns * t / n,
+            columns * (t + 1) / n};
+    }
+    run_parts(chunks, sizeof(*chunks), n, sort_columns);
+    m->colPtr[0] = 0;
+    for (uint64_t j = 0; j < columns; j++) m->colPtr[j + 1] += m->colPtr[j];
+    m->valueCount = m->colPtr[columns];
+    int ok = alloc_members(m);
+    if (ok) run_parts(chunks, sizeof(*chunks), n, fill_rmat_columns);
+    free(chunks);
+    free(job.sorted);
+    free(job.starts);
+    return ok;
+}
+
+int generate_family(struct cscMatrix* m, int family, uint64_t rows,
+        uint64_t columns, double density, uint64_t seed, unsigned threads) {
+    memset(m, 0, sizeof(*m));
+    if (family < 0 || family >= FAMILY_COUNT || !(density >= 0)
+            || density > 1 || !rows || !columns || !threads) {
+        errno = EINVAL;
+        return 0;
+    }
+    if (family == FAMILY_RMAT) {
+        struct rmatParams p = RMAT_DEFAULT_PARAMS;
+        uint64_t state = seed;
+        uint64_t edges = round_random(density * rows * columns, &state);
+        return generate_rmat(m, rows, columns, edges, &p, seed, threads);
+    }
+
+    m->rows = rows;
+    m->columns = columns;
+    m->colPtr = calloc(columns + 1, sizeof(uint64_t));
+    if (!m->colPtr) {
+        errno = ENOMEM;
+        return 0;
+    }
+    struct columnPlan p = {family, rows, columns, density, seed, 1};
+    if (family == FAMILY_BLOCK_DIAGONAL && density > 0) {
+        // Blocks a quarter full give the requested density overall
+        double blocks = 0.25 / density;
+        uint64_t max = rows < columns ? rows : columns;
+        p.blocks = blocks < 1 ? 1 : blocks > max ? max : (uint64_t) blocks;
+    }
+    int ok = generate_columns(m, &p, threads);
+    if (!ok) free_csc_members(m);
+    return ok;
+}
+
+// Checks whether a filename ends with the extension .bin
+static int has_bin_extension(const char* filename) {
+    size_t n = strlen(filename);
+    return n >= 4 && !strcasecmp(filename + n - 4, ".bin");
+}
+
+int generate_input_files(int family, uint64_t rows, uint64_t inner,
+        uint64_t columns, double density, const struct rmatParams* rmat,
+        uint64_t seed, unsigned threads, const char* filenameA,
+        const char* filenameB) {
+    const char* names[2] = {filenameA, filenameB};
+    uint64_t dims[2][2] = {{rows, inner}, {inner, columns}};
+    for (int i = 0; i < 2; i++) {
+        if (logData) {
+            printf("Generating matrix %c...", 'A' + i);
+            fflush(stdout);
+        }
+        struct cscMatrix m;
+        errno = 0;
+        int generated;
+        if (family == FAMILY_RMAT && rmat) {
+            double edges = density * dims[i][0] * dims[i][1];
+            generated = generate_rmat(&m, dims[i][0], dims[i][1],
+                    (uint64_t) (edges + 0.5), rmat, seed + i, threads);
+        } else {
+            generated = generate_family(&m, family, dims[i][0], dims[i][1],
+                    density, seed + i, threads);
+        }
+        if (!generated) {
+            perror(i ? "\rError while generating matrix B"
+                    : "\rError while generating matrix A");
+            return 0;
+        }
+        if (logData) {
+            printf("\rMatrix %c generated successfully (%lu values).\n",
+                    'A' + i, m.valueCount);
+        }
+        int written = has_bin_extension(names[i])
+            ? write_csc_binary(&m, 0, names[i])
+            : has_mtx_extension(names[i]) ? write_mtx_file(&m, names[i], 0)
+            : write_csc_text_mt(&m, names[i], 0, threads);
+        free_csc_members(&m);
+        if (!written) {
+            perror("Unable to write generated matrix");
+            return 0;
+        }
+    }
+    return 1;
+}
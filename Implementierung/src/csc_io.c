@@ -8,9 +8,13 @@
 #include <inttypes.h>
 #include <string.h>
 #include <time.h>
+#include <sys/stat.h>
 
 #include "csc_io.h"
+#include "csc_mmap.h"
+#include "csc_writer.h"
 #include "cs_matrix.h"
+#include "csc_trace.h"
 
 const char* usage_msg =
     "Usage: %s [commands] <arg>\n"
@@ -22,32 +26,204 @@ const char* usage_msg =
 const char* help_msg =
     "Help Message\n"
     "Commands with mandatory arguments:\n"
-    "  -V <Number>          Specify the version of the function.\n"
+    "  -V <Number>|auto     Specify the version of the function. auto selects "
+                            "the version with the lowest\n"
+    "                       duration predicted by the cost model from features "
+                            "of the inputs.\n"
+    "  --model <File>       Cost model used by -V auto (default: "
+                            "cost_model.txt, or built-in\n"
+    "                       coefficients if it does not exist).\n"
     "  -a <Filename>        Specify file containing Matrix a.\n"
     "  -b <Filename>        Specify file containing Matrix b.\n"
     "  -o <Filename>        Specify the output file .\n"
+    "                       If it ends in .mtx, the result is written in the "
+                            "Matrix Market format.\n"
+    "  -p, --precision <N>  Amount of significant digits of the values in the "
+                            "output file, between 1 and 9.\n"
+    "                       Defaults to 0, which writes the shortest "
+                            "representation that is read back exactly.\n"
+    "  -t, --threads <N>    Amount of threads used to parse, transpose and "
+                            "multiply the inputs and to write\n"
+    "                       the output file. They are started once and reused "
+                            "by every phase. Defaults to 1.\n"
+    "  -M, --memory <MB>    Out-of-core mode for inputs that do not fit into "
+                            "memory. The binary input files are\n"
+    "                       multiplied in panels that use about MB megabytes "
+                            "of memory, and the result is\n"
+    "                       appended to the output file in the stream format. "
+                            "For versions 0 and 1, A must be\n"
+    "                       stored with --transposed.\n"
+    "  --cache <Dir>        Stores the parsed (and for A transposed) text and "
+                            "Matrix Market input files as\n"
+    "                       binary files in the directory Dir. Later runs map "
+                            "them instead of parsing the inputs\n"
+    "                       again if the inputs have not changed (same path, "
+                            "size and modification time).\n"
+    "  --to-binary <File>   Converts the text matrix file File to the binary "
+                            "format and writes it to the output file.\n"
+    "  --to-text <File>     Converts the binary, stream or Matrix Market file "
+                            "File to the text format and writes\n"
+    "                       it to the output file. Input files can be given in "
+                            "the text, binary or Matrix Market\n"
+    "                       (coordinate) format.\n"
     "Commands with optional arguments:\n"
-    "  -B<N>                Benchmarking mode. Logs the execution time of the "
-                            "program to the console, as well as the duration of"
-                            " different operations.\n" 
-    "                       N specifies the amount of times to perform the multiplication.\n"
+    "  -s<N>, --stream=<N>  Streaming mode. The result is computed in blocks of "
+                            "N columns (default: 1024) that are\n"
+    "                       written to the output file while the next block is "
+                            "computed, so the result is never\n"
+    "                       held in memory. The output file is a stream file "
+                            "that can be converted with --to-text.\n"
     "Commands without arguments:\n"
     "  -h, --help           Display this help message and exits.\n"
+    "  --transposed         With --to-binary, stores the transpose of the "
+                            "matrix. Such a file can be loaded\n"
+    "                       as matrix A of versions 0 and 1 without copying "
+                            "it.\n"
+    "  --cache-hash         With --cache, identifies the inputs by a hash of "
+                            "their contents instead of their\n"
+    "                       path, size and modification time. Reads the whole "
+                            "inputs on every run.\n"
+    "  --pin                Pins the threads of -t to one processor each.\n"
     "  -l                   Prints messages to the console indicating the "
                             "progress of the program.\n"
     "                       This option adds significant overhead and "
                             "increases its runtime by a nonnegligible amount.\n"
-    "                       Not recommended for benchmarking mode.\n"
+    "                       Not recommended for benchmarking mode.\n";
+
+const char* bench_help_msg =
+    "Benchmarking and profiling:\n"
+    "  -B<N>                Benchmarking mode. Logs the execution time of the "
+                            "program to the console, as well as the duration of"
+                            " different operations.\n" 
+    "                       N specifies the amount of times to perform the multiplication.\n"
+    "                       Also prints the multiply-adds, the nonzero values and "
+                            "compression ratio of the result,\n"
+    "                       GFLOP/s and the effective GB/s of the bytes every "
+                            "kernel has to read and write, and\n"
+    "                       hardware counters (cycles, instructions, "
+                            "cache, branch and dTLB misses)\n"
+    "                       of the load, multiply and write phases if "
+                            "perf_event_open is available.\n"
+    "                       The counters are summed over the calling thread "
+                            "and the -t workers started after\n"
+    "                       them; threads of other processes and kernel code "
+                            "are not counted.\n"
+    "  --bench <N>          Kernel benchmark. Loads the inputs once, runs the "
+                            "multiplication N times and prints\n"
+    "                       the median, 90th and 99th percentile and standard "
+                            "deviation of its duration, as\n"
+    "                       well as the time spent loading the inputs and "
+                            "writing the result once.\n"
+    "  --warmup <N>         With --bench, runs the multiplication N times "
+                            "before timing it (default: 1).\n"
+    "  --flush-cache        With --bench, evicts the CPU caches before every "
+                            "run to measure cold-cache timings.\n"
+    "  -S, --stats          Planning mode. Parses the inputs and prints their "
+                            "values per column, bandwidth\n"
+    "                       and profile, the multiply-adds of the product, its "
+                            "estimated values and the memory\n"
+    "                       and predicted time of every version, without "
+                            "multiplying. Takes about as long as\n"
+    "                       parsing the inputs.\n"
+    "  --calibrate[=<File>] Fits the cost model of -V auto by timing every "
+                            "version on generated matrices\n"
+    "                       and writes it to File (default: "
+                            "cost_model.txt).\n"
+    "  --trace <File>       Records the phases of the program and of its worker "
+                            "threads and writes them to File\n"
+    "                       as a Chrome trace (open it in chrome://tracing or "
+                            "ui.perfetto.dev).\n";
+
+const char* generate_help_msg =
+    "Random input matrices:\n"
     "  -r                   Generates a random pair of matrices A and B with "
                             "dimensions n*m and m*k respectively,\n"
-    "                       for n,m,k in between 512 and 1024. "
-                            "The resulting matrices are written to the files\n"
-    "                       randomMatrixA.txt and randomMatrixB.txt.\n";
-
-const char* shortopts = "V:a:b:o:B::hlr";
+    "                       for n,m,k in between 512 and 1024 unless --dims is "
+                            "given. The resulting matrices are\n"
+    "                       written to the files randomMatrixA.txt and "
+                            "randomMatrixB.txt.\n"
+    "  --seed <N>           Seed of the random matrices of -r. The same seed "
+                            "always gives the same matrices.\n"
+    "                       Defaults to the current time; the seed is printed.\n"
+    "  --dims <N>[x<M>x<K>] Dimensions of the random matrices of -r: A is N*M "
+                            "and B is M*K. A single number\n"
+    "                       gives square matrices.\n"
+    "  --density <D>        Expected fraction of nonzero values of the random "
+                            "matrices of -r (default: 0.1).\n"
+    "  --family <Name>      Structure of the random matrices of -r: uniform "
+                            "(default), banded, block-diagonal,\n"
+    "                       power-law or rmat.\n"
+    "  --rmat <a,b,c,d>     Generates R-MAT matrices whose values fall into the "
+                            "four quadrants with the given\n"
+    "                       probabilities at every level (default: "
+                            "0.57,0.19,0.19,0.05).\n"
+    "  --scale <S>          Makes the random matrices 2^S by 2^S.\n"
+    "  --edge-factor <F>    Average amount of values per row of the random "
+                            "matrices, in place of --density.\n"
+    "  --gen-binary         Writes the random matrices to randomMatrixA.bin "
+                            "and randomMatrixB.bin in the\n"
+    "                       binary format.\n";
+
+const char* daemon_help_msg =
+    "Resident matrices:\n"
+    "  --serve <Socket>     Daemon mode. Keeps named matrices in memory and "
+                            "serves requests on the Unix\n"
+    "                       domain socket Socket until it receives shutdown, "
+                            "SIGINT or SIGTERM. Requests are\n"
+    "                       lines of the form load <Name> <File>, mul <Name> "
+                            "<A> <B> [<Version>|auto],\n"
+    "                       fetch <Name> <File> (writes a binary file, e.g. "
+                            "to /dev/shm), drop <Name>, list\n"
+    "                       and shutdown. The transpose needed by versions 0 "
+                            "and 1 is kept with its matrix.\n"
+    "  --send <Socket>      Sends the remaining arguments as requests to the "
+                            "daemon on Socket and prints\n"
+    "                       its answers, e.g. --send /tmp/csc.sock \"load A "
+                            "a.txt\" \"mul C A A\".\n"
+    "Batches:\n"
+    "  --batch <Manifest>   Runs the products listed in Manifest, one per "
+                            "line as <A> <B> <Output>\n"
+    "                       (# starts a comment), with -V, -t, -p and "
+                            "--cache applying to all of them.\n"
+    "                       Loading, multiplying and writing run on their "
+                            "own threads, so the I/O of\n"
+    "                       one job overlaps the product of another. Failed "
+                            "jobs are reported and\n"
+    "                       skipped. Prints the throughput of the batch and "
+                            "how busy each stage was.\n";
+
+const char* shortopts = "V:a:b:o:B::hlrt:p:s::M:S";
 
 const struct option longopts[] = {
     {"help", no_argument, 0, 'h'},
+    {"threads", required_argument, 0, 't'},
+    {"precision", required_argument, 0, 'p'},
+    {"stream", optional_argument, 0, 's'},
+    {"memory", required_argument, 0, 'M'},
+    {"stats", no_argument, 0, 'S'},
+    {"to-binary", required_argument, 0, OPT_TO_BINARY},
+    {"to-text", required_argument, 0, OPT_TO_TEXT},
+    {"transposed", no_argument, 0, OPT_TRANSPOSED},
+    {"cache", required_argument, 0, OPT_CACHE},
+    {"cache-hash", no_argument, 0, OPT_CACHE_HASH},
+    {"bench", required_argument, 0, OPT_BENCH},
+    {"warmup", required_argument, 0, OPT_WARMUP},
+    {"flush-cache", no_argument, 0, OPT_FLUSH_CACHE},
+    {"seed", required_argument, 0, OPT_SEED},
+    {"dims", required_argument, 0, OPT_DIMS},
+    {"density", required_argument, 0, OPT_DENSITY},
+    {"family", required_argument, 0, OPT_FAMILY},
+    {"rmat", required_argument, 0, OPT_RMAT},
+    {"scale", required_argument, 0, OPT_SCALE},
+    {"edge-factor", required_argument, 0, OPT_EDGE_FACTOR},
+    {"gen-binary", no_argument, 0, OPT_GEN_BINARY},
+    {"trace", required_argument, 0, OPT_TRACE},
+    {"calibrate", optional_argument, 0, OPT_CALIBRATE},
+    {"model", required_argument, 0, OPT_MODEL},
+    {"pin", no_argument, 0, OPT_PIN},
+    {"serve", required_argument, 0, OPT_SERVE},
+    {"send", required_argument, 0, OPT_SEND},
+    {"batch", required_argument, 0, OPT_BATCH},
     {0,0,0,0}
 };
 
@@ -122,7 +298,8 @@ void create_random_matrix_doc(uint64_t minSize, uint64_t maxSize, const char* fi
 
 void print_help(const char* progname) {
     print_usage(progname);
-    fprintf(stderr, "\n%s", help_msg);
+    fprintf(stderr, "\n%s%s%s%s", help_msg, bench_help_msg,
+            generate_help_msg, daemon_help_msg);
 }
 
 
@@ -134,12 +311,13 @@ void free_csc_matrix(struct cscMatrix* matrix){
 }
 
 
-void free_transpose_matrix(struct cscMatrixTranspose* matrix){
+void free_csc_members(struct cscMatrix* matrix) {
     free(matrix->values);
     free(matrix->rowIndices);
     free(matrix->colPtr);
-    free(matrix->colIndices);
-    free(matrix);
+    matrix->values = 0;
+    matrix->rowIndices = 0;
+    matrix->colPtr = 0;
 }
 
 
@@ -258,22 +436,6 @@ static int line_parsing_uint(uint64_t* array, uint64_t num, char* line, char* ty
     return allZeros;
 }
 
-/**
- * Calculates the column indices from a csc Matrix.
- *
- * @param matrix         Matrix from which the indexes are to be calculated.
- * @param colIndices     Column indices of the matrix.
- */
-void get_col_indices(struct cscMatrixTranspose* matrix, uint64_t* colIndices) {
-    for (uint64_t i = 0; i < matrix->columns; ++i) {
-        uint64_t start = matrix->colPtr[i];
-        uint64_t len = matrix->colPtr[i+1] - matrix->colPtr[i];
-        for (uint64_t j = start; j < start+len; ++j) {
-            colIndices[j] = i;
-        }
-    }
-}
-
 /**
  * Parses the dimensions into the matrices
  *
@@ -304,6 +466,9 @@ static void read_dimensions(uint64_t* aRows, uint64_t* aCols, uint64_t* bRows, u
             errno = EINVAL;
 			return;
         }
+    } else {
+        errno = EINVAL;
+        perror("An error occurred during parsing");
     }
 
 }
@@ -325,10 +490,10 @@ static void read_values(uint64_t* aValC, uint64_t* bValC, float** aVals,
     size_t lenA = 0;
     size_t lenB = 0;
 
-    getline(&lineA, &lenA, fileA);
-    getline(&lineB, &lenB, fileB);
+    ssize_t readA = getline(&lineA, &lenA, fileA);
+    ssize_t readB = getline(&lineB, &lenB, fileB);
 
-    if (lineA && lineB) { 
+    if (readA >= 0 && readB >= 0) { 
         // Count amount of values in each matrix
         *aValC = count_values(lineA);
         *bValC = count_values(lineB);
@@ -341,8 +506,6 @@ static void read_values(uint64_t* aValC, uint64_t* bValC, float** aVals,
             *aVals = malloc(*aValC * sizeof(float));
             *bVals = malloc(*bValC * sizeof(float));
             if (!*aVals || !*bVals) {
-                free(*aVals);
-                free(*bVals);
                 free(lineA);
                 free(lineB);
                 errno = ENOMEM;
@@ -351,13 +514,12 @@ static void read_values(uint64_t* aValC, uint64_t* bValC, float** aVals,
 
             // Store values
             line_parsing_float(*aVals, *aValC, lineA);
-            if(errno) return;
-            line_parsing_float(*bVals, *bValC, lineB);
-            if(errno) return;
+            if (!errno) line_parsing_float(*bVals, *bValC, lineB);
         }
         free(lineA);
         free(lineB);
     } else {
+        errno = EINVAL;
         perror("An error occurred during parsing");
         free(lineA);
         free(lineB);
@@ -370,49 +532,41 @@ static void read_values(uint64_t* aValC, uint64_t* bValC, float** aVals,
  *
  * @param aValC         Value count of MatrixA. 
  * @param aRows         Rows of MatrixA.
- * @param aVals         Values of MatrixA.
  * @param aRowIds       Row indices of MatrixA.
  * @param bValC         Value count of MatrixB.
  * @param bRows         Rows of MatrixB.
- * @param bVals         Values of MatrixB.
  * @param bRowIds       Row indices of MatrixB.
  * @param fileA         File of a Matrix.
  * @param fileB         File of a Matrix.
  */
-static void read_row_indices(uint64_t aValC, uint64_t aRows, float** aVals, 
-        uint64_t** aRowIds, uint64_t bValC, uint64_t bRows, float** bVals, 
+static void read_row_indices(uint64_t aValC, uint64_t aRows,
+        uint64_t** aRowIds, uint64_t bValC, uint64_t bRows,
         uint64_t** bRowIds, FILE* fileA, FILE* fileB) {
     char* lineA = NULL;
     char* lineB = NULL;
     size_t lenA = 0;
     size_t lenB = 0;
 
-    getline(&lineA, &lenA, fileA);
-    getline(&lineB, &lenB, fileB);
+    ssize_t readA = getline(&lineA, &lenA, fileA);
+    ssize_t readB = getline(&lineB, &lenB, fileB);
 
-    if (lineA && lineB) {
+    if (readA >= 0 && readB >= 0) {
         if (count_values(lineA) != aValC || count_values(lineB) != bValC)
         {
             errno = EINVAL;
             perror("Wrong format. The number of indices and values do no match");
-            free(*aVals);
-            free(*bVals);
-            free(*aRowIds);
-            free(bRowIds);
+            free(lineA);
+            free(lineB);
             return;
         }
         if (aValC == 0 || bValC == 0) {
             *aRowIds = 0;
-            bRowIds = 0;
+            *bRowIds = 0;
         } else {
             // Allocate memory for the row indices
             *aRowIds = malloc(aValC * sizeof(uint64_t));
             *bRowIds = malloc(bValC * sizeof(uint64_t));
             if (!*aRowIds || !*bRowIds) {
-                free(*aVals);
-                free(*bVals);
-                free(*aRowIds);
-                free(*bRowIds);
                 free(lineA);
                 free(lineB);
                 errno = ENOMEM;
@@ -421,11 +575,12 @@ static void read_row_indices(uint64_t aValC, uint64_t aRows, float** aVals,
 
             // Store row indices
             line_parsing_uint(*aRowIds, aValC, lineA, "row", aRows);
-            line_parsing_uint(*bRowIds, bValC, lineB, "row", bRows);
+            if (!errno) line_parsing_uint(*bRowIds, bValC, lineB, "row", bRows);
         }
         free(lineA);
         free(lineB);
     } else {
+        errno = EINVAL;
         perror("An error occurred during parsing");
         free(lineA);
         free(lineB);
@@ -449,19 +604,20 @@ static int read_column_ptr(uint64_t aCols, uint64_t** aColPtr, uint64_t bCols,
     size_t lenA = 0;
     size_t lenB = 0;
 
-    getline(&lineA, &lenA, fileA);
-    getline(&lineB, &lenB, fileB);
-
-    uint64_t pointerCountA = count_values(lineA);
-    uint64_t pointerCountB = count_values(lineB);
+    ssize_t readA = getline(&lineA, &lenA, fileA);
+    ssize_t readB = getline(&lineB, &lenB, fileB);
 
-    if (lineA && lineB) {
+    if (readA >= 0 && readB >= 0) {
+        uint64_t pointerCountA = count_values(lineA);
+        uint64_t pointerCountB = count_values(lineB);
         if (pointerCountA != aCols + 1 || pointerCountB != bCols + 1) 
         {
             errno = EINVAL;
             perror("Wrong format. The number of column pointers is wrong");
             fprintf(stdout, "MatrixA Expected: %"PRIu64 " but was: %"PRIu64 "\n", pointerCountA, aCols + 1);
             fprintf(stdout, "MatrixB Expected: %"PRIu64 " but was: %"PRIu64 "\n", pointerCountB, bCols + 1);
+            free(lineA);
+            free(lineB);
             return 0;
         }
         uint64_t colPtrSizeA = aCols + 1;
@@ -488,6 +644,7 @@ static int read_column_ptr(uint64_t aCols, uint64_t** aColPtr, uint64_t bCols,
             return 0;
         }
     } else {
+        errno = EINVAL;
         perror("An error occurred during parsing");
         free(lineA);
         free(lineB);
@@ -496,69 +653,47 @@ static int read_column_ptr(uint64_t aCols, uint64_t** aColPtr, uint64_t bCols,
 }
 
 
-int parse_csc_file(const char* filename_a, const char* filename_b, 
-        struct cscMatrixTranspose* matrixA, struct cscMatrix* matrixB) {
-    errno = 0;
-    FILE* fileA = fopen(filename_a, "r");
-    FILE* fileB = fopen(filename_b, "r");
-
-    if (fileA == NULL || fileB == NULL) {
-        perror("Unable to open file.");
-        errno = ENOENT;
-        return 0;    
+// Opens an input file for reading. Directories can be opened, but not read,
+// so they are rejected with EISDIR.
+static FILE* open_input(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    struct stat st;
+    if (file && !fstat(fileno(file), &st) && S_ISDIR(st.st_mode)) {
+        fclose(file);
+        errno = EISDIR;
+        return NULL;
     }
+    return file;
+}
 
-    // Read dimensions
+int parse_csc_file_V2(const char* filename_a, const char* filename_b, 
+        struct cscMatrix* matrixA, struct cscMatrix* matrixB,
+        unsigned threads) {
     errno = 0;
-    read_dimensions(&matrixA->rows, &matrixA->columns, &matrixB->rows, 
-            &matrixB->columns, fileA, fileB);
-    if (errno) return 0;
-
-    // Read values
-    read_values(&matrixA->valueCount, &matrixB->valueCount, &matrixA->values, 
-            &matrixB->values, fileA, fileB);
-    if (errno) return 0;
-
-    // Read row indices
-    read_row_indices(matrixA->valueCount, matrixA->rows, &matrixA->values, 
-            &matrixA->rowIndices, matrixB->valueCount, matrixB->rows, &matrixB->values, 
-            &matrixB->rowIndices, fileA, fileB);
-    if (errno) return 0;
-
-    // Read column pointers
-    uint64_t isZero = read_column_ptr(matrixA->columns, &matrixA->colPtr, 
-            matrixB->columns, &matrixB->colPtr, fileA, fileB);
-    if (errno) {
-        free(matrixA);
-        free(matrixB);
-        return 0;
+    if (threads > 1) {
+        return parse_csc_files_mmap(filename_a, filename_b, matrixA, matrixB, 0,
+                threads);
     }
-    
-    //Get column indices 
-    matrixA->colIndices = malloc(matrixA->valueCount * sizeof(uint64_t));
-    if (matrixA->colIndices == NULL) {
-        free_csc_matrix(matrixB);
-        free_transpose_matrix(matrixA);
-        errno = ENOMEM;
-		return 0;
-    }
-    get_col_indices(matrixA, matrixA->colIndices);
-
-    fclose(fileA);
-    fclose(fileB);
-    return isZero;
-}
 
+    // Only the members are freed on failure, the matrices belong to the caller
+    matrixA->values = 0;
+    matrixA->rowIndices = 0;
+    matrixA->colPtr = 0;
+    matrixB->values = 0;
+    matrixB->rowIndices = 0;
+    matrixB->colPtr = 0;
 
-int parse_csc_file_V2(const char* filename_a, const char* filename_b, 
-        struct cscMatrix* matrixA, struct cscMatrix* matrixB) {
-    errno = 0;
-    FILE* fileA = fopen(filename_a, "r");
-    FILE* fileB = fopen(filename_b, "r");
+    // The error of the file that can not be opened is kept in errno
+    FILE* fileA = open_input(filename_a);
+    FILE* fileB = fileA ? open_input(filename_b) : NULL;
 
     if (fileA == NULL || fileB == NULL) {
-        perror("Unable to open file.");
-        errno = ENOENT;
+        perror("Unable to open file");
+        if (fileA) {
+            int err = errno;
+            fclose(fileA);
+            errno = err;
+        }
         return 0;    
     }
 
@@ -566,34 +701,42 @@ int parse_csc_file_V2(const char* filename_a, const char* filename_b,
     errno = 0;
     read_dimensions(&matrixA->rows, &matrixA->columns, &matrixB->rows, 
             &matrixB->columns, fileA, fileB);
-    if (errno) return 0;
+    if (errno) goto error;
 
     // Read values
+    TRACE_BEGIN(values);
     read_values(&matrixA->valueCount, &matrixB->valueCount, &matrixA->values, 
             &matrixB->values, fileA, fileB);
-    if (errno) return 0;
+    TRACE_END(values, "read values");
+    if (errno) goto error;
 
     // Read row indices
-    read_row_indices(matrixA->valueCount, matrixA->rows, &matrixA->values, 
-            &matrixA->rowIndices, matrixB->valueCount, matrixB->rows, &matrixB->values, 
-            &matrixB->rowIndices, fileA, fileB);
-    if (errno) return 0;
-
-    // FIXME: (URGENT): matrix pointers used to be freed after some failures 
-    // of read_column_ptr
+    TRACE_BEGIN(indices);
+    read_row_indices(matrixA->valueCount, matrixA->rows, &matrixA->rowIndices,
+            matrixB->valueCount, matrixB->rows, &matrixB->rowIndices, fileA,
+            fileB);
+    TRACE_END(indices, "read row indices");
+    if (errno) goto error;
 
     // Read column pointers
+    TRACE_BEGIN(pointers);
     uint64_t isZero = read_column_ptr(matrixA->columns, &matrixA->colPtr, 
             matrixB->columns, &matrixB->colPtr, fileA, fileB);
-    if (errno) { // WARNING: (@Alejandro) I don't know if this is the right fix
-        free(matrixA);
-        free(matrixB);
-        return 0;
-    }
+    TRACE_END(pointers, "read column pointers");
+    if (errno) goto error;
 
     fclose(fileA);
     fclose(fileB);
     return isZero;
+
+error:;
+    int error = errno;
+    free_csc_members(matrixA);
+    free_csc_members(matrixB);
+    fclose(fileA);
+    fclose(fileB);
+    errno = error;
+    return 0;
 }
 
 void print_empty_matrix(uint64_t rows, uint64_t columns, const char* output_file) {
@@ -620,58 +763,6 @@ void print_empty_matrix(uint64_t rows, uint64_t columns, const char* output_file
 
 
 void result_to_file(struct cscMatrix* result_matrix, const char* output_file) {  
-    FILE* file = fopen(output_file, "w");
-    if (!file) {
-        perror("Unable to open file ");
-        errno = ENOENT;
-		return;
-    }
-
-    //Write Dimensions
-    fprintf(file,  "%"PRIu64 ",%"PRIu64 "\n", result_matrix->rows, result_matrix->columns);
-    //Write Values
-    if (result_matrix->valueCount > 0) {
-        fprintf(file, "%g", result_matrix->values[0]);
-
-        for (uint64_t  i = 1; i < result_matrix->valueCount; i++) {   
-            if (logData && !(i % 100)) {
-                printf("\rWriting values. %.0f%% done.            ", 
-                        100*((double) i)/result_matrix->valueCount);
-                fflush(stdout);
-            }
-
-            fprintf(file, ",%g", result_matrix->values[i]);
-        }
-    }
-
-    fprintf(file, "\n");
-
-    if (result_matrix->valueCount > 0) {
-        //Write row indices
-        fprintf(file, "%"PRIu64 , result_matrix->rowIndices[0]);
-        for (uint64_t i = 1; i < result_matrix->valueCount; i++) {
-            if (logData && !(i % 100)) {
-                printf("\rWriting row indices. "
-                        "%.0f%% done.", 100*((double) i)/result_matrix->valueCount);
-                fflush(stdout);
-            }
-
-            fprintf(file, ",%"PRIu64, result_matrix->rowIndices[i]);
-        }
-    }
-    fprintf(file, "\n");
-
-    //Write column pointers
-    fprintf(file, "%" PRIu64, result_matrix->colPtr[0]);
-    for (uint64_t i = 1; i < result_matrix->columns + 1; i++) {
-            if (logData && !(i % 100)) {
-            printf("\rWriting column pointers. "
-                    "%.0f%% done.", 100*((double) i)/result_matrix->columns);
-            fflush(stdout);
-        }
-
-        fprintf(file, ",%" PRIu64, result_matrix->colPtr[i]);
-    }
-    fclose(file);
+    write_csc_text(result_matrix, output_file, 0);
 }
 
@@ -0,0 +1,757 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "csc_mmap.h"
+#include "csc_io.h"
+#include "cs_matrix.h"
+#include "transpose.h"
+#include "csc_pool.h"
+#include "csc_trace.h"
+
+/**
+ * @class textLine
+ *
+ * Line of a mapped file, without its line terminator
+ *
+ * @member begin    First character of the line
+ * @member end      End of the line (exclusive)
+ */
+struct textLine {
+    const char* begin;
+    const char* end;
+};
+
+// Powers of ten that are exactly representable as float and double
+static const float FLOAT_POW10[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+static const double DOUBLE_POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+    1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+int map_file(const char* filename, struct mappedFile* file) {
+    file->data = 0;
+    file->size = 0;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st)) {
+        close(fd);
+        return 0;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        errno = S_ISDIR(st.st_mode) ? EISDIR : ENODEV;
+        return 0;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        errno = EINVAL;
+        return 0;
+    }
+
+    void* data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return 0;
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    file->data = data;
+    file->size = st.st_size;
+    return 1;
+}
+
+void unmap_file(struct mappedFile* file) {
+    if (file->data) munmap((void*) file->data, file->size);
+    file->data = 0;
+    file->size = 0;
+}
+
+int cmp_files(const char* a, const char* b) {
+    struct mappedFile fileA, fileB;
+    if (!map_file(a, &fileA)) return 0;
+    if (!map_file(b, &fileB)) {
+        unmap_file(&fileA);
+        return 0;
+    }
+    int res = fileA.size == fileB.size
+        && !memcmp(fileA.data, fileB.data, fileA.size);
+    unmap_file(&fileA);
+    unmap_file(&fileB);
+    return res;
+}
+
+const char* scan_uint64(const char* p, const char* end, uint64_t* out) {
+    if (p >= end || (unsigned) (*p - '0') > 9) return 0;
+    uint64_t value = 0;
+    for (; p < end && (unsigned) (*p - '0') <= 9; ++p) {
+        unsigned digit = *p - '0';
+        if (value > (UINT64_MAX - digit) / 10) return 0;
+        value = value * 10 + digit;
+    }
+    *out = value;
+    return p;
+}
+
+/**
+ * Converts a number with strtof. Used for the inputs scan_float can not
+ * convert exactly by itself.
+ */
+static const char* scan_float_fallback(const char* p, const char* end,
+        float* out) {
+    char buf[128];
+    size_t len = 0;
+    while (p + len < end && len < sizeof(buf) - 1 && p[len] != ','
+            && p[len] != '\n') {
+        buf[len] = p[len];
+        len++;
+    }
+    buf[len] = '\0';
+    char* endptr;
+    *out = strtof(buf, &endptr);
+    if (endptr == buf) return 0;
+    return p + (endptr - buf);
+}
+
+const char* scan_float(const char* p, const char* end, float* out) {
+    const char* start = p;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    // At most 19 significant digits are kept in the mantissa, the value is
+    // mantissa * 10^exp10
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exp10 = 0;
+    int seen = 0;
+    int truncated = 0;
+    for (; p < end && (unsigned) (*p - '0') <= 9; ++p) {
+        seen = 1;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exp10++;
+            truncated |= *p != '0';
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && (unsigned) (*p - '0') <= 9; ++p) {
+            seen = 1;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exp10--;
+            } else {
+                truncated |= *p != '0';
+            }
+        }
+    }
+    if (!seen) return scan_float_fallback(start, end, out);
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        int expNegative = 0;
+        if (q < end && (*q == '-' || *q == '+')) expNegative = *q++ == '-';
+        if (q < end && (unsigned) (*q - '0') <= 9) {
+            int e = 0;
+            for (; q < end && (unsigned) (*q - '0') <= 9; ++q) {
+                if (e < 100000) e = e * 10 + (*q - '0');
+            }
+            exp10 += expNegative ? -e : e;
+            p = q;
+        }
+    }
+
+    float value;
+    if (mantissa == 0) {
+        value = 0;
+    } else if (mantissa < (1u << 24) && exp10 >= -10 && exp10 <= 10) {
+        // Both operands are exact, so a single float operation rounds correctly
+        value = exp10 < 0 ? (float) mantissa / FLOAT_POW10[-exp10]
+            : (float) mantissa * FLOAT_POW10[exp10];
+    } else if (!truncated && mantissa < (1ull << 53) && exp10 >= -22
+            && exp10 <= 22) {
+        double d = exp10 < 0 ? (double) mantissa / DOUBLE_POW10[-exp10]
+            : (double) mantissa * DOUBLE_POW10[exp10];
+        value = (float) d;
+    } else {
+        return scan_float_fallback(start, end, out);
+    }
+    *out = negative ? -value : value;
+    return p;
+}
+
+/**
+ * Gets the next line of a mapped file and advances the cursor past it.
+ * A trailing carriage return is not part of the line.
+ *
+ * @param cursor    Start of the line. Advanced to the start of the next line
+ * @param end       End of the mapped file
+ * @param line      Output parameter for the line
+ * @return          1 if there was a line left, 0 otherwise
+ */
+static int next_line(const char** cursor, const char* end,
+        struct textLine* line) {
+    if (*cursor >= end) return 0;
+    const char* nl = memchr(*cursor, '\n', end - *cursor);
+    line->begin = *cursor;
+    line->end = nl ? nl : end;
+    *cursor = nl ? nl + 1 : end;
+    if (line->end > line->begin && line->end[-1] == '\r') line->end--;
+    return 1;
+}
+
+/**
+ * Scans the next unsigned integer of a line and skips the separator after it.
+ *
+ * @return  1 if successful, 0 if there is no well-formed number at *p
+ */
+static int next_uint(const char** p, const char* end, uint64_t* out) {
+    const char* q = scan_uint64(*p, end, out);
+    if (!q || (q < end && *q != ',')) return 0;
+    *p = q + (q < end);
+    return 1;
+}
+
+/**
+ * Scans the next float of a line and skips the separator after it.
+ *
+ * @return  1 if successful, 0 if there is no well-formed number at *p
+ */
+static int next_float(const char** p, const char* end, float* out) {
+    const char* q = scan_float(*p, end, out);
+    if (!q || (q < end && *q != ',')) return 0;
+    *p = q + (q < end);
+    return 1;
+}
+
+/**
+ * Splits a mapped matrix file into its four lines and parses the dimensions.
+ *
+ * @return  1 if successful, 0 otherwise
+ */
+static int split_matrix_file(const struct mappedFile* file, uint64_t* rows,
+        uint64_t* columns, struct textLine* values, struct textLine* indices,
+        struct textLine* colPtr) {
+    const char* cursor = file->data;
+    const char* end = file->data + file->size;
+    struct textLine dims;
+    if (!next_line(&cursor, end, &dims) || !next_line(&cursor, end, values)
+            || !next_line(&cursor, end, indices)
+            || !next_line(&cursor, end, colPtr)) {
+        fprintf(stderr, "Wrong format. Matrix file is incomplete.\n");
+        return 0;
+    }
+    const char* p = dims.begin;
+    if (!next_uint(&p, dims.end, rows) || !next_uint(&p, dims.end, columns)
+            || p != dims.end || !*rows || !*columns) {
+        fprintf(stderr, "Wrong format. Could not read matrix dimensions.\n");
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Parses the column pointer line of a matrix.
+ *
+ * @return  1 if the line holds columns+1 sorted pointers from 0 to valueCount,
+ *          0 otherwise
+ */
+static int parse_col_ptr(struct textLine line, uint64_t* colPtr,
+        uint64_t columns, uint64_t valueCount) {
+    const char* p = line.begin;
+    for (uint64_t i = 0; i <= columns; ++i) {
+        if (p >= line.end || !next_uint(&p, line.end, &colPtr[i])
+                || (i ? colPtr[i] < colPtr[i - 1] : colPtr[0] != 0)) {
+            fprintf(stderr, "Wrong format. The column pointers are invalid.\n");
+            return 0;
+        }
+    }
+    if (p != line.end || colPtr[columns] != valueCount) {
+        fprintf(stderr, "Wrong format. The number of column pointers is wrong"
+                "\n");
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @class lineChunk
+ *
+ * Part of a line that is parsed by one thread. Chunks start at the beginning
+ * of a token and end after a separator (or at the end of the line).
+ *
+ * @member begin    First character of the chunk
+ * @member end      End of the chunk (exclusive)
+ * @member isFloat  Nonzero if the chunk holds floats, zero for integers
+ * @member limit    Integers must be less than limit. Ignored for floats
+ * @member count    Amount of tokens in the chunk
+ * @member offset   Index of the first token of the chunk in the whole line
+ * @member dest     Array to store the first token of the chunk at
+ * @member error    Set to EINVAL if the chunk is malformed
+ */
+struct lineChunk {
+    const char* begin;
+    const char* end;
+    int isFloat;
+    uint64_t limit;
+    uint64_t count;
+    uint64_t offset;
+    void* dest;
+    int error;
+};
+
+/**
+ * Splits a line into chunks of roughly equal size at token boundaries.
+ */
+static void split_line(struct textLine line, unsigned n,
+        struct lineChunk* chunks) {
+    size_t size = line.end - line.begin;
+    const char* prev = line.begin;
+    for (unsigned i = 0; i < n; ++i) {
+        const char* split = line.begin + (size * (i + 1)) / n;
+        if (i == n - 1 || split <= prev) {
+            split = i == n - 1 ? line.end : prev;
+        } else {
+            const char* comma = memchr(split, ',', line.end - split);
+            split = comma ? comma + 1 : line.end;
+        }
+        chunks[i].begin = prev;
+        chunks[i].end = split;
+        chunks[i].error = 0;
+        prev = split;
+    }
+}
+
+static void* count_chunk(void* arg) {
+    struct lineChunk* chunk = arg;
+    chunk->count = 0;
+    if (chunk->begin >= chunk->end) return 0;
+    TRACE_BEGIN(t);
+    // Every chunk but the last ends with a separator
+    const char* p = chunk->begin;
+    const char* last = chunk->end - 1;
+    chunk->count = 1;
+    while (p < last && (p = memchr(p, ',', last - p))) {
+        chunk->count++;
+        p++;
+    }
+    TRACE_END(t, "count chunk");
+    return 0;
+}
+
+static void parse_values(struct lineChunk* chunk) {
+    const char* p = chunk->begin;
+    if (chunk->isFloat) {
+        float* dest = chunk->dest;
+        for (uint64_t i = 0; i < chunk->count; ++i) {
+            if (!next_float(&p, chunk->end, &dest[i]) || dest[i] == 0) {
+                chunk->error = EINVAL;
+                return;
+            }
+        }
+    } else {
+        uint64_t* dest = chunk->dest;
+        for (uint64_t i = 0; i < chunk->count; ++i) {
+            if (!next_uint(&p, chunk->end, &dest[i])
+                    || dest[i] >= chunk->limit) {
+                chunk->error = EINVAL;
+                return;
+            }
+        }
+    }
+    if (p != chunk->end) chunk->error = EINVAL;
+}
+
+static void* parse_chunk(void* arg) {
+    TRACE_BEGIN(t);
+    parse_values(arg);
+    TRACE_END(t, "parse chunk");
+    return 0;
+}
+
+/**
+ * Runs fn on every chunk with the threads of the shared pool, see
+ * csc_pool_run.
+ */
+static void run_chunks(struct lineChunk* chunks, unsigned n,
+        void* (*fn)(void*)) {
+    csc_pool_run(csc_shared_pool(n), chunks, sizeof(*chunks), n, fn);
+}
+
+/**
+ * Parses a line of comma-separated numbers with several threads. Every thread
+ * counts the tokens of its chunk, the chunk offsets are computed with a prefix
+ * sum and every thread then parses its chunk into its part of the array.
+ *
+ * @param line      The line to parse
+ * @param isFloat   Nonzero if the line holds floats, zero for integers
+ * @param limit     Integers must be less than limit. Ignored for floats
+ * @param dest      Output parameter for the array. Allocated on the heap if
+ *                  the line is not empty, null otherwise
+ * @param count     Output parameter for the amount of tokens
+ * @param threads   Amount of threads to use
+ * @return          1 if successful, 0 otherwise. errno is set on failure
+ */
+static int parse_line_mt(struct textLine line, int isFloat, uint64_t limit,
+        void** dest, uint64_t* count, unsigned threads) {
+    size_t elemSize = isFloat ? sizeof(float) : sizeof(uint64_t);
+    *dest = 0;
+    struct lineChunk* chunks = malloc(threads * sizeof(*chunks));
+    if (!chunks) {
+        errno = ENOMEM;
+        return 0;
+    }
+    split_line(line, threads, chunks);
+    run_chunks(chunks, threads, count_chunk);
+
+    *count = 0;
+    for (unsigned i = 0; i < threads; ++i) {
+        chunks[i].isFloat = isFloat;
+        chunks[i].limit = limit;
+        chunks[i].offset = *count;
+        *count += chunks[i].count;
+    }
+    if (!*count) {
+        free(chunks);
+        return 1;
+    }
+
+    char* array = malloc(*count * elemSize);
+    if (!array) {
+        free(chunks);
+        errno = ENOMEM;
+        return 0;
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        chunks[i].dest = array + chunks[i].offset * elemSize;
+    }
+    run_chunks(chunks, threads, parse_chunk);
+
+    int err = 0;
+    for (unsigned i = 0; !err && i < threads; ++i) err = chunks[i].error;
+    free(chunks);
+    if (err) {
+        free(array);
+        errno = err;
+        return 0;
+    }
+    *dest = array;
+    return 1;
+}
+
+/**
+ * Parses a matrix file from a memory mapping, splitting every line across
+ * several threads.
+ *
+ * If an error occurs, errno is set and the pointer members of m are null.
+ *
+ * @param filename  Name of the file to parse
+ * @param m         Matrix to store the result in
+ * @param threads   Amount of threads to use
+ * @return          1 if the matrix contains no nonzero values, 0 otherwise
+ */
+static int parse_csc_mmap_mt(const char* filename, struct cscMatrix* m,
+        unsigned threads) {
+    m->values = 0;
+    m->rowIndices = 0;
+    m->colPtr = 0;
+
+    struct mappedFile file;
+    if (!map_file(filename, &file)) {
+        perror("Unable to map file");
+        return 0;
+    }
+
+    struct textLine valLine, idxLine, ptrLine;
+    uint64_t count;
+    if (!split_matrix_file(&file, &m->rows, &m->columns, &valLine, &idxLine,
+                &ptrLine)) goto format_error;
+
+    if (!parse_line_mt(valLine, 1, 0, (void**) &m->values, &m->valueCount,
+                threads)) {
+        fprintf(stderr, "Wrong format. The values must be nonzero numbers.\n");
+        goto error;
+    }
+    if (!parse_line_mt(idxLine, 0, m->rows, (void**) &m->rowIndices, &count,
+                threads)) {
+        fprintf(stderr, "Wrong format. Invalid row indices.\n");
+        goto error;
+    }
+    if (count != m->valueCount) {
+        fprintf(stderr, "Wrong format. The number of indices and values do no "
+                "match\n");
+        goto format_error;
+    }
+
+    m->colPtr = malloc((m->columns + 1) * sizeof(uint64_t));
+    if (!m->colPtr) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (!parse_col_ptr(ptrLine, m->colPtr, m->columns, count)) goto format_error;
+
+    unmap_file(&file);
+    return count == 0;
+
+format_error:
+    errno = EINVAL;
+error:
+    free_csc_members(m);
+    unmap_file(&file);
+    return 0;
+}
+
+int parse_csc_mmap(const char* filename, struct cscMatrix* m) {
+    m->values = 0;
+    m->rowIndices = 0;
+    m->colPtr = 0;
+
+    struct mappedFile file;
+    if (!map_file(filename, &file)) {
+        perror("Unable to map file");
+        return 0;
+    }
+
+    struct textLine valLine, idxLine, ptrLine;
+    if (!split_matrix_file(&file, &m->rows, &m->columns, &valLine, &idxLine,
+                &ptrLine)) goto format_error;
+
+    // A line of n numbers has at least 2n-1 characters. The allocation is
+    // shrunk after parsing; untouched pages of it are never backed by memory.
+    uint64_t maxCount = (valLine.end - valLine.begin + 1) / 2;
+    uint64_t count = 0;
+    if (maxCount) {
+        m->values = malloc(maxCount * sizeof(float));
+        if (!m->values) goto alloc_error;
+    }
+    const char* p = valLine.begin;
+    while (p < valLine.end) {
+        if (!next_float(&p, valLine.end, &m->values[count])) {
+            fprintf(stderr, "Wrong format. Invalid value at position %"PRIu64
+                    "\n", count);
+            goto format_error;
+        }
+        if (m->values[count++] == 0) {
+            errno = EINVAL;
+            perror("Wrong format. The values can not contain a zero value");
+            goto error;
+        }
+    }
+    m->valueCount = count;
+    if (count && count < maxCount) {
+        float* shrunk = realloc(m->values, count * sizeof(float));
+        if (shrunk) m->values = shrunk;
+    }
+
+    if (count) {
+        m->rowIndices = malloc(count * sizeof(uint64_t));
+        if (!m->rowIndices) goto alloc_error;
+    }
+    p = idxLine.begin;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (p >= idxLine.end || !next_uint(&p, idxLine.end, &m->rowIndices[i])
+                || m->rowIndices[i] >= m->rows) {
+            fprintf(stderr, "Wrong format. Invalid row index at position %"
+                    PRIu64"\n", i);
+            goto format_error;
+        }
+    }
+    if (p != idxLine.end) {
+        fprintf(stderr, "Wrong format. The number of indices and values do no "
+                "match\n");
+        goto format_error;
+    }
+
+    m->colPtr = malloc((m->columns + 1) * sizeof(uint64_t));
+    if (!m->colPtr) goto alloc_error;
+    if (!parse_col_ptr(ptrLine, m->colPtr, m->columns, count)) goto format_error;
+
+    unmap_file(&file);
+    return count == 0;
+
+format_error:
+    errno = EINVAL;
+    goto error;
+alloc_error:
+    errno = ENOMEM;
+error:
+    free_csc_members(m);
+    unmap_file(&file);
+    return 0;
+}
+
+int parse_csc_mmap_transposed(const char* filename, struct cscMatrix* m_t) {
+    uint64_t* colPtr = 0;
+    m_t->values = 0;
+    m_t->rowIndices = 0;
+    m_t->colPtr = 0;
+
+    struct mappedFile file;
+    if (!map_file(filename, &file)) {
+        perror("Unable to map file");
+        return 0;
+    }
+
+    uint64_t rows, columns;
+    struct textLine valLine, idxLine, ptrLine;
+    if (!split_matrix_file(&file, &rows, &columns, &valLine, &idxLine,
+                &ptrLine)) goto format_error;
+    m_t->rows = columns;
+    m_t->columns = rows;
+
+    // Count the entries of every row. The counts are stored shifted by two, so
+    // that after the prefix sum colPtr[r+1] is the insertion cursor of row r.
+    m_t->colPtr = calloc(rows + 2, sizeof(uint64_t));
+    colPtr = malloc((columns + 1) * sizeof(uint64_t));
+    if (!m_t->colPtr || !colPtr) goto alloc_error;
+
+    uint64_t count = 0;
+    const char* p = idxLine.begin;
+    while (p < idxLine.end) {
+        uint64_t row;
+        if (!next_uint(&p, idxLine.end, &row) || row >= rows) {
+            fprintf(stderr, "Wrong format. Invalid row index at position %"
+                    PRIu64"\n", count);
+            goto format_error;
+        }
+        m_t->colPtr[row + 2]++;
+        count++;
+    }
+    m_t->valueCount = count;
+
+    if (!parse_col_ptr(ptrLine, colPtr, columns, count)) goto format_error;
+
+    if (count) {
+        m_t->values = malloc(count * sizeof(float));
+        m_t->rowIndices = malloc(count * sizeof(uint64_t));
+        if (!m_t->values || !m_t->rowIndices) goto alloc_error;
+    }
+    for (uint64_t i = 2; i < rows + 1; ++i) {
+        m_t->colPtr[i] += m_t->colPtr[i - 1];
+    }
+
+    // Scatter every entry of column j into its row
+    const char* vp = valLine.begin;
+    p = idxLine.begin;
+    for (uint64_t j = 0; j < columns; ++j) {
+        for (uint64_t k = colPtr[j]; k < colPtr[j + 1]; ++k) {
+            float value;
+            uint64_t row;
+            if (vp >= valLine.end || !next_float(&vp, valLine.end, &value)) {
+                fprintf(stderr, "Wrong format. Invalid value at position %"
+                        PRIu64"\n", k);
+                goto format_error;
+            }
+            if (value == 0) {
+                errno = EINVAL;
+                perror("Wrong format. The values can not contain a zero value");
+                goto error;
+            }
+            next_uint(&p, idxLine.end, &row);
+            uint64_t dest = m_t->colPtr[row + 1]++;
+            m_t->values[dest] = value;
+            m_t->rowIndices[dest] = j;
+        }
+    }
+    if (vp != valLine.end) {
+        fprintf(stderr, "Wrong format. The number of indices and values do no "
+                "match\n");
+        goto format_error;
+    }
+
+    free(colPtr);
+    unmap_file(&file);
+    return count == 0;
+
+format_error:
+    errno = EINVAL;
+    goto error;
+alloc_error:
+    errno = ENOMEM;
+error:
+    free(colPtr);
+    free_csc_members(m_t);
+    unmap_file(&file);
+    return 0;
+}
+
+int is_mappable(const char* filename) {
+    struct stat st;
+    return stat(filename, &st) || S_ISREG(st.st_mode) || S_ISDIR(st.st_mode);
+}
+
+int parse_csc_file_mmap(const char* filename, struct cscMatrix* m,
+        int transpose, unsigned threads) {
+    errno = 0;
+    TRACE_BEGIN(t);
+    if (threads <= 1) {
+        int isZero = transpose ? parse_csc_mmap_transposed(filename, m)
+            : parse_csc_mmap(filename, m);
+        TRACE_END(t, transpose ? "parse transposed" : "parse");
+        return isZero;
+    }
+    if (!transpose) {
+        int isZero = parse_csc_mmap_mt(filename, m, threads);
+        TRACE_END(t, "parse");
+        return isZero;
+    }
+
+    // Parsing in parallel and transposing afterwards is faster than the
+    // sequential count and scatter passes, at the cost of a copy of the matrix
+    struct cscMatrix a = {0};
+    int isZero = parse_csc_mmap_mt(filename, &a, threads);
+    TRACE_END(t, "parse");
+    if (errno) return 0;
+    transpose_csc_mt(&a, m, threads);
+    free_csc_members(&a);
+    return isZero;
+}
+
+int parse_csc_files_mmap(const char* filename_a, const char* filename_b,
+        struct cscMatrix* matrixA, struct cscMatrix* matrixB, int transposeA,
+        unsigned threads) {
+    if (!is_mappable(filename_a) || !is_mappable(filename_b)) {
+        struct cscMatrix a = {0};
+        int isZero = parse_csc_file_V2(filename_a, filename_b,
+                transposeA ? &a : matrixA, matrixB, 1);
+        if (errno || !transposeA) return isZero;
+        transpose_csc_mt(&a, matrixA, threads);
+        free_csc_members(&a);
+        if (errno) free_csc_members(matrixB);
+        return isZero;
+    }
+
+    errno = 0;
+    int isZero = parse_csc_file_mmap(filename_a, matrixA, transposeA, threads);
+    if (errno) return 0;
+
+    isZero |= parse_csc_file_mmap(filename_b, matrixB, 0, threads);
+    if (errno) {
+        free_csc_members(matrixA);
+        return 0;
+    }
+
+    uint64_t aRows = transposeA ? matrixA->columns : matrixA->rows;
+    uint64_t aCols = transposeA ? matrixA->rows : matrixA->columns;
+    if (aCols != matrixB->rows) {
+        fprintf(stderr, "Dimension mismatch: cannot multiply %lu by %lu "
+                "matrix by a %lu by %lu matrix.\n", aRows, aCols,
+                matrixB->rows, matrixB->columns);
+        free_csc_members(matrixA);
+        free_csc_members(matrixB);
+        errno = EINVAL;
+        return 0;
+    }
+    return isZero;
+}
@@ -0,0 +1,405 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include "csc_model.h"
+#include "csc_binary.h"
+#include "csc_gen.h"
+#include "csc_io.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+#include "cs_matrix.h"
+
+void (*const modelKernels[MODEL_KERNELS])(const void*, const void*, void*) = {
+    matr_mult_csc, matr_mult_csc_V1, matr_mult_csc_V2};
+
+// Seconds per unit of the terms, fitted with calibrate_cost_model
+static const double DEFAULT_COEF[MODEL_KERNELS][MODEL_TERMS] = {
+    {2e-6, 0, 3.1e-9, 1.8e-7, 7e-12},
+    {2e-6, 1.3e-8, 7.9e-9, 1.5e-8, 2.5e-12},
+    {2e-6, 0, 0, 1.3e-6, 1.6e-9},
+};
+
+static const char MODEL_MAGIC[] = "csc-cost-model";
+#define MODEL_FORMAT_VERSION 1
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+void default_cost_model(struct costModel* m) {
+    memcpy(m->coef, DEFAULT_COEF, sizeof(m->coef));
+    m->calibrated = 0;
+}
+
+int read_cost_model(const char* filename, struct costModel* m) {
+    default_cost_model(m);
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        if (errno != ENOENT) return 0;
+        errno = 0;
+        return 1;
+    }
+    char magic[sizeof(MODEL_MAGIC)];
+    int format, calibrated = 0, ok;
+    ok = fscanf(file, "%14s %d calibrated %d", magic, &format,
+            &calibrated) == 3 && !strcmp(magic, MODEL_MAGIC)
+        && format == MODEL_FORMAT_VERSION;
+    struct costModel read = {{{0}}, calibrated};
+    for (int v = 0; ok && v < MODEL_KERNELS; v++) {
+        int version;
+        ok = fscanf(file, " V%d", &version) == 1 && version == v;
+        for (int i = 0; ok && i < MODEL_TERMS; i++) {
+            ok = fscanf(file, "%lf", &read.coef[v][i]) == 1
+                && read.coef[v][i] >= 0;
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        errno = EINVAL;
+        return 0;
+    }
+    *m = read;
+    return 1;
+}
+
+int load_cost_model(const char* filename, struct costModel* m) {
+    if (read_cost_model(filename, m)) return 1;
+    if (errno == EINVAL) fprintf(stderr, "%s is not a cost model.\n", filename);
+    return 0;
+}
+
+int save_cost_model(const char* filename, const struct costModel* m) {
+    FILE* file = fopen(filename, "w");
+    if (!file) return 0;
+    fprintf(file, "%s %d\ncalibrated %d\n", MODEL_MAGIC, MODEL_FORMAT_VERSION,
+            m->calibrated);
+    for (int v = 0; v < MODEL_KERNELS; v++) {
+        fprintf(file, "V%d", v);
+        for (int i = 0; i < MODEL_TERMS; i++) {
+            fprintf(file, " %.6e", m->coef[v][i]);
+        }
+        fprintf(file, "\n");
+    }
+    int ok = !ferror(file);
+    if (fclose(file) || !ok) {
+        if (!errno) errno = EIO;
+        return 0;
+    }
+    return 1;
+}
+
+int compute_features(const struct cscMatrix* a, const struct cscMatrix* b,
+        int transposedA, struct mulFeatures* f) {
+    memset(f, 0, sizeof(*f));
+    f->rows = transposedA ? a->columns : a->rows;
+    f->inner = b->rows;
+    f->columns = b->columns;
+    f->valuesA = a->valueCount;
+    f->valuesB = b->valueCount;
+    if (f->rows && f->inner) {
+        f->densityA = (double) f->valuesA / f->rows / f->inner;
+    }
+    if (f->inner && f->columns) {
+        f->densityB = (double) f->valuesB / f->inner / f->columns;
+    }
+
+    // Values of every column of A. Those of its transpose are its rows.
+    uint64_t* columnA = calloc(f->inner + 1, sizeof(uint64_t));
+    if (!columnA) {
+        errno = ENOMEM;
+        return 0;
+    }
+    if (transposedA) {
+        for (uint64_t i = 0; i < a->valueCount; i++) {
+            columnA[a->rowIndices[i]]++;
+        }
+    } else {
+        for (uint64_t k = 0; k < f->inner; k++) {
+            columnA[k] = a->colPtr[k + 1] - a->colPtr[k];
+        }
+    }
+    for (uint64_t k = 0; k < f->inner; k++) {
+        f->histA[csc_histogram_bucket(columnA[k])]++;
+        if (columnA[k] > f->maxColumnA) f->maxColumnA = columnA[k];
+    }
+
+    for (uint64_t j = 0; j < f->columns; j++) {
+        uint64_t n = b->colPtr[j + 1] - b->colPtr[j];
+        f->histB[csc_histogram_bucket(n)]++;
+        if (n > f->maxColumnB) f->maxColumnB = n;
+        if (n) f->nonEmptyB++;
+        // A row of the result is zero if it is zero in every column of A
+        // that is combined with the column, which are independent if the
+        // rows of A are random
+        double logZero = 0;
+        uint64_t products = 0;
+        for (uint64_t i = b->colPtr[j]; i < b->colPtr[j + 1]; i++) {
+            uint64_t k = b->rowIndices[i];
+            products += columnA[k];
+            if (f->rows) logZero += log1p(-(double) columnA[k] / f->rows);
+        }
+        f->products += products;
+        f->maxValues += products < f->rows ? products : f->rows;
+        f->estimatedValues += -expm1(logZero) * f->rows;
+    }
+    free(columnA);
+    if (f->rows && f->columns) {
+        f->estimatedDensity = f->estimatedValues / f->rows / f->columns;
+    }
+
+    double pairs = (double) f->nonEmptyB * f->rows;
+    f->terms[0] = 1;
+    f->terms[1] = pairs;
+    f->terms[2] = (double) f->nonEmptyB * f->valuesA
+        + (double) f->valuesB * f->rows;
+    f->terms[3] = f->estimatedValues;
+    f->terms[4] = pairs * (f->inner + f->valuesA / 2.0);
+    return 1;
+}
+
+double predict_cost(const struct costModel* m, int version,
+        const struct mulFeatures* f) {
+    double cost = 0;
+    for (int i = 0; i < MODEL_TERMS; i++) {
+        cost += m->coef[version][i] * f->terms[i];
+    }
+    return cost;
+}
+
+// Bytes of a result with the given amount of values, see csc_matrix_bytes
+static uint64_t result_bytes(const struct mulFeatures* f, uint64_t values) {
+    return values * (sizeof(float) + sizeof(uint64_t))
+        + (f->columns + 1) * sizeof(uint64_t);
+}
+
+void plan_multiplication(const struct mulFeatures* f,
+        const struct costModel* m, struct mulPlan* plan) {
+    uint64_t entry = sizeof(float) + sizeof(uint64_t);
+    plan->inputBytes = f->valuesA * entry + (f->inner + 1) * sizeof(uint64_t)
+        + f->valuesB * entry + (f->columns + 1) * sizeof(uint64_t);
+    // The transpose has a column pointer per row of A
+    plan->transposeBytes = f->valuesA * entry
+        + (f->rows + 1) * sizeof(uint64_t);
+    uint64_t values = (uint64_t) ceil(f->estimatedValues);
+    plan->resultBytes = result_bytes(f, values);
+    plan->maxResultBytes = result_bytes(f, f->maxValues);
+
+    // Mirrors initializeResultMatrix and extend_vector of the kernels
+    uint64_t capacity = f->rows > f->columns ? f->rows : f->columns;
+    while (capacity && capacity < values) capacity *= 2;
+    plan->peakBytes = capacity * (sizeof(float) + sizeof(uint64_t))
+        + (capacity + sizeof(uint64_t)) * sizeof(uint64_t);
+
+    plan->version = 0;
+    for (int v = 0; v < MODEL_KERNELS; v++) {
+        plan->predicted[v] = predict_cost(m, v, f);
+        if (plan->predicted[v] < plan->predicted[plan->version]) {
+            plan->version = v;
+        }
+    }
+}
+
+void print_mul_plan(const struct mulFeatures* f, const struct mulPlan* plan) {
+    printf("Product\n");
+    printf("Dimensions: %lu rows and %lu columns\n", f->rows, f->columns);
+    printf("Multiply-adds: %lu (%lu flops)\n", f->products, 2 * f->products);
+    printf("Nonzero values: about %.0f (density %.4g), at most %lu\n",
+            f->estimatedValues, f->estimatedDensity, f->maxValues);
+    printf("Memory: inputs %.3g MB, transpose of A %.3g MB, result about "
+            "%.3g MB (at most %.3g MB), %.3g MB allocated by the kernels\n",
+            plan->inputBytes / 1e6, plan->transposeBytes / 1e6,
+            plan->resultBytes / 1e6, plan->maxResultBytes / 1e6,
+            plan->peakBytes / 1e6);
+    printf("Predicted time:");
+    for (int v = 0; v < MODEL_KERNELS; v++) {
+        printf("%s V%d %.4g s", v ? "," : "", v, plan->predicted[v]);
+    }
+    printf(" (fastest: version %d)\n", plan->version);
+}
+
+int choose_kernel(const struct cscMatrix* a, const struct cscMatrix* b,
+        int transposedA, const struct costModel* m,
+        struct kernelChoice* choice) {
+    if (!compute_features(a, b, transposedA, &choice->features)) return 0;
+    choice->version = 0;
+    for (int v = 0; v < MODEL_KERNELS; v++) {
+        choice->predicted[v] = predict_cost(m, v, &choice->features);
+        if (choice->predicted[v] < choice->predicted[choice->version]) {
+            choice->version = v;
+        }
+    }
+    return 1;
+}
+
+int select_kernel(const char* filename_a, const char* filename_b,
+        unsigned threads, const struct cscCache* cache,
+        const struct costModel* m, struct kernelChoice* choice) {
+    struct cscFile a, b;
+    errno = 0;
+    // Versions 0 and 1 need the transpose, which is the common case
+    load_csc_files(filename_a, filename_b, &a, &b, 1, threads, cache, 0);
+    if (errno) return 0;
+    int ok = choose_kernel(&a.matrix, &b.matrix, 1, m, choice);
+    release_csc_file(&a);
+    release_csc_file(&b);
+    return ok;
+}
+
+void print_kernel_choice(const struct kernelChoice* choice,
+        const struct costModel* m, int verbose) {
+    const struct mulFeatures* f = &choice->features;
+    if (verbose) {
+        printf("A is %lu by %lu with %lu values (density %.4g), B is %lu by "
+                "%lu with %lu values (density %.4g).\n", f->rows, f->inner,
+                f->valuesA, f->densityA, f->inner, f->columns, f->valuesB,
+                f->densityB);
+        printCSCColumnHistogram("A", f->histA);
+        printCSCColumnHistogram("B", f->histB);
+        printf("%lu multiply-adds, about %.0f values in the result "
+                "(density %.4g).\n", f->products, f->estimatedValues,
+                f->estimatedDensity);
+    }
+    printf("Selected version %d with the %s cost model (predicted",
+            choice->version, m->calibrated ? "calibrated" : "built-in");
+    for (int v = 0; v < MODEL_KERNELS; v++) {
+        printf("%s V%d %.4g s", v ? "," : "", v, choice->predicted[v]);
+    }
+    printf(").\n");
+}
+
+/**
+ * Fits non-negative coefficients c minimizing the sum of the squared
+ * relative errors (x[i] * c - y[i]) / y[i] by coordinate descent on the
+ * normal equations, with every term scaled to unit norm first.
+ */
+static void fit_nonnegative(double (*x)[MODEL_TERMS], const double* y,
+        unsigned n, double* c) {
+    double scale[MODEL_TERMS], g[MODEL_TERMS][MODEL_TERMS], h[MODEL_TERMS];
+    for (int k = 0; k < MODEL_TERMS; k++) {
+        scale[k] = 0;
+        for (unsigned i = 0; i < n; i++) {
+            scale[k] += x[i][k] / y[i] * x[i][k] / y[i];
+        }
+        scale[k] = sqrt(scale[k]);
+    }
+    for (int k = 0; k < MODEL_TERMS; k++) {
+        h[k] = 0;
+        for (unsigned i = 0; i < n && scale[k]; i++) {
+            h[k] += x[i][k] / y[i] / scale[k];
+        }
+        for (int l = 0; l < MODEL_TERMS; l++) {
+            g[k][l] = 0;
+            for (unsigned i = 0; i < n && scale[k] && scale[l]; i++) {
+                g[k][l] += x[i][k] / y[i] / scale[k] * x[i][l] / y[i]
+                    / scale[l];
+            }
+        }
+        c[k] = 0;
+    }
+    for (int sweep = 0; sweep < 10000; sweep++) {
+        for (int k = 0; k < MODEL_TERMS; k++) {
+            if (!g[k][k]) continue;
+            double gradient = -h[k];
+            for (int l = 0; l < MODEL_TERMS; l++) gradient += g[k][l] * c[l];
+            c[k] -= gradient / g[k][k];
+            if (c[k] < 0) c[k] = 0;
+        }
+    }
+    for (int k = 0; k < MODEL_TERMS; k++) c[k] = scale[k] ? c[k] / scale[k] : 0;
+}
+
+// Shortest of three runs of a kernel. Returns a negative time on failure.
+static double time_kernel(int version, const struct cscMatrix* a,
+        const struct cscMatrix* b) {
+    double best = -1;
+    for (int run = 0; run < 3; run++) {
+        struct cscMatrix result = {0};
+        errno = 0;
+        double start = now();
+        quietKernels[version](a, b, &result);
+        double time = now() - start;
+        if (errno) return -1;
+        free_csc_members(&result);
+        if (best < 0 || time < best) best = time;
+    }
+    return best;
+}
+
+int calibrate_cost_model(struct costModel* m, FILE* log) {
+    static const unsigned sizes[] = {128, 256, 512, 1024};
+    static const double densities[] = {0.004, 0.02, 0.1};
+    static const int families[] = {FAMILY_UNIFORM, FAMILY_POWER_LAW};
+    enum {SAMPLES = sizeof(sizes) / sizeof(*sizes) * sizeof(densities)
+        / sizeof(*densities) * sizeof(families) / sizeof(*families)};
+    // Runs predicted to take longer are skipped
+    const double limit = 0.5;
+
+    struct costModel defaults;
+    default_cost_model(&defaults);
+    double x[MODEL_KERNELS][SAMPLES][MODEL_TERMS], y[MODEL_KERNELS][SAMPLES];
+    unsigned n[MODEL_KERNELS] = {0};
+    int ok = 1;
+    uint64_t seed = 1;
+    for (unsigned s = 0; ok && s < sizeof(sizes) / sizeof(*sizes); s++) {
+        for (unsigned d = 0; ok && d < sizeof(densities) / sizeof(*densities);
+                d++) {
+            for (unsigned f = 0; ok && f < sizeof(families) / sizeof(*families);
+                    f++) {
+                struct cscMatrix a = {0}, a_t = {0}, b = {0};
+                struct mulFeatures features;
+                ok = generate_family(&a, families[f], sizes[s], sizes[s],
+                        densities[d], seed++, 1)
+                    && generate_family(&b, families[f], sizes[s], sizes[s],
+                        densities[d], seed++, 1)
+                    && transpose_csc(&a, &a_t)
+                    && compute_features(&a, &b, 0, &features);
+                for (int v = 0; ok && v < MODEL_KERNELS; v++) {
+                    if (predict_cost(&defaults, v, &features) > limit) continue;
+                    double time = time_kernel(v, v == 2 ? &a : &a_t, &b);
+                    ok = time >= 0;
+                    if (!ok) break;
+                    // Durations below the clock resolution carry no signal
+                    if (time < 1e-6) continue;
+                    memcpy(x[v][n[v]], features.terms, sizeof(features.terms));
+                    y[v][n[v]++] = time;
+                    if (log) {
+                        fprintf(log, "%-10s %5u %6g  V%d  %10.4f ms\n",
+                                familyNames[families[f]], sizes[s],
+                                densities[d], v, 1e3 * time);
+                    }
+                }
+                free_csc_members(&a);
+                free_csc_members(&a_t);
+                free_csc_members(&b);
+            }
+        }
+    }
+    if (!ok) return 0;
+
+    *m = defaults;
+    m->calibrated = 1;
+    for (int v = 0; v < MODEL_KERNELS; v++) {
+        // Too few runs to fit the terms keep the built-in coefficients
+        if (n[v] < MODEL_TERMS) continue;
+        fit_nonnegative(x[v], y[v], n[v], m->coef[v]);
+        if (log) {
+            double error = 0;
+            for (unsigned i = 0; i < n[v]; i++) {
+                double predicted = 0;
+                for (int k = 0; k < MODEL_TERMS; k++) {
+                    predicted += m->coef[v][k] * x[v][i][k];
+                }
+                error += fabs(predicted - y[v][i]) / y[v][i];
+            }
+            fprintf(log, "V%d: fitted on %u runs, mean relative error "
+                    "%.1f%%.\n", v, n[v], 100 * error / n[v]);
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,600 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+
+#include "csc_mtx.h"
+#include "csc_mmap.h"
+#include "csc_writer.h"
+#include "csc_io.h"
+#include "cs_matrix.h"
+#include "csc_pool.h"
+
+// Fields of a Matrix Market file
+#define MTX_REAL 0
+#define MTX_INTEGER 1
+#define MTX_PATTERN 2
+
+// Symmetries of a Matrix Market file
+#define MTX_GENERAL 0
+#define MTX_SYMMETRIC 1
+#define MTX_SKEW_SYMMETRIC 2
+
+/**
+ * @class mtxInfo
+ *
+ * Header of a Matrix Market file
+ *
+ * @member rows         Amount of rows
+ * @member columns      Amount of columns
+ * @member entries      Amount of entry lines
+ * @member field        MTX_REAL, MTX_INTEGER or MTX_PATTERN
+ * @member symmetry     MTX_GENERAL, MTX_SYMMETRIC or MTX_SKEW_SYMMETRIC
+ * @member data         First character after the size line
+ */
+struct mtxInfo {
+    uint64_t rows;
+    uint64_t columns;
+    uint64_t entries;
+    int field;
+    int symmetry;
+    const char* data;
+};
+
+/**
+ * @class mtxChunk
+ *
+ * Lines of a Matrix Market file that are parsed by one thread
+ *
+ * @member begin        First character of the chunk
+ * @member end          End of the chunk (exclusive)
+ * @member info         Header of the file
+ * @member transpose    Nonzero if rows and columns are swapped
+ * @member capacity     Maximum amount of entries the chunk can produce
+ * @member minor        Destination of the row indices (of the stored matrix)
+ * @member major        Destination of the column indices
+ * @member values       Destination of the values
+ * @member lines        Amount of entry lines in the chunk
+ * @member count        Amount of entries written, including mirrored ones
+ * @member error        Set to EINVAL if the chunk is malformed
+ */
+struct mtxChunk {
+    const char* begin;
+    const char* end;
+    const struct mtxInfo* info;
+    int transpose;
+    uint64_t capacity;
+    uint64_t* minor;
+    uint64_t* major;
+    float* values;
+    uint64_t lines;
+    uint64_t count;
+    int error;
+};
+
+/**
+ * @class sortSlice
+ *
+ * Contiguous slice of the entries that is counted and scattered by one thread
+ * in a counting sort pass
+ *
+ * @member keys         Sort keys of the entries
+ * @member minor        Row indices of the entries
+ * @member major        Column indices of the entries
+ * @member values       Values of the entries
+ * @member begin        First entry of the slice
+ * @member end          End of the slice (exclusive)
+ * @member hist         Counts of the keys in the slice; then the position of
+ *                      the next entry of the slice with each key
+ * @member outMinor     Destination of the sorted row indices
+ * @member outMajor     Destination of the sorted column indices. May be null.
+ * @member outValues    Destination of the sorted values
+ */
+struct sortSlice {
+    const uint64_t* keys;
+    const uint64_t* minor;
+    const uint64_t* major;
+    const float* values;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t* hist;
+    uint64_t* outMinor;
+    uint64_t* outMajor;
+    float* outValues;
+};
+
+int is_mtx_file(const char* filename) {
+    struct mappedFile file;
+    int err = errno;
+    if (!map_file(filename, &file)) {
+        errno = err;
+        return 0;
+    }
+    size_t n = strlen(MTX_BANNER);
+    int res = file.size >= n && !memcmp(file.data, MTX_BANNER, n);
+    unmap_file(&file);
+    return res;
+}
+
+int has_mtx_extension(const char* filename) {
+    size_t n = strlen(filename);
+    return n >= 4 && !strcasecmp(filename + n - 4, ".mtx");
+}
+
+static const char* skip_blanks(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+/**
+ * Scans the next whitespace separated token of a line.
+ *
+ * @return  Pointer to the first character after the token
+ */
+static const char* next_token(const char* p, const char* end,
+        const char** token) {
+    p = skip_blanks(p, end);
+    *token = p;
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r') p++;
+    return p;
+}
+
+// Compares a token with a keyword, ignoring case
+static int is_token(const char* token, const char* end, const char* keyword) {
+    size_t n = strlen(keyword);
+    return (size_t) (end - token) == n && !strncasecmp(token, keyword, n);
+}
+
+/**
+ * Scans an unsigned integer preceded by blanks.
+ *
+ * @return  Pointer to the first character after the number, or null if there
+ *          is no number or it is not followed by a blank or the end of line
+ */
+static const char* next_uint(const char* p, const char* end, uint64_t* out) {
+    p = scan_uint64(skip_blanks(p, end), end, out);
+    if (p && p < end && *p != ' ' && *p != '\t' && *p != '\r') return 0;
+    return p;
+}
+
+/**
+ * Parses the banner, the comments and the size line of a Matrix Market file.
+ * Prints an error message if the header is invalid or unsupported.
+ *
+ * @return  1 if successful, 0 otherwise
+ */
+static int parse_mtx_header(const struct mappedFile* file,
+        struct mtxInfo* info) {
+    const char* p = file->data;
+    const char* end = file->data + file->size;
+    const char* nl = memchr(p, '\n', end - p);
+    const char* lineEnd = nl ? nl : end;
+
+    const char* tokens[5];
+    const char* tokenEnds[5];
+    for (int i = 0; i < 5; i++) {
+        p = next_token(p, lineEnd, &tokens[i]);
+        tokenEnds[i] = p;
+    }
+    if (!is_token(tokens[0], tokenEnds[0], MTX_BANNER)
+            || !is_token(tokens[1], tokenEnds[1], "matrix")) {
+        fprintf(stderr, "Wrong format. Not a Matrix Market matrix file.\n");
+        return 0;
+    }
+    if (!is_token(tokens[2], tokenEnds[2], "coordinate")) {
+        fprintf(stderr, "Only the coordinate format of Matrix Market files is "
+                "supported.\n");
+        return 0;
+    }
+    if (is_token(tokens[3], tokenEnds[3], "real")) info->field = MTX_REAL;
+    else if (is_token(tokens[3], tokenEnds[3], "integer")) {
+        info->field = MTX_INTEGER;
+    } else if (is_token(tokens[3], tokenEnds[3], "pattern")) {
+        info->field = MTX_PATTERN;
+    } else {
+        fprintf(stderr, "Unsupported Matrix Market field %.*s.\n",
+                (int) (tokenEnds[3] - tokens[3]), tokens[3]);
+        return 0;
+    }
+    if (is_token(tokens[4], tokenEnds[4], "general")) {
+        info->symmetry = MTX_GENERAL;
+    } else if (is_token(tokens[4], tokenEnds[4], "symmetric")) {
+        info->symmetry = MTX_SYMMETRIC;
+    } else if (is_token(tokens[4], tokenEnds[4], "skew-symmetric")) {
+        info->symmetry = MTX_SKEW_SYMMETRIC;
+    } else {
+        fprintf(stderr, "Unsupported Matrix Market symmetry %.*s.\n",
+                (int) (tokenEnds[4] - tokens[4]), tokens[4]);
+        return 0;
+    }
+
+    // Comments and blank lines up to the size line
+    p = nl ? nl + 1 : end;
+    for (;;) {
+        if (p >= end) {
+            fprintf(stderr, "Wrong format. The Matrix Market file has no size "
+                    "line.\n");
+            return 0;
+        }
+        nl = memchr(p, '\n', end - p);
+        lineEnd = nl ? nl : end;
+        const char* q = skip_blanks(p, lineEnd);
+        if (q < lineEnd && *q != '%') break;
+        p = nl ? nl + 1 : end;
+    }
+    if (!(p = next_uint(p, lineEnd, &info->rows))
+            || !(p = next_uint(p, lineEnd, &info->columns))
+            || !(p = next_uint(p, lineEnd, &info->entries))
+            || skip_blanks(p, lineEnd) != lineEnd
+            || !info->rows || !info->columns) {
+        fprintf(stderr, "Wrong format. Could not read matrix dimensions.\n");
+        return 0;
+    }
+    if (info->symmetry != MTX_GENERAL && info->rows != info->columns) {
+        fprintf(stderr, "Wrong format. A symmetric matrix must be square.\n");
+        return 0;
+    }
+    info->data = nl ? nl + 1 : end;
+    return 1;
+}
+
+/**
+ * Runs fn on n parts of size bytes each with the threads of the shared pool,
+ * see csc_pool_run.
+ */
+static void run_parts(void* parts, size_t size, unsigned n,
+        void* (*fn)(void*)) {
+    csc_pool_run(csc_shared_pool(n), parts, size, n, fn);
+}
+
+static void* count_lines(void* arg) {
+    struct mtxChunk* c = arg;
+    c->lines = 0;
+    const char* p = c->begin;
+    while (p < c->end && (p = memchr(p, '\n', c->end - p))) {
+        c->lines++;
+        p++;
+    }
+    // A last line without a line break
+    if (c->end > c->begin && c->end[-1] != '\n') c->lines++;
+    return 0;
+}
+
+static void* parse_entries(void* arg) {
+    struct mtxChunk* c = arg;
+    const struct mtxInfo* info = c->info;
+    c->lines = 0;
+    c->count = 0;
+    for (const char* p = c->begin; p < c->end;) {
+        const char* nl = memchr(p, '\n', c->end - p);
+        const char* lineEnd = nl ? nl : c->end;
+        const char* q = skip_blanks(p, lineEnd);
+        p = nl ? nl + 1 : c->end;
+        if (q == lineEnd || *q == '%') continue;
+
+        uint64_t row, col;
+        float value = 1;
+        if (!(q = next_uint(q, lineEnd, &row))
+                || !(q = next_uint(q, lineEnd, &col))
+                || !row || row > info->rows || !col || col > info->columns) {
+            c->error = EINVAL;
+            return 0;
+        }
+        if (info->field != MTX_PATTERN) {
+            q = scan_float(skip_blanks(q, lineEnd), lineEnd, &value);
+            if (!q) {
+                c->error = EINVAL;
+                return 0;
+            }
+        }
+        if (skip_blanks(q, lineEnd) != lineEnd) {
+            c->error = EINVAL;
+            return 0;
+        }
+        c->lines++;
+
+        uint64_t r = row - 1, k = col - 1;
+        c->minor[c->count] = c->transpose ? k : r;
+        c->major[c->count] = c->transpose ? r : k;
+        c->values[c->count++] = value;
+        if (info->symmetry != MTX_GENERAL && r != k) {
+            // The file only stores one triangle of the matrix
+            c->minor[c->count] = c->transpose ? r : k;
+            c->major[c->count] = c->transpose ? k : r;
+            c->values[c->count++] = info->symmetry == MTX_SKEW_SYMMETRIC
+                ? -value : value;
+        }
+    }
+    return 0;
+}
+
+static void* count_keys(void* arg) {
+    struct sortSlice* s = arg;
+    for (uint64_t i = s->begin; i < s->end; i++) {
+        s->hist[s->keys[i]]++;
+    }
+    return 0;
+}
+
+static void* scatter_keys(void* arg) {
+    struct sortSlice* s = arg;
+    for (uint64_t i = s->begin; i < s->end; i++) {
+        uint64_t pos = s->hist[s->keys[i]]++;
+        s->outMinor[pos] = s->minor[i];
+        if (s->outMajor) s->outMajor[pos] = s->major[i];
+        s->outValues[pos] = s->values[i];
+    }
+    return 0;
+}
+
+/**
+ * Stable parallel counting sort of the slices by their keys, which are less
+ * than keyCount. Every slice counts its keys, the positions of the slices'
+ * entries are computed with a prefix sum over the keys and slices, and every
+ * slice then scatters its entries.
+ *
+ * @param keyStart  Output parameter for the first position of every key and
+ *                  the total amount of entries. May be null.
+ * @return          1 if successful, 0 if the histograms could not be allocated
+ */
+static int counting_sort(struct sortSlice* slices, unsigned n,
+        uint64_t keyCount, uint64_t* keyStart) {
+    uint64_t* hist = calloc(n * keyCount, sizeof(uint64_t));
+    if (!hist) return 0;
+    for (unsigned t = 0; t < n; t++) {
+        slices[t].hist = hist + t * keyCount;
+    }
+    run_parts(slices, sizeof(*slices), n, count_keys);
+
+    uint64_t pos = 0;
+    for (uint64_t k = 0; k < keyCount; k++) {
+        if (keyStart) keyStart[k] = pos;
+        for (unsigned t = 0; t < n; t++) {
+            uint64_t count = slices[t].hist[k];
+            slices[t].hist[k] = pos;
+            pos += count;
+        }
+    }
+    if (keyStart) keyStart[keyCount] = pos;
+
+    run_parts(slices, sizeof(*slices), n, scatter_keys);
+    free(hist);
+    return 1;
+}
+
+/**
+ * Sums duplicate entries of every column and removes zeros. The row indices of
+ * every column must be sorted.
+ */
+static void compact_columns(struct cscMatrix* m) {
+    uint64_t k = 0, start = 0;
+    for (uint64_t j = 0; j < m->columns; j++) {
+        uint64_t end = m->colPtr[j + 1];
+        uint64_t first = k;
+        for (uint64_t i = start; i < end; i++) {
+            if (k > first && m->rowIndices[k - 1] == m->rowIndices[i]) {
+                m->values[k - 1] += m->values[i];
+            } else {
+                m->rowIndices[k] = m->rowIndices[i];
+                m->values[k++] = m->values[i];
+            }
+        }
+        uint64_t last = k;
+        k = first;
+        for (uint64_t i = first; i < last; i++) {
+            if (m->values[i] == 0) continue;
+            m->rowIndices[k] = m->rowIndices[i];
+            m->values[k++] = m->values[i];
+        }
+        m->colPtr[j] = first;
+        start = end;
+    }
+    m->colPtr[m->columns] = k;
+    m->valueCount = k;
+}
+
+int parse_mtx_file(const char* filename, struct cscMatrix* m, int transpose,
+        unsigned threads) {
+    memset(m, 0, sizeof(*m));
+    if (!threads) threads = 1;
+
+    struct mappedFile file;
+    if (!map_file(filename, &file)) {
+        perror("Unable to map file");
+        return 0;
+    }
+    struct mtxInfo info;
+    if (!parse_mtx_header(&file, &info)) {
+        unmap_file(&file);
+        errno = EINVAL;
+        return 0;
+    }
+    m->rows = transpose ? info.columns : info.rows;
+    m->columns = transpose ? info.rows : info.columns;
+
+    // Chunks of whole lines
+    const char* end = file.data + file.size;
+    struct mtxChunk* chunks = malloc(threads * sizeof(*chunks));
+    struct sortSlice* slices = malloc(threads * sizeof(*slices));
+    if (!chunks || !slices) {
+        free(chunks);
+        free(slices);
+        unmap_file(&file);
+        errno = ENOMEM;
+        perror("Unable to convert Matrix Market file");
+        return 0;
+    }
+    const char* prev = info.data;
+    for (unsigned t = 0; t < threads; t++) {
+        const char* split = info.data + (end - info.data) * (t + 1) / threads;
+        if (t == threads - 1 || split <= prev) {
+            split = t == threads - 1 ? end : prev;
+        } else {
+            const char* nl = memchr(split, '\n', end - split);
+            split = nl ? nl + 1 : end;
+        }
+        memset(&chunks[t], 0, sizeof(chunks[t]));
+        chunks[t].begin = prev;
+        chunks[t].end = split;
+        chunks[t].info = &info;
+        chunks[t].transpose = transpose != 0;
+        prev = split;
+    }
+    run_parts(chunks, sizeof(*chunks), threads, count_lines);
+
+    uint64_t capacity = 0;
+    for (unsigned t = 0; t < threads; t++) {
+        chunks[t].capacity = chunks[t].lines
+            * (info.symmetry == MTX_GENERAL ? 1 : 2);
+        capacity += chunks[t].capacity;
+    }
+    uint64_t* minor = malloc(capacity * sizeof(uint64_t));
+    uint64_t* major = malloc(capacity * sizeof(uint64_t));
+    float* values = malloc(capacity * sizeof(float));
+    uint64_t* sortedMinor = 0;
+    uint64_t* sortedMajor = 0;
+    float* sortedValues = 0;
+    if (capacity && (!minor || !major || !values)) goto memory_error;
+
+    uint64_t offset = 0;
+    for (unsigned t = 0; t < threads; t++) {
+        chunks[t].minor = minor + offset;
+        chunks[t].major = major + offset;
+        chunks[t].values = values + offset;
+        offset += chunks[t].capacity;
+    }
+    run_parts(chunks, sizeof(*chunks), threads, parse_entries);
+
+    uint64_t lines = 0, count = 0;
+    for (unsigned t = 0; t < threads; t++) {
+        if (chunks[t].error) {
+            fprintf(stderr, "Wrong format. Invalid entry in Matrix Market "
+                    "file.\n");
+            goto format_error;
+        }
+        lines += chunks[t].lines;
+        count += chunks[t].count;
+    }
+    if (lines != info.entries) {
+        fprintf(stderr, "Wrong format. The Matrix Market file has %lu entries "
+                "instead of %lu.\n", lines, info.entries);
+        goto format_error;
+    }
+
+    // First pass: stable sort by row
+    sortedMinor = malloc(count * sizeof(uint64_t));
+    sortedMajor = malloc(count * sizeof(uint64_t));
+    sortedValues = malloc(count * sizeof(float));
+    if (count && (!sortedMinor || !sortedMajor || !sortedValues)) {
+        goto memory_error;
+    }
+    offset = 0;
+    for (unsigned t = 0; t < threads; t++) {
+        slices[t] = (struct sortSlice) {minor, minor, major, values, offset,
+            offset + chunks[t].count, 0, sortedMinor, sortedMajor,
+            sortedValues};
+        offset += chunks[t].capacity;
+    }
+    if (!counting_sort(slices, threads, m->rows, 0)) goto memory_error;
+    free(minor);
+    free(major);
+    free(values);
+    minor = major = 0;
+    values = 0;
+
+    // Second pass: stable sort by column, which keeps the rows sorted
+    m->colPtr = malloc((m->columns + 1) * sizeof(uint64_t));
+    m->rowIndices = malloc(count * sizeof(uint64_t));
+    m->values = malloc(count * sizeof(float));
+    if (!m->colPtr || (count && (!m->rowIndices || !m->values))) {
+        goto memory_error;
+    }
+    for (unsigned t = 0; t < threads; t++) {
+        slices[t] = (struct sortSlice) {sortedMajor, sortedMinor, 0,
+            sortedValues, count * t / threads, count * (t + 1) / threads, 0,
+            m->rowIndices, 0, m->values};
+    }
+    if (!counting_sort(slices, threads, m->columns, m->colPtr)) {
+        goto memory_error;
+    }
+    free(sortedMinor);
+    free(sortedMajor);
+    free(sortedValues);
+    free(chunks);
+    free(slices);
+    unmap_file(&file);
+
+    compact_columns(m);
+    if (!m->valueCount) {
+        free(m->rowIndices);
+        free(m->values);
+        m->rowIndices = 0;
+        m->values = 0;
+    }
+    return m->valueCount == 0;
+
+memory_error:
+    errno = ENOMEM;
+    perror("Unable to convert Matrix Market file");
+    goto error;
+format_error:
+    errno = EINVAL;
+error:
+    free(minor);
+    free(major);
+    free(values);
+    free(sortedMinor);
+    free(sortedMajor);
+    free(sortedValues);
+    free(chunks);
+    free(slices);
+    free_csc_members(m);
+    m->colPtr = 0;
+    m->rowIndices = 0;
+    m->values = 0;
+    unmap_file(&file);
+    return 0;
+}
+
+static int put_string(struct textWriter* w, const char* s) {
+    int ok = 1;
+    while (ok && *s) ok = text_writer_put_char(w, *s++);
+    return ok;
+}
+
+int write_mtx_file(const struct cscMatrix* m, const char* filename,
+        int precision) {
+    struct textWriter w;
+    if (!open_text_writer(&w, filename)) return 0;
+
+    int ok = put_string(&w, MTX_BANNER " matrix coordinate real general\n")
+        && text_writer_put_uint64(&w, 0, m->rows)
+        && text_writer_put_uint64(&w, ' ', m->columns)
+        && text_writer_put_uint64(&w, ' ', m->valueCount)
+        && text_writer_put_char(&w, '\n');
+
+    w.section = "entries";
+    w.total = m->valueCount;
+    for (uint64_t j = 0; ok && m->valueCount && j < m->columns; j++) {
+        for (uint64_t i = m->colPtr[j]; ok && i < m->colPtr[j + 1]; i++) {
+            w.done = i;
+            ok = text_writer_put_uint64(&w, 0, m->rowIndices[i] + 1)
+                && text_writer_put_uint64(&w, ' ', j + 1)
+                && text_writer_put_float(&w, ' ', m->values[i], precision)
+                && text_writer_put_char(&w, '\n');
+        }
+    }
+    return close_text_writer(&w, ok);
+}
+
+int convert_mtx_to_text(const char* input, const char* output, int precision,
+        unsigned threads) {
+    struct cscMatrix m;
+    errno = 0;
+    parse_mtx_file(input, &m, 0, threads);
+    if (errno) return 0;
+    int res = write_csc_text_mt(&m, output, precision, threads);
+    free_csc_members(&m);
+    return res;
+}
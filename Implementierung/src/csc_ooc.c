@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "csc_ooc.h"
+#include "csc_binary.h"
+#include "csc_stream.h"
+#include "csc_mmap.h"
+#include "csc_io.h"
+#include "cs_matrix.h"
+
+// Size of a matrix with the given amount of columns and values in memory
+static uint64_t panel_bytes(uint64_t columns, uint64_t valueCount) {
+    return (columns + 1) * sizeof(uint64_t)
+        + valueCount * (sizeof(uint64_t) + sizeof(float));
+}
+
+/**
+ * Chooses the end of a panel of consecutive columns starting at first. The
+ * panel is extended while it fits into share bytes and the estimated size of
+ * its product fits into blockShare bytes. The product of a column with
+ * nonzero values is estimated as min(resultRows, nonzero values * fill)
+ * values.
+ *
+ * @return      Index of the first column after the panel, at least first + 1
+ */
+static uint64_t next_panel(const uint64_t* colPtr, uint64_t columns,
+        uint64_t first, uint64_t share, double fill, uint64_t resultRows,
+        double blockShare) {
+    double blockBytes = 0;
+    uint64_t end = first;
+    do {
+        double values = (colPtr[end + 1] - colPtr[end]) * fill;
+        if (values > resultRows) values = resultRows;
+        blockBytes += sizeof(uint64_t)
+            + values * (sizeof(uint64_t) + sizeof(float));
+        end++;
+    } while (end < columns
+            && panel_bytes(end + 1 - first, colPtr[end + 1] - colPtr[first])
+                <= share
+            && blockBytes <= blockShare);
+    return end;
+}
+
+/**
+ * Drops the pages of a read-only mapping that contain data from memory. They
+ * are read from the file again when accessed.
+ */
+static void drop_pages(const void* data, uint64_t size) {
+    if (!size) return;
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t) data & ~(page - 1);
+    madvise((void*) start, (uintptr_t) data + size - start, MADV_DONTNEED);
+}
+
+/**
+ * Joins the products of all row panels of A with a panel of B into one block.
+ * The row indices of piece p are shifted by rowStart[p]. The pieces are freed.
+ *
+ * @return      1 if successful, 0 otherwise. errno is set on failure.
+ */
+static int join_row_panels(struct cscMatrix* pieces, const uint64_t* rowStart,
+        uint64_t count, uint64_t rows, struct cscMatrix* block) {
+    memset(block, 0, sizeof(*block));
+    block->rows = rows;
+    block->columns = pieces[0].columns;
+    for (uint64_t p = 0; p < count; p++) {
+        block->valueCount += pieces[p].valueCount;
+    }
+    block->colPtr = malloc((block->columns + 1) * sizeof(uint64_t));
+    block->rowIndices = malloc(block->valueCount * sizeof(uint64_t));
+    block->values = malloc(block->valueCount * sizeof(float));
+    int ok = block->colPtr
+        && (!block->valueCount || (block->rowIndices && block->values));
+
+    uint64_t k = 0;
+    for (uint64_t j = 0; ok && j < block->columns; j++) {
+        block->colPtr[j] = k;
+        // The row panels are in ascending order, so the rows stay sorted
+        for (uint64_t p = 0; p < count; p++) {
+            const struct cscMatrix* piece = &pieces[p];
+            for (uint64_t i = piece->colPtr[j]; i < piece->colPtr[j + 1]; i++) {
+                block->rowIndices[k] = piece->rowIndices[i] + rowStart[p];
+                block->values[k++] = piece->values[i];
+            }
+        }
+    }
+    if (ok) block->colPtr[block->columns] = k;
+
+    for (uint64_t p = 0; p < count; p++) {
+        free_csc_members(&pieces[p]);
+        memset(&pieces[p], 0, sizeof(pieces[p]));
+    }
+    if (!ok) {
+        free_csc_members(block);
+        errno = ENOMEM;
+    }
+    return ok;
+}
+
+/**
+ * Checks that the files of A and B can be multiplied out of core. Prints an
+ * error message otherwise.
+ *
+ * @return      1 if they can, 0 otherwise
+ */
+static int check_ooc_inputs(const struct cscFile* a, const struct cscFile* b,
+        int transposedA) {
+    if (a->transposed != transposedA) {
+        fprintf(stderr, "Matrix A must be stored %s for this version. Convert "
+                "it with --to-binary%s.\n", transposedA ? "transposed"
+                : "untransposed", transposedA ? " --transposed" : "");
+        return 0;
+    }
+    if (b->transposed) {
+        fprintf(stderr, "Matrix B must not be stored transposed.\n");
+        return 0;
+    }
+    uint64_t aRows = transposedA ? a->matrix.columns : a->matrix.rows;
+    uint64_t aCols = transposedA ? a->matrix.rows : a->matrix.columns;
+    if (aCols != b->matrix.rows) {
+        fprintf(stderr, "Dimension mismatch: cannot multiply %lu by %lu "
+                "matrix by a %lu by %lu matrix.\n", aRows, aCols,
+                b->matrix.rows, b->matrix.columns);
+        return 0;
+    }
+    return 1;
+}
+
+int mul_csc_ooc(void (*mul)(const void*, const void*, void*), int transposedA,
+        const char* filename_a, const char* filename_b, uint64_t budget,
+        const char* filename, struct oocStats* stats) {
+    transposedA = transposedA != 0;
+    if (budget < CSC_OOC_MIN_BUDGET) {
+        fprintf(stderr, "The memory budget must be at least %d bytes.\n",
+                CSC_OOC_MIN_BUDGET);
+        errno = EINVAL;
+        return 0;
+    }
+    if (!is_csc_binary(filename_a) || !is_csc_binary(filename_b)) {
+        fprintf(stderr, "The out-of-core mode requires binary input files. "
+                "Convert them with --to-binary.\n");
+        errno = EINVAL;
+        return 0;
+    }
+
+    struct cscFile a, b;
+    errno = 0;
+    map_csc_binary(filename_a, &a, 0);
+    if (errno) return 0;
+    map_csc_binary(filename_b, &b, 0);
+    if (errno) {
+        release_csc_file(&a);
+        return 0;
+    }
+    if (!check_ooc_inputs(&a, &b, transposedA)) {
+        release_csc_file(&a);
+        release_csc_file(&b);
+        errno = EINVAL;
+        return 0;
+    }
+    const struct cscBinaryHeader* headerB = (const void*) b.mapping.data;
+    uint64_t resultRows = transposedA ? a.matrix.columns : a.matrix.rows;
+    uint64_t resultColumns = b.matrix.columns;
+    // Average amount of values a nonzero value of B adds to the product
+    double fill = b.matrix.rows
+        ? (double) a.matrix.valueCount / b.matrix.rows : 0;
+
+    // Row panels of A. Without transpose(A), A is used as a single panel.
+    uint64_t aPanels = 0;
+    uint64_t* rowStart = malloc(((transposedA ? resultRows : 0) + 2)
+            * sizeof(uint64_t));
+    if (!rowStart) {
+        release_csc_file(&a);
+        release_csc_file(&b);
+        errno = ENOMEM;
+        return 0;
+    }
+    rowStart[0] = 0;
+    if (transposedA) {
+        for (uint64_t r = 0; r < resultRows; aPanels++) {
+            r = next_panel(a.matrix.colPtr, resultRows, r, budget / 4, 0, 0,
+                    budget);
+            rowStart[aPanels + 1] = r;
+        }
+    }
+    if (!aPanels) rowStart[++aPanels] = resultRows;
+
+    struct cscMatrix* pieces = calloc(aPanels, sizeof(struct cscMatrix));
+    int fd = open(filename_b, O_RDONLY);
+    struct cscStreamWriter w;
+    if (!pieces || fd < 0 || !open_stream_writer(&w, filename, resultRows,
+                resultColumns, 1)) {
+        if (!pieces) errno = ENOMEM;
+        else if (fd < 0) perror("Unable to open file");
+        if (fd >= 0) close(fd);
+        free(pieces);
+        free(rowStart);
+        release_csc_file(&a);
+        release_csc_file(&b);
+        return 0;
+    }
+
+    struct oocStats s = {0};
+    s.aPanels = aPanels;
+    int ok = 1;
+    for (uint64_t j = 0; ok && j < resultColumns; s.bPanels++) {
+        uint64_t end = next_panel(b.matrix.colPtr, resultColumns, j,
+                budget / 4, fill, resultRows, budget / 8.0);
+        struct cscMatrix panel;
+        errno = 0;
+        if (!read_csc_binary_columns(fd, headerB, j, end - j, &panel)) {
+            perror("Unable to read panel of matrix B");
+            ok = 0;
+            break;
+        }
+        s.bBytesRead += panel_bytes(panel.columns, panel.valueCount);
+
+        for (uint64_t p = 0; ok && p < aPanels; p++) {
+            // View of the row panel, which shares all arrays with the mapping
+            struct cscMatrix view = a.matrix;
+            if (transposedA) {
+                view.columns = rowStart[p + 1] - rowStart[p];
+                view.colPtr = a.matrix.colPtr + rowStart[p];
+            }
+            uint64_t first = view.colPtr[0];
+            uint64_t valueCount = view.colPtr[view.columns] - first;
+
+            errno = 0;
+            mul(&view, &panel, &pieces[p]);
+            if (errno) {
+                // The kernel already freed the piece
+                memset(&pieces[p], 0, sizeof(pieces[p]));
+                ok = 0;
+                break;
+            }
+            s.products++;
+            s.aBytesRead += panel_bytes(view.columns, valueCount);
+            if (aPanels > 1) {
+                drop_pages(view.colPtr, (view.columns + 1) * sizeof(uint64_t));
+                drop_pages(view.rowIndices + first,
+                        valueCount * sizeof(uint64_t));
+                drop_pages(view.values + first, valueCount * sizeof(float));
+            }
+        }
+        free_csc_members(&panel);
+
+        struct cscMatrix block;
+        if (ok) {
+            ok = join_row_panels(pieces, rowStart, aPanels, resultRows, &block)
+                && stream_writer_push(&w, &block, j);
+        }
+        if (logData) {
+            printf("\rMultiplying panels. %.0f%% done.",
+                    100 * (double) end / resultColumns);
+            fflush(stdout);
+        }
+        j = end;
+    }
+    int err = errno;
+    for (uint64_t p = 0; p < aPanels; p++) {
+        free_csc_members(&pieces[p]);
+    }
+    ok = close_stream_writer(&w) && ok;
+    if (!ok && err) errno = err;
+    if (logData) printf("\n");
+
+    s.valueCount = w.valueCount;
+    s.bytesWritten = w.bytes;
+    if (stats) *stats = s;
+
+    close(fd);
+    free(pieces);
+    free(rowStart);
+    release_csc_file(&a);
+    release_csc_file(&b);
+    return ok;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "csc_perf.h"
+
+const char* const perfCounterNames[PERF_COUNTERS] = {"cycles", "instructions",
+    "L1d misses", "LLC misses", "branch misses", "dTLB misses"};
+
+#ifdef __linux__
+// Type and config of every counter, see perf_event_open(2)
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} events[PERF_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+        | PERF_COUNT_HW_CACHE_OP_READ << 8
+        | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB
+        | PERF_COUNT_HW_CACHE_OP_READ << 8
+        | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+};
+#endif
+
+unsigned perf_open(struct perfGroup* g) {
+    g->opened = 0;
+    for (int i = 0; i < PERF_COUNTERS; i++) g->fds[i] = -1;
+#ifdef __linux__
+    int leader = -1, firstErr = 0;
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // Counts the threads created afterwards as well, e.g. the pool workers.
+        // Reading the counter includes the threads that are still running.
+        attr.inherit = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        g->fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (g->fds[i] < 0) {
+            if (!firstErr) firstErr = errno;
+            g->fds[i] = -1;
+            continue;
+        }
+        if (leader < 0) leader = g->fds[i];
+        g->opened++;
+    }
+    if (!g->opened) errno = firstErr;
+#else
+    errno = ENOSYS;
+#endif
+    return g->opened;
+}
+
+void perf_read(const struct perfGroup* g, struct perfReading* r) {
+    memset(r, 0, sizeof(*r));
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        uint64_t data[3];
+        if (g->fds[i] < 0 || read(g->fds[i], data, sizeof(data))
+                != sizeof(data)) continue;
+        r->value[i] = data[0];
+        r->enabled[i] = data[1];
+        r->running[i] = data[2];
+    }
+}
+
+void perf_accumulate(struct perfTotals* t, const struct perfReading* before,
+        const struct perfReading* after) {
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        uint64_t running = after->running[i] - before->running[i];
+        uint64_t enabled = after->enabled[i] - before->enabled[i];
+        if (!running) continue;
+        double count = after->value[i] - before->value[i];
+        if (running < enabled) {
+            count = count * enabled / running;
+            t->scaled = 1;
+        }
+        t->count[i] += count;
+        t->counted[i] = 1;
+    }
+}
+
+void perf_close(struct perfGroup* g) {
+    // The members of the group are closed before the leader
+    for (int i = PERF_COUNTERS - 1; i >= 0; i--) {
+        if (g->fds[i] >= 0) close(g->fds[i]);
+        g->fds[i] = -1;
+    }
+    g->opened = 0;
+}
+
+void print_perf_totals(const char* const* names,
+        const struct perfTotals* totals, unsigned phases) {
+    int scaled = 0;
+    printf("%-10s", "phase");
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        printf(" %15s", perfCounterNames[i]);
+    }
+    printf(" %6s\n", "IPC");
+    for (unsigned p = 0; p < phases; p++) {
+        const struct perfTotals* t = &totals[p];
+        printf("%-10s", names[p]);
+        for (int i = 0; i < PERF_COUNTERS; i++) {
+            if (t->counted[i]) printf(" %15.0f", t->count[i]);
+            else printf(" %15s", "n/a");
+        }
+        if (t->counted[PERF_CYCLES] && t->counted[PERF_INSTRUCTIONS]
+                && t->count[PERF_CYCLES] > 0) {
+            printf(" %6.2f\n", t->count[PERF_INSTRUCTIONS]
+                    / t->count[PERF_CYCLES]);
+        } else {
+            printf(" %6s\n", "n/a");
+        }
+        scaled |= t->scaled;
+    }
+    if (scaled) {
+        printf("Some counters were multiplexed by the kernel; their counts "
+                "are scaled estimates.\n");
+    }
+}
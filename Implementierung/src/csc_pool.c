@@ -0,0 +1,335 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "csc_pool.h"
+
+/**
+ * @class cscPoolJob
+ *
+ * A job on the stack of its submitting thread
+ *
+ * @member task     Called with the index of every part and arg
+ * @member arg      Passed to task
+ * @member count    Amount of parts
+ * @member next     Index of the next part to start, guarded by the lock of
+ *                  the pool
+ * @member finished Amount of finished parts, updated atomically. The job
+ *                  must not be touched after the last one is counted.
+ * @member link     Next job in the queue of the pool
+ */
+struct cscPoolJob {
+    void (*task)(uint64_t index, void* arg);
+    void* arg;
+    uint64_t count;
+    uint64_t next;
+    uint64_t finished;
+    struct cscPoolJob* link;
+};
+
+static struct cscPool sharedPool;
+static int sharedStarted = 0;
+static int sharedPin = 0;
+static pthread_mutex_t sharedLock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Pins a worker to the (index+1)-th processor the process may run on
+static void pin_worker(pthread_t tid, unsigned index) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed)) return;
+    int count = CPU_COUNT(&allowed);
+    if (!count) return;
+    int target = (index + 1) % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed) || target--) continue;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(tid, sizeof(set), &set);
+        return;
+    }
+#else
+    (void) tid;
+    (void) index;
+#endif
+}
+
+/**
+ * Starts the next part of a job and removes the job from the queue if it
+ * was the last one. The lock of the pool must be held.
+ */
+static uint64_t claim_part(struct cscPool* pool, struct cscPoolJob* job) {
+    uint64_t index = job->next++;
+    if (job->next < job->count) return index;
+    struct cscPoolJob** p = &pool->jobs;
+    while (*p && *p != job) p = &(*p)->link;
+    if (*p) __atomic_store_n(p, job->link, __ATOMIC_RELAXED);
+    return index;
+}
+
+static void run_part(struct cscPool* pool, struct cscPoolJob* job,
+        uint64_t index) {
+    uint64_t count = job->count;
+    job->task(index, job->arg);
+    if (__atomic_add_fetch(&job->finished, 1, __ATOMIC_ACQ_REL) == count) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// Returns nonzero if a job was queued while spinning
+static int spin_for_job(struct cscPool* pool) {
+    unsigned spin = __atomic_load_n(&pool->spin, __ATOMIC_RELAXED);
+    for (unsigned i = 0; i < spin; i++) {
+        if (__atomic_load_n(&pool->jobs, __ATOMIC_RELAXED)) return 1;
+        cpu_relax();
+    }
+    return 0;
+}
+
+static void* run_worker(void* arg) {
+    struct cscPool* pool = arg;
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop) {
+        struct cscPoolJob* job = pool->jobs;
+        if (job) {
+            uint64_t index = claim_part(pool, job);
+            pthread_mutex_unlock(&pool->lock);
+            run_part(pool, job, index);
+            pthread_mutex_lock(&pool->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        int found = spin_for_job(pool);
+        pthread_mutex_lock(&pool->lock);
+        while (!found && !pool->jobs && !pool->stop) {
+            pool->sleeping++;
+            pthread_cond_wait(&pool->wake, &pool->lock);
+            pool->sleeping--;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+/**
+ * Starts workers until the pool has the given amount of threads. The lock
+ * of the pool must be held.
+ */
+static int add_workers(struct cscPool* pool, unsigned threads) {
+    if (threads <= pool->threads) return 1;
+    pthread_t* workers = realloc(pool->workers,
+            (threads - 1) * sizeof(pthread_t));
+    if (!workers) {
+        errno = ENOMEM;
+        return 0;
+    }
+    pool->workers = workers;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    __atomic_store_n(&pool->spin, processors > 0 && threads <= processors
+            ? CSC_POOL_SPIN : 0, __ATOMIC_RELAXED);
+    while (pool->threads < threads) {
+        unsigned index = pool->threads - 1;
+        int err = pthread_create(&workers[index], 0, run_worker, pool);
+        if (err) {
+            errno = err;
+            return 0;
+        }
+        if (pool->pin) pin_worker(workers[index], index);
+        __atomic_store_n(&pool->threads, pool->threads + 1, __ATOMIC_RELAXED);
+    }
+    return 1;
+}
+
+int csc_pool_init(struct cscPool* pool, unsigned threads, int pin) {
+    pool->jobs = 0;
+    pool->workers = 0;
+    pool->threads = 1;
+    pool->sleeping = 0;
+    pool->spin = 0;
+    pool->pin = pin;
+    pool->stop = 0;
+    pthread_mutex_init(&pool->lock, 0);
+    pthread_cond_init(&pool->wake, 0);
+    pthread_cond_init(&pool->done, 0);
+    pthread_mutex_lock(&pool->lock);
+    int ok = add_workers(pool, threads ? threads : 1);
+    pthread_mutex_unlock(&pool->lock);
+    if (!ok) {
+        int err = errno;
+        csc_pool_destroy(pool);
+        errno = err;
+    }
+    return ok;
+}
+
+void csc_pool_destroy(struct cscPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (unsigned i = 0; i + 1 < pool->threads; i++) {
+        pthread_join(pool->workers[i], 0);
+    }
+    free(pool->workers);
+    pool->workers = 0;
+    pool->threads = 1;
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+unsigned csc_pool_threads(struct cscPool* pool) {
+    return pool ? __atomic_load_n(&pool->threads, __ATOMIC_RELAXED) : 1;
+}
+
+/**
+ * Runs task on the indices 0 to count - 1 with the threads of the pool and
+ * returns when all are finished.
+ */
+static void run_job(struct cscPool* pool, void (*task)(uint64_t, void*),
+        void* arg, uint64_t count) {
+    if (count < 2 || csc_pool_threads(pool) < 2) {
+        for (uint64_t i = 0; i < count; i++) task(i, arg);
+        return;
+    }
+    struct cscPoolJob job = {task, arg, count, 0, 0, 0};
+    pthread_mutex_lock(&pool->lock);
+    struct cscPoolJob** last = &pool->jobs;
+    while (*last) last = &(*last)->link;
+    __atomic_store_n(last, &job, __ATOMIC_RELAXED);
+    // The calling thread takes one part itself
+    unsigned wake = count - 1 < pool->sleeping ? count - 1 : pool->sleeping;
+    for (unsigned i = 0; i < wake; i++) pthread_cond_signal(&pool->wake);
+
+    while (job.next < count) {
+        uint64_t index = claim_part(pool, &job);
+        pthread_mutex_unlock(&pool->lock);
+        run_part(pool, &job, index);
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    // The parts of the workers are usually about to finish as well
+    unsigned spin = __atomic_load_n(&pool->spin, __ATOMIC_RELAXED);
+    for (unsigned i = 0; i < spin; i++) {
+        if (__atomic_load_n(&job.finished, __ATOMIC_ACQUIRE) == count) return;
+        cpu_relax();
+    }
+    pthread_mutex_lock(&pool->lock);
+    while (__atomic_load_n(&job.finished, __ATOMIC_ACQUIRE) != count) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @class partsJob
+ *
+ * Arguments of csc_pool_run
+ */
+struct partsJob {
+    char* parts;
+    size_t size;
+    void* (*fn)(void*);
+};
+
+static void run_parts_task(uint64_t index, void* arg) {
+    struct partsJob* job = arg;
+    job->fn(job->parts + index * job->size);
+}
+
+void csc_pool_run(struct cscPool* pool, void* parts, size_t size, unsigned n,
+        void* (*fn)(void*)) {
+    struct partsJob job = {parts, size, fn};
+    run_job(pool, run_parts_task, &job, n);
+}
+
+/**
+ * @class forJob
+ *
+ * Arguments of csc_pool_for
+ */
+struct forJob {
+    uint64_t n;
+    uint64_t grain;
+    void (*body)(uint64_t, uint64_t, void*);
+    void* arg;
+};
+
+static void run_for_task(uint64_t index, void* arg) {
+    struct forJob* job = arg;
+    uint64_t begin = index * job->grain;
+    uint64_t end = job->n - begin < job->grain ? job->n : begin + job->grain;
+    job->body(begin, end, job->arg);
+}
+
+void csc_pool_for(struct cscPool* pool, uint64_t n, uint64_t grain,
+        void (*body)(uint64_t begin, uint64_t end, void* arg), void* arg) {
+    if (!n) return;
+    if (!grain) {
+        uint64_t ranges = 4 * (uint64_t) csc_pool_threads(pool);
+        grain = (n + ranges - 1) / ranges;
+    }
+    struct forJob job = {n, grain, body, arg};
+    run_job(pool, run_for_task, &job, (n - 1) / grain + 1);
+}
+
+static void stop_shared_pool(void) {
+    csc_pool_destroy(&sharedPool);
+}
+
+// Starts the shared pool, sharedLock must be held
+static int start_shared_pool(unsigned threads) {
+    if (!csc_pool_init(&sharedPool, threads, sharedPin)) return 0;
+    __atomic_store_n(&sharedStarted, 1, __ATOMIC_RELEASE);
+    atexit(stop_shared_pool);
+    return 1;
+}
+
+int csc_shared_pool_init(unsigned threads, int pin) {
+    pthread_mutex_lock(&sharedLock);
+    sharedPin = pin;
+    int ok;
+    if (!sharedStarted) {
+        ok = start_shared_pool(threads);
+    } else {
+        pthread_mutex_lock(&sharedPool.lock);
+        sharedPool.pin = pin;
+        ok = add_workers(&sharedPool, threads);
+        pthread_mutex_unlock(&sharedPool.lock);
+    }
+    pthread_mutex_unlock(&sharedLock);
+    return ok;
+}
+
+struct cscPool* csc_shared_pool(unsigned threads) {
+    if (__atomic_load_n(&sharedStarted, __ATOMIC_ACQUIRE)
+            && csc_pool_threads(&sharedPool) >= threads) {
+        return &sharedPool;
+    }
+    pthread_mutex_lock(&sharedLock);
+    int ok = 1;
+    if (!sharedStarted) {
+        ok = threads && start_shared_pool(threads);
+    } else {
+        pthread_mutex_lock(&sharedPool.lock);
+        ok = add_workers(&sharedPool, threads);
+        pthread_mutex_unlock(&sharedPool.lock);
+    }
+    pthread_mutex_unlock(&sharedLock);
+    return ok || sharedStarted ? &sharedPool : 0;
+}
@@ -0,0 +1,385 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "csc_stream.h"
+#include "csc_binary.h"
+#include "csc_mmap.h"
+#include "csc_io.h"
+#include "csc_writer.h"
+#include "bounded_queue.h"
+#include "cs_matrix.h"
+#include "csc_trace.h"
+
+/**
+ * @class pendingBlock
+ *
+ * Column block waiting in the queue of a cscStreamWriter
+ *
+ * @member matrix       The block. Its pointer members are stored on the heap.
+ * @member firstColumn  Index of the block's first column in the matrix
+ */
+struct pendingBlock {
+    struct cscMatrix matrix;
+    uint64_t firstColumn;
+};
+
+/**
+ * @class blockView
+ *
+ * Block of a mapped stream file
+ *
+ * @member header       Header of the block
+ * @member colPtr       Column pointers of the block, starting at 0
+ * @member rowIndices   Row indices of the block
+ * @member values       Values of the block
+ */
+struct blockView {
+    const struct cscStreamBlock* header;
+    const uint64_t* colPtr;
+    const uint64_t* rowIndices;
+    const float* values;
+};
+
+static double get_time_diff(struct timespec* start, struct timespec* end) {
+    return end->tv_sec - start->tv_sec +
+        1e-9 * (end->tv_nsec - start->tv_nsec);
+}
+
+// Size of a block in the stream file, including its header and padding
+static uint64_t block_size(uint64_t columnCount, uint64_t valueCount) {
+    uint64_t size = sizeof(struct cscStreamBlock)
+        + (columnCount + 1) * sizeof(uint64_t)
+        + valueCount * (sizeof(uint64_t) + sizeof(float));
+    return (size + 7) & ~(uint64_t) 7;
+}
+
+static int write_block(struct cscStreamWriter* w, struct pendingBlock* b) {
+    struct cscMatrix* m = &b->matrix;
+    if (b->firstColumn != w->nextColumn || m->rows != w->rows
+            || m->columns == 0 || m->columns > w->columns - w->nextColumn) {
+        fprintf(stderr, "Invalid column block %lu to %lu of the result.\n",
+                b->firstColumn, b->firstColumn + m->columns);
+        errno = EINVAL;
+        return 0;
+    }
+
+    struct cscStreamBlock header = {b->firstColumn, m->columns, m->valueCount};
+    static const char zeros[8];
+    uint64_t size = block_size(m->columns, m->valueCount);
+    uint64_t padding = size - sizeof(header)
+        - (m->columns + 1) * sizeof(uint64_t)
+        - m->valueCount * (sizeof(uint64_t) + sizeof(float));
+    // The arrays of a block without values may be null
+    if (fwrite(&header, sizeof(header), 1, w->file) != 1
+            || fwrite(m->colPtr, sizeof(uint64_t), m->columns + 1, w->file)
+                != m->columns + 1
+            || (m->valueCount && (fwrite(m->rowIndices, sizeof(uint64_t),
+                        m->valueCount, w->file) != m->valueCount
+                    || fwrite(m->values, sizeof(float), m->valueCount,
+                        w->file) != m->valueCount))
+            || fwrite(zeros, 1, padding, w->file) != padding) {
+        if (!errno) errno = EIO;
+        return 0;
+    }
+    w->nextColumn += m->columns;
+    w->valueCount += m->valueCount;
+    w->bytes += size;
+    return 1;
+}
+
+static void* stream_writer_main(void* arg) {
+    struct cscStreamWriter* w = arg;
+    struct pendingBlock* b;
+    while ((b = pop_queue(&w->queue))) {
+        if (!w->error) {
+            errno = 0;
+            TRACE_BEGIN(t);
+            if (!write_block(w, b)) {
+                w->error = errno;
+                // Makes further pushes fail, the queued blocks are still freed
+                close_queue(&w->queue);
+            }
+            TRACE_END(t, "write block");
+        }
+        free_csc_members(&b->matrix);
+        free(b);
+    }
+    return 0;
+}
+
+int open_stream_writer(struct cscStreamWriter* w, const char* filename,
+        uint64_t rows, uint64_t columns, unsigned capacity) {
+    memset(w, 0, sizeof(*w));
+    w->rows = rows;
+    w->columns = columns;
+    w->file = fopen(filename, "wb");
+    if (!w->file) {
+        perror("Unable to open file");
+        return 0;
+    }
+    setvbuf(w->file, 0, _IOFBF, 1 << 20);
+
+    struct cscStreamHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CSC_STREAM_MAGIC, sizeof(header.magic));
+    header.version = CSC_STREAM_VERSION;
+    header.byteOrder = CSC_BINARY_BYTE_ORDER;
+    header.rows = rows;
+    header.columns = columns;
+    w->bytes = sizeof(header);
+    if (fwrite(&header, sizeof(header), 1, w->file) != 1
+            || !init_queue(&w->queue, capacity)) {
+        fclose(w->file);
+        return 0;
+    }
+    int err = pthread_create(&w->thread, 0, stream_writer_main, w);
+    if (err) {
+        destroy_queue(&w->queue);
+        fclose(w->file);
+        errno = err;
+        return 0;
+    }
+    return 1;
+}
+
+int stream_writer_push(struct cscStreamWriter* w, struct cscMatrix* block,
+        uint64_t firstColumn) {
+    struct pendingBlock* b = malloc(sizeof(*b));
+    if (!b) {
+        free_csc_members(block);
+        errno = ENOMEM;
+        return 0;
+    }
+    b->matrix = *block;
+    b->firstColumn = firstColumn;
+    if (!push_queue(&w->queue, b)) {
+        // The writer thread failed and closed the queue
+        free_csc_members(&b->matrix);
+        free(b);
+        errno = EIO;
+        return 0;
+    }
+    return 1;
+}
+
+int close_stream_writer(struct cscStreamWriter* w) {
+    close_queue(&w->queue);
+    pthread_join(w->thread, 0);
+    destroy_queue(&w->queue);
+
+    int ok = !w->error;
+    if (ok && w->nextColumn != w->columns) {
+        fprintf(stderr, "The stream file is missing columns %lu to %lu.\n",
+                w->nextColumn, w->columns);
+        w->error = EINVAL;
+        ok = 0;
+    }
+    struct cscStreamBlock end = {w->columns, 0, w->valueCount};
+    if (ok && fwrite(&end, sizeof(end), 1, w->file) != 1) {
+        w->error = errno ? errno : EIO;
+        ok = 0;
+    }
+    w->bytes += sizeof(end);
+    if (fclose(w->file) && ok) {
+        w->error = errno;
+        ok = 0;
+    }
+    if (!ok) {
+        errno = w->error;
+        perror("Unable to write stream file");
+    }
+    return ok;
+}
+
+int mul_csc_stream(void (*mul)(const void*, const void*, void*),
+        const struct cscMatrix* a, const struct cscMatrix* b,
+        uint64_t resultRows, uint64_t blockColumns, const char* filename,
+        struct streamStats* stats) {
+    struct cscStreamWriter w;
+    if (!open_stream_writer(&w, filename, resultRows, b->columns,
+                CSC_STREAM_QUEUE_CAPACITY)) return 0;
+
+    int ok = 1;
+    double waitTime = 0;
+    uint64_t blocks = 0;
+    for (uint64_t j = 0; ok && j < b->columns; j += blockColumns) {
+        // View of the next blockColumns columns of B. The kernels index the
+        // values with colPtr, so the view shares all arrays with B.
+        struct cscMatrix view = *b;
+        view.columns = b->columns - j < blockColumns ? b->columns - j
+            : blockColumns;
+        view.colPtr = b->colPtr + j;
+
+        struct cscMatrix block = {0};
+        errno = 0;
+        mul(a, &view, &block);
+        if (errno) {
+            ok = 0;
+            break;
+        }
+
+        struct timespec start, end;
+        TRACE_BEGIN(t);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ok = stream_writer_push(&w, &block, j);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        TRACE_END(t, "wait for writer");
+        waitTime += get_time_diff(&start, &end);
+        blocks++;
+
+        if (logData) {
+            printf("\rComputing and writing blocks. %.0f%% done.",
+                    100 * ((double) j + view.columns) / b->columns);
+            fflush(stdout);
+        }
+    }
+    int err = errno;
+    ok = close_stream_writer(&w) && ok;
+    if (!ok && err) errno = err;
+    if (logData) printf("\n");
+
+    if (stats) {
+        stats->blocks = blocks;
+        stats->valueCount = w.valueCount;
+        stats->bytes = w.bytes;
+        stats->waitTime = waitTime;
+    }
+    return ok;
+}
+
+int is_csc_stream(const char* filename) {
+    struct mappedFile file;
+    int err = errno;
+    if (!map_file(filename, &file)) {
+        errno = err;
+        return 0;
+    }
+    int res = file.size >= sizeof(struct cscStreamHeader)
+        && !memcmp(file.data, CSC_STREAM_MAGIC, 8);
+    unmap_file(&file);
+    return res;
+}
+
+/**
+ * Reads the block at *offset of a mapped stream file and advances *offset
+ * past it.
+ *
+ * @return      1 if a block was read, 0 at the terminating block, -1 if the
+ *              block exceeds the file
+ */
+static int read_block(const struct mappedFile* file, uint64_t* offset,
+        struct blockView* v) {
+    uint64_t left = file->size - *offset;
+    if (left < sizeof(struct cscStreamBlock)) return -1;
+    v->header = (const void*) (file->data + *offset);
+    uint64_t columns = v->header->columnCount;
+    uint64_t values = v->header->valueCount;
+    if (!columns) {
+        *offset += sizeof(struct cscStreamBlock);
+        return 0;
+    }
+    if (columns >= left / sizeof(uint64_t)
+            || values > left / (sizeof(uint64_t) + sizeof(float))
+            || block_size(columns, values) > left) return -1;
+
+    v->colPtr = (const void*) (v->header + 1);
+    v->rowIndices = v->colPtr + columns + 1;
+    v->values = (const void*) (v->rowIndices + values);
+    *offset += block_size(columns, values);
+    return 1;
+}
+
+/**
+ * Checks the structure of a mapped stream file: the order and sizes of the
+ * blocks, their column pointers and row indices and the terminating block.
+ *
+ * @return      1 if the file is valid, 0 otherwise
+ */
+static int is_valid_stream(const struct mappedFile* file) {
+    const struct cscStreamHeader* h = (const void*) file->data;
+    if (file->size < sizeof(*h) || memcmp(h->magic, CSC_STREAM_MAGIC, 8)
+            || h->version != CSC_STREAM_VERSION
+            || h->byteOrder != CSC_BINARY_BYTE_ORDER) return 0;
+
+    uint64_t offset = sizeof(*h), column = 0, valueCount = 0;
+    struct blockView v;
+    int res;
+    while ((res = read_block(file, &offset, &v)) == 1) {
+        uint64_t n = v.header->columnCount;
+        if (v.header->firstColumn != column || n > h->columns - column
+                || v.colPtr[0] != 0 || v.colPtr[n] != v.header->valueCount) {
+            return 0;
+        }
+        for (uint64_t i = 0; i < n; i++) {
+            if (v.colPtr[i] > v.colPtr[i + 1]) return 0;
+        }
+        for (uint64_t i = 0; i < v.header->valueCount; i++) {
+            if (v.rowIndices[i] >= h->rows) return 0;
+        }
+        column += n;
+        valueCount += v.header->valueCount;
+    }
+    return res == 0 && column == h->columns
+        && v.header->firstColumn == h->columns
+        && v.header->valueCount == valueCount;
+}
+
+int convert_stream_to_text(const char* input, const char* output,
+        int precision) {
+    struct mappedFile file;
+    if (!map_file(input, &file)) {
+        perror("Unable to map file");
+        return 0;
+    }
+    if (!is_valid_stream(&file)) {
+        fprintf(stderr, "Wrong format. Invalid or incomplete stream file.\n");
+        unmap_file(&file);
+        errno = EINVAL;
+        return 0;
+    }
+    const struct cscStreamHeader* h = (const void*) file.data;
+
+    struct textWriter w;
+    if (!open_text_writer(&w, output)) {
+        unmap_file(&file);
+        return 0;
+    }
+    int ok = text_writer_put_uint64(&w, 0, h->rows)
+        && text_writer_put_uint64(&w, ',', h->columns)
+        && text_writer_put_char(&w, '\n');
+
+    // One pass over the blocks for each line of the text format
+    for (int line = 0; ok && line < 3; line++) {
+        uint64_t offset = sizeof(*h), written = 0;
+        struct blockView v;
+        if (line == 2) ok = text_writer_put_uint64(&w, 0, 0);
+        while (ok && read_block(&file, &offset, &v) == 1) {
+            uint64_t n = v.header->valueCount;
+            if (line == 0) {
+                for (uint64_t i = 0; ok && i < n; i++) {
+                    ok = text_writer_put_float(&w, written + i ? ',' : 0,
+                            v.values[i], precision);
+                }
+            } else if (line == 1) {
+                for (uint64_t i = 0; ok && i < n; i++) {
+                    ok = text_writer_put_uint64(&w, written + i ? ',' : 0,
+                            v.rowIndices[i]);
+                }
+            } else {
+                for (uint64_t i = 1; ok && i <= v.header->columnCount; i++) {
+                    ok = text_writer_put_uint64(&w, ',', written + v.colPtr[i]);
+                }
+            }
+            written += n;
+        }
+        if (ok && line < 2) ok = text_writer_put_char(&w, '\n');
+    }
+
+    ok = close_text_writer(&w, ok);
+    unmap_file(&file);
+    return ok;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "csc_trace.h"
+
+int traceEnabled = 0;
+
+static uint64_t origin;
+static struct traceBuffer* buffers;
+static unsigned lanes;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t ownerKey;
+static int keyCreated;
+// Incremented by trace_stop. Buffers of an older generation are freed, so
+// threads that outlive a trace, like the workers of the shared pool, must
+// not touch them.
+static unsigned generation;
+static __thread struct traceBuffer* current;
+static __thread unsigned currentGeneration;
+
+// Hands the buffer of an exiting thread to the next thread
+static void release_buffer(void* arg) {
+    struct traceBuffer* buffer = arg;
+    pthread_mutex_lock(&lock);
+    if (currentGeneration == generation) buffer->owned = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+static struct traceBuffer* acquire_buffer() {
+    pthread_mutex_lock(&lock);
+    struct traceBuffer* buffer = buffers;
+    while (buffer && buffer->owned) buffer = buffer->next;
+    if (!buffer) {
+        buffer = malloc(sizeof(struct traceBuffer));
+        if (buffer) {
+            buffer->count = 0;
+            buffer->lane = lanes++;
+            buffer->next = buffers;
+            buffers = buffer;
+        }
+    }
+    if (buffer) buffer->owned = 1;
+    currentGeneration = generation;
+    pthread_mutex_unlock(&lock);
+    if (buffer) pthread_setspecific(ownerKey, buffer);
+    return buffer;
+}
+
+int trace_start() {
+    if (!keyCreated) {
+        int err = pthread_key_create(&ownerKey, release_buffer);
+        if (err) {
+            errno = err;
+            return 0;
+        }
+        keyCreated = 1;
+    }
+    origin = trace_now();
+    // The calling thread gets the first line of the timeline
+    current = acquire_buffer();
+    if (!current) {
+        errno = ENOMEM;
+        return 0;
+    }
+    traceEnabled = 1;
+    return 1;
+}
+
+uint64_t trace_now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+void trace_span(const char* name, uint64_t start) {
+    if (start < origin) return;
+    // A thread takes a buffer with its first span of every trace
+    if (current && currentGeneration
+            != __atomic_load_n(&generation, __ATOMIC_RELAXED)) {
+        current = 0;
+    }
+    if (!current && !(current = acquire_buffer())) return;
+    struct traceSpan* s = &current->spans[current->count++
+        % TRACE_BUFFER_EVENTS];
+    s->name = name;
+    s->start = start;
+    s->duration = trace_now() - start;
+}
+
+int trace_write(const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (!file) return 0;
+    uint64_t dropped = 0;
+    fprintf(file, "{\"traceEvents\":[\n");
+    int first = 1;
+    for (struct traceBuffer* b = buffers; b; b = b->next) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}", first ? ""
+                : ",\n", b->lane, b->lane ? "worker" : "main", b->lane);
+        first = 0;
+        uint64_t begin = b->count > TRACE_BUFFER_EVENTS
+            ? b->count - TRACE_BUFFER_EVENTS : 0;
+        dropped += begin;
+        for (uint64_t i = begin; i < b->count; i++) {
+            const struct traceSpan* s = &b->spans[i % TRACE_BUFFER_EVENTS];
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"csc\",\"ph\":\"X\","
+                    "\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", s->name,
+                    b->lane, (s->start - origin) / 1e3, s->duration / 1e3);
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\","
+            "\"otherData\":{\"droppedSpans\":%lu}}\n", dropped);
+    int ok = !ferror(file);
+    if (fclose(file) || !ok) {
+        if (!errno) errno = EIO;
+        return 0;
+    }
+    return 1;
+}
+
+void trace_stop() {
+    traceEnabled = 0;
+    pthread_mutex_lock(&lock);
+    while (buffers) {
+        struct traceBuffer* next = buffers->next;
+        free(buffers);
+        buffers = next;
+    }
+    lanes = 0;
+    __atomic_store_n(&generation, generation + 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&lock);
+    if (keyCreated) pthread_setspecific(ownerKey, 0);
+    current = 0;
+}
@@ -0,0 +1,627 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "csc_writer.h"
+#include "cs_matrix.h"
+#include "csc_pool.h"
+#include "csc_trace.h"
+
+// Tables and helpers of Ryu's f2s. FLOAT_POW5_INV_SPLIT[i] is
+// 2^(pow5bits(i) - 1 + FLOAT_POW5_INV_BITCOUNT) / 5^i + 1 and
+// FLOAT_POW5_SPLIT[i] holds the FLOAT_POW5_BITCOUNT most significant bits
+// of 5^i.
+#define FLOAT_POW5_INV_BITCOUNT 59
+#define FLOAT_POW5_BITCOUNT 61
+
+static const uint64_t FLOAT_POW5_INV_SPLIT[32] = {
+    576460752303423489u, 461168601842738791u, 368934881474191033u,
+    295147905179352826u, 472236648286964522u, 377789318629571618u,
+    302231454903657294u, 483570327845851670u, 386856262276681336u,
+    309485009821345069u, 495176015714152110u, 396140812571321688u,
+    316912650057057351u, 507060240091291761u, 405648192073033409u,
+    324518553658426727u, 519229685853482763u, 415383748682786211u,
+    332306998946228969u, 531691198313966350u, 425352958651173080u,
+    340282366920938464u, 544451787073501542u, 435561429658801234u,
+    348449143727040987u, 557518629963265579u, 446014903970612463u,
+    356811923176489971u, 570899077082383953u, 456719261665907162u,
+    365375409332725730u, 292300327466180584u,
+};
+
+static const uint64_t FLOAT_POW5_SPLIT[48] = {
+    1152921504606846976u, 1441151880758558720u, 1801439850948198400u,
+    2251799813685248000u, 1407374883553280000u, 1759218604441600000u,
+    2199023255552000000u, 1374389534720000000u, 1717986918400000000u,
+    2147483648000000000u, 1342177280000000000u, 1677721600000000000u,
+    2097152000000000000u, 1310720000000000000u, 1638400000000000000u,
+    2048000000000000000u, 1280000000000000000u, 1600000000000000000u,
+    2000000000000000000u, 1250000000000000000u, 1562500000000000000u,
+    1953125000000000000u, 1220703125000000000u, 1525878906250000000u,
+    1907348632812500000u, 1192092895507812500u, 1490116119384765625u,
+    1862645149230957031u, 1164153218269348144u, 1455191522836685180u,
+    1818989403545856475u, 2273736754432320594u, 1421085471520200371u,
+    1776356839400250464u, 2220446049250313080u, 1387778780781445675u,
+    1734723475976807094u, 2168404344971008868u, 1355252715606880542u,
+    1694065894508600678u, 2117582368135750847u, 1323488980084844279u,
+    1654361225106055349u, 2067951531382569187u, 1292469707114105741u,
+    1615587133892632177u, 2019483917365790221u, 1262177448353618888u,
+};
+
+static const char DIGIT_PAIRS[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+// ceil(log2(5^e)) for e > 0, 1 for e = 0
+static int32_t pow5bits(int32_t e) {
+    return (int32_t) (((uint32_t) e * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e))
+static uint32_t log10_pow2(int32_t e) {
+    return ((uint32_t) e * 78913) >> 18;
+}
+
+// floor(log10(5^e))
+static uint32_t log10_pow5(int32_t e) {
+    return ((uint32_t) e * 732923) >> 20;
+}
+
+static int is_multiple_of_pow5(uint32_t value, uint32_t p) {
+    uint32_t count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        count++;
+    }
+    return count >= p;
+}
+
+static int is_multiple_of_pow2(uint32_t value, uint32_t p) {
+    return (value & ((1u << p) - 1)) == 0;
+}
+
+// (m * factor) >> shift for shift > 32, without a 128 bit product
+static uint32_t mul_shift32(uint32_t m, uint64_t factor, int32_t shift) {
+    uint64_t bits0 = (uint64_t) m * (uint32_t) factor;
+    uint64_t bits1 = (uint64_t) m * (uint32_t) (factor >> 32);
+    uint64_t sum = (bits0 >> 32) + bits1;
+    return (uint32_t) (sum >> (shift - 32));
+}
+
+int float_to_shortest(float f, uint32_t* digits, int32_t* exponent) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint32_t ieeeMantissa = bits & ((1u << 23) - 1);
+    uint32_t ieeeExponent = (bits >> 23) & 0xff;
+
+    if (!ieeeMantissa && !ieeeExponent) {
+        *digits = 0;
+        *exponent = 0;
+        return 1;
+    }
+
+    // The float is m2 * 2^e2; the additional factor 4 of mv, mp and mm leaves
+    // room for the halfway points to the neighboring floats
+    int32_t e2;
+    uint32_t m2;
+    if (ieeeExponent == 0) {
+        e2 = 1 - 127 - 23 - 2;
+        m2 = ieeeMantissa;
+    } else {
+        e2 = (int32_t) ieeeExponent - 127 - 23 - 2;
+        m2 = (1u << 23) | ieeeMantissa;
+    }
+    int acceptBounds = (m2 & 1) == 0;
+    uint32_t mv = 4 * m2;
+    uint32_t mp = 4 * m2 + 2;
+    uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+    uint32_t mm = 4 * m2 - 1 - mmShift;
+
+    // Convert the interval [mm, mp] * 2^e2 to [vm, vp] * 10^e10
+    uint32_t vr, vp, vm;
+    int32_t e10;
+    int vmIsTrailingZeros = 0, vrIsTrailingZeros = 0;
+    uint32_t lastRemovedDigit = 0;
+    if (e2 >= 0) {
+        uint32_t q = log10_pow2(e2);
+        e10 = (int32_t) q;
+        int32_t k = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32_t) q) - 1;
+        int32_t i = -e2 + (int32_t) q + k;
+        vr = mul_shift32(mv, FLOAT_POW5_INV_SPLIT[q], i);
+        vp = mul_shift32(mp, FLOAT_POW5_INV_SPLIT[q], i);
+        vm = mul_shift32(mm, FLOAT_POW5_INV_SPLIT[q], i);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            // The loop below removes at most one digit, which is computed here
+            int32_t l = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32_t) q - 1) - 1;
+            lastRemovedDigit = mul_shift32(mv, FLOAT_POW5_INV_SPLIT[q - 1],
+                    -e2 + (int32_t) q - 1 + l) % 10;
+        }
+        if (q <= 9) {
+            // Only one of mp, mv and mm can be a multiple of 5
+            if (mv % 5 == 0) {
+                vrIsTrailingZeros = is_multiple_of_pow5(mv, q);
+            } else if (acceptBounds) {
+                vmIsTrailingZeros = is_multiple_of_pow5(mm, q);
+            } else {
+                vp -= is_multiple_of_pow5(mp, q);
+            }
+        }
+    } else {
+        uint32_t q = log10_pow5(-e2);
+        e10 = (int32_t) q + e2;
+        int32_t i = -e2 - (int32_t) q;
+        int32_t k = pow5bits(i) - FLOAT_POW5_BITCOUNT;
+        int32_t j = (int32_t) q - k;
+        vr = mul_shift32(mv, FLOAT_POW5_SPLIT[i], j);
+        vp = mul_shift32(mp, FLOAT_POW5_SPLIT[i], j);
+        vm = mul_shift32(mm, FLOAT_POW5_SPLIT[i], j);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            j = (int32_t) q - 1 - (pow5bits(i + 1) - FLOAT_POW5_BITCOUNT);
+            lastRemovedDigit = mul_shift32(mv, FLOAT_POW5_SPLIT[i + 1], j) % 10;
+        }
+        if (q <= 1) {
+            // mv = 4 * m2 always has at least two trailing zero bits
+            vrIsTrailingZeros = 1;
+            if (acceptBounds) {
+                vmIsTrailingZeros = mmShift == 1;
+            } else {
+                --vp;
+            }
+        } else if (q < 31) {
+            vrIsTrailingZeros = is_multiple_of_pow2(mv, q - 1);
+        }
+    }
+
+    // Remove digits as long as the interval contains a shorter number
+    int32_t removed = 0;
+    uint32_t output;
+    if (vmIsTrailingZeros || vrIsTrailingZeros) {
+        while (vp / 10 > vm / 10) {
+            vmIsTrailingZeros &= vm % 10 == 0;
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vmIsTrailingZeros) {
+            while (vm % 10 == 0) {
+                vrIsTrailingZeros &= lastRemovedDigit == 0;
+                lastRemovedDigit = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        // Round half to even if the removed digits were exactly 50...0
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+            lastRemovedDigit = 4;
+        }
+        output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros))
+                || lastRemovedDigit >= 5);
+    } else {
+        while (vp / 10 > vm / 10) {
+            lastRemovedDigit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || lastRemovedDigit >= 5);
+    }
+
+    int32_t exp = e10 + removed;
+    while (output % 10 == 0) {
+        output /= 10;
+        exp++;
+    }
+    *digits = output;
+    *exponent = exp;
+
+    int n = 1;
+    for (uint32_t d = output; d >= 10; d /= 10) n++;
+    return n;
+}
+
+char* format_uint64(char* p, uint64_t value) {
+    int n = 1;
+    for (uint64_t v = value; v >= 10; v /= 10) n++;
+
+    char* end = p + n;
+    char* q = end;
+    while (value >= 100) {
+        q -= 2;
+        memcpy(q, DIGIT_PAIRS + 2 * (value % 100), 2);
+        value /= 100;
+    }
+    if (value >= 10) {
+        memcpy(q - 2, DIGIT_PAIRS + 2 * value, 2);
+    } else {
+        q[-1] = '0' + value;
+    }
+    return end;
+}
+
+/**
+ * Writes the decimal number 0.d1d2...dn * 10^(x+1) (i.e. with the exponent x
+ * of its first digit) like %.<precision>g would.
+ */
+static char* format_digits(char* p, const char* digits, int n, int32_t x,
+        int precision) {
+    if (x < -4 || x >= precision) {
+        *p++ = digits[0];
+        if (n > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, n - 1);
+            p += n - 1;
+        }
+        *p++ = 'e';
+        *p++ = x < 0 ? '-' : '+';
+        uint32_t absX = x < 0 ? -x : x;
+        if (absX < 10) *p++ = '0';
+        return format_uint64(p, absX);
+    }
+    if (x < 0) {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -x - 1);
+        p += -x - 1;
+        memcpy(p, digits, n);
+        return p + n;
+    }
+    if (n <= x + 1) {
+        memcpy(p, digits, n);
+        memset(p + n, '0', x + 1 - n);
+        return p + x + 1;
+    }
+    memcpy(p, digits, x + 1);
+    p += x + 1;
+    *p++ = '.';
+    memcpy(p, digits + x + 1, n - x - 1);
+    return p + n - x - 1;
+}
+
+char* format_float(char* p, float f, int precision) {
+    // The shortest digits are the correctly rounded digits of %.<precision>g
+    // as long as they fit and a float's half-ulp is below half a unit in the
+    // last place, which holds for up to 6 digits and normal floats
+    if (precision > 6 || f != f || f - f != 0) {
+        return p + snprintf(p, CSC_WRITER_MAX_NUMBER, "%.*g", precision, f);
+    }
+
+    uint32_t significand;
+    int32_t exponent;
+    int n = float_to_shortest(f, &significand, &exponent);
+    if (precision && (n > precision || (f != 0 && fabsf(f) < FLT_MIN))) {
+        return p + snprintf(p, CSC_WRITER_MAX_NUMBER, "%.*g", precision, f);
+    }
+
+    if (signbit(f)) *p++ = '-';
+    char digits[10];
+    format_uint64(digits, significand);
+    return format_digits(p, digits, n, exponent + n - 1,
+            precision ? precision : 9);
+}
+
+static int flush_writer(struct textWriter* w) {
+    const char* p = w->buffer;
+    size_t left = w->used;
+    while (left) {
+        ssize_t written = write(w->fd, p, left);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += written;
+        left -= written;
+    }
+    w->used = 0;
+    if (logData && w->total) {
+        printf("\rWriting %s. %.0f%% done.            ", w->section,
+                100 * ((double) w->done) / w->total);
+        fflush(stdout);
+    }
+    return 1;
+}
+
+/**
+ * Makes sure that the buffer has space for a separator and a number.
+ */
+static int reserve(struct textWriter* w) {
+    if (w->used <= CSC_WRITER_BUFFER_SIZE - CSC_WRITER_MAX_NUMBER - 1) return 1;
+    return flush_writer(w);
+}
+
+int open_text_writer(struct textWriter* w, const char* filename) {
+    memset(w, 0, sizeof(*w));
+    w->buffer = malloc(CSC_WRITER_BUFFER_SIZE);
+    if (!w->buffer) {
+        errno = ENOMEM;
+        return 0;
+    }
+    w->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) {
+        perror("Unable to open file");
+        free(w->buffer);
+        w->buffer = 0;
+        return 0;
+    }
+    return 1;
+}
+
+int text_writer_put_float(struct textWriter* w, char separator, float f,
+        int precision) {
+    if (!reserve(w)) return 0;
+    char* p = w->buffer + w->used;
+    if (separator) *p++ = separator;
+    w->used = format_float(p, f, precision) - w->buffer;
+    return 1;
+}
+
+int text_writer_put_uint64(struct textWriter* w, char separator,
+        uint64_t value) {
+    if (!reserve(w)) return 0;
+    char* p = w->buffer + w->used;
+    if (separator) *p++ = separator;
+    w->used = format_uint64(p, value) - w->buffer;
+    return 1;
+}
+
+int text_writer_put_char(struct textWriter* w, char c) {
+    if (!reserve(w)) return 0;
+    w->buffer[w->used++] = c;
+    return 1;
+}
+
+int close_text_writer(struct textWriter* w, int ok) {
+    w->total = 0;
+    ok = ok && flush_writer(w);
+    int err = errno;
+    if (close(w->fd)) ok = 0;
+    free(w->buffer);
+    w->buffer = 0;
+    if (!ok) {
+        errno = err ? err : EIO;
+        perror("Unable to write file");
+        return 0;
+    }
+    return 1;
+}
+
+static int write_uint64_array(struct textWriter* w, const uint64_t* a,
+        uint64_t n, const char* section) {
+    w->section = section;
+    w->total = n;
+    for (uint64_t i = 0; i < n; i++) {
+        w->done = i;
+        if (!text_writer_put_uint64(w, i ? ',' : 0, a[i])) return 0;
+    }
+    return 1;
+}
+
+int write_csc_text(const struct cscMatrix* m, const char* filename,
+        int precision) {
+    struct textWriter w;
+    if (!open_text_writer(&w, filename)) return 0;
+
+    int ok = text_writer_put_uint64(&w, 0, m->rows)
+        && text_writer_put_uint64(&w, ',', m->columns)
+        && text_writer_put_char(&w, '\n');
+
+    w.section = "values";
+    w.total = m->valueCount;
+    for (uint64_t i = 0; ok && i < m->valueCount; i++) {
+        w.done = i;
+        ok = text_writer_put_float(&w, i ? ',' : 0, m->values[i], precision);
+    }
+    ok = ok && text_writer_put_char(&w, '\n')
+        && write_uint64_array(&w, m->rowIndices, m->valueCount, "row indices")
+        && text_writer_put_char(&w, '\n')
+        && write_uint64_array(&w, m->colPtr, m->columns + 1,
+                "column pointers");
+    return close_text_writer(&w, ok);
+}
+
+/**
+ * @class writeSegment
+ *
+ * Slice of an array that is formatted and written by one thread
+ *
+ * @member array        The array. Either float* or uint64_t*
+ * @member isFloat      Nonzero if array holds floats
+ * @member precision    Precision of the floats. See format_float.
+ * @member begin        First element of the slice
+ * @member end          End of the slice (exclusive)
+ * @member buffer       Buffer for the formatted slice
+ * @member length       Amount of bytes in buffer
+ * @member fd           File descriptor of the output file
+ * @member offset       Offset of the segment in the output file
+ * @member error        errno of a failed write, 0 otherwise
+ */
+struct writeSegment {
+    const void* array;
+    int isFloat;
+    int precision;
+    uint64_t begin;
+    uint64_t end;
+    char* buffer;
+    size_t length;
+    int fd;
+    off_t offset;
+    int error;
+};
+
+static void* format_segment(void* arg) {
+    struct writeSegment* seg = arg;
+    TRACE_BEGIN(t);
+    char* p = seg->buffer;
+    if (seg->isFloat) {
+        const float* values = seg->array;
+        for (uint64_t i = seg->begin; i < seg->end; i++) {
+            if (i) *p++ = ',';
+            p = format_float(p, values[i], seg->precision);
+        }
+    } else {
+        const uint64_t* indices = seg->array;
+        for (uint64_t i = seg->begin; i < seg->end; i++) {
+            if (i) *p++ = ',';
+            p = format_uint64(p, indices[i]);
+        }
+    }
+    seg->length = p - seg->buffer;
+    TRACE_END(t, "format segment");
+    return 0;
+}
+
+static int pwrite_all(int fd, const char* data, size_t size, off_t offset) {
+    while (size) {
+        ssize_t written = pwrite(fd, data, size, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += written;
+        size -= written;
+        offset += written;
+    }
+    return 1;
+}
+
+static void* write_segment(void* arg) {
+    struct writeSegment* seg = arg;
+    seg->error = 0;
+    TRACE_BEGIN(t);
+    if (!pwrite_all(seg->fd, seg->buffer, seg->length, seg->offset)) {
+        seg->error = errno;
+    }
+    TRACE_END(t, "write segment");
+    return 0;
+}
+
+/**
+ * Runs fn on every segment with the threads of the shared pool, see
+ * csc_pool_run.
+ */
+static void run_segments(struct writeSegment* segs, unsigned n,
+        void* (*fn)(void*)) {
+    csc_pool_run(csc_shared_pool(n), segs, sizeof(*segs), n, fn);
+}
+
+/**
+ * Formats and writes an array in rounds of at most
+ * threads * CSC_WRITER_SEGMENT_SIZE elements. In every round, the threads
+ * format their slices, the offsets of the slices are computed with a prefix
+ * sum, the file is extended to the end of the round and the threads write
+ * their slices with pwrite.
+ *
+ * @param offset    Offset of the array in the file. Advanced past the array.
+ * @return          1 if successful, 0 otherwise. errno is set on failure.
+ */
+static int write_array_mt(struct writeSegment* segs, unsigned threads,
+        const void* array, int isFloat, uint64_t n, off_t* offset) {
+    for (uint64_t done = 0; done < n;) {
+        uint64_t round = n - done;
+        if (round > (uint64_t) threads * CSC_WRITER_SEGMENT_SIZE) {
+            round = (uint64_t) threads * CSC_WRITER_SEGMENT_SIZE;
+        }
+        for (unsigned i = 0; i < threads; i++) {
+            segs[i].array = array;
+            segs[i].isFloat = isFloat;
+            segs[i].begin = done + round * i / threads;
+            segs[i].end = done + round * (i + 1) / threads;
+        }
+        run_segments(segs, threads, format_segment);
+
+        for (unsigned i = 0; i < threads; i++) {
+            segs[i].offset = *offset;
+            *offset += segs[i].length;
+        }
+        if (ftruncate(segs[0].fd, *offset)) return 0;
+        run_segments(segs, threads, write_segment);
+        for (unsigned i = 0; i < threads; i++) {
+            if (segs[i].error) {
+                errno = segs[i].error;
+                return 0;
+            }
+        }
+
+        done += round;
+        if (logData) {
+            printf("\rWriting output. %.0f%% of the array done.            ",
+                    100 * ((double) done) / n);
+            fflush(stdout);
+        }
+    }
+    return 1;
+}
+
+int write_csc_text_mt(const struct cscMatrix* m, const char* filename,
+        int precision, unsigned threads) {
+    if (threads <= 1) return write_csc_text(m, filename, precision);
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Unable to open file");
+        return 0;
+    }
+    // Pipes and devices can neither be extended nor written at an offset
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return write_csc_text(m, filename, precision);
+    }
+    struct writeSegment* segs = calloc(threads, sizeof(*segs));
+    if (!segs) {
+        close(fd);
+        errno = ENOMEM;
+        perror("Unable to write file");
+        return 0;
+    }
+    int ok = 1;
+    for (unsigned i = 0; ok && i < threads; i++) {
+        segs[i].fd = fd;
+        segs[i].precision = precision;
+        segs[i].buffer = malloc(CSC_WRITER_SEGMENT_SIZE
+                * (CSC_WRITER_MAX_NUMBER + 1));
+        if (!segs[i].buffer) {
+            errno = ENOMEM;
+            ok = 0;
+        }
+    }
+
+    char header[2 * CSC_WRITER_MAX_NUMBER + 2];
+    char* p = format_uint64(header, m->rows);
+    *p++ = ',';
+    p = format_uint64(p, m->columns);
+    *p++ = '\n';
+    off_t offset = p - header;
+    ok = ok && pwrite_all(fd, header, offset, 0);
+
+    ok = ok && write_array_mt(segs, threads, m->values, 1, m->valueCount,
+            &offset);
+    ok = ok && pwrite_all(fd, "\n", 1, offset++);
+    ok = ok && write_array_mt(segs, threads, m->rowIndices, 0, m->valueCount,
+            &offset);
+    ok = ok && pwrite_all(fd, "\n", 1, offset++);
+    ok = ok && write_array_mt(segs, threads, m->colPtr, 0, m->columns + 1,
+            &offset);
+
+    int err = errno;
+    if (close(fd)) ok = 0;
+    for (unsigned i = 0; i < threads; i++) free(segs[i].buffer);
+    free(segs);
+    if (!ok) {
+        errno = err ? err : EIO;
+        perror("Unable to write file");
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <errno.h>
+
+#include "cscmul.h"
+#include "csc_model.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+
+/**
+ * @class cscmulPlan
+ *
+ * @member a        The layout of A the kernel needs: a view of the caller's
+ *                  matrix or converted
+ * @member b        View of the caller's B
+ * @member owned    Nonzero if the arrays of a were allocated by the plan
+ * @member rows     Amount of rows of the product
+ * @member version  The kernel
+ * @member ctx      Context with the allocator of the plan, for
+ *                  cscmul_destroy
+ */
+struct cscmulPlan {
+    struct cscMatrix a;
+    struct cscMatrix b;
+    int owned;
+    uint64_t rows;
+    int version;
+    struct cscContext ctx;
+};
+
+/**
+ * Checks that the column pointers of a matrix are consistent with its
+ * values and that the row indices of every column are increasing and in
+ * range, which the kernels rely on.
+ */
+static int valid_csc(const struct cscMatrix* m) {
+    if (!m->colPtr || m->colPtr[0] || m->colPtr[m->columns] != m->valueCount
+            || (m->valueCount && (!m->values || !m->rowIndices))) {
+        return 0;
+    }
+    for (uint64_t j = 0; j < m->columns; j++) {
+        uint64_t start = m->colPtr[j], end = m->colPtr[j + 1];
+        if (end < start) return 0;
+        for (uint64_t i = start; i < end; i++) {
+            if (m->rowIndices[i] >= m->rows
+                    || (i > start && m->rowIndices[i] <= m->rowIndices[i - 1])) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Returns ctx, or a default context initialized in storage if it is null
+static const struct cscContext* context_or_default(
+        const struct cscContext* ctx, struct cscContext* storage) {
+    if (ctx) return ctx;
+    csc_context_init(storage);
+    return storage;
+}
+
+// Transposes A into memory of the plan
+static int convert_a(const struct cscMatrix* a, struct cscmulPlan* plan) {
+    const struct cscContext* ctx = &plan->ctx;
+    struct cscMatrix* a_t = &plan->a;
+    a_t->values = a->valueCount
+        ? csc_malloc(ctx, a->valueCount * sizeof(float)) : 0;
+    a_t->rowIndices = a->valueCount
+        ? csc_malloc(ctx, a->valueCount * sizeof(uint64_t)) : 0;
+    a_t->colPtr = csc_calloc(ctx, a->rows + 2, sizeof(uint64_t));
+    plan->owned = 1;
+    if ((a->valueCount && (!a_t->values || !a_t->rowIndices))
+            || !a_t->colPtr) {
+        return CSC_OUT_OF_MEMORY;
+    }
+    transpose_csc_ctx(ctx, a, a_t);
+    return CSC_OK;
+}
+
+int cscmul_analyze(const struct cscContext* ctx, const struct cscMatrix* a,
+        const struct cscMatrix* b, const struct cscmulOptions* options,
+        struct cscmulPlan** plan) {
+    const struct cscmulOptions defaults = CSCMUL_DEFAULT_OPTIONS;
+    struct cscContext defaultCtx;
+    ctx = context_or_default(ctx, &defaultCtx);
+    if (!options) options = &defaults;
+    *plan = 0;
+    int transposed = options->transposedA;
+    if (!a || !b || (transposed ? a->rows : a->columns) != b->rows
+            || options->version < CSCMUL_AUTO
+            || options->version >= MODEL_KERNELS || !valid_csc(a)
+            || !valid_csc(b)) {
+        csc_log(ctx, CSC_LOG_ERROR, "The matrices can not be multiplied.\n");
+        return CSC_INVALID_ARGUMENT;
+    }
+
+    struct cscmulPlan* p = csc_malloc(ctx, sizeof(struct cscmulPlan));
+    if (!p) return CSC_OUT_OF_MEMORY;
+    p->a = *a;
+    p->b = *b;
+    p->owned = 0;
+    p->rows = transposed ? a->columns : a->rows;
+    p->version = options->version;
+    p->ctx = *ctx;
+
+    if (p->version == CSCMUL_AUTO) {
+        struct costModel model;
+        struct mulFeatures features;
+        struct mulPlan requirements;
+        int ok;
+        if (options->modelFile) {
+            ok = read_cost_model(options->modelFile, &model);
+            if (!ok && errno == EINVAL) {
+                csc_log(ctx, CSC_LOG_ERROR, "%s is not a cost model.\n",
+                        options->modelFile);
+            }
+        } else {
+            default_cost_model(&model);
+            ok = 1;
+        }
+        ok = ok && compute_features(a, b, transposed, &features);
+        if (!ok) {
+            int status = csc_errno_status(errno);
+            csc_free(ctx, p);
+            return status;
+        }
+        plan_multiplication(&features, &model, &requirements);
+        p->version = requirements.version;
+        csc_log(ctx, CSC_LOG_PROGRESS, "Selected version %d.\n", p->version);
+    }
+
+    // Versions 0 and 1 multiply with the transpose of A
+    if (transposed != (p->version != 2)) {
+        int status = convert_a(a, p);
+        if (status) {
+            cscmul_destroy(p);
+            return status;
+        }
+    }
+    *plan = p;
+    return CSC_OK;
+}
+
+int cscmul_execute(const struct cscContext* ctx, const struct cscmulPlan* plan,
+        struct cscMatrix* c) {
+    struct cscContext defaultCtx;
+    ctx = context_or_default(ctx, &defaultCtx);
+    c->rows = plan->rows;
+    c->columns = plan->b.columns;
+    c->valueCount = 0;
+    c->values = 0;
+    c->rowIndices = 0;
+    // The kernels are not run on an input without values
+    if (!plan->a.valueCount || !plan->b.valueCount) {
+        c->colPtr = csc_calloc(ctx, c->columns + 1, sizeof(uint64_t));
+        return c->colPtr ? CSC_OK : CSC_OUT_OF_MEMORY;
+    }
+    c->colPtr = 0;
+    return mul_csc_ctx(ctx, plan->version, &plan->a, &plan->b, c);
+}
+
+int cscmul_version(const struct cscmulPlan* plan) {
+    return plan->version;
+}
+
+void cscmul_free_result(const struct cscContext* ctx, struct cscMatrix* c) {
+    struct cscContext defaultCtx;
+    ctx = context_or_default(ctx, &defaultCtx);
+    csc_free(ctx, c->values);
+    csc_free(ctx, c->rowIndices);
+    csc_free(ctx, c->colPtr);
+    c->values = 0;
+    c->rowIndices = 0;
+    c->colPtr = 0;
+}
+
+void cscmul_destroy(struct cscmulPlan* plan) {
+    if (!plan) return;
+    if (plan->owned) cscmul_free_result(&plan->ctx, &plan->a);
+    csc_free(&plan->ctx, plan);
+}
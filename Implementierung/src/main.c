@@ -5,9 +5,25 @@
 #include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "csc_io.h"
+#include "csc_mmap.h"
+#include "csc_binary.h"
+#include "csc_writer.h"
+#include "csc_stream.h"
+#include "csc_ooc.h"
+#include "csc_mtx.h"
+#include "csc_cache.h"
+#include "csc_bench.h"
+#include "csc_gen.h"
+#include "csc_perf.h"
+#include "csc_trace.h"
+#include "csc_model.h"
 #include "matrix_mul.h"
+#include "csc_pool.h"
+#include "csc_daemon.h"
+#include "csc_batch.h"
 #include "cs_matrix.h"
 #include "transpose.h"
 
@@ -20,6 +36,190 @@ static void get_time(struct timespec* t) {
     clock_gettime(CLOCK_MONOTONIC, t);
 }
 
+// Writes the trace to its file if --trace was given. Returns 1 if successful.
+static int finish_trace(const char* filename) {
+    if (!filename) return 1;
+    errno = 0;
+    int ok = trace_write(filename);
+    if (!ok) perror("Unable to write the trace");
+    trace_stop();
+    return ok;
+}
+
+// Phases of an iteration the hardware counters are read around
+enum phase {PHASE_LOAD, PHASE_MUL, PHASE_WRITE, PHASES};
+static const char* const phaseNames[PHASES] = {"load", "multiply", "write"};
+
+// Adds the counts since start to the totals of a phase
+static void end_phase(const struct perfGroup* g,
+        const struct perfReading* start, struct perfTotals* t) {
+    struct perfReading now;
+    perf_read(g, &now);
+    perf_accumulate(t, start, &now);
+}
+
+// Computes the metrics of -B. Without them only the rates are not printed,
+// so a failure is a warning and errno is cleared.
+static int measure_metrics(const struct cscMatrix* a,
+        const struct cscMatrix* b, int transposedA,
+        const struct cscMatrix* result, struct mulMetrics* m) {
+    errno = 0;
+    if (mul_metrics(a, b, transposedA, result, m)) return 1;
+    perror("Warning: the rates of the multiplication are not printed");
+    errno = 0;
+    return 0;
+}
+
+/**
+ * Loads the inputs without transposing A and prints their statistics and the
+ * requirements of their product, without multiplying (-S).
+ */
+static int print_statistics(const char* file_a, const char* file_b,
+        unsigned threads, const struct cscCache* cache,
+        const char* model_file) {
+    struct costModel model;
+    if (!load_cost_model(model_file, &model)) return 0;
+    struct timespec load_start, load_end, end;
+    struct cscFile a, b;
+    get_time(&load_start);
+    errno = 0;
+    TRACE_BEGIN(load);
+    load_csc_files(file_a, file_b, &a, &b, 0, threads, cache, 0);
+    TRACE_END(load, "load inputs");
+    if (errno) return 0;
+    get_time(&load_end);
+
+    TRACE_BEGIN(stats);
+    struct cscStatistics statsA, statsB;
+    struct mulFeatures features;
+    struct mulPlan plan;
+    compute_csc_statistics(&a.matrix, &statsA);
+    compute_csc_statistics(&b.matrix, &statsB);
+    int ok = compute_features(&a.matrix, &b.matrix, 0, &features);
+    release_csc_file(&a);
+    release_csc_file(&b);
+    if (!ok) return 0;
+    plan_multiplication(&features, &model, &plan);
+    TRACE_END(stats, "statistics");
+    get_time(&end);
+
+    printCSCMatrixStatistics("A", &statsA);
+    printf("\n");
+    printCSCMatrixStatistics("B", &statsB);
+    printf("\n");
+    print_mul_plan(&features, &plan);
+    printf("\nLoading the inputs took %g s, the statistics %g s (%s cost "
+            "model).\n", get_time_diff(&load_start, &load_end),
+            get_time_diff(&load_end, &end), model.calibrated ? "calibrated"
+            : "built-in");
+    return 1;
+}
+
+/**
+ * Chooses the kernel of -V auto from inputs loaded with A transposed and
+ * prints the decision. If version 2 wins, A is transposed back instead of
+ * loading it again, which would not work for pipes.
+ *
+ * @return  The version, or VERSION_AUTO on failure. errno is set on failure.
+ */
+static int choose_version(struct cscFile* a, const struct cscFile* b,
+        const struct costModel* model, unsigned threads, int measureTime) {
+    struct kernelChoice choice;
+    struct timespec start, end;
+    get_time(&start);
+    errno = 0;
+    if (!choose_kernel(&a->matrix, &b->matrix, 1, model, &choice)) {
+        return VERSION_AUTO;
+    }
+    if (choice.version == 2) {
+        struct cscMatrix m = {0};
+        if (!transpose_csc_mt(&a->matrix, &m, threads)) {
+            errno = ENOMEM;
+            return VERSION_AUTO;
+        }
+        release_csc_file(a);
+        a->matrix = m;
+    }
+    get_time(&end);
+    print_kernel_choice(&choice, model, logData);
+    if (measureTime) {
+        printf("Selecting the version took %g s.\n",
+                get_time_diff(&start, &end));
+    }
+    return choice.version;
+}
+
+/**
+ * Sends requests to a daemon (--send) and prints its answers.
+ *
+ * @return  1 if every request succeeded, 0 otherwise
+ */
+static int send_requests(const char* socketPath, char** requests, int n) {
+    int fd = daemon_connect(socketPath);
+    if (fd < 0) {
+        perror("Unable to connect to the daemon");
+        return 0;
+    }
+    int ok = 1;
+    for (int i = 0; i < n; i++) {
+        char response[CSC_DAEMON_LINE_LENGTH];
+        errno = 0;
+        int answered = daemon_request(fd, requests[i], response,
+                sizeof(response));
+        if (!answered && errno) {
+            perror("Connection to the daemon failed");
+            ok = 0;
+            break;
+        }
+        printf("%s\n", response);
+        ok = ok && answered;
+    }
+    close(fd);
+    return ok;
+}
+
+/**
+ * Runs the products of a manifest (--batch) and prints the throughput.
+ *
+ * @return  1 if every job succeeded, 0 otherwise
+ */
+static int run_manifest(const char* manifest,
+        const struct batchConfig* config) {
+    struct batchJob* jobs;
+    unsigned count;
+    errno = 0;
+    if (!read_batch_manifest(manifest, &jobs, &count)) {
+        perror("Unable to read the manifest");
+        return 0;
+    }
+    struct batchStats stats;
+    int ran = run_batch(jobs, count, config, &stats);
+    free_batch_jobs(jobs, count);
+    if (!ran) {
+        perror("Unable to run the batch");
+        return 0;
+    }
+    print_batch_stats(&stats);
+    return !stats.failed;
+}
+
+// Parses N or NxMxK into dims. Returns 1 if successful.
+static int parse_dims(const char* s, uint64_t dims[3]) {
+    char* end;
+    for (int i = 0; i < 3; i++) {
+        errno = 0;
+        dims[i] = strtoull(s, &end, 10);
+        if (end == s || errno || !dims[i] || *s == '-') return 0;
+        if (!i && !*end) {
+            dims[1] = dims[2] = dims[0];
+            return 1;
+        }
+        if (*end != (i < 2 ? 'x' : '\0')) return 0;
+        s = end + 1;
+    }
+    return 1;
+}
+
 int main(int argc, char *argv[]) {
     const char* progname = argv[0];
 
@@ -32,12 +232,40 @@ int main(int argc, char *argv[]) {
     logData = 0;
     int option_index = 0;
     int generateNew = 0;
+    unsigned int threads = 1;
+    unsigned int precision = 0;
+    unsigned int streamColumns = 0;
+    struct streamStats streamStats = {0};
+    unsigned int memoryBudget = 0;
+    struct oocStats oocStats = {0};
+    const char* convert_input = 0;
+    int convert_to_binary = 0;
+    int store_transposed = 0;
+    struct cscCache cache = {0};
+    struct benchConfig benchConfig = {1, 0, 0};
+    uint64_t seed = time(NULL);
+    uint64_t dims[3] = {0, 0, 0};
+    double density = 0.1;
+    int genFamily = FAMILY_UNIFORM;
+    struct rmatParams rmat = RMAT_DEFAULT_PARAMS;
+    double edgeFactor = 0;
+    int genBinary = 0;
+    const char* trace_file = 0;
+    const char* model_file = CSC_MODEL_FILE;
+    const char* calibrate_file = 0;
+    int statsMode = 0;
+    int pin = 0;
+    const char* serve_socket = 0;
+    const char* send_socket = 0;
+    const char* batch_manifest = 0;
 
     int opt;
     while ((opt = getopt_long(argc, argv, shortopts, longopts, &option_index)) != -1) {
         switch (opt) {
             case 'V':
-                if (convert_int(optarg, &version) != 0) {
+                if (!strcmp(optarg, "auto")) {
+                    version = VERSION_AUTO;
+                } else if (convert_int(optarg, &version) != 0) {
                     return EXIT_FAILURE;
                 }
                 break;
@@ -68,61 +296,435 @@ int main(int argc, char *argv[]) {
             case 'r':
                 generateNew = 1;
                 break;
+            case 'S':
+                statsMode = 1;
+                break;
+            case 't':
+                if (convert_unsigned(optarg, &threads) != 0) {
+                    return EXIT_FAILURE;
+                }
+                if (!threads) {
+                    fprintf(stderr, "The thread count must be at least 1.\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's':
+                streamColumns = CSC_STREAM_BLOCK_COLUMNS;
+                if (optarg) {
+                    if (convert_unsigned(optarg, &streamColumns) != 0) {
+                        return EXIT_FAILURE;
+                    }
+                    if (!streamColumns) {
+                        fprintf(stderr, "A block must have at least one "
+                                "column.\n");
+                        return EXIT_FAILURE;
+                    }
+                }
+                break;
+            case 'M':
+                if (convert_unsigned(optarg, &memoryBudget) != 0) {
+                    return EXIT_FAILURE;
+                }
+                if (!memoryBudget) {
+                    fprintf(stderr, "The memory budget must be at least "
+                            "1 MB.\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p':
+                if (convert_unsigned(optarg, &precision) != 0) {
+                    return EXIT_FAILURE;
+                }
+                if (precision > 9) {
+                    fprintf(stderr, "The precision must be at most 9.\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_TO_BINARY:
+            case OPT_TO_TEXT:
+                convert_input = optarg;
+                convert_to_binary = opt == OPT_TO_BINARY;
+                break;
+            case OPT_TRANSPOSED:
+                store_transposed = 1;
+                break;
+            case OPT_CACHE:
+                cache.dir = optarg;
+                break;
+            case OPT_CACHE_HASH:
+                cache.hashContents = 1;
+                break;
+            case OPT_BENCH:
+                if (convert_unsigned(optarg, &benchConfig.iterations) != 0) {
+                    return EXIT_FAILURE;
+                }
+                if (!benchConfig.iterations) {
+                    fprintf(stderr, "The benchmark needs at least one "
+                            "iteration.\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_WARMUP:
+                if (convert_unsigned(optarg, &benchConfig.warmup) != 0) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_FLUSH_CACHE:
+                benchConfig.flush = 1;
+                break;
+            case OPT_SEED: {
+                char* end;
+                errno = 0;
+                seed = strtoull(optarg, &end, 10);
+                if (end == optarg || *end || errno) {
+                    fprintf(stderr, "Invalid seed: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case OPT_DIMS:
+                if (!parse_dims(optarg, dims)) {
+                    fprintf(stderr, "Invalid dimensions: %s (expected N or "
+                            "NxMxK)\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_FAMILY:
+                genFamily = parse_family(optarg);
+                if (genFamily < 0) {
+                    fprintf(stderr, "Unknown matrix family: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_RMAT: {
+                int n = 0;
+                if (sscanf(optarg, "%lf,%lf,%lf,%lf%n", &rmat.a, &rmat.b,
+                            &rmat.c, &rmat.d, &n) != 4 || optarg[n]
+                        || !(rmat.a >= 0 && rmat.b >= 0 && rmat.c >= 0
+                            && rmat.d >= 0)
+                        || rmat.a + rmat.b + rmat.c + rmat.d < 0.999
+                        || rmat.a + rmat.b + rmat.c + rmat.d > 1.001) {
+                    fprintf(stderr, "The R-MAT probabilities must be four "
+                            "nonnegative numbers a,b,c,d with a sum of 1.\n");
+                    return EXIT_FAILURE;
+                }
+                genFamily = FAMILY_RMAT;
+                break;
+            }
+            case OPT_SCALE: {
+                unsigned scale;
+                if (convert_unsigned(optarg, &scale) != 0) {
+                    return EXIT_FAILURE;
+                }
+                if (!scale || scale > 40) {
+                    fprintf(stderr, "The scale must be between 1 and 40.\n");
+                    return EXIT_FAILURE;
+                }
+                dims[0] = dims[1] = dims[2] = 1ull << scale;
+                break;
+            }
+            case OPT_EDGE_FACTOR: {
+                char* end;
+                edgeFactor = strtod(optarg, &end);
+                if (end == optarg || *end || !(edgeFactor > 0)) {
+                    fprintf(stderr, "The edge factor must be a number greater "
+                            "than 0.\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case OPT_GEN_BINARY:
+                genBinary = 1;
+                break;
+            case OPT_TRACE:
+                trace_file = optarg;
+                break;
+            case OPT_CALIBRATE:
+                calibrate_file = optarg ? optarg : CSC_MODEL_FILE;
+                break;
+            case OPT_MODEL:
+                model_file = optarg;
+                break;
+            case OPT_PIN:
+                pin = 1;
+                break;
+            case OPT_SERVE:
+                serve_socket = optarg;
+                break;
+            case OPT_SEND:
+                send_socket = optarg;
+                break;
+            case OPT_BATCH:
+                batch_manifest = optarg;
+                break;
+            case OPT_DENSITY: {
+                char* end;
+                density = strtod(optarg, &end);
+                if (end == optarg || *end || !(density > 0) || density > 1) {
+                    fprintf(stderr, "The density must be a number greater "
+                            "than 0 and at most 1.\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
             default:
                 abort();
         }
     }
 
-    srand(time(NULL));
+    if (memoryBudget && streamColumns) {
+        fprintf(stderr, "The streaming and out-of-core modes can not be "
+                "combined.\n");
+        return EXIT_FAILURE;
+    }
+    if (benchConfig.iterations && (memoryBudget || streamColumns)) {
+        fprintf(stderr, "The benchmark can not be combined with the streaming "
+                "or out-of-core modes.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (batch_manifest && (benchConfig.iterations || memoryBudget
+                || streamColumns)) {
+        fprintf(stderr, "--batch can not be combined with the benchmark, "
+                "streaming or out-of-core modes.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (version == VERSION_AUTO && memoryBudget) {
+        fprintf(stderr, "-V auto can not be combined with the out-of-core "
+                "mode.\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(seed);
+
+    if (calibrate_file) {
+        struct costModel model;
+        printf("Calibrating the cost model...\n");
+        if (!calibrate_cost_model(&model, stdout)
+                || !save_cost_model(calibrate_file, &model)) {
+            perror("Calibration failed");
+            return EXIT_FAILURE;
+        }
+        printf("Cost model written to %s.\n", calibrate_file);
+        return EXIT_SUCCESS;
+    }
+
+    // Inherited counters only follow the threads created after them, so they
+    // are opened before the workers are started. Missing counters are
+    // reported after the run instead of failing it.
+    struct perfGroup perf = {0};
+    int perfErr = 0;
+    if (measureTime && !perf_open(&perf)) perfErr = errno;
+
+    // The cost model is calibrated with the serial kernels, the threads are
+    // started afterwards
+    if (threads > 1 && !csc_shared_pool_init(threads, pin)) {
+        perror("Unable to start the threads");
+        return EXIT_FAILURE;
+    }
+
+    if (serve_socket) {
+        errno = 0;
+        if (!run_daemon(serve_socket, threads, model_file)) {
+            perror("Unable to serve requests");
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    if (send_socket) {
+        return send_requests(send_socket, argv + optind, argc - optind)
+            ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (convert_input) {
+        errno = 0;
+        int ok = convert_to_binary
+            ? convert_text_to_binary(convert_input, output_file,
+                    store_transposed, threads)
+            : is_csc_stream(convert_input)
+            ? convert_stream_to_text(convert_input, output_file, precision)
+            : is_mtx_file(convert_input)
+            ? convert_mtx_to_text(convert_input, output_file, precision,
+                    threads)
+            : convert_binary_to_text(convert_input, output_file);
+        if (!ok) {
+            fprintf(stderr, "Conversion of %s failed.\n", convert_input);
+            return EXIT_FAILURE;
+        }
+        if (logData) printf("Converted %s to %s.\n", convert_input, output_file);
+        return EXIT_SUCCESS;
+    }
 
-    int (*transpose_fun)(struct cscMatrixTranspose*, struct cscMatrix*);
     void (*mul_fun)(const void*, const void*, void*);
 
     switch (version) {
         case 0:
-            transpose_fun = transpose;
             mul_fun = matr_mult_csc;
             break;
         case 1:
-            transpose_fun = transpose;
             mul_fun = matr_mult_csc_V1;
             break;
         case 2:
-            transpose_fun = 0;
             mul_fun = matr_mult_csc_V2;
             break;
+        case VERSION_AUTO:
+            // Selected once the inputs exist
+            mul_fun = 0;
+            break;
         default:
             fprintf(stderr, "Invalid program version.\n");
             return EXIT_FAILURE;
             break;
     }
 
-    struct timespec start_time, end_time, mul_start, mul_end, 
-            transpose_start, transpose_end, create_start, create_end, 
-            parse_start, parse_end;
-    double elapsed_time, mul_time = 0, transpose_time = 0, create_time, 
-          parse_time = 0;
+    if (batch_manifest) {
+        struct batchConfig batchConfig = {version, threads, precision,
+            cache.dir ? &cache : 0, model_file};
+        return run_manifest(batch_manifest, &batchConfig) ? EXIT_SUCCESS
+            : EXIT_FAILURE;
+    }
+
+    if (trace_file && !trace_start()) {
+        perror("Unable to start the trace");
+        return EXIT_FAILURE;
+    }
+
+    struct timespec start_time, end_time, mul_start, mul_end, create_start,
+            create_end, parse_start, parse_end;
+    double elapsed_time, mul_time = 0, create_time, parse_time = 0,
+           load_a_time = 0, load_b_time = 0;
+    int loadConcurrent = 0;
+    unsigned cacheHits = 0;
+    struct perfReading perfStart;
+    struct perfTotals perfTotals[PHASES];
+    memset(perfTotals, 0, sizeof(perfTotals));
+    // Metrics of the last multiplication and amount of measured ones. All
+    // iterations multiply the same inputs. Once they fail, they are skipped.
+    struct mulMetrics metrics;
+    unsigned measuredMuls = 0;
+    int metricsFailed = 0;
     if (measureTime) get_time(&start_time);
 
     if (generateNew) {
         if (measureTime) get_time(&create_start);
-        errno = 0;
-        create_random_matrix_doc(512, 1024, "randomMatrixA.txt", "randomMatrixB.txt");
-
-        int err = errno;
+        TRACE_BEGIN(generate);
+        // Without --dims, the dimensions are drawn from the seed as well
+        for (int i = 0; i < 3; i++) {
+            if (!dims[i]) dims[i] = 512 + rand() % 513;
+        }
+        // The edge factor is the average amount of values per row
+        if (edgeFactor) density = edgeFactor / dims[1];
+        int generated = generate_input_files(genFamily, dims[0], dims[1],
+                dims[2], density, &rmat, seed, threads, genBinary
+                ? "randomMatrixA.bin" : "randomMatrixA.txt", genBinary
+                ? "randomMatrixB.bin" : "randomMatrixB.txt");
+        TRACE_END(generate, "generate inputs");
         if (measureTime) get_time(&create_end);
-        if (err) return 1;
+        if (!generated) return EXIT_FAILURE;
+        printf("Generated a %lu by %lu and a %lu by %lu %s matrix with seed "
+                "%lu.\n", dims[0], dims[1], dims[1], dims[2],
+                familyNames[genFamily], seed);
     }
 
-    for (size_t i = 0; i < iterations; i++) {
+    if (statsMode) {
+        if (!print_statistics(file_a, file_b, threads, cache.dir ? &cache : 0,
+                    model_file)) {
+            perror("Computing the statistics failed");
+            return EXIT_FAILURE;
+        }
+        return finish_trace(trace_file) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-        struct cscMatrix* matrixB = malloc(sizeof(struct cscMatrix));
-        struct cscMatrix* matrixA_in = malloc(sizeof(struct cscMatrix));
-        if (!matrixA_in || !matrixB) {
-            errno = ENOMEM;
-            perror("Error initializing input matrices");
+    // Without --bench, -V auto chooses the kernel once the inputs are loaded
+    struct costModel model;
+    if (version == VERSION_AUTO && !load_cost_model(model_file, &model)) {
+        perror("Kernel selection failed");
+        return EXIT_FAILURE;
+    }
+    if (version == VERSION_AUTO && benchConfig.iterations) {
+        struct kernelChoice choice;
+        struct timespec select_start, select_end;
+        // The benchmark loads the inputs once more, which pipes do not allow
+        if (!is_mappable(file_a) || !is_mappable(file_b)) {
+            fprintf(stderr, "-V auto can not be combined with --bench for "
+                    "inputs that are not regular files.\n");
+            return EXIT_FAILURE;
+        }
+        get_time(&select_start);
+        if (!select_kernel(file_a, file_b, threads, cache.dir ? &cache : 0,
+                    &model, &choice)) {
+            perror("Kernel selection failed");
+            return EXIT_FAILURE;
+        }
+        version = choice.version;
+        mul_fun = modelKernels[version];
+        get_time(&select_end);
+        print_kernel_choice(&choice, &model, logData);
+        if (measureTime) {
+            printf("Selecting the version took %g s.\n",
+                    get_time_diff(&select_start, &select_end));
+        }
+    }
+
+    if (benchConfig.iterations) {
+        struct benchReport report;
+        errno = 0;
+        // For V0 and V1, A is loaded as its transpose
+        if (!bench_multiplication(quietKernels[version], version != 2, file_a, file_b,
+                    output_file, precision, threads, cache.dir ? &cache : 0,
+                    &benchConfig, &report)) {
+            perror("Benchmark failed");
             return EXIT_FAILURE;
         }
+        printf("Version: %d\n", version);
+        printf("Benchmark of %u runs after %u warmup runs%s.\n",
+                benchConfig.iterations, benchConfig.warmup, benchConfig.flush
+                ? ", with the CPU caches flushed before every run" : "");
+        printf("Loading the inputs once took %g s (A%s %g s, B %g s%s).\n",
+                report.parseTime, version != 2 ? " including its transposition"
+                : "", report.load.aTime, report.load.bTime,
+                report.load.concurrent ? ", on separate threads" : "");
+        if (report.kernel.count) {
+            print_bench_summary("kernel", &report.kernel);
+            printf("At the median: ");
+            print_mul_metrics(&report.metrics, report.kernel.median);
+        } else {
+            printf("An input has no nonzero values, the kernel was not run.\n");
+        }
+        printf("Writing the result (%lu by %lu, %lu values) once took %g s.\n",
+                report.rows, report.columns, report.valueCount,
+                report.writeTime);
+        return finish_trace(trace_file) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < iterations; i++) {
+
+        if (memoryBudget) {
+            if (measureTime) {
+                perf_read(&perf, &perfStart);
+                get_time(&mul_start);
+            }
+            errno = 0;
+            TRACE_BEGIN(ooc);
+            // For V0 and V1, the file of A must contain its transpose
+            int multiplied = mul_csc_ooc(quietKernels[version], version != 2,
+                    file_a, file_b, (uint64_t) memoryBudget << 20,
+                    output_file, &oocStats);
+            TRACE_END(ooc, "out-of-core multiply");
+            if (measureTime) {
+                get_time(&mul_end);
+                mul_time += get_time_diff(&mul_start, &mul_end);
+                end_phase(&perf, &perfStart, &perfTotals[PHASE_MUL]);
+            }
+            if (!multiplied) {
+                fprintf(stderr, "Out-of-core multiplication failed.\n");
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+
+        struct cscFile fileA, fileB;
         struct cscMatrix* result = malloc(sizeof(struct cscMatrix));
         if (!result) {
             perror("Error initializing output matrix");
@@ -131,94 +733,135 @@ int main(int argc, char *argv[]) {
 
         if (logData) printf("Input matrix structs initialized successfully.\n");
 
-        if (measureTime) get_time(&parse_start);
+        if (measureTime) {
+            perf_read(&perf, &perfStart);
+            get_time(&parse_start);
+        }
         errno = 0;
-        if (version != 2) {
-            struct cscMatrixTranspose* matrixA = 
-                malloc(sizeof(struct cscMatrixTranspose));
-            if (!matrixA) {
-                perror("Error initializing auxiliary matrix");
-                return EXIT_FAILURE;
-            }
-            if(parse_csc_file(file_a, file_b, matrixA, matrixB)){
-                if (measureTime) {
-                    get_time(&parse_end);
-                    parse_time += get_time_diff(&parse_start, &parse_end);
-                }
-                print_empty_matrix(matrixA->columns, matrixB->columns, 
-                        output_file);
-                free_csc_matrix(matrixB);
-                free_transpose_matrix(matrixA);
-                continue;
-            }
-            if (measureTime) {
-                get_time(&parse_end);
-                parse_time += get_time_diff(&parse_start, &parse_end);
-            }
+        // For V0 and V1, A is loaded as its transpose
+        struct loadStats loadStats;
+        TRACE_BEGIN(load);
+        int isZero = load_csc_files(file_a, file_b, &fileA, &fileB,
+                version != 2, threads, cache.dir ? &cache : 0, &loadStats);
+        TRACE_END(load, "load inputs");
+        if (measureTime) {
+            get_time(&parse_end);
+            parse_time += get_time_diff(&parse_start, &parse_end);
+            end_phase(&perf, &perfStart, &perfTotals[PHASE_LOAD]);
+            load_a_time += loadStats.aTime;
+            load_b_time += loadStats.bTime;
+            loadConcurrent |= loadStats.concurrent;
+            cacheHits += loadStats.aCached + loadStats.bCached;
+        }
+        if (logData && (loadStats.aCached || loadStats.bCached)) {
+            printf("Loaded %s from the cache.\n", !loadStats.bCached ? "A"
+                    : !loadStats.aCached ? "B" : "A and B");
+        }
 
+        if (errno) {
+            fprintf(stderr, "Matrix parsing failed.\n");
+            free(result);
+            return EXIT_FAILURE;
+        }
 
-            if (errno || !matrixA || !matrixB) {
-                fprintf(stderr, "Matrix parsing failed.\n");
+        // A was loaded transposed, as versions 0 and 1 need it
+        if (version == VERSION_AUTO) {
+            version = choose_version(&fileA, &fileB, &model, threads,
+                    measureTime);
+            if (version == VERSION_AUTO) {
+                perror("Kernel selection failed");
+                release_csc_file(&fileB);
+                release_csc_file(&fileA);
+                free(result);
                 return EXIT_FAILURE;
             }
+            mul_fun = modelKernels[version];
+        }
 
-
-
-            if (logData) printf("Transposing matrix A...");
-            if (measureTime) get_time(&transpose_start);
-            if (!transpose_fun(matrixA, matrixA_in)) {
-                if (measureTime) get_time(&transpose_end);
-                if (logData) perror("\rError transposing matrix A");
-                free_transpose_matrix(matrixA);
-                free_csc_matrix(matrixB);
-                return EXIT_FAILURE;
+        // The streaming mode writes an empty stream file instead
+        if (isZero && !streamColumns) {
+            uint64_t rows = version != 2 ? fileA.matrix.columns
+                : fileA.matrix.rows;
+            if (has_mtx_extension(output_file)) {
+                struct cscMatrix empty = {rows, fileB.matrix.columns, 0, 0, 0,
+                    0};
+                write_mtx_file(&empty, output_file, precision);
             } else {
-                free_transpose_matrix(matrixA);
+                print_empty_matrix(rows, fileB.matrix.columns, output_file);
             }
-        } else {
-            if(parse_csc_file_V2(file_a, file_b, matrixA_in, matrixB)){
-                if (measureTime) {
-                    get_time(&parse_end);
-                    parse_time += get_time_diff(&parse_start, &parse_end);
-                }
-                print_empty_matrix(matrixA_in->rows, matrixB->columns,
-                        output_file);
-                free_csc_matrix(matrixB);
-                free_csc_matrix(matrixA_in);
-                free_csc_matrix(result);
-                continue;
+            release_csc_file(&fileB);
+            release_csc_file(&fileA);
+            free(result);
+            continue;
+        }
+
+        if (logData) printf("Input matrices parsed successfully.\n");
+
+        if (streamColumns) {
+            if (measureTime) {
+                perf_read(&perf, &perfStart);
+                get_time(&mul_start);
             }
+            TRACE_BEGIN(stream);
+            int streamed = mul_csc_stream(quietKernels[version], &fileA.matrix,
+                    &fileB.matrix, version != 2 ? fileA.matrix.columns
+                    : fileA.matrix.rows, streamColumns, output_file,
+                    &streamStats);
+            TRACE_END(stream, "stream multiply");
             if (measureTime) {
-                get_time(&parse_end);
-                parse_time += get_time_diff(&parse_start, &parse_end);
+                get_time(&mul_end);
+                mul_time += get_time_diff(&mul_start, &mul_end);
+                end_phase(&perf, &perfStart, &perfTotals[PHASE_MUL]);
             }
-
-
-            if (errno || !matrixA_in || !matrixB) {
-                fprintf(stderr, "Matrix parsing failed.\n");
+            if (measureTime && streamed && !metricsFailed) {
+                // Only the amount of values of the streamed result is known
+                struct cscMatrix streamedResult = {0, fileB.matrix.columns,
+                    streamStats.valueCount, 0, 0, 0};
+                if (measure_metrics(&fileA.matrix, &fileB.matrix, version != 2,
+                            &streamedResult, &metrics)) {
+                    measuredMuls++;
+                } else {
+                    metricsFailed = 1;
+                }
+            }
+            release_csc_file(&fileB);
+            release_csc_file(&fileA);
+            free(result);
+            if (!streamed) {
+                fprintf(stderr, "Streaming multiplication failed.\n");
                 return EXIT_FAILURE;
             }
+            continue;
         }
 
         if (measureTime) {
-            get_time(&transpose_end);
-            transpose_time += get_time_diff(&transpose_start, &transpose_end);
+            perf_read(&perf, &perfStart);
+            get_time(&mul_start);
         }
-
-        if(logData) printf("\rMatrix A transposed successfully.\n");
-
-        if (measureTime) get_time(&mul_start);
-        mul_fun(matrixA_in, matrixB, result); 
-        // Store dimensions and valueCounts for logging
-        uint64_t aRows = matrixA_in->rows, aCols = matrixA_in->columns,
-                 aVals = matrixA_in->valueCount, bRows = matrixB->rows,
-                 bCols = matrixB->columns, bVals = matrixB->valueCount;
-        free_csc_matrix(matrixB);
-        free_csc_matrix(matrixA_in);
+        TRACE_BEGIN(multiply);
+        mul_fun(&fileA.matrix, &fileB.matrix, result); 
+        TRACE_END(multiply, "multiply");
         if (measureTime) {
             get_time(&mul_end);
             mul_time += get_time_diff(&mul_start, &mul_end);
+            end_phase(&perf, &perfStart, &perfTotals[PHASE_MUL]);
+        }
+        // The metrics need the inputs, so they are computed before those are
+        // released
+        if (measureTime && !errno && !metricsFailed) {
+            if (measure_metrics(&fileA.matrix, &fileB.matrix, version != 2,
+                        result, &metrics)) {
+                measuredMuls++;
+            } else {
+                metricsFailed = 1;
+            }
         }
+        // Store dimensions and valueCounts for logging
+        uint64_t aRows = fileA.matrix.rows, aCols = fileA.matrix.columns,
+                 aVals = fileA.matrix.valueCount, bRows = fileB.matrix.rows,
+                 bCols = fileB.matrix.columns, bVals = fileB.matrix.valueCount;
+        release_csc_file(&fileB);
+        release_csc_file(&fileA);
 
         if (errno != 0) {
             fprintf(stderr, "Matrix multiplication failed.\n");
@@ -232,15 +875,23 @@ int main(int argc, char *argv[]) {
             fflush(stdout);
         }
         if (measureTime) {
+            perf_read(&perf, &perfStart);
             get_time(&parse_start);
         }
-        result_to_file(result, output_file);
+        // Results are written in the Matrix Market format if the output file
+        // has the extension .mtx
+        TRACE_BEGIN(write);
+        int written = has_mtx_extension(output_file)
+            ? write_mtx_file(result, output_file, precision)
+            : write_csc_text_mt(result, output_file, precision, threads);
+        TRACE_END(write, "write result");
         if (measureTime) {
             get_time(&parse_end);
             parse_time += get_time_diff(&parse_start, &parse_end);
+            end_phase(&perf, &perfStart, &perfTotals[PHASE_WRITE]);
         }
 
-        if (errno != 0) {
+        if (!written) {
             perror("\rError writing result to output file");
             return EXIT_FAILURE;
         }
@@ -291,10 +942,6 @@ int main(int argc, char *argv[]) {
 
         if (iterations > 1) {
             printf("Average computation time: %g s.\n", (mul_time / iterations));
-            if (version != 2) {
-                printf("Average transposing time: %g s.\n", 
-                        (transpose_time / iterations));
-            }
             printf("Average parsing time: %g s.\n", parse_time / iterations);
             printf("Average iteration length: %g s.\n", 
                     (elapsed_time / iterations) - average_create);
@@ -305,11 +952,50 @@ int main(int argc, char *argv[]) {
         }
 
         printf("Total I/O processing time: %g s.\n", parse_time);
+        if (load_a_time || load_b_time) {
+            printf("Loading A%s took %g s, loading B %g s%s.\n",
+                    version != 2 ? " (including its transposition)" : "",
+                    load_a_time, load_b_time, loadConcurrent
+                    ? ", on separate threads" : "");
+        }
+        if (cache.dir) {
+            printf("%u of %u input files were loaded from the cache.\n",
+                    cacheHits, 2 * iterations);
+        }
         printf("Total computation time: %g s.\n", mul_time);
-        if (version != 2) {
-            printf("Total transposing time: %g s.\n", transpose_time);
+        if (measuredMuls && !metricsFailed) {
+            print_mul_metrics(&metrics, mul_time / measuredMuls);
+        }
+        if (streamColumns) {
+            printf("The computation time includes writing the result in %lu "
+                    "blocks of up to %u columns\n(%lu values, %.1f MB), "
+                    "%g s of which were spent waiting for the writer.\n",
+                    streamStats.blocks, streamColumns,
+                    streamStats.valueCount, streamStats.bytes / 1e6,
+                    streamStats.waitTime);
+        }
+        if (memoryBudget) {
+            printf("The computation time includes all I/O of the out-of-core "
+                    "mode with a budget of %u MB:\n"
+                    "%lu column panels of B and %lu row panels of A "
+                    "(%lu panel products),\n"
+                    "%.1f MB read from B, %.1f MB read from A, "
+                    "%.1f MB written (%lu values).\n", memoryBudget,
+                    oocStats.bPanels, oocStats.aPanels, oocStats.products,
+                    oocStats.bBytesRead / 1e6, oocStats.aBytesRead / 1e6,
+                    oocStats.bytesWritten / 1e6, oocStats.valueCount);
+        }
+        if (perf.opened) {
+            printf("Hardware counters (user space, all iterations%s):\n",
+                    version != 2 ? ", loading includes the transposition of A"
+                    : "");
+            print_perf_totals(phaseNames, perfTotals, PHASES);
+        } else {
+            printf("Hardware counters are unavailable: %s.\n",
+                    strerror(perfErr));
         }
+        perf_close(&perf);
     }
-    return EXIT_SUCCESS;
+    return finish_trace(trace_file) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
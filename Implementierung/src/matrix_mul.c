@@ -1,118 +1,164 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 
 #include "matrix_mul.h"
 #include "cs_matrix.h"
+#include "csc_context.h"
+#include "csc_pool.h"
+#include "csc_trace.h"
 
 /**
- * Procedure to free all pointer members in a cscMatrix.
+ * Procedure to free all pointer members in a cscMatrix and set them to null.
  *
  * If any of the pointer members either points to the stack or has already been
  * freed, this function results in undefined behavior.
  *
+ * @param ctx           Context whose allocator allocated the members
  * @param result        Matrix whose members should be freed
  */
-static void freeResultPtrs(struct cscMatrix* result) {
-    free(result->colPtr);
-    free(result->rowIndices);
-    free(result->values);
+static void freeResultPtrs(const struct cscContext* ctx,
+        struct cscMatrix* result) {
+    csc_free(ctx, result->colPtr);
+    csc_free(ctx, result->rowIndices);
+    csc_free(ctx, result->values);
+    result->colPtr = 0;
+    result->rowIndices = 0;
+    result->values = 0;
 }
 
-static void realloc_result(struct cscMatrix* result, uint64_t resultSize){
-    if (result->valueCount > 0 && resultSize > result->valueCount) { 
-        float* newVals = realloc(result->values, result->valueCount 
+/**
+ * Doubles the memory for values and row indices of the result, see
+ * extend_vector.
+ *
+ * @return  The new amount of elements, or 0 if the memory can not be
+ *          allocated or current is already max
+ */
+static uint64_t extend_result(const struct cscContext* ctx,
+        struct cscMatrix* result, uint64_t current, uint64_t max) {
+    if (current == max) return 0;
+    uint64_t doubleSize;
+    int of = __builtin_umull_overflow(2, current, &doubleSize);
+    uint64_t newSize = (of || doubleSize > max) ? max : doubleSize;
+    uint64_t valueBytes, indexBytes;
+    if (__builtin_umull_overflow(newSize, sizeof(float), &valueBytes)
+            || __builtin_umull_overflow(newSize, sizeof(uint64_t),
+                &indexBytes)) {
+        return 0;
+    }
+    float* newVals = csc_realloc(ctx, result->values, valueBytes);
+    if (newVals) result->values = newVals;
+    uint64_t* newInd = csc_realloc(ctx, result->rowIndices, indexBytes);
+    if (newInd) result->rowIndices = newInd;
+    return newVals && newInd ? newSize : 0;
+}
+
+static int realloc_result(const struct cscContext* ctx,
+        struct cscMatrix* result, uint64_t resultSize) {
+    if (result->valueCount > 0 && resultSize > result->valueCount) {
+        float* newVals = csc_realloc(ctx, result->values, result->valueCount
                 * sizeof(float));
-        uint64_t* newInd = realloc(result->rowIndices, result->valueCount
-                * sizeof(uint64_t));
-        if (!newVals || !newInd) { 
-            free(newInd);
-            free(newVals);
-            freeResultPtrs(result);
-            errno = ENOMEM;
-            perror("Error reallocating memory for entries of result matrix.");
+        if (newVals) result->values = newVals;
+        uint64_t* newInd = csc_realloc(ctx, result->rowIndices,
+                result->valueCount * sizeof(uint64_t));
+        if (newInd) result->rowIndices = newInd;
+        if (!newVals || !newInd) {
+            freeResultPtrs(ctx, result);
+            csc_log(ctx, CSC_LOG_ERROR, "Error reallocating memory for "
+                    "entries of result matrix.\n");
+            return CSC_OUT_OF_MEMORY;
         }
-        result->values = newVals;
-        result->rowIndices = newInd;
     } else if (!result->valueCount) {
-        free(result->values);
-        free(result->rowIndices);
+        csc_free(ctx, result->values);
+        csc_free(ctx, result->rowIndices);
         result->values = 0;
         result->rowIndices = 0;
     }
+    return CSC_OK;
 }
 
 /**
  * Initializes the result matrix of a multiplication with either known values
  * or estimates.
  *
- * The value and rowIndices pointers are initialized to 
- * max(result->rows, result->columns) elements, and the size is returned to allow 
+ * The value and rowIndices pointers are initialized to
+ * max(result->rows, result->columns) elements, and the size is returned to allow
  * dynamic size modifications.
  *
- * @param a             First factor in multiplication 
+ * @param ctx           Context to allocate with
+ * @param a             First factor in multiplication
  * @param b             Second factor in multiplication
  * @param result        Product of first and two factor matrices
  * @param transposed    Boolean integer, nonzero if a is transposed
- * @return              The amount of elements that the pointers point to, or 0 
- *                      if an error ocurred during initialization
+ * @param size          Output parameter for the amount of elements that the
+ *                      pointers point to
+ * @return              CSC_OK, or the status of the error that occurred
+ *                      during initialization
  */
-static uint64_t initializeResultMatrix(const struct cscMatrix* a, 
-        const struct cscMatrix* b, struct cscMatrix* result, int transposed) {
+static int initializeResultMatrix(const struct cscContext* ctx,
+        const struct cscMatrix* a, const struct cscMatrix* b,
+        struct cscMatrix* result, int transposed, uint64_t* size) {
 
     result->rows = transposed ? a->columns : a->rows;
     result->columns = b->columns;
 
-    uint64_t vals = result->rows > result->columns ? result->rows 
+    uint64_t vals = result->rows > result->columns ? result->rows
         : result->columns;
 
-    uint64_t maxSize = sizeof(uint64_t) > sizeof(float) ? sizeof(uint64_t) 
+    uint64_t maxSize = sizeof(uint64_t) > sizeof(float) ? sizeof(uint64_t)
         : sizeof(float);
     uint64_t prod;
     uint64_t sum;
     int of_mul = __builtin_umull_overflow(vals, maxSize, &prod);
     int of_add = __builtin_uaddl_overflow(vals, maxSize, &sum);
 
-    if (of_mul || of_add) {
-        errno = ERANGE;
-        return 0;
-    }
-
     result->valueCount = 0;
-    
-    result->rowIndices = malloc(vals * sizeof(uint64_t));
-    result->values = malloc(vals * sizeof(float));
-    result->colPtr = calloc(sum, sizeof(uint64_t));
+    result->rowIndices = 0;
+    result->values = 0;
+    result->colPtr = 0;
+    if (of_mul || of_add) return CSC_OVERFLOW;
+
+    result->rowIndices = csc_malloc(ctx, vals * sizeof(uint64_t));
+    result->values = csc_malloc(ctx, vals * sizeof(float));
+    result->colPtr = csc_calloc(ctx, sum, sizeof(uint64_t));
     if (!result->rowIndices || !result->values || !result->colPtr) {
-        freeResultPtrs(result);
-        return 0;
+        freeResultPtrs(ctx, result);
+        return CSC_OUT_OF_MEMORY;
     }
-    return vals;
+    *size = vals;
+    return CSC_OK;
 }
 
-void matr_mult_csc(const void* a, const void* b, void* result) {
-    const struct cscMatrix* csA = a; 
-    const struct cscMatrix* csB = b;
-    struct cscMatrix* csResult = result;
-
-    errno = 0;
-    uint64_t resultSize = initializeResultMatrix(csA, csB, csResult, 1);
-    if (errno != 0) {
-        perror("Error initializing result matrix members");
-        return;
+// Logs the progress of a kernel in steps of about 1%
+static void log_progress(const struct cscContext* ctx, uint64_t j,
+        uint64_t columns, uint64_t step) {
+    if (ctx->logLevel < CSC_LOG_PROGRESS || !step || j % step) return;
+    csc_log(ctx, CSC_LOG_PROGRESS, "\rComputing product of matrices. "
+            "%.0f%% done.", 100*((double) j)/columns);
+}
+
+static int mul_csc_V0(const struct cscContext* ctx, const struct cscMatrix* csA,
+        const struct cscMatrix* csB, struct cscMatrix* csResult) {
+    TRACE_BEGIN(t);
+    uint64_t resultSize;
+    int status = initializeResultMatrix(ctx, csA, csB, csResult, 1,
+            &resultSize);
+    if (status) {
+        csc_log(ctx, CSC_LOG_ERROR, "Error initializing result matrix "
+                "members: %s\n", csc_status_string(status));
+        return status;
     }
     uint64_t maxSize;
-    if (__builtin_umull_overflow(csResult->rows, csResult->columns, &maxSize)) 
+    if (__builtin_umull_overflow(csResult->rows, csResult->columns, &maxSize))
         maxSize = UINT64_MAX;
 
-    if (logData) printf("Result matrix members initialized successfully.\n");
+    csc_log(ctx, CSC_LOG_PROGRESS, "Result matrix members initialized "
+            "successfully.\n");
 
     for (uint64_t j = 0; j < csB->columns; ++j) {
-        if (logData && csB->columns > 100 && !(j % (csB->columns/100))) {
-            printf("\rComputing product of matrices. "
-                    "%.0f%% done.", 100*((double) j)/csB->columns);
-            fflush(stdout);
-        }
+        log_progress(ctx, j, csB->columns, csB->columns > 100
+                ? csB->columns/100 : 0);
 
         uint64_t bStart = csB->colPtr[j];
         uint64_t bEnd = csB->colPtr[j+1];
@@ -127,63 +173,64 @@ void matr_mult_csc(const void* a, const void* b, void* result) {
         for (uint64_t i = 0; i < csA->columns; ++i) {
             // Compute the scalar product between the next A column and the current
             // B column in-place
-            float entry = scalar_prod_in_place(csA->values, csB->values, 
-                    csA->rowIndices, csB->rowIndices, csA->colPtr[i], 
+            float entry = scalar_prod_in_place(csA->values, csB->values,
+                    csA->rowIndices, csB->rowIndices, csA->colPtr[i],
                     csA->colPtr[i+1], bStart, bEnd);
 
-            if (cmp_float_eq(entry, 0)) continue; 
+            if (cmp_float_eq(entry, 0)) continue;
 
             // Increase the memory for values and row indices if necessary
             if (csResult->valueCount >= resultSize) {
-                resultSize = extend_vector(&csResult->values, 
-                        &csResult->rowIndices, csResult->valueCount, maxSize);
+                resultSize = extend_result(ctx, csResult,
+                        csResult->valueCount, maxSize);
                 if (!resultSize) {
-                    perror("Error storing result values.");
-                    freeResultPtrs(csResult);
-                    return;
+                    csc_log(ctx, CSC_LOG_ERROR, "Error storing result "
+                            "values.\n");
+                    freeResultPtrs(ctx, csResult);
+                    return CSC_OUT_OF_MEMORY;
                 }
             }
 
-            csResult->values[csResult->valueCount] = entry; 
+            csResult->values[csResult->valueCount] = entry;
             csResult->rowIndices[csResult->valueCount++] = i;
             csResult->colPtr[j+1]++;
-        }       
+        }
         // Set value of next-next column pointer to value of next one
         if (j < csB->columns-1){
             csResult->colPtr[j+2] = csResult->colPtr[j+1];
         }
     }
 
-    if (logData) printf("\rProduct of matrices computed successfully.\n");
+    csc_log(ctx, CSC_LOG_PROGRESS, "\rProduct of matrices computed "
+            "successfully.\n");
 
-    errno = 0;
     // realloc result values and rowIndices to valueCount
-    realloc_result(csResult, resultSize);
+    status = realloc_result(ctx, csResult, resultSize);
+    TRACE_END(t, "kernel V0");
+    return status;
 }
 
-void matr_mult_csc_V1(const void* a, const void* b, void* result) {
-    const struct cscMatrix* csA = a; 
-    const struct cscMatrix* csB = b;
-    struct cscMatrix* csResult = result;
-
-    errno = 0;
-    uint64_t resultSize = initializeResultMatrix(csA, csB, csResult, 1);
-    if (errno != 0) {
-        perror("Error initializing result matrix members");
-        return;
+static int mul_csc_V1(const struct cscContext* ctx, const struct cscMatrix* csA,
+        const struct cscMatrix* csB, struct cscMatrix* csResult) {
+    TRACE_BEGIN(t);
+    uint64_t resultSize;
+    int status = initializeResultMatrix(ctx, csA, csB, csResult, 1,
+            &resultSize);
+    if (status) {
+        csc_log(ctx, CSC_LOG_ERROR, "Error initializing result matrix "
+                "members: %s\n", csc_status_string(status));
+        return status;
     }
     uint64_t maxSize;
-    if (__builtin_umull_overflow(csResult->rows, csResult->columns, &maxSize)) 
+    if (__builtin_umull_overflow(csResult->rows, csResult->columns, &maxSize))
         maxSize = UINT64_MAX;
 
-    if (logData) printf("Result matrix members initialized successfully.\n");
+    csc_log(ctx, CSC_LOG_PROGRESS, "Result matrix members initialized "
+            "successfully.\n");
 
     for (uint64_t j = 0; j < csB->columns; ++j) {
-        if (logData && csB->columns > 100 && !(j % (csB->columns/100))) {
-            printf("\rComputing product of matrices. "
-                    "%.0f%% done.", 100*((double) j)/csB->columns);
-            fflush(stdout);
-        }
+        log_progress(ctx, j, csB->columns, csB->columns > 100
+                ? csB->columns/100 : 0);
         // get the next B column
         uint64_t start = csB->colPtr[j];
         uint64_t end = csB->colPtr[j+1];
@@ -195,16 +242,15 @@ void matr_mult_csc_V1(const void* a, const void* b, void* result) {
             continue;
         }
 
-        float* bVec = malloc(bLen * sizeof(float));
-        uint64_t* bInd = malloc(bLen * sizeof(uint64_t));
+        float* bVec = csc_malloc(ctx, bLen * sizeof(float));
+        uint64_t* bInd = csc_malloc(ctx, bLen * sizeof(uint64_t));
         if (!bVec || !bInd) {
-            errno = ENOMEM;
-            free(bVec);
-            free(bInd);
-            freeResultPtrs(csResult);
-            fprintf(stderr, 
-                    "\rError allocating memory for column %lu of matrix B.", j);
-            return;
+            csc_free(ctx, bVec);
+            csc_free(ctx, bInd);
+            freeResultPtrs(ctx, csResult);
+            csc_log(ctx, CSC_LOG_ERROR, "\rError allocating memory for column "
+                    "%lu of matrix B.", j);
+            return CSC_OUT_OF_MEMORY;
         }
 
         get_col_vector(csB->values, csB->rowIndices, bLen, bVec, bInd, start);
@@ -216,89 +262,132 @@ void matr_mult_csc_V1(const void* a, const void* b, void* result) {
             if (!aLen) continue;
 
             // get the next A column
-            float* aVec = malloc(aLen * sizeof(float));
-            uint64_t* aInd = malloc(aLen * sizeof(uint64_t));
+            float* aVec = csc_malloc(ctx, aLen * sizeof(float));
+            uint64_t* aInd = csc_malloc(ctx, aLen * sizeof(uint64_t));
             if (!aVec || !aInd) {
-                errno = ENOMEM;
-                free(aVec);
-                free(aInd);
-                free(bVec);
-                free(bInd);
-                freeResultPtrs(csResult);
-                fprintf(stderr, 
-                    "\rError allocating memory for row %lu of matrix A.\n", i);
-                return;
+                csc_free(ctx, aVec);
+                csc_free(ctx, aInd);
+                csc_free(ctx, bVec);
+                csc_free(ctx, bInd);
+                freeResultPtrs(ctx, csResult);
+                csc_log(ctx, CSC_LOG_ERROR, "\rError allocating memory for "
+                        "row %lu of matrix A.\n", i);
+                return CSC_OUT_OF_MEMORY;
             }
 
-            get_col_vector(csA->values, csA->rowIndices, aLen, aVec, aInd, 
+            get_col_vector(csA->values, csA->rowIndices, aLen, aVec, aInd,
                     start);
 
             float entry = scalar_prod(aVec, bVec, aInd, bInd, aLen, bLen);
 
-            free(aVec);
-            free(aInd);
+            csc_free(ctx, aVec);
+            csc_free(ctx, aInd);
 
-            if (cmp_float_eq(entry, 0)) continue; 
+            if (cmp_float_eq(entry, 0)) continue;
 
             // Increase the memory for values and row indices if necessary
             if (csResult->valueCount >= resultSize) {
-                resultSize = extend_vector(&csResult->values, &csResult->rowIndices,
-                                           csResult->valueCount, maxSize);
+                resultSize = extend_result(ctx, csResult,
+                        csResult->valueCount, maxSize);
                 if (!resultSize) {
-                    perror("Error storing result values.");
-                    free(bVec);
-                    free(bInd);
-                    freeResultPtrs(csResult);
-                    return;
+                    csc_log(ctx, CSC_LOG_ERROR, "Error storing result "
+                            "values.\n");
+                    csc_free(ctx, bVec);
+                    csc_free(ctx, bInd);
+                    freeResultPtrs(ctx, csResult);
+                    return CSC_OUT_OF_MEMORY;
                 }
             }
 
-            csResult->values[csResult->valueCount] = entry; 
+            csResult->values[csResult->valueCount] = entry;
             csResult->rowIndices[csResult->valueCount++] = i;
             csResult->colPtr[j+1]++;
-        }       
-        
+        }
+
         // Set value of next-next column pointer to value of next one
         if (j < csB->columns-1){
             csResult->colPtr[j+2] = csResult->colPtr[j+1];
         }
-        free(bVec);
-        free(bInd);
+        csc_free(ctx, bVec);
+        csc_free(ctx, bInd);
     }
-    if (logData) printf("\rProduct of matrices computed successfully.\n");
+    csc_log(ctx, CSC_LOG_PROGRESS, "\rProduct of matrices computed "
+            "successfully.\n");
 
-    errno = 0;
     // realloc result values and rowIndices to valueCount
-    realloc_result(csResult, resultSize);
-    
+    status = realloc_result(ctx, csResult, resultSize);
+    TRACE_END(t, "kernel V1");
+    return status;
 }
 
+/**
+ * Extracts a row of a matrix like get_row_vector, with the allocator of a
+ * context.
+ *
+ * @return  CSC_OK, or CSC_OUT_OF_MEMORY, in which case the row is empty
+ */
+static int get_row(const struct cscContext* ctx, const struct cscMatrix* m,
+        uint64_t index, struct cscRow* row) {
+    row->valueCount = 0;
+    row->values = csc_malloc(ctx, sizeof(float));
+    row->colIndices = csc_malloc(ctx, sizeof(uint64_t));
+    uint64_t size = 1;
+    int ok = row->values && row->colIndices;
+
+    for (uint64_t i = 0; ok && i < m->columns; ++i) {
+        for (uint64_t j = m->colPtr[i]; j < m->colPtr[i + 1]; ++j) {
+            if (m->rowIndices[j] != index) continue;
+
+            if (row->valueCount >= size) {
+                size *= 2;
+                float* values = csc_realloc(ctx, row->values,
+                        size * sizeof(float));
+                if (values) row->values = values;
+                uint64_t* indices = csc_realloc(ctx, row->colIndices,
+                        size * sizeof(uint64_t));
+                if (indices) row->colIndices = indices;
+                if (!values || !indices) {
+                    ok = 0;
+                    break;
+                }
+            }
 
-void matr_mult_csc_V2(const void* a, const void* b, void* result) {
-    const struct cscMatrix* csA = a; 
-    const struct cscMatrix* csB = b;
-    struct cscMatrix* csResult = result;
-
-    errno = 0;
-    uint64_t resultSize = initializeResultMatrix(csA, csB, csResult, 0);
-    if (errno != 0) {
-        perror("Error initializing result matrix members");
-        return;
+            row->values[row->valueCount] = m->values[j];
+            row->colIndices[row->valueCount++] = i;
+            break;
+        }
+    }
+    if (ok) return CSC_OK;
+    csc_free(ctx, row->values);
+    csc_free(ctx, row->colIndices);
+    row->values = 0;
+    row->colIndices = 0;
+    row->valueCount = 0;
+    return CSC_OUT_OF_MEMORY;
+}
+
+static int mul_csc_V2(const struct cscContext* ctx, const struct cscMatrix* csA,
+        const struct cscMatrix* csB, struct cscMatrix* csResult) {
+    TRACE_BEGIN(t);
+    uint64_t resultSize;
+    int status = initializeResultMatrix(ctx, csA, csB, csResult, 0,
+            &resultSize);
+    if (status) {
+        csc_log(ctx, CSC_LOG_ERROR, "Error initializing result matrix "
+                "members: %s\n", csc_status_string(status));
+        return status;
     }
     uint64_t maxSize;
-    if (__builtin_umull_overflow(csResult->rows, csResult->columns, &maxSize)) 
+    if (__builtin_umull_overflow(csResult->rows, csResult->columns, &maxSize))
         maxSize = UINT64_MAX;
 
-    if (logData) printf("Result matrix members initialized successfully.\n");
+    csc_log(ctx, CSC_LOG_PROGRESS, "Result matrix members initialized "
+            "successfully.\n");
 
     for (uint64_t j = 0; j < csB->columns; ++j) {
-        // show progress if l option is set. Print only 1% of iterations to 
+        // show progress if l option is set. Print only 1% of iterations to
         // reduce overhead
-        if (logData && !(j % 100)) {
-            printf("\rComputing product of matrices. "
-                    "%.0f%% done.", 100*((double) j)/csB->columns);
-            fflush(stdout);
-        }                                                                        
+        log_progress(ctx, j, csB->columns, 100);
         // get the next B column
         uint64_t start = csB->colPtr[j];
         uint64_t end = csB->colPtr[j+1];
@@ -310,70 +399,288 @@ void matr_mult_csc_V2(const void* a, const void* b, void* result) {
             continue;
         }
 
-        float* bVec = malloc(bLen * sizeof(float));
-        uint64_t* bInd = malloc(bLen * sizeof(uint64_t));
+        float* bVec = csc_malloc(ctx, bLen * sizeof(float));
+        uint64_t* bInd = csc_malloc(ctx, bLen * sizeof(uint64_t));
         if (!bVec || !bInd) {
-            errno = ENOMEM;
-            free(bVec);
-            free(bInd);
-            freeResultPtrs(csResult);
-            fprintf(stderr, 
-                    "\rError allocating memory for column %lu of matrix B.", j);
-            return;
+            csc_free(ctx, bVec);
+            csc_free(ctx, bInd);
+            freeResultPtrs(ctx, csResult);
+            csc_log(ctx, CSC_LOG_ERROR, "\rError allocating memory for column "
+                    "%lu of matrix B.", j);
+            return CSC_OUT_OF_MEMORY;
         }
-                                                                                               
+
         get_col_vector(csB->values, csB->rowIndices, bLen, bVec, bInd, start);
-                                                                               
+
         for (uint64_t i = 0; i < csA->rows; ++i) {
 
-            errno = 0;
-            struct cscRow row = get_row_vector(csA, i);
-            if (errno) {
-                perror("Error getting row vector from a");
-                free(bVec);
-                free(bInd);
-                freeResultPtrs(csResult);
-                return;
+            struct cscRow row;
+            status = get_row(ctx, csA, i, &row);
+            if (status) {
+                csc_log(ctx, CSC_LOG_ERROR, "Error getting row vector from "
+                        "a: %s\n", csc_status_string(status));
+                csc_free(ctx, bVec);
+                csc_free(ctx, bInd);
+                freeResultPtrs(ctx, csResult);
+                return status;
             }
-            // printFloatVector(row.values, row.valueCount);
-            // printUint64Vector(row.colIndices, row.valueCount);
 
             float entry = scalar_prod(row.values, bVec, row.colIndices, bInd,
                                       row.valueCount, bLen);
-            free(row.colIndices);
-            free(row.values);
+            csc_free(ctx, row.colIndices);
+            csc_free(ctx, row.values);
 
-            if (cmp_float_eq(entry, 0)) continue; 
+            if (cmp_float_eq(entry, 0)) continue;
 
             // Increase the memory for values and row indices if necessary
             if (csResult->valueCount >= resultSize) {
-                resultSize = extend_vector(&csResult->values, &csResult->rowIndices,
-                                           csResult->valueCount, maxSize);
+                resultSize = extend_result(ctx, csResult,
+                        csResult->valueCount, maxSize);
                 if (!resultSize) {
-                    perror("Error storing result values.");
-                    free(bVec);
-                    free(bInd);
-                    freeResultPtrs(csResult);
-                    return;
+                    csc_log(ctx, CSC_LOG_ERROR, "Error storing result "
+                            "values.\n");
+                    csc_free(ctx, bVec);
+                    csc_free(ctx, bInd);
+                    freeResultPtrs(ctx, csResult);
+                    return CSC_OUT_OF_MEMORY;
                 }
             }
 
-            csResult->values[csResult->valueCount] = entry; 
+            csResult->values[csResult->valueCount] = entry;
             csResult->rowIndices[csResult->valueCount++] = i;
             csResult->colPtr[j+1]++;
-        }       
-        
+        }
+
         // Set value of next-next column pointer to value of next one
         if (j < csB->columns-1){
             csResult->colPtr[j+2] = csResult->colPtr[j+1];
         }
-        free(bVec);
-        free(bInd);
+        csc_free(ctx, bVec);
+        csc_free(ctx, bInd);
     }
-    if (logData) printf("\rProduct of matrices computed successfully.\n");
+    csc_log(ctx, CSC_LOG_PROGRESS, "\rProduct of matrices computed "
+            "successfully.\n");
 
-    errno = 0;
     // realloc result values and rowIndices to valueCount
-    realloc_result(csResult, resultSize);
+    status = realloc_result(ctx, csResult, resultSize);
+    TRACE_END(t, "kernel V2");
+    return status;
+}
+
+static int mul_serial(const struct cscContext* ctx, int version,
+        const struct cscMatrix* a, const struct cscMatrix* b,
+        struct cscMatrix* result) {
+    switch (version) {
+        case 0:
+            return mul_csc_V0(ctx, a, b, result);
+        case 1:
+            return mul_csc_V1(ctx, a, b, result);
+        default:
+            return mul_csc_V2(ctx, a, b, result);
+    }
+}
+
+/**
+ * @class mulSlice
+ *
+ * Consecutive columns of B and the corresponding columns of the product,
+ * computed by one part of a parallel multiplication
+ *
+ * @member ctx      Context of the kernel, which logs errors only
+ * @member version  The kernel
+ * @member a        First factor
+ * @member first    First column of the slice
+ * @member b        View of the columns of B, whose column pointers point
+ *                  into those of B
+ * @member result   Product of a and the slice of B
+ * @member offset   Position of the values of the slice in the product
+ * @member product  The product, whose arrays the slice is copied into
+ * @member status   Status of the kernel
+ */
+struct mulSlice {
+    const struct cscContext* ctx;
+    int version;
+    const struct cscMatrix* a;
+    uint64_t first;
+    struct cscMatrix b;
+    struct cscMatrix result;
+    uint64_t offset;
+    struct cscMatrix* product;
+    int status;
+};
+
+static void* mul_slice(void* arg) {
+    struct mulSlice* s = arg;
+    s->status = s->b.columns
+        ? mul_serial(s->ctx, s->version, s->a, &s->b, &s->result) : CSC_OK;
+    return 0;
+}
+
+// Copies the values and column pointers of a slice into the product
+static void* copy_slice(void* arg) {
+    struct mulSlice* s = arg;
+    struct cscMatrix* p = s->product;
+    if (s->result.valueCount) {
+        memcpy(p->values + s->offset, s->result.values,
+                s->result.valueCount * sizeof(float));
+        memcpy(p->rowIndices + s->offset, s->result.rowIndices,
+                s->result.valueCount * sizeof(uint64_t));
+    }
+    for (uint64_t j = 1; j <= s->b.columns; j++) {
+        p->colPtr[s->first + j] = s->offset + s->result.colPtr[j];
+    }
+    return 0;
+}
+
+void split_csc_columns(const struct cscMatrix* b, uint64_t n,
+        uint64_t* ends) {
+    // Targets are relative to the first column, which need not start at 0
+    uint64_t base = b->colPtr[0];
+    uint64_t total = b->colPtr[b->columns] - base;
+    uint64_t end = 0;
+    for (uint64_t i = 0; i + 1 < n; i++) {
+        uint64_t target = total / n * (i + 1);
+        uint64_t first = end;
+        // Every range keeps a column for each of the ranges after it
+        uint64_t last = b->columns - (n - 1 - i);
+        while (end < last && (end == first
+                    || b->colPtr[end] - base < target)) {
+            end++;
+        }
+        ends[i] = end;
+    }
+    ends[n - 1] = b->columns;
+}
+
+/**
+ * Multiplies with the threads of the pool of the context. B is split into
+ * four slices of columns per thread with about the same amount of values,
+ * every slice is multiplied by the kernel on its own, and the products of
+ * the slices are then copied into the product in parallel.
+ */
+static int mul_parallel(const struct cscContext* ctx, int version,
+        const struct cscMatrix* a, const struct cscMatrix* b,
+        struct cscMatrix* result) {
+    TRACE_BEGIN(t);
+    uint64_t n = 4 * (uint64_t) csc_pool_threads(ctx->pool);
+    if (n > b->columns) n = b->columns;
+    struct cscContext sliceCtx = *ctx;
+    if (sliceCtx.logLevel > CSC_LOG_ERROR) sliceCtx.logLevel = CSC_LOG_ERROR;
+    struct mulSlice* slices = csc_calloc(ctx, n, sizeof(struct mulSlice));
+    uint64_t* ends = csc_malloc(ctx, n * sizeof(uint64_t));
+    result->rows = version == 2 ? a->rows : a->columns;
+    result->columns = b->columns;
+    result->valueCount = 0;
+    result->values = 0;
+    result->rowIndices = 0;
+    result->colPtr = 0;
+    if (!slices || !ends) {
+        if (slices) csc_free(ctx, slices);
+        if (ends) csc_free(ctx, ends);
+        return CSC_OUT_OF_MEMORY;
+    }
+
+    split_csc_columns(b, n, ends);
+    uint64_t first = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t end = ends[i];
+        slices[i].ctx = &sliceCtx;
+        slices[i].version = version;
+        slices[i].a = a;
+        slices[i].first = first;
+        slices[i].b = (struct cscMatrix) {b->rows, end - first,
+            b->colPtr[end] - b->colPtr[first], b->values, b->rowIndices,
+            b->colPtr + first};
+        first = end;
+    }
+    csc_log(ctx, CSC_LOG_PROGRESS, "Computing product of matrices with %u "
+            "threads.\n", csc_pool_threads(ctx->pool));
+    csc_pool_run(ctx->pool, slices, sizeof(*slices), n, mul_slice);
+
+    int status = CSC_OK;
+    for (uint64_t i = 0; i < n; i++) {
+        if (!status) status = slices[i].status;
+        slices[i].offset = result->valueCount;
+        result->valueCount += slices[i].result.valueCount;
+    }
+    if (!status) {
+        result->colPtr = csc_calloc(ctx, b->columns + 1, sizeof(uint64_t));
+        if (result->valueCount) {
+            result->values = csc_malloc(ctx, result->valueCount
+                    * sizeof(float));
+            result->rowIndices = csc_malloc(ctx, result->valueCount
+                    * sizeof(uint64_t));
+        }
+        if (!result->colPtr || (result->valueCount && (!result->values
+                        || !result->rowIndices))) {
+            freeResultPtrs(ctx, result);
+            status = CSC_OUT_OF_MEMORY;
+        }
+    }
+    if (!status) {
+        for (uint64_t i = 0; i < n; i++) slices[i].product = result;
+        csc_pool_run(ctx->pool, slices, sizeof(*slices), n, copy_slice);
+        csc_log(ctx, CSC_LOG_PROGRESS, "Product of matrices computed "
+                "successfully.\n");
+    } else {
+        result->valueCount = 0;
+        csc_log(ctx, CSC_LOG_ERROR, "Error computing product of matrices: "
+                "%s\n", csc_status_string(status));
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        if (slices[i].b.columns) freeResultPtrs(ctx, &slices[i].result);
+    }
+    csc_free(ctx, slices);
+    csc_free(ctx, ends);
+    TRACE_END(t, "parallel multiply");
+    return status;
+}
+
+int mul_csc_ctx(const struct cscContext* ctx, int version,
+        const struct cscMatrix* a, const struct cscMatrix* b,
+        struct cscMatrix* result) {
+    if (version < 0 || version > 2) return CSC_INVALID_ARGUMENT;
+    if (csc_pool_threads(ctx->pool) > 1 && b->columns > 1) {
+        return mul_parallel(ctx, version, a, b, result);
+    }
+    return mul_serial(ctx, version, a, b, result);
+}
+
+// The kernels of the program log like the rest of it and report errors
+// through errno. Quiet ones only log errors.
+static void mul_with_globals(int version, int quiet, const void* a,
+        const void* b, void* result) {
+    struct cscContext ctx;
+    csc_context_from_globals(&ctx);
+    if (quiet) ctx.logLevel = CSC_LOG_ERROR;
+    errno = csc_status_errno(mul_csc_ctx(&ctx, version, a, b, result));
+}
+
+void matr_mult_csc(const void* a, const void* b, void* result) {
+    mul_with_globals(0, 0, a, b, result);
+}
+
+void matr_mult_csc_V1(const void* a, const void* b, void* result) {
+    mul_with_globals(1, 0, a, b, result);
+}
+
+void matr_mult_csc_V2(const void* a, const void* b, void* result) {
+    mul_with_globals(2, 0, a, b, result);
+}
+
+static void matr_mult_csc_quiet(const void* a, const void* b, void* result) {
+    mul_with_globals(0, 1, a, b, result);
+}
+
+static void matr_mult_csc_V1_quiet(const void* a, const void* b,
+        void* result) {
+    mul_with_globals(1, 1, a, b, result);
+}
+
+static void matr_mult_csc_V2_quiet(const void* a, const void* b,
+        void* result) {
+    mul_with_globals(2, 1, a, b, result);
 }
 
+void (*const quietKernels[3])(const void*, const void*, void*) = {
+    matr_mult_csc_quiet, matr_mult_csc_V1_quiet, matr_mult_csc_V2_quiet};
@@ -5,6 +5,9 @@
 #include "radixsort.h"
 #include "cs_matrix.h"
 #include "transpose.h"
+#include "csc_context.h"
+#include "csc_pool.h"
+#include "csc_trace.h"
 
 /**
  * Computes the column pointers using the row pointers of a CSC matrix
@@ -30,38 +33,187 @@ int computeColPtr(uint64_t* indices, uint64_t* dest, uint64_t numCols, uint64_t
 }
 
 /**
- * Transposes a given CSC matrix
- * @param a     matrix to transpose
- * @param a_t   transposed matrix
- * @return
+ * Allocates the members of the transpose of a and transposes it with the
+ * threads of ctx.
  */
-int transpose(struct cscMatrixTranspose* a, struct cscMatrix* a_t) {
+static int transpose_alloc(const struct cscContext* ctx,
+        const struct cscMatrix* a, struct cscMatrix* a_t) {
     a_t->valueCount = a->valueCount;
     a_t->rows = a->columns;
     a_t->columns = a->rows;
-    a_t->values = malloc((a_t->valueCount) * sizeof(float));
-    a_t->rowIndices = malloc((a_t->valueCount) * sizeof(uint64_t));
-    a_t->colPtr = malloc((a_t->columns+1) * sizeof(uint64_t));
+    a_t->values = a->valueCount ? malloc(a->valueCount * sizeof(float)) : 0;
+    a_t->rowIndices = a->valueCount 
+        ? malloc(a->valueCount * sizeof(uint64_t)) : 0;
+    // Two extra entries: the row counts are stored shifted by two, so that
+    // after the prefix sum colPtr[r+1] is the insertion cursor of row r.
+    a_t->colPtr = calloc(a_t->columns + 2, sizeof(uint64_t));
 
-    if (!a_t->values || !a_t->rowIndices || !a_t->colPtr) {
+    if ((a->valueCount && (!a_t->values || !a_t->rowIndices)) 
+            || !a_t->colPtr) {
         free(a_t->values);
         free(a_t->rowIndices);
         free(a_t->colPtr);
+        a_t->values = 0;
+        a_t->rowIndices = 0;
+        a_t->colPtr = 0;
         errno = ENOMEM;
         return 0;
     }
-    for (uint64_t i = 0; i < a_t->valueCount; ++i) {
-        a_t->values[i] = a->values[i];
-        a_t->rowIndices[i] = a->colIndices[i];
+
+    transpose_csc_ctx(ctx, a, a_t);
+    return 1;
+}
+
+int transpose_csc(const struct cscMatrix* a, struct cscMatrix* a_t) {
+    struct cscContext ctx;
+    csc_context_init(&ctx);
+    return transpose_alloc(&ctx, a, a_t);
+}
+
+int transpose_csc_mt(const struct cscMatrix* a, struct cscMatrix* a_t,
+        unsigned threads) {
+    struct cscContext ctx;
+    csc_context_init(&ctx);
+    ctx.pool = csc_shared_pool(threads);
+    return transpose_alloc(&ctx, a, a_t);
+}
+
+void transpose_csc_into(const struct cscMatrix* a, struct cscMatrix* a_t) {
+    TRACE_BEGIN(t);
+    a_t->valueCount = a->valueCount;
+    a_t->rows = a->columns;
+    a_t->columns = a->rows;
+    for (uint64_t i = 0; i < a->valueCount; ++i) {
+        a_t->colPtr[a->rowIndices[i] + 2]++;
+    }
+    for (uint64_t i = 2; i < a_t->columns + 1; ++i) {
+        a_t->colPtr[i] += a_t->colPtr[i - 1];
+    }
+    for (uint64_t j = 0; j < a->columns; ++j) {
+        for (uint64_t k = a->colPtr[j]; k < a->colPtr[j + 1]; ++k) {
+            uint64_t dest = a_t->colPtr[a->rowIndices[k] + 1]++;
+            a_t->values[dest] = a->values[k];
+            a_t->rowIndices[dest] = j;
+        }
     }
+    TRACE_END(t, "transpose");
+}
 
-    errno = 0;
-    radixSort(a->rowIndices, a_t->values, a_t->rowIndices, a_t->valueCount);
-    if (errno == ENOMEM) {
-        return 0;
+/**
+ * @class transposeSlice
+ *
+ * Consecutive columns of the matrix a parallel transpose works on
+ *
+ * @member a        The matrix to transpose
+ * @member a_t      The transposed matrix
+ * @member first    First column of the slice
+ * @member end      Column after the slice
+ * @member hist     a->rows counters of the slice: first the amount of values
+ *                  in every row, then the position of the next one
+ * @member slices   All slices, used by the prefix sum
+ * @member n        Amount of slices
+ */
+struct transposeSlice {
+    const struct cscMatrix* a;
+    struct cscMatrix* a_t;
+    uint64_t first;
+    uint64_t end;
+    uint64_t* hist;
+    struct transposeSlice* slices;
+    unsigned n;
+};
+
+static void* count_slice_rows(void* arg) {
+    struct transposeSlice* s = arg;
+    const struct cscMatrix* a = s->a;
+    for (uint64_t k = a->colPtr[s->first]; k < a->colPtr[s->end]; k++) {
+        s->hist[a->rowIndices[k]]++;
+    }
+    return 0;
+}
+
+// Stores the amount of values of every row in colPtr[row + 1]
+static void sum_row_counts(uint64_t begin, uint64_t end, void* arg) {
+    struct transposeSlice* slices = arg;
+    for (uint64_t r = begin; r < end; r++) {
+        uint64_t count = 0;
+        for (unsigned t = 0; t < slices->n; t++) count += slices[t].hist[r];
+        slices->a_t->colPtr[r + 1] = count;
     }
+}
 
-    computeColPtr(a->rowIndices, a_t->colPtr, a_t->columns, a->valueCount);
-    return 1;
+// Replaces the counts of every row by the position of the slices' values
+static void place_row_counts(uint64_t begin, uint64_t end, void* arg) {
+    struct transposeSlice* slices = arg;
+    for (uint64_t r = begin; r < end; r++) {
+        uint64_t pos = slices->a_t->colPtr[r];
+        for (unsigned t = 0; t < slices->n; t++) {
+            uint64_t count = slices[t].hist[r];
+            slices[t].hist[r] = pos;
+            pos += count;
+        }
+    }
+}
+
+static void* scatter_slice(void* arg) {
+    struct transposeSlice* s = arg;
+    const struct cscMatrix* a = s->a;
+    for (uint64_t j = s->first; j < s->end; ++j) {
+        for (uint64_t k = a->colPtr[j]; k < a->colPtr[j + 1]; ++k) {
+            uint64_t dest = s->hist[a->rowIndices[k]]++;
+            s->a_t->values[dest] = a->values[k];
+            s->a_t->rowIndices[dest] = j;
+        }
+    }
+    return 0;
 }
 
+void transpose_csc_ctx(const struct cscContext* ctx, const struct cscMatrix* a,
+        struct cscMatrix* a_t) {
+    unsigned n = csc_pool_threads(ctx->pool);
+    uint64_t histSize;
+    if (n < 2 || a->columns < n || __builtin_umull_overflow(n, a->rows,
+                &histSize) || histSize > a->valueCount) {
+        transpose_csc_into(a, a_t);
+        return;
+    }
+    uint64_t* hist = csc_calloc(ctx, histSize, sizeof(uint64_t));
+    struct transposeSlice* slices = csc_malloc(ctx, n * sizeof(*slices));
+    if (!hist || !slices) {
+        csc_free(ctx, hist);
+        csc_free(ctx, slices);
+        transpose_csc_into(a, a_t);
+        return;
+    }
+    TRACE_BEGIN(t);
+    a_t->valueCount = a->valueCount;
+    a_t->rows = a->columns;
+    a_t->columns = a->rows;
+
+    // The slices hold about the same amount of values
+    uint64_t first = 0;
+    for (unsigned i = 0; i < n; i++) {
+        uint64_t target = a->valueCount / n * (i + 1);
+        uint64_t end = first;
+        if (i == n - 1) {
+            end = a->columns;
+        } else {
+            while (end < a->columns && a->colPtr[end] < target) end++;
+        }
+        slices[i] = (struct transposeSlice) {a, a_t, first, end,
+            hist + i * a->rows, slices, n};
+        first = end;
+    }
+
+    csc_pool_run(ctx->pool, slices, sizeof(*slices), n, count_slice_rows);
+    csc_pool_for(ctx->pool, a->rows, 0, sum_row_counts, slices);
+    a_t->colPtr[0] = 0;
+    for (uint64_t r = 0; r < a->rows; r++) {
+        a_t->colPtr[r + 1] += a_t->colPtr[r];
+    }
+    csc_pool_for(ctx->pool, a->rows, 0, place_row_counts, slices);
+    csc_pool_run(ctx->pool, slices, sizeof(*slices), n, scatter_slice);
+    csc_free(ctx, hist);
+    csc_free(ctx, slices);
+    TRACE_END(t, "transpose");
+}
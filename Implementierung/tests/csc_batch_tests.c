@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "cs_matrix.h"
+#include "csc_batch.h"
+#include "csc_batch_tests.h"
+#include "csc_binary.h"
+#include "csc_gen.h"
+#include "csc_io.h"
+#include "csc_model.h"
+#include "csc_writer.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+
+// Loads a result of the batch and compares it with the expected one
+static int expect_result(const char* filename, struct cscMatrix* expected) {
+    struct cscFile f;
+    errno = 0;
+    load_csc_file(filename, &f, 0, 1);
+    if (errno) return 0;
+    int res = cmp_csc_eq(&f.matrix, expected);
+    release_csc_file(&f);
+    return res;
+}
+
+// Writes a manifest, returns 1 if successful
+static int write_manifest(const char* filename, const char* contents) {
+    FILE* file = fopen(filename, "w");
+    if (!file) return 0;
+    int res = fputs(contents, file) >= 0;
+    return !fclose(file) && res;
+}
+
+int test_csc_batch(uint64_t size, double density, unsigned threads) {
+    char prefix[64], fileA[80], fileB[80], manifest[80], contents[1024];
+    char outputs[3][80];
+    snprintf(prefix, sizeof(prefix), "/tmp/csc_batch_%d", (int) getpid());
+    snprintf(fileA, sizeof(fileA), "%s_a.txt", prefix);
+    snprintf(fileB, sizeof(fileB), "%s_b.bin", prefix);
+    snprintf(manifest, sizeof(manifest), "%s.manifest", prefix);
+    snprintf(outputs[0], sizeof(outputs[0]), "%s_c0.txt", prefix);
+    snprintf(outputs[1], sizeof(outputs[1]), "%s_c1.mtx", prefix);
+    snprintf(outputs[2], sizeof(outputs[2]), "%s_c2.txt", prefix);
+
+    struct cscMatrix a = {0}, a_t = {0}, b = {0}, expected = {0};
+    errno = 0;
+    int res = generate_family(&a, FAMILY_UNIFORM, size, size + 3, density, 31,
+            1) && generate_family(&b, FAMILY_UNIFORM, size + 3, size - 5,
+                density, 32, 1) && transpose_csc(&a, &a_t)
+        && write_csc_text(&a, fileA, 0) && write_csc_binary(&b, 0, fileB);
+    if (res) {
+        matr_mult_csc(&a_t, &b, &expected);
+        res = !errno;
+    }
+
+    // Two valid jobs, a missing input and mismatched dimensions
+    snprintf(contents, sizeof(contents), "# Nightly products\n\n"
+            "%s %s %s\n  %s\t%s %s\n%s_missing.txt %s %s\n%s %s %s\n", fileA,
+            fileB, outputs[0], fileA, fileB, outputs[1], prefix, fileB,
+            outputs[2], fileA, fileA, outputs[2]);
+    struct batchJob* jobs = 0;
+    unsigned count = 0;
+    res = res && write_manifest(manifest, contents)
+        && read_batch_manifest(manifest, &jobs, &count) && count == 4
+        && jobs[0].line == 3 && jobs[1].line == 4
+        && !strcmp(jobs[1].output, outputs[1]);
+
+    int versions[] = {0, VERSION_AUTO};
+    for (unsigned i = 0; res && i < 2; i++) {
+        struct batchConfig config = {versions[i], threads, 0, 0, 0};
+        struct batchStats stats;
+        res = run_batch(jobs, count, &config, &stats) && stats.jobs == 4
+            && stats.failed == 2 && stats.resultValues
+            == 2 * expected.valueCount && stats.inputBytes > 0
+            && stats.outputBytes > 0 && stats.busy[BATCH_MULTIPLY] >= 0
+            && expect_result(outputs[0], &expected)
+            && expect_result(outputs[1], &expected)
+            && access(outputs[2], F_OK);
+        remove(outputs[0]);
+        remove(outputs[1]);
+    }
+    if (jobs) free_batch_jobs(jobs, count);
+
+    // A line without the result is rejected
+    snprintf(contents, sizeof(contents), "%s %s %s\n%s %s\n", fileA, fileB,
+            outputs[0], fileA, fileB);
+    res = res && write_manifest(manifest, contents)
+        && !read_batch_manifest(manifest, &jobs, &count);
+
+    printf("\ntest_csc_batch: %s\n", res ? "Test passed." : "Test failed.");
+    remove(manifest);
+    remove(fileA);
+    remove(fileB);
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    free_csc_members(&expected);
+    return res;
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_bench.h"
+#include "csc_bench_tests.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+
+static int close_to(double a, double b) {
+    double d = a - b;
+    return d < 1e-9 && d > -1e-9;
+}
+
+int test_summarize_samples() {
+    // 1 to 100 in shuffled order
+    double samples[100];
+    for (unsigned i = 0; i < 100; i++) samples[i] = i + 1;
+    for (unsigned i = 100; i > 1; i--) {
+        unsigned k = rand() % i;
+        double tmp = samples[i - 1];
+        samples[i - 1] = samples[k];
+        samples[k] = tmp;
+    }
+    struct benchSummary s;
+    int res = summarize_samples(samples, 100, &s) && s.count == 100
+        && s.min == 1 && s.max == 100 && s.median == 50.5 && s.p90 == 90
+        && s.p99 == 99 && s.mean == 50.5
+        && close_to(s.stddev, 29.011491975882016);
+
+    double ten[] = {7, 3, 10, 1, 9, 2, 8, 4, 6, 5};
+    res = res && summarize_samples(ten, 10, &s) && s.median == 5.5
+        && s.p90 == 9 && s.p99 == 10;
+
+    double one = 0.25;
+    res = res && summarize_samples(&one, 1, &s) && s.median == 0.25
+        && s.p90 == 0.25 && s.p99 == 0.25 && s.stddev == 0;
+
+    res = res && !summarize_samples(samples, 0, &s) && errno == EINVAL;
+
+    printf("\ntest_summarize_samples: %s\n", res ? "Test passed."
+            : "Test failed.");
+    return res;
+}
+
+int test_bench_kernel(uint64_t minSize, uint64_t maxSize) {
+    void (*kernels[])(const void*, const void*, void*) = {matr_mult_csc,
+        matr_mult_csc_V1, matr_mult_csc_V2};
+    struct cscMatrix a = {0}, a_t = {0}, b = {0};
+    uint64_t diff = maxSize - minSize + 1;
+    a.rows = minSize + rand() % diff;
+    a.columns = b.rows = minSize + rand() % diff;
+    b.columns = minSize + rand() % diff;
+    errno = 0;
+    generate_csc_matr_rand(&a, 10, 3);
+    generate_csc_matr_rand(&b, 10, 3);
+    int res = !errno && transpose_csc(&a, &a_t);
+
+    struct benchConfig config = {2, 5, 1};
+    double samples[5];
+    for (int v = 0; res && v < 3; v++) {
+        struct cscMatrix expected = {0}, result = {0};
+        const struct cscMatrix* factor = v == 2 ? &a : &a_t;
+        errno = 0;
+        kernels[v](factor, &b, &expected);
+        res = !errno && bench_kernel(kernels[v], factor, &b, &config,
+                samples, &result);
+        res = res && cmp_csc_eq(&expected, &result);
+        for (unsigned i = 0; res && i < config.iterations; i++) {
+            res = samples[i] > 0;
+        }
+        free_csc_members(&expected);
+        free_csc_members(&result);
+    }
+
+    printf("\ntest_bench_kernel: %lu by %lu times %lu by %lu matrix. %s\n",
+            a.rows, a.columns, b.rows, b.columns, res ? "Test passed."
+            : "Test failed.");
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    return res;
+}
+
+int test_mul_metrics(uint64_t size) {
+    struct cscMatrix a = {0}, a_t = {0}, b = {0}, c = {0};
+    a.rows = a.columns = b.rows = b.columns = size;
+    errno = 0;
+    generate_csc_matr_rand(&a, 10, 3);
+    generate_csc_matr_rand(&b, 10, 3);
+    int res = !errno && transpose_csc(&a, &a_t);
+    if (res) {
+        matr_mult_csc_V2(&a, &b, &c);
+        res = !errno;
+    }
+
+    // Every value B(k, j) is multiplied with every value of column k of A
+    uint64_t products = 0;
+    for (uint64_t k = 0; res && k < a.columns; k++) {
+        uint64_t column = a.colPtr[k + 1] - a.colPtr[k];
+        for (uint64_t j = 0; j < b.valueCount; j++) {
+            if (b.rowIndices[j] == k) products += column;
+        }
+    }
+
+    struct mulMetrics m, mt;
+    res = res && mul_metrics(&a, &b, 0, &c, &m)
+        && mul_metrics(&a_t, &b, 1, &c, &mt);
+    res = res && m.products == products && mt.products == products
+        && m.flops == 2 * products && m.valueCount == c.valueCount
+        && mt.bytes == m.bytes && m.bytes == csc_matrix_bytes(&a)
+        + csc_matrix_bytes(&b) + csc_matrix_bytes(&c);
+    // Every value of the result is the sum of at least one product
+    res = res && (c.valueCount ? m.compression >= 1
+            && close_to(m.compression, (double) products / c.valueCount)
+            : m.compression == 0);
+
+    printf("\ntest_mul_metrics: %lu products into %lu values. %s\n",
+            products, c.valueCount, res ? "Test passed." : "Test failed.");
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    free_csc_members(&c);
+    return res;
+}
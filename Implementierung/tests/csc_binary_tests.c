@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_binary.h"
+#include "csc_mtx.h"
+#include "csc_binary_tests.h"
+#include "transpose.h"
+
+static int is_aligned(const void* p) {
+    return !((uintptr_t) p % CSC_BINARY_ALIGNMENT);
+}
+
+/**
+ * Loads a binary file and compares it with the expected matrix.
+ *
+ * @param zeroCopy  Nonzero if the matrix must point into the mapping
+ */
+static int check_load(const char* filename, int transpose,
+        struct cscMatrix* expected, int zeroCopy) {
+    struct cscFile f;
+    load_csc_file(filename, &f, transpose, 1);
+    if (errno) return 0;
+    int res = cmp_csc_eq(&f.matrix, expected)
+        && (f.mapping.data != 0) == (zeroCopy != 0)
+        && (!zeroCopy || (is_aligned(f.matrix.colPtr)
+                    && is_aligned(f.matrix.rowIndices)
+                    && is_aligned(f.matrix.values)));
+    release_csc_file(&f);
+    return res;
+}
+
+int test_binary_roundtrip(uint64_t minSize, uint64_t maxSize) {
+    const char* filename = "testMatrix.bin";
+    const char* filenameT = "testMatrixT.bin";
+    struct cscMatrix matrix = {0}, matrix_t = {0};
+    uint64_t diff = maxSize - minSize + 1;
+    matrix.rows = minSize + rand() % diff;
+    matrix.columns = minSize + rand() % diff;
+    errno = 0;
+    generate_csc_matr_rand(&matrix, 10, 3);
+    if (errno || !transpose_csc(&matrix, &matrix_t)) {
+        free_csc_members(&matrix);
+        return 0;
+    }
+
+    int res = write_csc_binary(&matrix, 0, filename)
+        && write_csc_binary(&matrix_t, 1, filenameT)
+        && is_csc_binary(filename)
+        && check_load(filename, 0, &matrix, 1)
+        && check_load(filename, 1, &matrix_t, 0)
+        && check_load(filenameT, 1, &matrix_t, 1)
+        && check_load(filenameT, 0, &matrix, 0);
+    remove(filename);
+    remove(filenameT);
+
+    printf("\ntest_binary_roundtrip: %lu by %lu matrix. %s\n", matrix.rows,
+            matrix.columns, res ? "Test passed." : "Test failed.");
+    free_csc_members(&matrix);
+    free_csc_members(&matrix_t);
+    return res;
+}
+
+/**
+ * Flips a byte of a file at the given offset.
+ */
+static void flip_byte(const char* filename, long offset) {
+    FILE* file = fopen(filename, "r+b");
+    if (!file) return;
+    fseek(file, offset, SEEK_SET);
+    int c = fgetc(file);
+    fseek(file, offset, SEEK_SET);
+    fputc(c ^ 0x10, file);
+    fclose(file);
+}
+
+int test_binary_corrupt() {
+    const char* filename = "testCorrupt.bin";
+    uint64_t colPtr[] = {0, 1, 3};
+    uint64_t rowIndices[] = {1, 0, 1};
+    float values[] = {1.5f, 2.0f, -3.25f};
+    struct cscMatrix matrix;
+    generate_csc_matr(&matrix, 2, 2, 3, rowIndices, colPtr, values);
+    struct cscFile f;
+
+    int res = write_csc_binary(&matrix, 0, filename);
+    flip_byte(filename, offsetof(struct cscBinaryHeader, valuesOffset));
+    errno = 0;
+    map_csc_binary(filename, &f, 0);
+    res &= errno == EINVAL;
+
+    res &= write_csc_binary(&matrix, 0, filename);
+    // The padded header and the two index arrays take 128, 64 and 64 bytes
+    flip_byte(filename, 128 + 64 + 64);
+    errno = 0;
+    map_csc_binary(filename, &f, 0);
+    // Without verification the values are not read
+    res &= errno == 0 && f.matrix.values[0] != values[0];
+    release_csc_file(&f);
+    errno = 0;
+    map_csc_binary(filename, &f, 1);
+    res &= errno == EINVAL && !f.mapping.data;
+
+    // A row index beyond the rows is rejected without verification, and
+    // load_csc_file does not hand it to the kernels
+    res &= write_csc_binary(&matrix, 0, filename);
+    flip_byte(filename, 128 + 64 + 7);
+    errno = 0;
+    map_csc_binary(filename, &f, 0);
+    res &= errno == EINVAL && !f.mapping.data;
+    errno = 0;
+    load_csc_file(filename, &f, 1, 1);
+    res &= errno == EINVAL && !f.matrix.rowIndices;
+    remove(filename);
+
+    printf("\ntest_binary_corrupt: %s\n", res ? "Test passed." : "Test failed.");
+    return res;
+}
+
+int test_binary_convert() {
+    const char* text = "testConvert.txt";
+    const char* binary = "testConvert.bin";
+    const char* result = "testConvertResult.txt";
+    struct cscMatrix matrix = {0};
+    matrix.rows = 1 + rand() % 50;
+    matrix.columns = 1 + rand() % 50;
+    errno = 0;
+    generate_csc_matr_rand(&matrix, 10, 3);
+    if (errno) return 0;
+    result_to_file(&matrix, text);
+
+    struct cscFile f = {0};
+    errno = 0;
+    int res = convert_text_to_binary(text, binary, 1, 1)
+        && convert_binary_to_text(binary, result);
+    if (res) {
+        load_csc_file(result, &f, 0, 1);
+        res = !errno && cmp_csc_eq(&f.matrix, &matrix);
+        release_csc_file(&f);
+    }
+    remove(text);
+    remove(binary);
+    remove(result);
+
+    printf("\ntest_binary_convert: %s\n", res ? "Test passed." : "Test failed.");
+    free_csc_members(&matrix);
+    return res;
+}
+
+int test_load_csc_files(unsigned threads) {
+    const char* filesA[] = {"testLoadA.txt", "testLoadA.bin", "testLoadA.mtx"};
+    const char* filesB[] = {"testLoadB.txt", "testLoadB.bin", "testLoadB.mtx"};
+    struct cscMatrix a = {0}, a_t = {0}, b = {0};
+    a.rows = 1 + rand() % 100;
+    a.columns = b.rows = 1 + rand() % 100;
+    b.columns = 1 + rand() % 100;
+    errno = 0;
+    generate_csc_matr_rand(&a, 10, 3);
+    generate_csc_matr_rand(&b, 10, 3);
+    int res = !errno && transpose_csc(&a, &a_t);
+    if (res) {
+        result_to_file(&a, filesA[0]);
+        result_to_file(&b, filesB[0]);
+        res = !errno && write_csc_binary(&a, 0, filesA[1])
+            && write_csc_binary(&b, 0, filesB[1])
+            && write_mtx_file(&a, filesA[2], 0)
+            && write_mtx_file(&b, filesB[2], 0);
+    }
+
+    for (int i = 0; res && i < 9; i++) {
+        struct cscFile fileA, fileB;
+        struct loadStats stats;
+        errno = 0;
+        load_csc_files(filesA[i / 3], filesB[i % 3], &fileA, &fileB, 1,
+                threads, 0, &stats);
+        if (errno) {
+            res = 0;
+            break;
+        }
+        res = cmp_csc_eq(&fileA.matrix, &a_t) && fileA.transposed
+            && cmp_csc_eq(&fileB.matrix, &b) && stats.concurrent;
+        release_csc_file(&fileA);
+        release_csc_file(&fileB);
+    }
+
+    // A times A only fits for square matrices
+    if (res && a.rows != a.columns) {
+        struct cscFile fileA, fileB;
+        errno = 0;
+        load_csc_files(filesA[0], filesA[1], &fileA, &fileB, 1, threads, 0,
+                0);
+        res = errno == EINVAL && !fileA.matrix.colPtr && !fileB.matrix.colPtr;
+    }
+    // A missing input and a directory are reported with their own errno
+    const char* unreadable[] = {"testLoadMissing.txt", "."};
+    const int errors[] = {ENOENT, EISDIR};
+    for (int i = 0; res && i < 4; i++) {
+        struct cscFile fileA, fileB;
+        errno = 0;
+        load_csc_files(i < 2 ? unreadable[i] : filesA[0],
+                i < 2 ? filesB[0] : unreadable[i - 2], &fileA, &fileB, 1,
+                threads, 0, 0);
+        res = errno == errors[i % 2] && !fileA.matrix.colPtr
+            && !fileB.matrix.colPtr;
+    }
+    for (int i = 0; i < 3; i++) {
+        remove(filesA[i]);
+        remove(filesB[i]);
+    }
+
+    printf("\ntest_load_csc_files: %lu by %lu times %lu by %lu matrix with %u "
+            "threads. %s\n", a.rows, a.columns, b.rows, b.columns, threads,
+            res ? "Test passed." : "Test failed.");
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    return res;
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_binary.h"
+#include "csc_cache.h"
+#include "csc_cache_tests.h"
+#include "transpose.h"
+
+/**
+ * Loads a file through the cache and compares it with the expected matrix.
+ *
+ * @return  1 if the matrix matches and hit equals expectHit, 0 otherwise
+ */
+static int check_load(const char* filename, int transpose,
+        const struct cscCache* cache, struct cscMatrix* expected,
+        int expectHit) {
+    struct cscFile f;
+    int hit;
+    errno = 0;
+    load_csc_file_cached(filename, &f, transpose, 2, cache, &hit);
+    if (errno) return 0;
+    int res = hit == expectHit && f.transposed == (transpose != 0)
+        && cmp_csc_eq(&f.matrix, expected);
+    release_csc_file(&f);
+    return res;
+}
+
+// Removes a cache file
+static void remove_cache_file(const struct cscCache* cache, uint64_t key) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%016lx.bin", cache->dir, key);
+    remove(path);
+}
+
+// Flips a byte of the values of a cache file
+static void damage_cache_file(const struct cscCache* cache, uint64_t key) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%016lx.bin", cache->dir, key);
+    FILE* file = fopen(path, "r+b");
+    if (!file) return;
+    struct cscBinaryHeader h;
+    if (fread(&h, sizeof(h), 1, file) == 1
+            && !fseek(file, h.valuesOffset, SEEK_SET)) {
+        int c = fgetc(file);
+        fseek(file, h.valuesOffset, SEEK_SET);
+        fputc(c ^ 0x10, file);
+    }
+    fclose(file);
+}
+
+int test_csc_cache(int hashContents) {
+    const char* filename = "testCache.txt";
+    struct cscCache cache = {"testCacheDir", hashContents};
+    struct cscMatrix m[2] = {{0}}, m_t[2] = {{0}};
+    int res = 1;
+    errno = 0;
+    for (int i = 0; res && i < 2; i++) {
+        m[i].rows = 1 + rand() % 100;
+        m[i].columns = 1 + rand() % 100;
+        generate_csc_matr_rand(&m[i], 10, 3);
+        res = !errno && transpose_csc(&m[i], &m_t[i]);
+    }
+
+    uint64_t keys[2] = {0, 0};
+    if (res) {
+        result_to_file(&m[0], filename);
+        res = !errno && csc_cache_key(&cache, filename, 0, &keys[0])
+            && csc_cache_key(&cache, filename, 1, &keys[1])
+            && keys[0] != keys[1];
+    }
+    // First loads miss and fill the cache, the second ones are hits
+    for (int pass = 0; res && pass < 2; pass++) {
+        res = check_load(filename, 0, &cache, &m[0], pass)
+            && check_load(filename, 1, &cache, &m_t[0], pass);
+    }
+
+    // A damaged cache file is parsed again and replaced
+    if (res && m[0].valueCount) {
+        damage_cache_file(&cache, keys[0]);
+        res = check_load(filename, 0, &cache, &m[0], 0)
+            && check_load(filename, 0, &cache, &m[0], 1);
+    }
+
+    // The stale cache files of the old contents must not be used
+    uint64_t newKey = keys[0];
+    if (res) {
+        // Keeps the modification time from being equal on coarse clocks
+        if (!hashContents) usleep(10000);
+        result_to_file(&m[1], filename);
+        res = !errno && csc_cache_key(&cache, filename, 0, &newKey)
+            && newKey != keys[0]
+            && check_load(filename, 0, &cache, &m[1], 0)
+            && check_load(filename, 0, &cache, &m[1], 1);
+    }
+    remove_cache_file(&cache, keys[0]);
+    remove_cache_file(&cache, keys[1]);
+    if (newKey != keys[0]) remove_cache_file(&cache, newKey);
+    remove(filename);
+    rmdir(cache.dir);
+
+    printf("\ntest_csc_cache: %s keys. %s\n", hashContents ? "content"
+            : "metadata", res ? "Test passed." : "Test failed.");
+    for (int i = 0; i < 2; i++) {
+        free_csc_members(&m[i]);
+        free_csc_members(&m_t[i]);
+    }
+    return res;
+}
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "cs_matrix.h"
+#include "csc_daemon.h"
+#include "csc_daemon_tests.h"
+#include "csc_binary.h"
+#include "csc_gen.h"
+#include "csc_io.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+
+/**
+ * @class daemonThread
+ *
+ * Arguments and result of run_daemon on its own thread
+ */
+struct daemonThread {
+    const char* socketPath;
+    int res;
+};
+
+static void* run_daemon_thread(void* arg) {
+    struct daemonThread* t = arg;
+    t->res = run_daemon(t->socketPath, 2, 0);
+    return 0;
+}
+
+// Connects to the daemon, waiting up to two seconds for it to start
+static int connect_daemon(const char* socketPath) {
+    struct timespec wait = {0, 10000000};
+    for (int i = 0; i < 200; i++) {
+        int fd = daemon_connect(socketPath);
+        if (fd >= 0) return fd;
+        nanosleep(&wait, 0);
+    }
+    return -1;
+}
+
+// Sends a request and checks whether it succeeds as expected
+static int expect(int fd, const char* request, int success) {
+    char response[CSC_DAEMON_LINE_LENGTH];
+    return daemon_request(fd, request, response, sizeof(response)) == success
+        && !strncmp(response, success ? "ok" : "error", success ? 2 : 5);
+}
+
+// Fetches a matrix and compares it with the expected one
+static int expect_matrix(int fd, const char* name, const char* filename,
+        struct cscMatrix* expected) {
+    char request[CSC_DAEMON_LINE_LENGTH];
+    snprintf(request, sizeof(request), "fetch %s %s", name, filename);
+    struct cscFile f;
+    errno = 0;
+    int res = expect(fd, request, 1) && (map_csc_binary(filename, &f, 1),
+            !errno);
+    if (res) {
+        res = cmp_csc_eq(&f.matrix, expected);
+        release_csc_file(&f);
+    }
+    remove(filename);
+    return res;
+}
+
+// Leaves a socket file behind like a daemon that was killed
+static int create_stale_socket(const char* socketPath) {
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+    int res = !bind(fd, (struct sockaddr*) &addr, sizeof(addr));
+    close(fd);
+    return res;
+}
+
+int test_csc_daemon(uint64_t size, double density) {
+    char socketPath[64], fileA[64], fileB[64], fileC[64];
+    snprintf(socketPath, sizeof(socketPath), "/tmp/csc_daemon_%d.sock",
+            (int) getpid());
+    snprintf(fileA, sizeof(fileA), "/tmp/csc_daemon_%d_a.bin", (int) getpid());
+    snprintf(fileB, sizeof(fileB), "/tmp/csc_daemon_%d_b.bin", (int) getpid());
+    snprintf(fileC, sizeof(fileC), "/tmp/csc_daemon_%d_c.bin", (int) getpid());
+
+    struct cscMatrix a = {0}, a_t = {0}, b = {0}, expected = {0};
+    errno = 0;
+    int res = generate_family(&a, FAMILY_UNIFORM, size, size + 3, density, 21,
+            1) && generate_family(&b, FAMILY_UNIFORM, size + 3, size - 5,
+                density, 22, 1) && transpose_csc(&a, &a_t)
+        && write_csc_binary(&a, 0, fileA) && write_csc_binary(&b, 0, fileB);
+    if (res) {
+        matr_mult_csc(&a_t, &b, &expected);
+        res = !errno;
+    }
+
+    // A regular file in the place of the socket is not removed
+    FILE* file = res ? fopen(socketPath, "w") : 0;
+    res = file && !fclose(file);
+    errno = 0;
+    res = res && !run_daemon(socketPath, 1, 0) && errno == EADDRINUSE
+        && !remove(socketPath);
+
+    // The socket of a killed daemon is replaced
+    res = res && create_stale_socket(socketPath);
+    struct daemonThread daemon = {socketPath, 0};
+    pthread_t tid;
+    int started = res && !pthread_create(&tid, 0, run_daemon_thread, &daemon);
+    int fd = started ? connect_daemon(socketPath) : -1;
+    res = res && fd >= 0;
+
+    // The socket of a running daemon is not taken over
+    errno = 0;
+    res = res && !run_daemon(socketPath, 1, 0) && errno == EADDRINUSE
+        && !access(socketPath, F_OK);
+
+    char request[CSC_DAEMON_LINE_LENGTH];
+    snprintf(request, sizeof(request), "load A %s", fileA);
+    res = res && expect(fd, request, 1);
+    snprintf(request, sizeof(request), "load B %s", fileB);
+    res = res && expect(fd, request, 1);
+
+    // Every version, the transpose of A is computed once and reused
+    const char* products[] = {"mul C0 A B 0", "mul C1 A B 1", "mul C2 A B 2",
+        "mul C A B", "mul C0 A B 0"};
+    for (unsigned i = 0; i < sizeof(products) / sizeof(*products); i++) {
+        res = res && expect(fd, products[i], 1);
+    }
+    const char* names[] = {"C0", "C1", "C2", "C"};
+    for (unsigned i = 0; i < 4; i++) {
+        res = res && expect_matrix(fd, names[i], fileC, &expected);
+    }
+
+    // Invalid requests
+    res = res && expect(fd, "mul X A A", 0) && expect(fd, "mul X A Y", 0)
+        && expect(fd, "mul X A B 3", 0) && expect(fd, "load X", 0)
+        && expect(fd, "load X /nonexistent/file", 0) && expect(fd, "", 0)
+        && expect(fd, "unknown", 0);
+
+    // A second connection sees the matrices, dropped ones are gone
+    int second = res ? connect_daemon(socketPath) : -1;
+    res = res && second >= 0 && expect(second, "drop C1", 1)
+        && expect(second, "drop C1", 0) && expect(fd, "fetch C1 /tmp/x", 0);
+    char response[CSC_DAEMON_LINE_LENGTH];
+    res = res && daemon_request(second, "list", response, sizeof(response))
+        && !strncmp(response, "ok 5 ", 5);
+    if (second >= 0) close(second);
+
+    res = res && expect(fd, "shutdown", 1);
+    if (fd >= 0) close(fd);
+    if (started) {
+        pthread_join(tid, 0);
+        res = res && daemon.res && access(socketPath, F_OK);
+    }
+
+    printf("\ntest_csc_daemon: %s\n", res ? "Test passed." : "Test failed.");
+    remove(fileA);
+    remove(fileB);
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    free_csc_members(&expected);
+    return res;
+}
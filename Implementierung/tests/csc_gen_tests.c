@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_gen.h"
+#include "csc_gen_tests.h"
+
+// Checks the row order and the values of a generated matrix
+static int check_generated(struct cscMatrix* m) {
+    if (is_valid_csc(m) != 1) return 0;
+    for (uint64_t j = 0; j < m->columns; j++) {
+        for (uint64_t i = m->colPtr[j]; i < m->colPtr[j + 1]; i++) {
+            if (i > m->colPtr[j] && m->rowIndices[i - 1] >= m->rowIndices[i]) {
+                return 0;
+            }
+            if (m->values[i] < 1 || m->values[i] > 8
+                    || m->values[i] != (int) m->values[i]) return 0;
+        }
+    }
+    return 1;
+}
+
+// Variance of the amount of values of the columns of a matrix
+static double column_variance(const struct cscMatrix* m) {
+    double mean = (double) m->valueCount / m->columns, sum = 0;
+    for (uint64_t j = 0; j < m->columns; j++) {
+        double d = (m->colPtr[j + 1] - m->colPtr[j]) - mean;
+        sum += d * d;
+    }
+    return sum / m->columns;
+}
+
+int test_generate_family(uint64_t rows, uint64_t columns, double density) {
+    int res = 1;
+    uint64_t seed = rand();
+    for (int f = 0; res && f < FAMILY_COUNT; f++) {
+        struct cscMatrix m, again;
+        errno = 0;
+        res = generate_family(&m, f, rows, columns, density, seed, 1);
+        if (!res) break;
+        // The matrix must not depend on the amount of threads
+        res = generate_family(&again, f, rows, columns, density, seed, 3);
+        res = res && check_generated(&m) && cmp_csc_eq(&m, &again);
+
+        double actual = (double) m.valueCount / (rows * columns);
+        if (res && f == FAMILY_UNIFORM) {
+            // Per-entry draws give binomial amounts of values per column
+            double variance = rows * density * (1 - density);
+            res = actual > 0.9 * density && actual < 1.1 * density
+                && column_variance(&m) > 0.7 * variance
+                && column_variance(&m) < 1.3 * variance;
+        }
+        printf("%s: %lu values (density %.4f). ", familyNames[f],
+                m.valueCount, actual);
+        free_csc_members(&m);
+        free_csc_members(&again);
+    }
+    struct cscMatrix m;
+    res = res
+        && !generate_family(&m, FAMILY_COUNT, rows, columns, density, 0, 1)
+        && errno == EINVAL && parse_family("rmat") == FAMILY_RMAT
+        && parse_family("dense") == -1;
+
+    printf("\ntest_generate_family: %lu by %lu matrices. %s\n", rows, columns,
+            res ? "Test passed." : "Test failed.");
+    return res;
+}
+
+int test_generate_rmat(unsigned scale, unsigned edgeFactor) {
+    struct rmatParams p = RMAT_DEFAULT_PARAMS;
+    uint64_t n = 1ull << scale, edges = (uint64_t) edgeFactor << scale;
+    uint64_t seed = rand();
+    struct cscMatrix m, again;
+    errno = 0;
+    int res = generate_rmat(&m, n, n, edges, &p, seed, 1);
+    if (!res) {
+        printf("\ntest_generate_rmat: Test failed.\n");
+        return 0;
+    }
+    res = generate_rmat(&again, n, n, edges, &p, seed, 4);
+    res = res && check_generated(&m) && cmp_csc_eq(&m, &again)
+        && m.valueCount <= edges && m.valueCount > edges / 2;
+
+    // The densest column holds many times the average amount of values
+    uint64_t maxDegree = 0;
+    for (uint64_t j = 0; j < m.columns; j++) {
+        uint64_t degree = m.colPtr[j + 1] - m.colPtr[j];
+        if (degree > maxDegree) maxDegree = degree;
+    }
+    res = res && maxDegree > 10 * m.valueCount / m.columns;
+    printf("rmat: %lu of %lu edges kept, largest column %lu. ", m.valueCount,
+            edges, maxDegree);
+    free_csc_members(&m);
+    free_csc_members(&again);
+
+    res = res && generate_rmat(&m, n / 2 + 3, n, edges / 2, &p, seed, 3)
+        && check_generated(&m);
+    free_csc_members(&m);
+    struct rmatParams invalid = {0.5, 0.5, 0.5, 0};
+    res = res && !generate_rmat(&m, n, n, edges, &invalid, seed, 1)
+        && errno == EINVAL;
+
+    printf("\ntest_generate_rmat: scale %u, edge factor %u. %s\n", scale,
+            edgeFactor, res ? "Test passed." : "Test failed.");
+    return res;
+}
@@ -2,9 +2,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <inttypes.h>
+#include <errno.h>
 
 #include "cs_matrix.h"
 #include "csc_io.h"
+#include "csc_mmap.h"
 #include "csc_io_tests.h"
 
 void static create_test_file(const char* filename, const char* content) {
@@ -20,28 +22,10 @@ void static create_test_file(const char* filename, const char* content) {
 
 int test_getColIndices_example() {
     
-    struct cscMatrixTranspose m = {4, 4, 5};
-    uint64_t rI[] = {0,2,1,1,3};
     uint64_t cPtr[] = {0,2,3,4,5};
-    float val[] = {5,0.5,6,1,3};
-    m.rowIndices = malloc(5*sizeof(uint64_t));
-    m.colPtr = malloc(5*sizeof(uint64_t));
-    m.values = malloc(5*sizeof(float));
-    if (!m.rowIndices || !m.colPtr || !m.values) {
-        free(m.rowIndices);
-        free(m.colPtr);
-        free(m.values);
-        return 0;
-    }
-
-    for (int i = 0; i < 5; ++i) {
-        m.rowIndices[i] = rI[i];
-        m.colPtr[i] = cPtr[i];
-        m.values[i] = val[i];
-    }
 
     uint64_t cI[5];
-    get_col_indices(&m, cI);
+    calculateColumnIndices(cPtr, 4, cI);
     uint64_t expected[] = {0,0,1,2,3};
     for (int i = 0; i < 5; ++i) {
         if (cI[i] != expected[i]) {
@@ -52,10 +36,6 @@ int test_getColIndices_example() {
             return 0;
         }
     }
-
-    free(m.rowIndices);
-    free(m.colPtr);
-    free(m.values);
     return 1;
 }
     
@@ -64,10 +44,10 @@ int test_parseCSCFile() {
     create_test_file("testMatrixA.txt", "4,4\n5,0.5,6,1,3\n0,2,1,1,3\n0,2,3,4,5\n");
     create_test_file("testMatrixB.txt", "4,4\n5,0.5,6,1,3\n0,2,1,1,3\n0,2,3,4,5\n");
 
-    struct cscMatrixTranspose* matrixA = malloc(sizeof(struct cscMatrixTranspose));
+    struct cscMatrix* matrixA = malloc(sizeof(struct cscMatrix));
     struct cscMatrix* matrixB = malloc(sizeof(struct cscMatrix));
 
-    parse_csc_file("testMatrixA.txt", "testMatrixB.txt", matrixA, matrixB);
+    parse_csc_file_V2("testMatrixA.txt", "testMatrixB.txt", matrixA, matrixB, 1);
 
     float expectedA_values[] = {5,0.5,6,1,3};
     uint64_t expectedA_rowIndices[] = {0,2,1,1,3};
@@ -114,7 +94,7 @@ int test_parseCSCFile() {
     printUint64Vector(matrixB->rowIndices, 5);
     printUint64Vector(matrixB->colPtr, 5);
 
-    free_transpose_matrix(matrixA);
+    free_csc_matrix(matrixA);
     free_csc_matrix(matrixB);
     remove("testMatrixA.txt");
     remove("testMatrixB.txt");
@@ -151,10 +131,9 @@ int test_result_to_file_fixed() {
 
     result_to_file(&expected, "output1.txt");
 
-    struct cscMatrix result;
-    struct cscMatrixTranspose foo;
+    struct cscMatrix result, copy;
 
-    parse_csc_file("output1.txt", "output1.txt", &foo, &result);
+    parse_csc_file_V2("output1.txt", "output1.txt", &copy, &result, 1);
 
     if (5 != result.valueCount || 4 != result.rows || 4 != result.columns ||
         !cmp_float_vec_eq(result.values, val, 5) || !cmp_uint64_t_vec_eq(result.rowIndices, rI, 5)
@@ -179,10 +158,7 @@ int test_result_to_file_fixed() {
     free(result.colPtr);
     free(result.rowIndices);
     free(result.values);
-    free(foo.colIndices);
-    free(foo.colPtr);
-    free(foo.rowIndices);
-    free(foo.values);
+    free_csc_members(&copy);
     free(expected.colPtr);
     free(expected.rowIndices);
     free(expected.values);
@@ -208,10 +184,9 @@ int test_result_to_file_random(uint64_t maxSize, uint64_t minSize) {
         return 0;
     }
 
-    struct cscMatrix result;
-    struct cscMatrixTranspose foo;
+    struct cscMatrix result, copy;
 
-    parse_csc_file("output2.txt", "output2.txt", &foo, &result);
+    parse_csc_file_V2("output2.txt", "output2.txt", &copy, &result, 1);
 
     if (!cmp_csc_eq(&result, &matrix))
     {
@@ -226,10 +201,7 @@ int test_result_to_file_random(uint64_t maxSize, uint64_t minSize) {
     free(result.colPtr);
     free(result.rowIndices);
     free(result.values);
-    free(foo.colIndices);
-    free(foo.colPtr);
-    free(foo.rowIndices);
-    free(foo.values);
+    free_csc_members(&copy);
     free(matrix.colPtr);
     free(matrix.rowIndices);
     free(matrix.values);
@@ -238,3 +210,61 @@ int test_result_to_file_random(uint64_t maxSize, uint64_t minSize) {
     return 1;
 }
 
+
+int test_parse_csc_file_mmap_transposed() {
+    const char* invalid[] = {
+        "4,3\n81.75,29.3,83.96,19.21\n2,x,0,3\n0,2,2,4\n",
+        "4,3\n81.75,29.3,83.96,19.21\n2,3,0,-3\n0,2,2,4\n",
+        "4,3\n81.75,29.3x,83.96,19.21\n2,3,0,3\n0,2,2,4\n",
+        "4,3\n81.75,29.3,83.96,19.21\n2,3,0,3\n0,2,2a,4\n",
+        "4,3\n81.75,29.3,83.96,19.21\n2,3,0,3\n1,2,2,4\n"};
+    float expVals[] = {83.96, 81.75, 29.3, 19.21};
+    uint64_t expRowIs[] = {2, 0, 0, 2};
+    uint64_t expColPtr[] = {0, 1, 1, 2, 4};
+    struct cscMatrix expected = {0};
+    generate_csc_matr(&expected, 3, 4, 4, expRowIs, expColPtr, expVals);
+
+    // The serial count-and-fill parser and the chunked parallel parser
+    int res = 1;
+    unsigned threads[] = {1, 3};
+    for (unsigned t = 0; res && t < sizeof(threads) / sizeof(*threads); t++) {
+        create_test_file("testMatrixA.txt",
+                "4,3\n81.75,29.3,83.96,19.21\n2,3,0,3\n0,2,2,4\n");
+        struct cscMatrix matrixA = {0};
+        errno = 0;
+        int isZero = parse_csc_file_mmap("testMatrixA.txt", &matrixA, 1,
+                threads[t]);
+        if (errno || isZero) {
+            printf("test_parse_csc_file_mmap_transposed failed: parsing error "
+                    "with %u threads.\n", threads[t]);
+            res = 0;
+            break;
+        }
+        res = cmp_csc_eq(&expected, &matrixA);
+        if (!res) {
+            printf("\ntest_parse_csc_file_mmap_transposed expected:\n");
+            printCSCMatrix(&expected, 0);
+            printf("Actual with %u threads was:\n", threads[t]);
+            printCSCMatrix(&matrixA, 0);
+        }
+        free_csc_members(&matrixA);
+
+        // Junk tokens and a first column pointer other than 0 are rejected
+        for (unsigned i = 0; res && i < sizeof(invalid) / sizeof(*invalid);
+                i++) {
+            struct cscMatrix a = {0};
+            create_test_file("testMatrixA.txt", invalid[i]);
+            errno = 0;
+            parse_csc_file_mmap("testMatrixA.txt", &a, 1, threads[t]);
+            res = errno == EINVAL && !a.colPtr;
+            if (!res) {
+                printf("Invalid input %u was accepted with %u threads.\n", i,
+                        threads[t]);
+            }
+            free_csc_members(&a);
+        }
+    }
+    remove("testMatrixA.txt");
+    printf(res ? "Test passed.\n" : "Test failed.\n");
+    return res;
+}
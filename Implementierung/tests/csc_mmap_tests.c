@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_mmap.h"
+#include "csc_mmap_tests.h"
+#include "transpose.h"
+
+static void create_test_file(const char* filename, const char* content) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        perror("Unable to create test file");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(file, "%s", content);
+    fclose(file);
+}
+
+/**
+ * @class pipeWriter
+ *
+ * Content written into a FIFO by a thread, like a process substitution
+ *
+ * @member filename The FIFO
+ * @member content  The text to write
+ */
+struct pipeWriter {
+    const char* filename;
+    const char* content;
+};
+
+static void* write_pipe(void* arg) {
+    struct pipeWriter* w = arg;
+    FILE* file = fopen(w->filename, "w");
+    if (file) {
+        fputs(w->content, file);
+        fclose(file);
+    }
+    return 0;
+}
+
+/**
+ * Parses a FIFO fed with content as A and a regular file as B with
+ * parse_csc_files_mmap.
+ *
+ * @return  errno of the parser
+ */
+static int parse_pipe(const char* fifo, const char* content,
+        const char* filename_b, struct cscMatrix* a, struct cscMatrix* b,
+        int transposeA) {
+    struct pipeWriter w = {fifo, content};
+    pthread_t writer;
+    if (pthread_create(&writer, 0, write_pipe, &w)) return errno = EAGAIN;
+    errno = 0;
+    parse_csc_files_mmap(fifo, filename_b, a, b, transposeA, 1);
+    int err = errno;
+    pthread_join(writer, 0);
+    return err;
+}
+
+static double get_time_diff(struct timespec* start, struct timespec* end) {
+    return end->tv_sec - start->tv_sec +
+        1e-9 * (end->tv_nsec - start->tv_nsec);
+}
+
+/**
+ * Compares the result of scan_float with the result of strtof.
+ *
+ * @param str       The number to convert
+ * @param exact     Nonzero if both results must be bitwise identical, 
+ *                  otherwise they may differ by one ulp
+ * @return          1 if the results match, 0 otherwise
+ */
+static int cmp_scan_strtof(const char* str, int exact) {
+    float expected = strtof(str, 0);
+    float actual;
+    const char* end = scan_float(str, str + strlen(str), &actual);
+    if (!end || *end != '\0') {
+        printf("scan_float did not consume \"%s\"\n", str);
+        return 0;
+    }
+    uint32_t e, a;
+    memcpy(&e, &expected, sizeof(e));
+    memcpy(&a, &actual, sizeof(a));
+    if (e == a || (!exact && (e - a == 1 || a - e == 1))) return 1;
+    printf("scan_float(\"%s\") returned %.9g, expected %.9g\n", str, actual,
+            expected);
+    return 0;
+}
+
+int test_scan_float_fixed() {
+    const char* inputs[] = {"5", "0.5", "81.75", "-29.3", "+83.96", "1e10",
+        "2.5E-3", "0.000123", "123456", "16777217", "3.4028235e38",
+        "1.17549435e-38", "1.4e-45", "7.00649232e-45", "4503599627370497.5",
+        "0.100000001490116119384765625", "inf", "-nan", "1e39", "1e-50"};
+    unsigned n = sizeof(inputs) / sizeof(inputs[0]);
+    int res = 1;
+    for (unsigned i = 0; i < n; ++i) {
+        res &= cmp_scan_strtof(inputs[i], 1);
+    }
+
+    uint64_t u;
+    const char* digits = "18446744073709551615,";
+    res &= scan_uint64(digits, digits + strlen(digits), &u) == digits + 20
+        && u == UINT64_MAX;
+    digits = "18446744073709551616";
+    res &= scan_uint64(digits, digits + strlen(digits), &u) == 0;
+
+    printf("\ntest_scan_float_fixed: %s\n", res ? "Test passed." 
+            : "Test failed.");
+    return res;
+}
+
+int test_scan_float_rand(unsigned n) {
+    char buf[64];
+    unsigned exact = 0;
+    unsigned tested = 0;
+    int res = 1;
+    for (unsigned i = 0; i < n && res; ++i) {
+        uint32_t bits = ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        if (f != f || f - f != 0) continue; // skip nan and inf
+        tested++;
+
+        snprintf(buf, sizeof(buf), (i & 1) ? "%.9g" : "%g", f);
+        res &= cmp_scan_strtof(buf, 0);
+
+        float actual;
+        scan_float(buf, buf + strlen(buf), &actual);
+        exact += actual == strtof(buf, 0);
+    }
+    printf("\ntest_scan_float_rand: %u of %u conversions bitwise identical to "
+            "strtof. %s\n", exact, tested, res ? "Test passed." : "Test failed.");
+    return res;
+}
+
+int test_parse_mmap_fixed() {
+    create_test_file("testMatrixMmap.txt", 
+            "4,3\r\n81.75,29.3,83.96,19.21\r\n2,3,0,3\r\n0,2,2,4");
+
+    struct cscMatrix m = {0};
+    struct cscMatrix m_t = {0};
+    errno = 0;
+    parse_csc_mmap("testMatrixMmap.txt", &m);
+    int err = errno;
+    parse_csc_mmap_transposed("testMatrixMmap.txt", &m_t);
+    err |= errno;
+    remove("testMatrixMmap.txt");
+    if (err) {
+        printf("\ntest_parse_mmap_fixed failed: parsing error.\n");
+        return 0;
+    }
+
+    float vals[] = {81.75, 29.3, 83.96, 19.21};
+    uint64_t rowIs[] = {2, 3, 0, 3};
+    uint64_t colPtr[] = {0, 2, 2, 4};
+    float valsT[] = {83.96, 81.75, 29.3, 19.21};
+    uint64_t rowIsT[] = {2, 0, 0, 2};
+    uint64_t colPtrT[] = {0, 1, 1, 2, 4};
+    struct cscMatrix expected = {0};
+    struct cscMatrix expectedT = {0};
+    generate_csc_matr(&expected, 4, 3, 4, rowIs, colPtr, vals);
+    generate_csc_matr(&expectedT, 3, 4, 4, rowIsT, colPtrT, valsT);
+
+    int res = cmp_csc_eq(&m, &expected) && cmp_csc_eq(&m_t, &expectedT);
+    printf("\ntest_parse_mmap_fixed: %s\n", res ? "Test passed." 
+            : "Test failed.");
+    free_csc_members(&m);
+    free_csc_members(&m_t);
+    return res;
+}
+
+int test_parse_mmap_throughput(uint64_t minSize, uint64_t maxSize) {
+    const char* filename = "testMatrixThroughput.txt";
+    struct cscMatrix matrix = {0};
+    uint64_t diff = maxSize - minSize + 1;
+    // Square, so that the file can be used as both factors
+    matrix.rows = matrix.columns = minSize + rand() % diff;
+    errno = 0;
+    generate_csc_matr_rand(&matrix, 10, 3);
+    if (errno) return 0;
+    result_to_file(&matrix, filename);
+    if (errno) {
+        free_csc_members(&matrix);
+        return 0;
+    }
+
+    struct stat st;
+    stat(filename, &st);
+    double megabytes = 2.0 * st.st_size / 1e6;
+
+    struct cscMatrix oldA = {0}, oldB = {0}, newA = {0}, newB = {0};
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    parse_csc_file_V2(filename, filename, &oldA, &oldB, 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double oldTime = get_time_diff(&start, &end);
+    int err = errno;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    parse_csc_files_mmap(filename, filename, &newA, &newB, 0, 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double newTime = get_time_diff(&start, &end);
+    err |= errno;
+
+    struct cscMatrix mtA = {0}, mtB = {0};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    parse_csc_files_mmap(filename, filename, &mtA, &mtB, 0, 4);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double mtTime = get_time_diff(&start, &end);
+    err |= errno;
+    remove(filename);
+
+    int res = !err && cmp_csc_eq(&oldA, &matrix) && cmp_csc_eq(&newA, &matrix)
+        && cmp_csc_eq(&newB, &oldB) && cmp_csc_eq(&mtA, &matrix);
+
+    printf("\ntest_parse_mmap_throughput: %lu by %lu matrix, %.1f MB parsed\n",
+            matrix.rows, matrix.columns, megabytes);
+    printf("parse_csc_file_V2:    %8.1f MB/s\n", megabytes / oldTime);
+    printf("parse_csc_files_mmap: %8.1f MB/s (%.1fx)\n", megabytes / newTime,
+            oldTime / newTime);
+    printf("4 threads:            %8.1f MB/s (%.1fx)\n", megabytes / mtTime,
+            oldTime / mtTime);
+    printf("%s\n", res ? "Test passed." : "Test failed.");
+
+    free_csc_members(&mtA);
+    free_csc_members(&mtB);
+    free_csc_members(&matrix);
+    free_csc_members(&oldA);
+    free_csc_members(&oldB);
+    free_csc_members(&newA);
+    free_csc_members(&newB);
+    return res;
+}
+
+int test_parse_mmap_threads(uint64_t minSize, uint64_t maxSize, unsigned threads) {
+    const char* filename = "testMatrixThreads.txt";
+    struct cscMatrix matrix = {0};
+    uint64_t diff = maxSize - minSize + 1;
+    matrix.rows = matrix.columns = minSize + rand() % diff;
+    errno = 0;
+    generate_csc_matr_rand(&matrix, 10, 3);
+    if (errno) return 0;
+    result_to_file(&matrix, filename);
+
+    struct cscMatrix a = {0}, b = {0}, a_t = {0}, b2 = {0}, expected_t = {0};
+    errno = 0;
+    parse_csc_file_V2(filename, filename, &a, &b, threads);
+    int err = errno;
+    parse_csc_files_mmap(filename, filename, &a_t, &b2, 1, threads);
+    err |= errno;
+    remove(filename);
+    transpose_csc(&matrix, &expected_t);
+
+    int res = !err && cmp_csc_eq(&a, &matrix) && cmp_csc_eq(&b, &matrix)
+        && cmp_csc_eq(&a_t, &expected_t) && cmp_csc_eq(&b2, &matrix);
+    printf("\ntest_parse_mmap_threads: %lu by %lu matrix with %u threads. %s\n",
+            matrix.rows, matrix.columns, threads,
+            res ? "Test passed." : "Test failed.");
+
+    free_csc_members(&matrix);
+    free_csc_members(&a);
+    free_csc_members(&b);
+    free_csc_members(&a_t);
+    free_csc_members(&b2);
+    free_csc_members(&expected_t);
+    return res;
+}
+
+int test_parse_mmap_pipe() {
+    const char* fifo = "testMatrixPipe";
+    const char* filename = "testMatrixPipeB.txt";
+    // The column pointers of A are one short
+    const char* malformed = "2,2\n1,2\n0,1\n0,1\n";
+    const char* valid = "2,2\n1,2\n0,1\n0,1,2\n";
+    create_test_file(filename, valid);
+    remove(fifo);
+    int res = !mkfifo(fifo, 0600);
+
+    for (int transposeA = 0; res && transposeA < 2; transposeA++) {
+        struct cscMatrix a = {0}, b = {0};
+        res = parse_pipe(fifo, malformed, filename, &a, &b, transposeA) == EINVAL
+            && !a.values && !a.rowIndices && !a.colPtr
+            && !b.values && !b.rowIndices && !b.colPtr;
+        free_csc_members(&a);
+        free_csc_members(&b);
+    }
+
+    // A is diagonal, so it equals its transpose
+    struct cscMatrix a = {0}, b = {0};
+    res = res && !parse_pipe(fifo, valid, filename, &a, &b, 1)
+        && cmp_csc_eq(&a, &b) && a.colPtr[2] == 2;
+    free_csc_members(&a);
+    free_csc_members(&b);
+    remove(fifo);
+    remove(filename);
+
+    printf("\ntest_parse_mmap_pipe: %s\n", res ? "Test passed." : "Test failed.");
+    return res;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_gen.h"
+#include "csc_bench.h"
+#include "csc_model.h"
+#include "csc_model_tests.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+
+int test_cost_model(uint64_t size, double density) {
+    struct cscMatrix a = {0}, a_t = {0}, b = {0}, c = {0};
+    struct mulFeatures f, ft;
+    struct mulMetrics metrics;
+    errno = 0;
+    int res = generate_family(&a, FAMILY_UNIFORM, size, size, density, 3, 1)
+        && generate_family(&b, FAMILY_UNIFORM, size, size, density, 4, 1)
+        && transpose_csc(&a, &a_t)
+        && compute_features(&a, &b, 0, &f)
+        && compute_features(&a_t, &b, 1, &ft);
+    if (res) {
+        matr_mult_csc(&a_t, &b, &c);
+        res = !errno && mul_metrics(&a_t, &b, 1, &c, &metrics);
+    }
+
+    // Both layouts give the same features
+    res = res && !memcmp(&f, &ft, sizeof(f));
+    res = res && f.rows == size && f.inner == size && f.columns == size
+        && f.valuesA == a.valueCount && f.valuesB == b.valueCount
+        && f.products == metrics.products;
+    res = res && f.maxValues >= c.valueCount && f.maxValues <= f.products;
+    uint64_t columns = 0;
+    for (int i = 0; res && i < MODEL_BUCKETS; i++) columns += f.histA[i];
+    res = res && columns == size;
+    // The values of uniform matrices are random, so the estimate is close
+    res = res && f.estimatedValues > 0.9 * c.valueCount
+        && f.estimatedValues < 1.1 * c.valueCount;
+
+    struct costModel model, read;
+    default_cost_model(&model);
+    const char* filename = "test_cost_model.txt";
+    model.coef[1][2] = 1.25e-9;
+    model.calibrated = 1;
+    res = res && save_cost_model(filename, &model)
+        && load_cost_model(filename, &read) && read.calibrated
+        && read.coef[1][2] == model.coef[1][2];
+    for (int v = 0; res && v < MODEL_KERNELS; v++) {
+        for (int i = 0; res && i < MODEL_TERMS; i++) {
+            double d = read.coef[v][i] - model.coef[v][i];
+            res = d <= 1e-6 * model.coef[v][i] && -d <= 1e-6 * model.coef[v][i];
+        }
+    }
+    remove(filename);
+
+    default_cost_model(&model);
+    res = res && predict_cost(&model, 2, &f) > predict_cost(&model, 0, &f);
+    struct mulPlan plan;
+    plan_multiplication(&f, &model, &plan);
+    res = res && plan.version != 2
+        && plan.predicted[plan.version] == predict_cost(&model, plan.version,
+                &f)
+        && plan.inputBytes == csc_matrix_bytes(&a) + csc_matrix_bytes(&b)
+        && plan.transposeBytes == csc_matrix_bytes(&a_t)
+        && plan.resultBytes <= plan.maxResultBytes
+        && plan.resultBytes <= plan.peakBytes;
+
+    printf("\ntest_cost_model: %lu values estimated, %lu actual. %s\n",
+            (uint64_t) f.estimatedValues, c.valueCount, res ? "Test passed."
+            : "Test failed.");
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    free_csc_members(&c);
+    return res;
+}
+
+int test_csc_statistics() {
+    // Columns {0, 2}, {}, {3, 0} and {1}
+    uint64_t colPtr[] = {0, 2, 2, 4, 5};
+    uint64_t rowIndices[] = {0, 2, 3, 0, 1};
+    float values[] = {1, 2, 3, 4, 5};
+    struct cscMatrix m = {4, 4, 5, values, rowIndices, colPtr};
+    struct cscStatistics s;
+    compute_csc_statistics(&m, &s);
+    int res = s.rows == 4 && s.columns == 4 && s.valueCount == 5
+        && s.density == 5 / 16.0 && s.emptyColumns == 1 && s.minColumn == 0
+        && s.maxColumn == 2 && s.meanColumn == 1.25
+        && s.stddevColumn > 0.829 && s.stddevColumn < 0.830
+        && s.histogram[0] == 1 && s.histogram[1] == 1 && s.histogram[2] == 2
+        && s.lowerBandwidth == 2 && s.upperBandwidth == 2 && s.profile == 4;
+
+    // A matrix without columns has nothing to count
+    struct cscMatrix empty = {3, 0, 0, 0, 0, colPtr};
+    compute_csc_statistics(&empty, &s);
+    res = res && !s.columns && !s.maxColumn && !s.histogram[0];
+
+    printf("\ntest_csc_statistics: %s\n", res ? "Test passed."
+            : "Test failed.");
+    return res;
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_mtx.h"
+#include "csc_mtx_tests.h"
+#include "transpose.h"
+
+/**
+ * Writes the entries of a matrix in random order, one-based and with the
+ * values written like %.9g, below a Matrix Market header.
+ */
+static int write_shuffled(const struct cscMatrix* m, const char* filename) {
+    uint64_t* order = malloc(m->valueCount * sizeof(uint64_t));
+    uint64_t* cols = malloc(m->valueCount * sizeof(uint64_t));
+    FILE* file = fopen(filename, "w");
+    if ((m->valueCount && (!order || !cols)) || !file) {
+        free(order);
+        free(cols);
+        if (file) fclose(file);
+        return 0;
+    }
+    for (uint64_t j = 0; j < m->columns; j++) {
+        for (uint64_t i = m->colPtr[j]; i < m->colPtr[j + 1]; i++) cols[i] = j;
+    }
+    for (uint64_t i = 0; i < m->valueCount; i++) order[i] = i;
+    for (uint64_t i = m->valueCount; i > 1; i--) {
+        uint64_t k = rand() % i, tmp = order[i - 1];
+        order[i - 1] = order[k];
+        order[k] = tmp;
+    }
+
+    fprintf(file, "%%%%MatrixMarket matrix coordinate real general\n"
+            "%% Shuffled test matrix\n%lu %lu %lu\n", m->rows, m->columns,
+            m->valueCount);
+    for (uint64_t i = 0; i < m->valueCount; i++) {
+        uint64_t k = order[i];
+        fprintf(file, "%lu %lu %.9g\n", m->rowIndices[k] + 1, cols[k] + 1,
+                m->values[k]);
+    }
+    free(order);
+    free(cols);
+    return !fclose(file);
+}
+
+static int check_parse(const char* filename, int transpose, unsigned threads,
+        struct cscMatrix* expected) {
+    struct cscMatrix m;
+    errno = 0;
+    parse_mtx_file(filename, &m, transpose, threads);
+    if (errno) return 0;
+    int res = cmp_csc_eq(&m, expected);
+    free_csc_members(&m);
+    return res;
+}
+
+int test_mtx_roundtrip(uint64_t minSize, uint64_t maxSize, unsigned threads) {
+    const char* filename = "testMatrix.mtx";
+    const char* shuffled = "testShuffled.mtx";
+    struct cscMatrix matrix = {0}, matrix_t = {0};
+    uint64_t diff = maxSize - minSize + 1;
+    matrix.rows = minSize + rand() % diff;
+    matrix.columns = minSize + rand() % diff;
+    errno = 0;
+    generate_csc_matr_rand(&matrix, 10, 3);
+    if (errno || !transpose_csc(&matrix, &matrix_t)) {
+        free_csc_members(&matrix);
+        return 0;
+    }
+
+    int res = write_mtx_file(&matrix, filename, 0)
+        && is_mtx_file(filename) && has_mtx_extension(filename)
+        && check_parse(filename, 0, threads, &matrix)
+        && check_parse(filename, 1, threads, &matrix_t)
+        && write_shuffled(&matrix, shuffled)
+        && check_parse(shuffled, 0, threads, &matrix)
+        && check_parse(shuffled, 1, threads, &matrix_t);
+    remove(filename);
+    remove(shuffled);
+
+    printf("\ntest_mtx_roundtrip: %lu by %lu matrix with %u threads. %s\n",
+            matrix.rows, matrix.columns, threads,
+            res ? "Test passed." : "Test failed.");
+    free_csc_members(&matrix);
+    free_csc_members(&matrix_t);
+    return res;
+}
+
+/**
+ * Writes content to a file, parses it and compares the result with the
+ * matrix given by the arrays, or checks that parsing fails with EINVAL if
+ * rows is 0.
+ */
+static int check_file(const char* content, uint64_t rows, uint64_t columns,
+        uint64_t valueCount, float* values, uint64_t* rowIndices,
+        uint64_t* colPtr) {
+    const char* filename = "testVariant.mtx";
+    FILE* file = fopen(filename, "w");
+    if (!file) return 0;
+    fputs(content, file);
+    fclose(file);
+
+    struct cscMatrix expected = {rows, columns, valueCount, values, rowIndices,
+        colPtr};
+    int res;
+    if (rows) {
+        res = check_parse(filename, 0, 1, &expected)
+            && check_parse(filename, 0, 3, &expected);
+    } else {
+        struct cscMatrix m;
+        errno = 0;
+        parse_mtx_file(filename, &m, 0, 2);
+        res = errno == EINVAL && !m.colPtr && !m.values && !m.rowIndices;
+    }
+    remove(filename);
+    return res;
+}
+
+int test_mtx_variants() {
+    // The duplicate entry (3, 1) is summed and mirrored to (1, 3)
+    float symValues[] = {1, 4, 4, 3};
+    uint64_t symRows[] = {0, 2, 0, 2};
+    uint64_t symPtr[] = {0, 2, 2, 4};
+
+    float skewValues[] = {-5, 5};
+    uint64_t skewRows[] = {1, 0};
+    uint64_t skewPtr[] = {0, 1, 2};
+
+    float patValues[] = {1, 1, 1};
+    uint64_t patRows[] = {1, 0, 1};
+    uint64_t patPtr[] = {0, 1, 3};
+
+    // Duplicates are summed, explicit zeros and cancelling duplicates dropped
+    float dupValues[] = {3.5f, -1};
+    uint64_t dupRows[] = {1, 0};
+    uint64_t dupPtr[] = {0, 1, 2};
+
+    int res = check_file("%%MatrixMarket matrix coordinate real symmetric\n"
+            "% comment\n\n3 3 4\n3 1 2\n1 1 1\n3 3 3\n3 1 2e0\n", 3, 3, 4,
+            symValues, symRows, symPtr);
+    res = res && check_file("%%MatrixMarket matrix coordinate real "
+            "skew-symmetric\n2 2 1\n2 1 -5\n", 2, 2, 2, skewValues, skewRows,
+            skewPtr);
+    res = res && check_file("%%MatrixMarket matrix coordinate pattern "
+            "general\n2 2 3\r\n2 2\r\n2 1\r\n1 2", 2, 2, 3, patValues,
+            patRows, patPtr);
+    res = res && check_file("%%MatrixMarket matrix coordinate integer "
+            "general\n2 2 6\n2 1 1\n2 1 2.5\n1 1 0\n1 2 -1\n2 2 4\n2 2 -4\n",
+            2, 2, 2, dupValues, dupRows, dupPtr);
+
+    // Malformed and unsupported files
+    res = res && check_file("%%MatrixMarket matrix array real general\n2 2\n1\n"
+            "2\n3\n4\n", 0, 0, 0, 0, 0, 0);
+    res = res && check_file("%%MatrixMarket matrix coordinate complex "
+            "general\n1 1 1\n1 1 1 0\n", 0, 0, 0, 0, 0, 0);
+    res = res && check_file("%%MatrixMarket matrix coordinate real general\n"
+            "2 2 1\n3 1 1\n", 0, 0, 0, 0, 0, 0);
+    res = res && check_file("%%MatrixMarket matrix coordinate real general\n"
+            "2 2 2\n1 1 1\n", 0, 0, 0, 0, 0, 0);
+    res = res && check_file("%%MatrixMarket matrix coordinate real general\n"
+            "2 2 1\n1 1 x\n", 0, 0, 0, 0, 0, 0);
+    res = res && check_file("%%MatrixMarket matrix coordinate real symmetric\n"
+            "2 3 1\n1 1 1\n", 0, 0, 0, 0, 0, 0);
+
+    printf("\ntest_mtx_variants: %s\n", res ? "Test passed." : "Test failed.");
+    return res;
+}
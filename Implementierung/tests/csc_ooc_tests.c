@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_mmap.h"
+#include "csc_binary.h"
+#include "csc_stream.h"
+#include "csc_ooc.h"
+#include "csc_ooc_tests.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+
+int test_mul_ooc(uint64_t minSize, uint64_t maxSize, uint64_t budget) {
+    const char* fileA = "testOocA.bin";
+    const char* fileAT = "testOocAT.bin";
+    const char* fileB = "testOocB.bin";
+    const char* expectedFile = "testOocExpected.txt";
+    const char* streamFile = "testOoc.bin";
+    const char* textFile = "testOoc.txt";
+    void (*kernels[])(const void*, const void*, void*) = {matr_mult_csc,
+        matr_mult_csc_V1, matr_mult_csc_V2};
+
+    struct cscMatrix a = {0}, a_t = {0}, b = {0};
+    uint64_t diff = maxSize - minSize + 1;
+    a.rows = minSize + rand() % diff;
+    a.columns = b.rows = minSize + rand() % diff;
+    b.columns = minSize + rand() % diff;
+    errno = 0;
+    generate_csc_matr_rand(&a, 10, 3);
+    generate_csc_matr_rand(&b, 10, 3);
+    int res = !errno && transpose_csc(&a, &a_t)
+        && write_csc_binary(&a, 0, fileA)
+        && write_csc_binary(&a_t, 1, fileAT)
+        && write_csc_binary(&b, 0, fileB);
+
+    // The stats of version 0, where A is split into row panels
+    struct oocStats rowStats = {0}, stats;
+    for (int v = 0; res && v < 3; v++) {
+        struct cscMatrix result = {0};
+        kernels[v](v == 2 ? &a : &a_t, &b, &result);
+        res = !errno;
+        result_to_file(&result, expectedFile);
+        free_csc_members(&result);
+
+        res = res && mul_csc_ooc(kernels[v], v != 2, v == 2 ? fileA : fileAT,
+                fileB, budget, streamFile, &stats)
+            && convert_stream_to_text(streamFile, textFile, 0)
+            && cmp_files(expectedFile, textFile)
+            && stats.products == stats.aPanels * stats.bPanels
+            && (v == 2 || stats.bPanels > 1);
+        if (!v) rowStats = stats;
+    }
+
+    // The orientation of A must match the kernel
+    res = res && !mul_csc_ooc(matr_mult_csc, 1, fileA, fileB, budget,
+            streamFile, 0) && errno == EINVAL;
+
+    remove(fileA);
+    remove(fileAT);
+    remove(fileB);
+    remove(expectedFile);
+    remove(streamFile);
+    remove(textFile);
+
+    printf("\ntest_mul_ooc: %lu by %lu times %lu by %lu matrix with a budget of "
+            "%lu bytes (%lu row and %lu column panels). %s\n", a.rows,
+            a.columns, b.rows, b.columns, budget, rowStats.aPanels,
+            rowStats.bPanels,
+            res ? "Test passed." : "Test failed.");
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    return res;
+}
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_gen.h"
+#include "csc_perf.h"
+#include "csc_perf_tests.h"
+#include "matrix_mul.h"
+
+int test_perf_counters(unsigned size) {
+    struct perfGroup g;
+    struct perfReading before, after;
+    struct perfTotals totals;
+    memset(&totals, 0, sizeof(totals));
+    errno = 0;
+    if (!perf_open(&g)) {
+        // Counters are often unavailable in containers and virtual machines
+        printf("perf_event_open unavailable (%s), skipping counts... ",
+                strerror(errno));
+        perf_read(&g, &before);
+        perf_read(&g, &after);
+        perf_accumulate(&totals, &before, &after);
+        perf_close(&g);
+        int res = errno != 0;
+        for (int i = 0; i < PERF_COUNTERS; i++) res &= !totals.counted[i];
+        return res;
+    }
+
+    // The product of two generated matrices with A used as its transpose,
+    // which is equal to A in distribution
+    struct cscMatrix a = {0}, b = {0}, c;
+    int res = generate_family(&a, FAMILY_UNIFORM, size, size, 0.1, 1, 1)
+        && generate_family(&b, FAMILY_UNIFORM, size, size, 0.1, 2, 1);
+    if (res) {
+        perf_read(&g, &before);
+        errno = 0;
+        matr_mult_csc_V1(&a, &b, &c);
+        res = !errno;
+        perf_read(&g, &after);
+        if (res) free_csc_members(&c);
+        perf_accumulate(&totals, &before, &after);
+    }
+    free_csc_members(&a);
+    free_csc_members(&b);
+
+    for (int i = 0; res && i < PERF_COUNTERS; i++) {
+        // Exactly the opened counters must have counted
+        res = totals.counted[i] == (g.fds[i] >= 0);
+    }
+    if (res && g.fds[PERF_CYCLES] >= 0) res = totals.count[PERF_CYCLES] > 0;
+    if (res && g.fds[PERF_INSTRUCTIONS] >= 0) {
+        res = totals.count[PERF_INSTRUCTIONS] > 0;
+    }
+    perf_close(&g);
+    for (int i = 0; res && i < PERF_COUNTERS; i++) res = g.fds[i] == -1;
+    return res;
+}
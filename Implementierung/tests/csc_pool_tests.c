@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "cs_matrix.h"
+#include "csc_pool.h"
+#include "csc_pool_tests.h"
+#include "csc_context.h"
+#include "csc_gen.h"
+#include "csc_io.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+
+// Counts how often every index of the range is visited
+static void count_visits(uint64_t begin, uint64_t end, void* arg) {
+    unsigned* visits = arg;
+    for (uint64_t i = begin; i < end; i++) {
+        __atomic_add_fetch(&visits[i], 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Checks that every one of the n counters is 1 and resets them
+static int visited_once(unsigned* visits, uint64_t n) {
+    int res = 1;
+    for (uint64_t i = 0; i < n; i++) {
+        res = res && visits[i] == 1;
+        visits[i] = 0;
+    }
+    return res;
+}
+
+/**
+ * @class poolPart
+ *
+ * A part of the test that submits a job of its own
+ *
+ * @member pool     The pool
+ * @member visits   Counters of the nested job
+ * @member n        Amount of counters
+ * @member jobs     Amount of jobs to submit one after another
+ * @member res      Nonzero if every job visited all counters once
+ */
+struct poolPart {
+    struct cscPool* pool;
+    unsigned* visits;
+    uint64_t n;
+    unsigned jobs;
+    int res;
+};
+
+static void* run_nested(void* arg) {
+    struct poolPart* p = arg;
+    p->res = 1;
+    for (unsigned i = 0; i < p->jobs; i++) {
+        csc_pool_for(p->pool, p->n, 7, count_visits, p->visits);
+        p->res = p->res && visited_once(p->visits, p->n);
+    }
+    return 0;
+}
+
+int test_csc_pool(unsigned threads) {
+    const uint64_t n = 10000;
+    struct cscPool pool;
+    unsigned* visits = calloc(8 * n, sizeof(unsigned));
+    int res = visits && csc_pool_init(&pool, threads, 0)
+        && csc_pool_threads(&pool) == threads;
+    if (!res) {
+        free(visits);
+        printf("\ntest_csc_pool: Test failed.\n");
+        return 0;
+    }
+
+    // Every index is visited once, for grains that do not divide n as well
+    uint64_t grains[] = {0, 1, 3, n, 2 * n};
+    for (unsigned g = 0; res && g < sizeof(grains) / sizeof(*grains); g++) {
+        csc_pool_for(&pool, n, grains[g], count_visits, visits);
+        res = visited_once(visits, n);
+    }
+    csc_pool_for(&pool, 0, 0, count_visits, visits);
+    csc_pool_for(0, n, 0, count_visits, visits);
+    res = res && visited_once(visits, n);
+
+    // Parts that submit jobs to the same pool, many small jobs in a row
+    struct poolPart parts[8];
+    for (unsigned i = 0; i < 8; i++) {
+        parts[i] = (struct poolPart) {&pool, visits + i * n, i * 100 + 50,
+            i == 0 ? 1000 : 10, 0};
+    }
+    csc_pool_run(&pool, parts, sizeof(*parts), 8, run_nested);
+    for (unsigned i = 0; i < 8; i++) res = res && parts[i].res;
+
+    // Threads outside of the pool submitting at the same time
+    pthread_t tids[4];
+    int started[4];
+    for (unsigned i = 0; i < 4; i++) {
+        parts[i].n = n;
+        parts[i].jobs = 50;
+        started[i] = !pthread_create(&tids[i], 0, run_nested, &parts[i]);
+    }
+    for (unsigned i = 0; i < 4; i++) {
+        if (started[i]) pthread_join(tids[i], 0);
+        res = res && started[i] && parts[i].res;
+    }
+    csc_pool_destroy(&pool);
+
+    // A pinned pool with more threads than processors
+    res = res && csc_pool_init(&pool, 2 * threads, 1);
+    if (res) {
+        csc_pool_for(&pool, n, 0, count_visits, visits);
+        res = visited_once(visits, n);
+        csc_pool_destroy(&pool);
+    }
+
+    free(visits);
+    printf("\ntest_csc_pool: %s\n", res ? "Test passed." : "Test failed.");
+    return res;
+}
+
+/**
+ * Checks that split_csc_columns splits a view of the columns of m, starting
+ * at column first, into n nonempty ranges whose values exceed an equal share
+ * by at most two columns.
+ */
+static int check_split(const struct cscMatrix* m, uint64_t first, uint64_t n) {
+    struct cscMatrix view = {m->rows, m->columns - first,
+        m->colPtr[m->columns] - m->colPtr[first], m->values, m->rowIndices,
+        m->colPtr + first};
+    uint64_t widest = 0;
+    for (uint64_t j = 0; j < view.columns; j++) {
+        uint64_t values = view.colPtr[j + 1] - view.colPtr[j];
+        if (values > widest) widest = values;
+    }
+    uint64_t* ends = malloc(n * sizeof(uint64_t));
+    if (!ends) return 0;
+    split_csc_columns(&view, n, ends);
+    int res = ends[n - 1] == view.columns;
+    for (uint64_t i = 0, begin = 0; res && i < n; begin = ends[i++]) {
+        res = ends[i] > begin && view.colPtr[ends[i]] - view.colPtr[begin]
+            <= view.valueCount / n + 2 * widest;
+    }
+    free(ends);
+    return res;
+}
+
+int test_csc_pool_kernels(unsigned threads, uint64_t size, double density) {
+    struct cscMatrix a = {0}, a_t = {0}, b = {0};
+    struct cscContext serial, parallel;
+    struct cscPool pool;
+    csc_context_init(&serial);
+    csc_context_init(&parallel);
+    errno = 0;
+    int res = csc_pool_init(&pool, threads, 0);
+    if (!res) {
+        printf("\ntest_csc_pool_kernels: Test failed.\n");
+        return 0;
+    }
+    parallel.pool = &pool;
+    res = generate_family(&a, FAMILY_POWER_LAW, size, size + 5, density, 11,
+            1) && generate_family(&b, FAMILY_UNIFORM, size + 5, size - 2,
+                density, 12, 1) && transpose_csc(&a, &a_t);
+
+    // The parallel transpose gives the same matrix as the serial one
+    struct cscMatrix t = {a.columns, a.rows, a.valueCount, 0, 0, 0};
+    t.values = malloc(a.valueCount * sizeof(float) + 1);
+    t.rowIndices = malloc(a.valueCount * sizeof(uint64_t) + 1);
+    t.colPtr = calloc(a.rows + 2, sizeof(uint64_t));
+    res = res && t.values && t.rowIndices && t.colPtr;
+    if (res) {
+        transpose_csc_ctx(&parallel, &a, &t);
+        res = cmp_csc_eq(&t, &a_t);
+    }
+    free_csc_members(&t);
+
+    // Column views, as the streaming and out-of-core modes multiply them,
+    // are split by their own values
+    res = res && check_split(&b, 0, 4 * threads)
+        && check_split(&b, b.columns / 3, 4 * threads)
+        && check_split(&b, b.columns - 2, 2);
+
+    uint64_t skip = b.columns / 3;
+    struct cscMatrix view = {b.rows, b.columns - skip, b.colPtr[b.columns]
+        - b.colPtr[skip], b.values, b.rowIndices, b.colPtr + skip};
+    for (int version = 0; res && version < 3; version++) {
+        const struct cscMatrix* first = version == 2 ? &a : &a_t;
+        struct cscMatrix expected = {0}, c = {0};
+        res = mul_csc_ctx(&serial, version, first, &b, &expected) == CSC_OK
+            && mul_csc_ctx(&parallel, version, first, &b, &c) == CSC_OK
+            && cmp_csc_eq(&c, &expected);
+        free_csc_members(&expected);
+        free_csc_members(&c);
+        res = res && mul_csc_ctx(&serial, version, first, &view, &expected)
+            == CSC_OK && mul_csc_ctx(&parallel, version, first, &view, &c)
+            == CSC_OK && cmp_csc_eq(&c, &expected);
+        free_csc_members(&expected);
+        free_csc_members(&c);
+    }
+
+    csc_pool_destroy(&pool);
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    printf("\ntest_csc_pool_kernels: %s\n", res ? "Test passed."
+            : "Test failed.");
+    return res;
+}
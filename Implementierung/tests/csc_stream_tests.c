@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_mmap.h"
+#include "csc_stream.h"
+#include "csc_stream_tests.h"
+#include "bounded_queue.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+
+#define QUEUE_TEST_ITEMS 10000
+
+static void* produce(void* arg) {
+    struct boundedQueue* q = arg;
+    for (uintptr_t i = 1; i <= QUEUE_TEST_ITEMS; i++) {
+        push_queue(q, (void*) i);
+    }
+    close_queue(q);
+    return 0;
+}
+
+int test_bounded_queue() {
+    struct boundedQueue q;
+    if (!init_queue(&q, 2)) return 0;
+    pthread_t producer;
+    if (pthread_create(&producer, 0, produce, &q)) {
+        destroy_queue(&q);
+        return 0;
+    }
+
+    uintptr_t expected = 1;
+    void* item;
+    int res = 1;
+    while ((item = pop_queue(&q))) {
+        res &= (uintptr_t) item == expected++;
+    }
+    pthread_join(producer, 0);
+    res &= expected == QUEUE_TEST_ITEMS + 1 && !push_queue(&q, &q);
+    destroy_queue(&q);
+
+    printf("\ntest_bounded_queue: %s\n", res ? "Test passed." : "Test failed.");
+    return res;
+}
+
+int test_mul_stream(uint64_t minSize, uint64_t maxSize, uint64_t blockColumns) {
+    const char* expectedFile = "testStreamExpected.txt";
+    const char* streamFile = "testStream.bin";
+    const char* textFile = "testStream.txt";
+    void (*kernels[])(const void*, const void*, void*) = {matr_mult_csc,
+        matr_mult_csc_V1, matr_mult_csc_V2};
+
+    struct cscMatrix a = {0}, a_t = {0}, b = {0};
+    uint64_t diff = maxSize - minSize + 1;
+    a.rows = minSize + rand() % diff;
+    a.columns = b.rows = minSize + rand() % diff;
+    b.columns = minSize + rand() % diff;
+    errno = 0;
+    generate_csc_matr_rand(&a, 10, 3);
+    generate_csc_matr_rand(&b, 10, 3);
+    int res = !errno && transpose_csc(&a, &a_t);
+
+    for (int v = 0; res && v < 3; v++) {
+        const struct cscMatrix* factor = v == 2 ? &a : &a_t;
+        struct cscMatrix result = {0};
+        kernels[v](factor, &b, &result);
+        res = !errno;
+        result_to_file(&result, expectedFile);
+        free_csc_members(&result);
+
+        struct streamStats stats;
+        res = res && mul_csc_stream(kernels[v], factor, &b, a.rows,
+                blockColumns, streamFile, &stats)
+            && is_csc_stream(streamFile)
+            && convert_stream_to_text(streamFile, textFile, 0)
+            && cmp_files(expectedFile, textFile)
+            && stats.blocks == (b.columns + blockColumns - 1) / blockColumns;
+    }
+    remove(expectedFile);
+    remove(streamFile);
+    remove(textFile);
+
+    printf("\ntest_mul_stream: %lu by %lu times %lu by %lu matrix in blocks of "
+            "%lu columns. %s\n", a.rows, a.columns, b.rows, b.columns,
+            blockColumns, res ? "Test passed." : "Test failed.");
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    return res;
+}
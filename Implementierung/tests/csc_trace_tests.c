@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "csc_trace.h"
+#include "csc_trace_tests.h"
+
+static void* record_spans(void* arg) {
+    unsigned n = *(unsigned*) arg;
+    for (unsigned i = 0; i < n; i++) {
+        TRACE_BEGIN(t);
+        TRACE_END(t, "worker span");
+    }
+    return 0;
+}
+
+// Records a span in the trace running when it starts and one in the next
+static void* outlive_trace(void* arg) {
+    pthread_barrier_t* barrier = arg;
+    TRACE_BEGIN(first);
+    TRACE_END(first, "outliving span");
+    pthread_barrier_wait(barrier);
+    pthread_barrier_wait(barrier);
+    TRACE_BEGIN(second);
+    TRACE_END(second, "outliving span");
+    return 0;
+}
+
+// Counts the occurrences of a string in a file
+static unsigned count_in_file(const char* filename, const char* s) {
+    FILE* file = fopen(filename, "r");
+    if (!file) return 0;
+    unsigned count = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        for (char* p = line; (p = strstr(p, s)); p++) count++;
+    }
+    fclose(file);
+    return count;
+}
+
+int test_trace(unsigned threads) {
+    const char* filename = "test_trace.json";
+    if (!trace_start()) return 0;
+    unsigned spans = 10;
+    for (unsigned i = 0; i < TRACE_BUFFER_EVENTS + 5; i++) {
+        TRACE_BEGIN(t);
+        TRACE_END(t, "main span");
+    }
+
+    // Threads that run one after another share a buffer
+    for (unsigned i = 0; i < threads; i++) {
+        pthread_t tid;
+        if (pthread_create(&tid, 0, record_spans, &spans)) return 0;
+        pthread_join(tid, 0);
+    }
+    pthread_t tids[threads];
+    for (unsigned i = 0; i < threads; i++) {
+        if (pthread_create(&tids[i], 0, record_spans, &spans)) return 0;
+    }
+    for (unsigned i = 0; i < threads; i++) pthread_join(tids[i], 0);
+
+    errno = 0;
+    int res = trace_write(filename);
+    trace_stop();
+    // Disabled tracing must not record anything
+    TRACE_BEGIN(t);
+    TRACE_END(t, "main span");
+    res = res && !traceEnabled;
+
+#ifdef CSC_NO_TRACE
+    res = res && count_in_file(filename, "\"ph\":\"X\"") == 0;
+#else
+    // One buffer for the main thread, at least one for the sequential
+    // threads and at most one per concurrent thread
+    unsigned lanes = count_in_file(filename, "\"thread_name\"");
+    res = res && lanes >= 2 && lanes <= threads + 1
+        && count_in_file(filename, "\"main span\"") == TRACE_BUFFER_EVENTS
+        && count_in_file(filename, "\"worker span\"") == 2 * threads * spans
+        && count_in_file(filename, "\"droppedSpans\":5}") == 1;
+#endif
+
+    // A thread that outlives a trace, like a worker of the shared pool, must
+    // not record into or release the freed buffers of the old one
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, 0, 2);
+    pthread_t tid;
+    int started = trace_start() && !pthread_create(&tid, 0, outlive_trace,
+            &barrier);
+    res = res && started;
+    if (started) {
+        pthread_barrier_wait(&barrier);
+        trace_stop();
+        res = trace_start() && res;
+        pthread_barrier_wait(&barrier);
+        pthread_join(tid, 0);
+        res = res && trace_write(filename);
+    }
+    trace_stop();
+    pthread_barrier_destroy(&barrier);
+#ifndef CSC_NO_TRACE
+    res = res && count_in_file(filename, "\"outliving span\"") == 1;
+#endif
+    remove(filename);
+
+    printf("\ntest_trace: %u worker threads. %s\n", threads,
+            res ? "Test passed." : "Test failed.");
+    return res;
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <float.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "cs_matrix.h"
+#include "csc_io.h"
+#include "csc_mmap.h"
+#include "csc_writer.h"
+#include "csc_writer_tests.h"
+
+static double get_time_diff(struct timespec* start, struct timespec* end) {
+    return end->tv_sec - start->tv_sec +
+        1e-9 * (end->tv_nsec - start->tv_nsec);
+}
+
+static int check_format(float f, int precision, const char* expected) {
+    char buffer[CSC_WRITER_MAX_NUMBER + 1];
+    *format_float(buffer, f, precision) = '\0';
+    if (strcmp(buffer, expected)) {
+        printf("format_float(%.9g, %d): expected %s, actual %s\n", f,
+                precision, expected, buffer);
+        return 0;
+    }
+    return 1;
+}
+
+int test_format_float_fixed() {
+    int res = check_format(0.1f, 0, "0.1")
+        && check_format(1.0f, 0, "1")
+        && check_format(-0.0f, 0, "-0")
+        && check_format(100.0f, 0, "100")
+        && check_format(1.5e-5f, 0, "1.5e-05")
+        && check_format(0.0001f, 0, "0.0001")
+        && check_format(123456792.0f, 0, "123456790")
+        && check_format(1e9f, 0, "1e+09")
+        && check_format(FLT_MAX, 0, "3.4028235e+38")
+        && check_format(FLT_MIN, 0, "1.1754944e-38")
+        && check_format(1e-45f, 0, "1e-45")
+        && check_format(16777216.0f, 0, "16777216")
+        && check_format(0.3f, 6, "0.3")
+        && check_format(1.0f / 3, 6, "0.333333")
+        && check_format(1.0f / 3, 2, "0.33")
+        && check_format(2.5f, 1, "2")
+        && check_format(1234567.0f, 6, "1.23457e+06")
+        && check_format(1.0f / 3, 9, "0.333333343");
+
+    char buffer[21];
+    *format_uint64(buffer, 0) = '\0';
+    res = res && !strcmp(buffer, "0");
+    *format_uint64(buffer, UINT64_MAX) = '\0';
+    res = res && !strcmp(buffer, "18446744073709551615");
+
+    printf("\ntest_format_float_fixed: %s\n", res ? "Test passed."
+            : "Test failed.");
+    return res;
+}
+
+int test_format_float_rand(unsigned n) {
+    unsigned failed = 0;
+    for (unsigned i = 0; i < n; i++) {
+        uint32_t bits = ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        if (f != f || f - f != 0) continue;
+
+        char buffer[CSC_WRITER_MAX_NUMBER + 1], expected[32];
+        *format_float(buffer, f, 0) = '\0';
+        float parsed = strtof(buffer, 0);
+        int shortest;
+        for (shortest = 1; shortest < 9; shortest++) {
+            snprintf(expected, sizeof(expected), "%.*e", shortest - 1, f);
+            if (strtof(expected, 0) == f) break;
+        }
+        uint32_t digits;
+        int32_t exponent;
+        int ok = memcmp(&parsed, &f, sizeof(f)) == 0
+            && float_to_shortest(f, &digits, &exponent) == shortest;
+
+        *format_float(buffer, f, 6) = '\0';
+        snprintf(expected, sizeof(expected), "%.6g", f);
+        ok = ok && !strcmp(buffer, expected);
+        if (!ok && failed++ < 5) {
+            printf("format_float failed for %.9g (0x%08x)\n", f, bits);
+        }
+    }
+    printf("\ntest_format_float_rand: %u of %u floats failed. %s\n", failed, n,
+            failed ? "Test failed." : "Test passed.");
+    return failed == 0;
+}
+
+/**
+ * Writes a matrix with one fprintf call per number, like result_to_file did
+ * before write_csc_text.
+ */
+static void write_fprintf(struct cscMatrix* m, const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (!file) return;
+    fprintf(file, "%" PRIu64 ",%" PRIu64 "\n", m->rows, m->columns);
+    for (uint64_t i = 0; i < m->valueCount; i++) {
+        fprintf(file, i ? ",%g" : "%g", m->values[i]);
+    }
+    fprintf(file, "\n");
+    for (uint64_t i = 0; i < m->valueCount; i++) {
+        fprintf(file, i ? ",%" PRIu64 : "%" PRIu64, m->rowIndices[i]);
+    }
+    fprintf(file, "\n");
+    for (uint64_t i = 0; i < m->columns + 1; i++) {
+        fprintf(file, i ? ",%" PRIu64 : "%" PRIu64, m->colPtr[i]);
+    }
+    fclose(file);
+}
+
+int test_write_csc_text(uint64_t minSize, uint64_t maxSize) {
+    const char* expectedFile = "testWriterExpected.txt";
+    const char* actualFile = "testWriterActual.txt";
+    const char* shortestFile = "testWriterShortest.txt";
+    struct cscMatrix matrix = {0}, parsed = {0};
+    uint64_t diff = maxSize - minSize + 1;
+    matrix.rows = minSize + rand() % diff;
+    matrix.columns = minSize + rand() % diff;
+    errno = 0;
+    generate_csc_matr_rand(&matrix, 10, 3);
+    if (errno) return 0;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    write_fprintf(&matrix, expectedFile);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double oldTime = get_time_diff(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int ok = write_csc_text(&matrix, actualFile, 6);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double newTime = get_time_diff(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ok = ok && write_csc_text(&matrix, shortestFile, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double shortestTime = get_time_diff(&start, &end);
+
+    struct stat st;
+    double megabytes = stat(expectedFile, &st) ? 0 : st.st_size / 1e6;
+    int res = ok && cmp_files(expectedFile, actualFile);
+    errno = 0;
+    parse_csc_mmap(shortestFile, &parsed);
+    res = res && !errno && parsed.valueCount == matrix.valueCount
+        && !memcmp(parsed.values, matrix.values,
+                matrix.valueCount * sizeof(float))
+        && cmp_csc_eq(&parsed, &matrix);
+    remove(expectedFile);
+    remove(actualFile);
+    remove(shortestFile);
+
+    printf("\ntest_write_csc_text: %lu by %lu matrix, %.1f MB written\n",
+            matrix.rows, matrix.columns, megabytes);
+    printf("fprintf:                  %8.1f MB/s\n", megabytes / oldTime);
+    printf("write_csc_text (%%.6g):    %8.1f MB/s (%.1fx)\n",
+            megabytes / newTime, oldTime / newTime);
+    printf("write_csc_text (shortest):   %.3f s\n", shortestTime);
+    printf("%s\n", res ? "Test passed." : "Test failed.");
+    free_csc_members(&matrix);
+    free_csc_members(&parsed);
+    return res;
+}
+
+int test_write_csc_text_mt(uint64_t minSize, uint64_t maxSize) {
+    const char* serialFile = "testWriterSerial.txt";
+    const char* parallelFile = "testWriterParallel.txt";
+    struct cscMatrix matrix = {0};
+    uint64_t diff = maxSize - minSize + 1;
+    matrix.rows = minSize + rand() % diff;
+    matrix.columns = minSize + rand() % diff;
+    errno = 0;
+    generate_csc_matr_rand(&matrix, 10, 3);
+    if (errno) return 0;
+
+    struct timespec start, end;
+    int res = 1;
+    for (int precision = 0; precision <= 6; precision += 6) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        res &= write_csc_text(&matrix, serialFile, precision);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double serialTime = get_time_diff(&start, &end);
+        printf("\ntest_write_csc_text_mt: %lu by %lu matrix, precision %d\n",
+                matrix.rows, matrix.columns, precision);
+        printf("1 thread:  %.3f s\n", serialTime);
+
+        for (unsigned threads = 2; threads <= 8; threads *= 2) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            res &= write_csc_text_mt(&matrix, parallelFile, precision, threads);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double time = get_time_diff(&start, &end);
+            res &= cmp_files(serialFile, parallelFile);
+            printf("%u threads: %.3f s (%.1fx)\n", threads, time,
+                    serialTime / time);
+        }
+    }
+
+    // Arrays shorter than the amount of threads
+    struct cscMatrix empty = {0};
+    uint64_t colPtr[] = {0, 0};
+    generate_csc_matr(&empty, 3, 1, 0, 0, colPtr, 0);
+    res &= write_csc_text(&empty, serialFile, 0)
+        && write_csc_text_mt(&empty, parallelFile, 0, 4)
+        && cmp_files(serialFile, parallelFile);
+
+    remove(serialFile);
+    remove(parallelFile);
+    printf("%s\n", res ? "Test passed." : "Test failed.");
+    free_csc_members(&matrix);
+    return res;
+}
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "cs_matrix.h"
+#include "cscmul.h"
+#include "cscmul_tests.h"
+#include "csc_io.h"
+#include "csc_gen.h"
+#include "matrix_mul.h"
+#include "transpose.h"
+
+int test_cscmul(uint64_t size, double density) {
+    struct cscMatrix a = {0}, a_t = {0}, b = {0}, expected = {0};
+    errno = 0;
+    int res = generate_family(&a, FAMILY_UNIFORM, size, size + 7, density, 5,
+            1) && generate_family(&b, FAMILY_UNIFORM, size + 7, size - 3,
+                density, 6, 1) && transpose_csc(&a, &a_t);
+    if (res) {
+        matr_mult_csc(&a_t, &b, &expected);
+        res = !errno;
+    }
+
+    // Every version with both layouts of A gives the same product
+    for (int version = CSCMUL_AUTO; res && version < 3; version++) {
+        for (int transposed = 0; res && transposed < 2; transposed++) {
+            struct cscmulOptions options = {version, transposed, 0};
+            struct cscmulPlan* plan;
+            struct cscMatrix c;
+            res = cscmul_analyze(0, transposed ? &a_t : &a, &b, &options,
+                    &plan) == CSC_OK && (version == CSCMUL_AUTO
+                    || cscmul_version(plan) == version)
+                && cscmul_execute(0, plan, &c) == CSC_OK;
+            if (res) {
+                res = cmp_csc_eq(&c, &expected);
+                cscmul_free_result(0, &c);
+            }
+            cscmul_destroy(plan);
+        }
+    }
+
+    // Inputs that can not be multiplied are rejected
+    struct cscmulPlan* plan;
+    res = res && cscmul_analyze(0, &a, &a, 0, &plan) == CSC_INVALID_ARGUMENT
+        && !plan;
+    struct cscmulOptions invalid = {3, 0, 0};
+    res = res && cscmul_analyze(0, &a, &b, &invalid, &plan)
+        == CSC_INVALID_ARGUMENT;
+    if (res && b.valueCount > 1 && b.colPtr[1] > 1) {
+        uint64_t row = b.rowIndices[0];
+        b.rowIndices[0] = b.rowIndices[1];
+        res = cscmul_analyze(0, &a, &b, 0, &plan) == CSC_INVALID_ARGUMENT;
+        b.rowIndices[0] = row;
+    }
+
+    // A product with an empty input is empty
+    uint64_t* colPtr = calloc(b.columns + 1, sizeof(uint64_t));
+    struct cscMatrix empty = {b.rows, b.columns, 0, 0, 0, colPtr};
+    struct cscMatrix c = {0};
+    plan = 0;
+    res = res && colPtr && cscmul_analyze(0, &a, &empty, 0, &plan) == CSC_OK
+        && cscmul_execute(0, plan, &c) == CSC_OK && c.rows == size
+        && c.columns == b.columns && !c.valueCount && !c.colPtr[c.columns];
+    cscmul_free_result(0, &c);
+    cscmul_destroy(plan);
+    free(colPtr);
+
+    printf("\ntest_cscmul: %s\n", res ? "Test passed." : "Test failed.");
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    free_csc_members(&expected);
+    return res;
+}
+
+/**
+ * @class countingAllocator
+ *
+ * Allocator of a worker of test_cscmul_threads that counts its live blocks
+ */
+struct countingAllocator {
+    long blocks;
+    long messages;
+};
+
+static void* counting_malloc(size_t size, void* user) {
+    void* p = malloc(size);
+    if (p) ((struct countingAllocator*) user)->blocks++;
+    return p;
+}
+
+static void* counting_realloc(void* p, size_t size, void* user) {
+    void* q = realloc(p, size);
+    if (q && !p) ((struct countingAllocator*) user)->blocks++;
+    return q;
+}
+
+static void counting_free(void* p, void* user) {
+    if (p) ((struct countingAllocator*) user)->blocks--;
+    free(p);
+}
+
+static void count_message(int level, const char* message, void* user) {
+    (void) level;
+    (void) message;
+    ((struct countingAllocator*) user)->messages++;
+}
+
+/**
+ * @class productJob
+ *
+ * A product computed by a worker of test_cscmul_threads
+ */
+struct productJob {
+    const struct cscMatrix* a;
+    const struct cscMatrix* b;
+    const struct cscMatrix* expected;
+    int version;
+    struct countingAllocator counter;
+    int ok;
+};
+
+static void* multiply_job(void* arg) {
+    struct productJob* job = arg;
+    struct cscContext ctx;
+    csc_context_init(&ctx);
+    ctx.logLevel = CSC_LOG_PROGRESS;
+    ctx.log = count_message;
+    ctx.logUser = &job->counter;
+    ctx.allocator.malloc = counting_malloc;
+    ctx.allocator.realloc = counting_realloc;
+    ctx.allocator.free = counting_free;
+    ctx.allocator.user = &job->counter;
+
+    struct cscmulOptions options = {job->version, 0, 0};
+    struct cscmulPlan* plan;
+    struct cscMatrix c;
+    job->ok = 1;
+    for (int i = 0; job->ok && i < 3; i++) {
+        job->ok = cscmul_analyze(&ctx, job->a, job->b, &options, &plan)
+            == CSC_OK && cscmul_execute(&ctx, plan, &c) == CSC_OK;
+        if (job->ok) {
+            job->ok = cmp_csc_eq(&c, (struct cscMatrix*) job->expected);
+            cscmul_free_result(&ctx, &c);
+        }
+        cscmul_destroy(plan);
+    }
+    return 0;
+}
+
+int test_cscmul_threads(unsigned threads) {
+    struct cscMatrix a = {0}, a_t = {0}, b = {0}, expected = {0};
+    struct productJob* jobs = calloc(threads, sizeof(struct productJob));
+    pthread_t* ids = calloc(threads, sizeof(pthread_t));
+    errno = 0;
+    int res = jobs && ids
+        && generate_family(&a, FAMILY_UNIFORM, 150, 130, 0.05, 7, 1)
+        && generate_family(&b, FAMILY_UNIFORM, 130, 140, 0.05, 8, 1)
+        && transpose_csc(&a, &a_t);
+    if (res) {
+        matr_mult_csc(&a_t, &b, &expected);
+        res = !errno;
+    }
+
+    unsigned started = 0;
+    for (; res && started < threads; started++) {
+        jobs[started] = (struct productJob) {&a, &b, &expected,
+            started % 3, {0, 0}, 0};
+        res = !pthread_create(&ids[started], 0, multiply_job, &jobs[started]);
+    }
+    for (unsigned i = 0; i < started; i++) pthread_join(ids[i], 0);
+    // Every product is correct, every context got its own progress messages
+    // and every block of its allocator was freed
+    for (unsigned i = 0; res && i < threads; i++) {
+        res = jobs[i].ok && jobs[i].counter.messages > 0
+            && !jobs[i].counter.blocks;
+    }
+
+    printf("\ntest_cscmul_threads: %s\n", res ? "Test passed."
+            : "Test failed.");
+    free(jobs);
+    free(ids);
+    free_csc_members(&a);
+    free_csc_members(&a_t);
+    free_csc_members(&b);
+    free_csc_members(&expected);
+    return res;
+}
@@ -5,6 +5,7 @@
 
 #include "cs_matrix.h"
 #include "matrix_mul.h"
+#include "csc_io.h"
 #include "matrix_mul_tests.h"
 
 
@@ -394,45 +395,30 @@ int test_random_matrix_generation(uint64_t minSize, uint64_t maxSize) {
     a.columns = minSize + rand() % diff;
     a.rows = minSize + rand() % diff;
 
-    struct cscMatrixTranspose b = {0};
+    struct cscMatrix b = {0};
     b.columns = minSize + rand() % diff;
     b.rows = minSize + rand() % diff;
 
     generate_csc_matr_rand(&a, 10, 3);
-    generateCSCMatrixTRand(&b, 10, 3);
+    generate_csc_matr_rand(&b, 10, 3);
     int resA = is_valid_csc(&a);
     if(resA != 1) {
         printf("test_random_matrix_generation failed: a is not valid\n");
         printCSCMatrixMetadata(&a);
-        free(a.values);
-        free(a.rowIndices);
-        free(a.colPtr);
-        free(b.values);
-        free(b.rowIndices);
-        free(b.colPtr);
-        free(b.colIndices);
+        free_csc_members(&a);
+        free_csc_members(&b);
         return resA;
     }   
-    int resB = is_valid_csc_transpose(&b);
+    int resB = is_valid_csc(&b);
     if(resB != 1) {
         printf("test_random_matrix_generation failed: b is not valid\n");
-        printCSCMatrixMetadataT(&b);
-        free(a.values);
-        free(a.rowIndices);
-        free(a.colPtr);
-        free(b.values);
-        free(b.rowIndices);
-        free(b.colPtr);
-        free(b.colIndices);
+        printCSCMatrixMetadata(&b);
+        free_csc_members(&a);
+        free_csc_members(&b);
         return resB;
     }   
-    free(a.values);
-    free(a.rowIndices);
-    free(a.colPtr);
-    free(b.values);
-    free(b.rowIndices);
-    free(b.colPtr);
-    free(b.colIndices);
+    free_csc_members(&a);
+    free_csc_members(&b);
 
     printf("test_random_matrix_generation passed: both matrices are valid\n");
     return 1;
@@ -8,6 +8,23 @@
 #include "matrix_mul_tests.h"
 #include "csc_io_tests.h"
 #include "transpose_tests.h"
+#include "csc_mmap_tests.h"
+#include "csc_binary_tests.h"
+#include "csc_writer_tests.h"
+#include "csc_stream_tests.h"
+#include "csc_ooc_tests.h"
+#include "csc_ooc.h"
+#include "csc_mtx_tests.h"
+#include "csc_cache_tests.h"
+#include "csc_bench_tests.h"
+#include "csc_gen_tests.h"
+#include "csc_perf_tests.h"
+#include "csc_trace_tests.h"
+#include "csc_model_tests.h"
+#include "cscmul_tests.h"
+#include "csc_pool_tests.h"
+#include "csc_daemon_tests.h"
+#include "csc_batch_tests.h"
 #include "matrix_mul.h"
 
 static void print_runtime(clock_t start, clock_t end) {
@@ -92,7 +109,7 @@ static void test_csc_randomness(int n, int minD, int maxD) {
 int run_tests(){
     srand(time(NULL)); // Set rng seed to current time
 
-    const int count = 22;
+    const int count = 68;
     int passed = 0;
 
     int res[count];
@@ -127,6 +144,52 @@ int run_tests(){
     res[19] = test_random_matrix_generation(10, 300);
     res[20] = test_mul_v2_id();
     res[21] = test_mul_rand_v2(10, 100, 1);
+    res[22] = test_parse_csc_file_mmap_transposed();
+    res[23] = test_scan_float_fixed();
+    res[24] = test_scan_float_rand(100000);
+    res[25] = test_parse_mmap_fixed();
+    res[26] = test_parse_mmap_throughput(1500, 2000);
+    res[27] = test_transpose_csc_fixed();
+    res[28] = test_parse_mmap_threads(200, 400, 3);
+    res[29] = test_parse_mmap_threads(1, 3, 8);
+    res[30] = test_binary_roundtrip(1, 300);
+    res[31] = test_binary_corrupt();
+    res[32] = test_binary_convert();
+    res[33] = test_format_float_fixed();
+    res[34] = test_format_float_rand(100000);
+    res[35] = test_write_csc_text(1500, 2000);
+    res[36] = test_write_csc_text_mt(1500, 2000);
+    res[37] = test_bounded_queue();
+    res[38] = test_mul_stream(1, 60, 1);
+    res[39] = test_mul_stream(10, 80, 7);
+    res[40] = test_mul_stream(5, 20, 100);
+    res[41] = test_mul_ooc(10, 80, CSC_OOC_MIN_BUDGET);
+    res[42] = test_mul_ooc(50, 200, 1 << 16);
+    res[43] = test_mtx_roundtrip(1, 300, 1);
+    res[44] = test_mtx_roundtrip(100, 500, 4);
+    res[45] = test_mtx_variants();
+    res[46] = test_load_csc_files(1);
+    res[47] = test_load_csc_files(3);
+    res[48] = test_csc_cache(0);
+    res[49] = test_csc_cache(1);
+    res[50] = test_summarize_samples();
+    res[51] = test_bench_kernel(10, 100);
+    res[52] = test_generate_family(1000, 800, 0.01);
+    res[53] = test_generate_family(50, 300, 0.3);
+    res[54] = test_generate_rmat(14, 8);
+    res[55] = test_perf_counters(300);
+    res[56] = test_mul_metrics(200);
+    res[57] = test_trace(4);
+    res[58] = test_cost_model(300, 0.02);
+    res[59] = test_cost_model(100, 0.1);
+    res[60] = test_csc_statistics();
+    res[61] = test_cscmul(120, 0.05);
+    res[62] = test_cscmul_threads(6);
+    res[63] = test_csc_pool(4);
+    res[64] = test_csc_pool_kernels(4, 200, 0.1);
+    res[65] = test_csc_daemon(80, 0.1);
+    res[66] = test_csc_batch(60, 0.1, 2);
+    res[67] = test_parse_mmap_pipe();
 
     for (int i = 0; i < count; ++i) {
         passed += (res[i] == 1);
@@ -138,7 +201,6 @@ int run_tests(){
         switch (i) {
             case 9:
             case 17:
-            case 22:
                 printf("Test %d: %s\n", i, res[i] ? "successful execution"
                         : "memory error encountered");
                 break;
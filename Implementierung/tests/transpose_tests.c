@@ -25,11 +25,9 @@ static void printExpr(struct cscMatrix *result, struct cscMatrix *input) {
 }
 
 int test_radixsort_fixed() {
-    struct cscMatrixTranspose A = {0};
     float valuesA[] = {5, 0.5f, 6, 1, 3};
     uint64_t rowIdxsA[] = {0, 2, 1, 1, 3};
     uint64_t colIdxsA[] = {0, 0, 1, 2, 3};
-    uint64_t colPtrA[] = {0, 2, 3, 4, 5};
 
     uint64_t rowIdxsExp[] = {0, 1, 2, 0, 3};
     float valuesExp[] = {5, 6, 1, 0.5f, 3};
@@ -37,7 +35,6 @@ int test_radixsort_fixed() {
 
     int res = 0;
 
-    generateCSCMatrixTranspose(&A, 4, 4, 5, rowIdxsA, colIdxsA, colPtrA, valuesA);
     radixSort(rowIdxsA, valuesA, colIdxsA, 5);
 
     printf("\ntest_radixsort_fixed expected :\n Sorted Rows: \n");
@@ -120,7 +117,7 @@ int test_computeColPtr_fixed() {
 }
 
 int test_transpose_fixed() {
-    struct cscMatrixTranspose matrA = {0};
+    struct cscMatrix matrA = {0};
     struct cscMatrix result = {0};
     struct cscMatrix expected = {0};
 
@@ -132,12 +129,11 @@ int test_transpose_fixed() {
 
     float valuesA[] = {5, 0.5f, 6, 1, 3};
     uint64_t rowIdxsA[] = {0, 2, 1, 1, 3};
-    uint64_t colIdxsA[] = {0, 0, 1, 2, 3};
     uint64_t colPtrA[] = {0, 2, 3, 4, 5};
 
-    generateCSCMatrixTranspose(&matrA, 4, 4, 5, rowIdxsA, colIdxsA, colPtrA, valuesA);
+    generate_csc_matr(&matrA, 4, 4, 5, rowIdxsA, colPtrA, valuesA);
 
-    transpose(&matrA, &result);
+    if (!transpose_csc(&matrA, &result)) return 0;
     printf("\ntest_tranpose_fixed expected:\n");
     printCSCMatrix(&expected, 0);
     printf("Actual was:\n");
@@ -148,11 +144,12 @@ int test_transpose_fixed() {
     } else {
         printf("Transposed Matrix mismatch. Test failed.\n");
     }
+    free_csc_members(&result);
     return res;
 }
 
 int test_transpose_rand_fixed() {
-    struct cscMatrixTranspose a = {0};
+    struct cscMatrix a = {0};
     struct cscMatrix a_t = {0};
     struct cscMatrix exp = {0};
     struct cscMatrix cscMatrix = {0}; // input matrix as cscMatrix
@@ -160,14 +157,13 @@ int test_transpose_rand_fixed() {
     uint64_t rowIsA[] = {2, 3, 0, 3};
     uint64_t colPtrA[] = {0, 2, 2, 4};
     float aVals[] = {81.75, 29.3, 83.96, 19.21};
-    uint64_t colIsA[] = {0, 0, 2, 2};
 
     uint64_t rowIsCSC[] = {2, 3, 0, 3};
     uint64_t colPtrCSC[] = {0, 2, 2, 4};
     float CSCVals[] = {81.75, 29.3, 83.96, 19.21};
 
     generate_csc_matr(&cscMatrix, 4, 3, 4, rowIsCSC, colPtrCSC, CSCVals);
-    generateCSCMatrixTranspose(&a, 4, 3, 4, rowIsA, colIsA, colPtrA, aVals);
+    generate_csc_matr(&a, 4, 3, 4, rowIsA, colPtrA, aVals);
 
     float expVals[] = {83.96, 81.75, 29.3, 19.21};
     uint64_t rowIsExp[] = {2, 0, 0, 2};
@@ -176,7 +172,7 @@ int test_transpose_rand_fixed() {
     generate_csc_matr(&exp, 3, 4, 4, rowIsExp, colPtrExp, expVals);
     printf("\ntest_transpose_rand expected:\n");
     printCSCMatrix(&exp, 0);
-    transpose(&a, &a_t);
+    if (!transpose_csc(&a, &a_t)) return 0;
     printf("\nActual was:\n");
     printCSCMatrix(&a_t, 0);
     printf("\nWolfram Alpha comparison:\n");
@@ -187,6 +183,7 @@ int test_transpose_rand_fixed() {
     } else {
         printf("Transposed Matrix mismatch. Test failed.\n");
     }
+    free_csc_members(&a_t);
     return res;
 }
 
@@ -195,7 +192,7 @@ int test_transpose_rand_fixed() {
  * as the matrices are too large to test by hand
  */
 void test_transpose_rand_fixed_large() {
-    struct cscMatrixTranspose a = {0};
+    struct cscMatrix a = {0};
     struct cscMatrix cscMatrix = {0};
     struct cscMatrix a_t = {0};
 
@@ -208,13 +205,9 @@ void test_transpose_rand_fixed_large() {
                      68.14, 45.3, 69.69, 54.76, 74, 33.31, 49.28, 32.68, 81.29, 76.11,
                      61.45, 89.56, 89.2, 73.4, 87.92, 47.2};
 
-    uint64_t *colIsA = malloc(sizeof(rowIsA) / sizeof(rowIsA[0]) * 
-            sizeof(uint64_t));
-    calculateColumnIndices(colPtrA, 12, colIsA);
-
-    generateCSCMatrixTranspose(&a, 10, 12, 44, rowIsA, colIsA, colPtrA, aVals);
+    generate_csc_matr(&a, 10, 12, 44, rowIsA, colPtrA, aVals);
 
-    transpose(&a, &a_t);
+    if (!transpose_csc(&a, &a_t)) return;
 
     uint64_t rowIsCSC[] = {1, 1, 3, 4, 6, 8, 1, 4, 5, 9, 1, 5, 7, 2, 4, 8, 1, 2, 5, 1, 4, 6, 7, 8, 2, 8, 1,
                            4, 5, 6, 8, 0, 3, 4, 5, 6, 9, 1, 3, 6, 7, 8, 5, 7};
@@ -236,17 +229,46 @@ void test_transpose_rand_fixed_large() {
 
     printExpr(&a_t, &cscMatrix); // for manual testing with wolfram alpha
 
-    free(colIsA);
+    free_csc_members(&a_t);
 }
 
 int test_transpose_rand(uint64_t minSize, uint64_t maxSize) {
-    struct cscMatrixTranspose a = {0};
+    struct cscMatrix a = {0};
     struct cscMatrix res = {0};
     uint64_t diff = maxSize - minSize;
     a.rows = minSize + rand() % diff;
     a.columns = minSize + rand() % diff;
-    generateCSCMatrixTRand(&a, 10, 3);
-    errno = 0;
-    transpose(&a, &res);
-    return !errno;
+    generate_csc_matr_rand(&a, 10, 3);
+    int ok = transpose_csc(&a, &res) && is_valid_csc(&res) == 1;
+    free_csc_members(&a);
+    free_csc_members(&res);
+    return ok;
+}
+
+int test_transpose_csc_fixed() {
+    struct cscMatrix a = {0};
+    struct cscMatrix a_t = {0};
+    struct cscMatrix exp = {0};
+
+    uint64_t rowIsA[] = {2, 3, 0, 3};
+    uint64_t colPtrA[] = {0, 2, 2, 4};
+    float aVals[] = {81.75, 29.3, 83.96, 19.21};
+    generate_csc_matr(&a, 4, 3, 4, rowIsA, colPtrA, aVals);
+
+    float expVals[] = {83.96, 81.75, 29.3, 19.21};
+    uint64_t rowIsExp[] = {2, 0, 0, 2};
+    uint64_t colPtrExp[] = {0, 1, 1, 2, 4};
+    generate_csc_matr(&exp, 3, 4, 4, rowIsExp, colPtrExp, expVals);
+
+    if (!transpose_csc(&a, &a_t)) return 0;
+    printf("\ntest_transpose_csc_fixed expected:\n");
+    printCSCMatrix(&exp, 0);
+    printf("Actual was:\n");
+    printCSCMatrix(&a_t, 0);
+    int res = cmp_csc_eq(&exp, &a_t);
+    printf(res ? "Test passed.\n" : "Transposed Matrix mismatch. Test failed.\n");
+    free(a_t.values);
+    free(a_t.rowIndices);
+    free(a_t.colPtr);
+    return res;
 }